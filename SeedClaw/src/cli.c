@@ -2,9 +2,18 @@
 #include "seedclaw_config.h"
 #include "wifi.h"
 #include "discord.h"
+#include "discord_gateway.h"
+#include "discord_ratelimit.h"
 #include "llm.h"
 #include "gpio_ctrl.h"
 #include "tools.h"
+#include "rules.h"
+#include "summary.h"
+#include "sampler.h"
+#include "gpio_watch.h"
+#include "control_loop.h"
+#include "scheduler.h"
+#include "pipeline.h"
 #include "esp_console.h"
 #include "esp_log.h"
 #include "esp_system.h"
@@ -15,6 +24,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <time.h>
 
 static const char *TAG = "cli";
 
@@ -93,6 +103,38 @@ static int cmd_webhook(int argc, char **argv)
     return 0;
 }
 
+static int cmd_gateway(int argc, char **argv)
+{
+    if (argc != 2 || (strcmp(argv[1], "on") != 0 && strcmp(argv[1], "off") != 0)) {
+        printf("Usage: gateway <on|off>\n");
+        return 1;
+    }
+
+    esp_err_t err = discord_gateway_set_enabled(strcmp(argv[1], "on") == 0);
+    if (err == ESP_OK) {
+        printf("Gateway mode %s. Restart to apply.\n", argv[1]);
+    } else {
+        printf("Failed to save gateway mode: %s\n", esp_err_to_name(err));
+    }
+    return 0;
+}
+
+static int cmd_gateway_url(int argc, char **argv)
+{
+    if (argc != 2) {
+        printf("Usage: gateway_url <wss://...>\n");
+        return 1;
+    }
+
+    esp_err_t err = discord_gateway_set_url(argv[1]);
+    if (err == ESP_OK) {
+        printf("Gateway URL saved. Restart to apply.\n");
+    } else {
+        printf("Failed to save gateway URL: %s\n", esp_err_to_name(err));
+    }
+    return 0;
+}
+
 static int cmd_api_key(int argc, char **argv)
 {
     if (argc != 2) {
@@ -178,19 +220,129 @@ static int cmd_gpio_write(int argc, char **argv)
 
 static int cmd_adc_read(int argc, char **argv)
 {
-    if (argc != 2) {
-        printf("Usage: adc_read <pin>\n");
+    if (argc < 2 || argc - 1 > SEEDCLAW_ADC_MULTI_MAX) {
+        printf("Usage: adc_read <pin> [<pin> ...]\n");
+        return 1;
+    }
+
+    int pins[SEEDCLAW_ADC_MULTI_MAX];
+    adc_result_t results[SEEDCLAW_ADC_MULTI_MAX];
+    int n = argc - 1;
+    int samples = 0;
+    for (int i = 0; i < n; i++) {
+        pins[i] = atoi(argv[i + 1]);
+    }
+    esp_err_t err = gpio_ctrl_adc_read_multi(pins, n, results, &samples);
+    if (err != ESP_OK) {
+        printf("Failed to read ADC: %s\n", esp_err_to_name(err));
+        return 0;
+    }
+    for (int i = 0; i < n; i++) {
+        printf("ADC GPIO%d: raw=%d, voltage=%dmV, %%=%d\n",
+               pins[i], results[i].raw, results[i].voltage_mv, results[i].percentage);
+    }
+    printf("(%s, %d samples averaged)\n", gpio_ctrl_adc_backend(), samples);
+    return 0;
+}
+
+static int cmd_pulse(int argc, char **argv)
+{
+    if (argc < 2) {
+        printf("Usage: pulse <pin> [start [rising|falling|both] [up|down|none] | reset | stop]\n");
+        return 1;
+    }
+    int pin = atoi(argv[1]);
+    esp_err_t err = ESP_OK;
+    if (argc >= 3 && strcmp(argv[2], "start") == 0) {
+        pulse_edge_t edge = PULSE_EDGE_RISING;
+        if (argc >= 4 && strcmp(argv[3], "falling") == 0) {
+            edge = PULSE_EDGE_FALLING;
+        } else if (argc >= 4 && strcmp(argv[3], "both") == 0) {
+            edge = PULSE_EDGE_BOTH;
+        }
+        gpio_ctrl_pull_t pull = GPIO_CTRL_PULL_NONE;
+        if (argc >= 5 && strcmp(argv[4], "up") == 0) {
+            pull = GPIO_CTRL_PULL_UP;
+        } else if (argc >= 5 && strcmp(argv[4], "down") == 0) {
+            pull = GPIO_CTRL_PULL_DOWN;
+        }
+        err = gpio_ctrl_pulse_start(pin, edge, pull, 0);
+    } else if (argc == 3 && strcmp(argv[2], "reset") == 0) {
+        err = gpio_ctrl_pulse_reset(pin);
+    } else if (argc == 3 && strcmp(argv[2], "stop") == 0) {
+        err = gpio_ctrl_pulse_stop(pin);
+        if (err == ESP_OK) {
+            printf("Pulse counter on GPIO%d stopped.\n", pin);
+            return 0;
+        }
+    }
+    if (err != ESP_OK) {
+        printf("Pulse counter error: %s\n", esp_err_to_name(err));
+        return 1;
+    }
+
+    pulse_stats_t ps;
+    if (gpio_ctrl_pulse_read(pin, &ps) != ESP_OK) {
+        printf("GPIO%d is not counting\n", pin);
+        return 1;
+    }
+    printf("GPIO%d: %lu pulses in %lus, avg %.2f/s, last 10s %.2f/s, last 60s %.2f/s\n",
+           pin, (unsigned long)ps.count, (unsigned long)(ps.elapsed_ms / 1000),
+           ps.rate_avg, ps.rate_10s, ps.rate_60s);
+    return 0;
+}
+
+static int cmd_freq(int argc, char **argv)
+{
+    if (argc < 2 || argc > 3) {
+        printf("Usage: freq <pin> [window_ms]\n");
+        return 1;
+    }
+    int pin = atoi(argv[1]);
+    freq_result_t fr;
+    esp_err_t err = gpio_ctrl_freq_measure(pin, argc == 3 ? atoi(argv[2]) : 1000, &fr);
+    if (err != ESP_OK) {
+        printf("Failed to measure GPIO%d: %s\n", pin, esp_err_to_name(err));
+        return 1;
+    }
+    printf("GPIO%d: %.2f Hz (%lu edges in %dms, period %luus)\n",
+           pin, fr.hz, (unsigned long)fr.edges, fr.window_ms, (unsigned long)fr.period_us);
+    return 0;
+}
+
+static int cmd_adc_oversample(int argc, char **argv)
+{
+    if (argc == 2) {
+        if (gpio_ctrl_adc_set_oversample(atoi(argv[1])) != ESP_OK) {
+            printf("Oversample must be 1-%d\n", SEEDCLAW_ADC_OVERSAMPLE_MAX);
+            return 1;
+        }
+    } else if (argc != 1) {
+        printf("Usage: adc_oversample [<samples>]\n");
+        return 1;
+    }
+    printf("ADC: %s backend, %d samples averaged per read\n",
+           gpio_ctrl_adc_backend(), gpio_ctrl_adc_get_oversample());
+    return 0;
+}
+
+static int cmd_pwm_fade(int argc, char **argv)
+{
+    if (argc < 4 || argc > 5) {
+        printf("Usage: pwm_fade <pin> <duty> <ms> [freq]\n");
         return 1;
     }
 
     int pin = atoi(argv[1]);
-    adc_result_t result;
-    esp_err_t err = gpio_ctrl_adc_read(pin, &result);
+    int duty = atoi(argv[2]);
+    int ms = atoi(argv[3]);
+    int freq = (argc == 5) ? atoi(argv[4]) : 0;
+
+    esp_err_t err = gpio_ctrl_pwm_fade(pin, duty, ms, freq);
     if (err == ESP_OK) {
-        printf("ADC GPIO%d: raw=%d, voltage=%dmV, %%=%d\n",
-               pin, result.raw, result.voltage_mv, result.percentage);
+        printf("PWM GPIO%d: fading to %d%% over %dms\n", pin, duty, ms);
     } else {
-        printf("Failed to read ADC on GPIO%d: %s\n", pin, esp_err_to_name(err));
+        printf("Failed to fade PWM on GPIO%d: %s\n", pin, esp_err_to_name(err));
     }
     return 0;
 }
@@ -235,6 +387,16 @@ static int cmd_restart(int argc, char **argv)
     return 0;
 }
 
+static void print_pipeline_stage(const char *name, const pipeline_stage_stats_t *st, int queue_len)
+{
+    printf("  %s: queue %lu/%d, %lu done, %lu rejected, wait last %lums / avg %lums / max %lums, run %lums\n",
+           name, (unsigned long)st->depth, queue_len,
+           (unsigned long)st->processed, (unsigned long)st->rejected,
+           (unsigned long)st->last_wait_ms,
+           (unsigned long)(st->processed ? st->total_wait_ms / st->processed : 0),
+           (unsigned long)st->max_wait_ms, (unsigned long)st->last_run_ms);
+}
+
 static int cmd_status(int argc, char **argv)
 {
     printf("=== SeedClaw System Status ===\n");
@@ -243,11 +405,103 @@ static int cmd_status(int argc, char **argv)
     if (wifi_is_connected()) {
         printf("  IP: %s\n", wifi_get_ip());
     }
-    printf("Monitoring rules: %d/%d\n", rules_count(), SEEDCLAW_MAX_RULES);
+    discord_http_stats_t dstats;
+    discord_get_http_stats(&dstats);
+    printf("Discord HTTP: %lu requests, %lu handshakes (%lu avoided), %lu reconnects\n",
+           (unsigned long)dstats.requests, (unsigned long)dstats.handshakes,
+           (unsigned long)dstats.handshakes_avoided, (unsigned long)dstats.reconnects);
+    discord_rl_route_t routes[SEEDCLAW_DISCORD_RL_MAX_ROUTES];
+    int route_count = discord_ratelimit_snapshot(routes, SEEDCLAW_DISCORD_RL_MAX_ROUTES);
+    for (int i = 0; i < route_count; i++) {
+        printf("  %s: remaining %d/%d, reset in %lums, %lu requests, %lu deferred, %lu 429s\n",
+               routes[i].route, routes[i].remaining, routes[i].limit,
+               (unsigned long)routes[i].reset_in_ms, (unsigned long)routes[i].requests,
+               (unsigned long)routes[i].deferred, (unsigned long)routes[i].hits_429);
+    }
+    discord_outbox_stats_t ostats;
+    discord_get_outbox_stats(&ostats);
+    printf("Webhook outbox: %lu/%d queued, %lu sent (%lu coalesced), %lu retries, %lu 429s, "
+           "%lu dropped (%lu unconfirmed)\n",
+           (unsigned long)ostats.depth, SEEDCLAW_OUTBOX_LEN, (unsigned long)ostats.delivered,
+           (unsigned long)ostats.coalesced, (unsigned long)ostats.retries,
+           (unsigned long)ostats.rate_limited, (unsigned long)ostats.dropped,
+           (unsigned long)ostats.unconfirmed);
+    if (ostats.delivered > 0) {
+        printf("  latency: last %lums / avg %lums / max %lums\n",
+               (unsigned long)ostats.last_latency_ms,
+               (unsigned long)(ostats.total_latency_ms / ostats.delivered),
+               (unsigned long)ostats.max_latency_ms);
+    }
+    if (discord_gateway_is_ready()) {
+        discord_gateway_stats_t gstats;
+        discord_gateway_get_stats(&gstats);
+        printf("Discord Gateway: ready (%lu msgs, %lu heartbeats, %lu resumes, %lu dropped, %lu oversized)\n",
+               (unsigned long)gstats.messages, (unsigned long)gstats.heartbeats,
+               (unsigned long)gstats.resumes, (unsigned long)gstats.dropped,
+               (unsigned long)gstats.oversized);
+    } else {
+        printf("Discord Gateway: not connected (REST polling)\n");
+    }
+    llm_session_stats_t lstats;
+    llm_get_session_stats(&lstats);
+    printf("LLM session: %lu requests, %lu connects, %lu idle evictions\n",
+           (unsigned long)lstats.requests, (unsigned long)lstats.connects,
+           (unsigned long)lstats.evictions);
+    if (lstats.requests > 0) {
+        printf("  last: connect %lums / request %lums, avg: connect %lums / request %lums\n",
+               (unsigned long)lstats.last_connect_ms, (unsigned long)lstats.last_request_ms,
+               (unsigned long)(lstats.connects ? lstats.total_connect_ms / lstats.connects : 0),
+               (unsigned long)(lstats.total_request_ms / lstats.requests));
+    }
+    pipeline_stats_t pstats;
+    pipeline_get_stats(&pstats);
+    printf("Pipeline: worker %s\n", pstats.worker_busy ? "busy" : "idle");
+    print_pipeline_stage("LLM worker", &pstats.work, SEEDCLAW_PIPELINE_WORK_QUEUE_LEN);
+    printf("Fast path: %lu/%lu messages (%lu%%) handled without LLM\n",
+           (unsigned long)pstats.fastpath_hits, (unsigned long)pstats.user_messages,
+           (unsigned long)(pstats.user_messages ?
+                           pstats.fastpath_hits * 100 / pstats.user_messages : 0));
+    llm_usage_stats_t ustats;
+    llm_get_usage_stats(&ustats);
+    if (ustats.requests > 0) {
+        // ヒット率 = キャッシュ読み出し / 入力トークン全体
+        uint64_t prompt_total = ustats.total_input_tokens + ustats.total_cache_write_tokens +
+                                ustats.total_cache_read_tokens;
+        printf("LLM tokens: %llu in, %llu out, cache %llu written / %llu read (hit ratio %lu%%)\n",
+               (unsigned long long)ustats.total_input_tokens,
+               (unsigned long long)ustats.total_output_tokens,
+               (unsigned long long)ustats.total_cache_write_tokens,
+               (unsigned long long)ustats.total_cache_read_tokens,
+               (unsigned long)(prompt_total ? ustats.total_cache_read_tokens * 100 / prompt_total : 0));
+    }
+    tools_history_usage_t hist;
+    tools_get_history_usage(&hist);
+    printf("History: %d records, %u/%u bytes, last request %d records (~%u/%u tokens)\n",
+           hist.records, (unsigned)hist.bytes_used, (unsigned)hist.arena_size,
+           hist.last_sent_records, (unsigned)hist.last_sent_tokens,
+           (unsigned)SEEDCLAW_HISTORY_TOKEN_BUDGET);
+    rules_stats_t rstats;
+    rules_get_stats(&rstats);
+    printf("Monitoring rules: %d/%d (%d via LLM), %lu local evals, %lu local reports, "
+           "%lu compiled / %lu not compilable\n",
+           rules_count(), SEEDCLAW_MAX_RULES, rules_llm_count(),
+           (unsigned long)rstats.local_evals, (unsigned long)rstats.local_fires,
+           (unsigned long)rstats.compiles, (unsigned long)rstats.compile_failures);
+    gpio_watch_stats_t wstats;
+    gpio_watch_get_stats(&wstats);
+    if (wstats.isr_edges > 0) {
+        printf("GPIO watch: %lu edges, %lu notified, %lu bounces filtered, %lu dropped, "
+               "latency last %lums / max %lums\n",
+               (unsigned long)wstats.isr_edges, (unsigned long)wstats.notified,
+               (unsigned long)wstats.bounces, (unsigned long)wstats.ring_dropped,
+               (unsigned long)(wstats.last_latency_us / 1000),
+               (unsigned long)(wstats.max_latency_us / 1000));
+    }
     int interval = auto_interval_get();
     if (interval > 0) {
-        printf("Auto check: every %d polls (~%ds)\n",
-               interval, (interval * SEEDCLAW_POLL_INTERVAL_MS) / 1000);
+        printf("Auto check: every %d polls (~%ds), LLM checks %lu executed / %lu skipped (no change)\n",
+               interval, (interval * SEEDCLAW_POLL_INTERVAL_MS) / 1000,
+               (unsigned long)rstats.gate_executed, (unsigned long)rstats.gate_skipped);
     } else {
         printf("Auto check: disabled\n");
     }
@@ -317,6 +571,246 @@ static int cmd_auto_off(int argc, char **argv)
     return 0;
 }
 
+static int cmd_deadband(int argc, char **argv)
+{
+    if (argc == 3) {
+        int pin = atoi(argv[1]);
+        if (rules_set_deadband(pin, atoi(argv[2])) != ESP_OK) {
+            printf("Invalid pin or deadband (ADC pins 2-4, 0-3300 mV)\n");
+            return 1;
+        }
+    } else if (argc != 1) {
+        printf("Usage: deadband [<pin> <mV>]\n");
+        return 1;
+    }
+    for (int pin = 0; pin < 22; pin++) {
+        int mv = rules_get_deadband(pin);
+        if (mv >= 0) {
+            printf("  GPIO%d: %d mV\n", pin, mv);
+        }
+    }
+    return 0;
+}
+
+static int cmd_sample(int argc, char **argv)
+{
+    if (argc == 3 && strcmp(argv[1], "off") == 0) {
+        if (sampler_remove(atoi(argv[2])) != ESP_OK) {
+            printf("GPIO%s is not being sampled\n", argv[2]);
+            return 1;
+        }
+        printf("Sampling stopped.\n");
+        return 0;
+    } else if (argc == 4) {
+        int pin = atoi(argv[1]);
+        sampler_kind_t kind;
+        if (strcmp(argv[2], "adc") == 0) {
+            kind = SAMPLER_ADC_MV;
+        } else if (strcmp(argv[2], "gpio") == 0) {
+            kind = SAMPLER_DIGITAL;
+        } else {
+            printf("Kind must be 'adc' or 'gpio'\n");
+            return 1;
+        }
+        esp_err_t err = sampler_configure(pin, kind, atoi(argv[3]));
+        if (err == ESP_ERR_NO_MEM) {
+            printf("All %d sampler channels are in use\n", SEEDCLAW_SAMPLER_MAX_CHANNELS);
+            return 1;
+        } else if (err != ESP_OK) {
+            printf("Invalid pin or period (adc: GPIO 2-4, period >= 1s)\n");
+            return 1;
+        }
+    } else if (argc != 1) {
+        printf("Usage: sample [<pin> <adc|gpio> <period_s> | off <pin>]\n");
+        return 1;
+    }
+
+    sampler_channel_info_t info[SEEDCLAW_SAMPLER_MAX_CHANNELS];
+    int n = sampler_list(info, SEEDCLAW_SAMPLER_MAX_CHANNELS);
+    if (n == 0) {
+        printf("No pins are being sampled.\n");
+    }
+    for (int i = 0; i < n; i++) {
+        printf("  GPIO%d: %s every %ds, %lu samples in %lu/%d bytes (%lu total, %lu missed)\n",
+               info[i].pin, info[i].kind == SAMPLER_ADC_MV ? "adc" : "gpio",
+               info[i].period_s, (unsigned long)info[i].stored,
+               (unsigned long)info[i].bytes_used, SEEDCLAW_SAMPLER_RING_BYTES,
+               (unsigned long)info[i].total, (unsigned long)info[i].missed);
+    }
+    return 0;
+}
+
+static int cmd_loop(int argc, char **argv)
+{
+    if (argc == 3 && strcmp(argv[1], "off") == 0) {
+        if (control_loop_remove(atoi(argv[2])) != ESP_OK) {
+            printf("No loop on GPIO%s\n", argv[2]);
+            return 1;
+        }
+        printf("Loop removed, output off.\n");
+        return 0;
+    } else if (argc >= 5) {
+        loop_config_t cfg;
+        control_loop_defaults(&cfg);
+        cfg.out_pin = atoi(argv[1]);
+        cfg.in_pin = atoi(argv[2]);
+        cfg.setpoint_mv = atoi(argv[4]);
+        if (strcmp(argv[3], "pid") == 0 && argc >= 8) {
+            cfg.mode = LOOP_PID;
+            cfg.kp = strtof(argv[5], NULL);
+            cfg.ki = strtof(argv[6], NULL);
+            cfg.kd = strtof(argv[7], NULL);
+        } else if (strcmp(argv[3], "hyst") == 0 && argc >= 6) {
+            cfg.mode = LOOP_HYSTERESIS;
+            cfg.band_mv = atoi(argv[5]);
+            if (argc >= 7 && strcmp(argv[6], "gpio") == 0) {
+                cfg.output = LOOP_OUT_GPIO;
+            }
+        } else {
+            printf("Usage: loop <out> <in> pid <sp_mv> <kp> <ki> <kd> | loop <out> <in> hyst <sp_mv> <band_mv> [gpio]\n");
+            return 1;
+        }
+        esp_err_t err = control_loop_set(&cfg);
+        if (err == ESP_ERR_NO_MEM) {
+            printf("All %d loops are in use\n", SEEDCLAW_LOOP_MAX);
+            return 1;
+        } else if (err == ESP_ERR_INVALID_STATE) {
+            printf("GPIO%d is watched (watch off %d first)\n", cfg.out_pin, cfg.out_pin);
+            return 1;
+        } else if (err != ESP_OK) {
+            printf("Invalid loop (input: ADC GPIO 2-4, output: allowed GPIO)\n");
+            return 1;
+        }
+    } else if (argc != 1) {
+        printf("Usage: loop [<out> <in> pid <sp_mv> <kp> <ki> <kd> | <out> <in> hyst <sp_mv> <band_mv> [gpio] | off <out>]\n");
+        return 1;
+    }
+
+    loop_status_t st[SEEDCLAW_LOOP_MAX];
+    int n = control_loop_list(st, SEEDCLAW_LOOP_MAX);
+    if (n == 0) {
+        printf("No control loops.\n");
+    }
+    for (int i = 0; i < n; i++) {
+        const loop_config_t *c = &st[i].cfg;
+        printf("  GPIO%d <- GPIO%d: %s sp=%dmV pv=%dmV out=%d%s every %dms (%lu runs)%s\n",
+               c->out_pin, c->in_pin, c->mode == LOOP_PID ? "pid" : "hyst",
+               c->setpoint_mv, st[i].pv_mv, st[i].output,
+               c->output == LOOP_OUT_PWM ? "%" : "", c->period_ms,
+               (unsigned long)st[i].iterations, st[i].fault ? " FAULT" : "");
+    }
+    return 0;
+}
+
+static int cmd_schedule(int argc, char **argv)
+{
+    if (argc == 3 && strcmp(argv[1], "rm") == 0) {
+        if (scheduler_remove(atoi(argv[2])) != ESP_OK) {
+            printf("No job #%s\n", argv[2]);
+            return 1;
+        }
+        printf("Job removed.\n");
+        return 0;
+    } else if (argc != 1) {
+        printf("Usage: schedule [rm <id>]\n");
+        return 1;
+    }
+
+    char when[24];
+    if (scheduler_time_synced()) {
+        time_t now = time(NULL);
+        strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", localtime(&now));
+        printf("Clock: %s (%s)\n", when, SEEDCLAW_TIMEZONE);
+    } else {
+        printf("Clock: not synced yet (SNTP %s)\n", SEEDCLAW_SNTP_SERVER);
+    }
+
+    sched_info_t *jobs = malloc(sizeof(sched_info_t) * SEEDCLAW_SCHED_MAX_JOBS);
+    if (jobs == NULL) {
+        return 1;
+    }
+    int n = scheduler_list(jobs, SEEDCLAW_SCHED_MAX_JOBS);
+    if (n == 0) {
+        printf("No scheduled jobs.\n");
+    }
+    for (int i = 0; i < n; i++) {
+        const sched_info_t *j = &jobs[i];
+        printf("  #%d %s%s%s: %s %s", j->id, j->job.label,
+               j->job.label[0] ? " " : "", j->job.kind == SCHED_CRON ? j->job.cron : "once",
+               j->job.tool, j->job.input);
+        if (j->job.duration_s > 0) {
+            printf(" for %lus", (unsigned long)j->job.duration_s);
+        }
+        if (j->next_run > 0) {
+            time_t t = (time_t)j->next_run;
+            strftime(when, sizeof(when), "%Y-%m-%d %H:%M", localtime(&t));
+            printf(", next %s", when);
+        }
+        printf(" (%lu runs)%s\n", (unsigned long)j->runs, j->last_ok ? "" : " LAST FAILED");
+    }
+    free(jobs);
+    return 0;
+}
+
+static int cmd_watch(int argc, char **argv)
+{
+    if (argc == 3 && strcmp(argv[1], "off") == 0) {
+        if (gpio_watch_remove(atoi(argv[2])) != ESP_OK) {
+            printf("GPIO%s is not being watched\n", argv[2]);
+            return 1;
+        }
+        printf("Watch removed.\n");
+        return 0;
+    } else if (argc >= 3 && argc <= 5) {
+        watch_edge_t edge;
+        if (strcmp(argv[2], "rising") == 0) {
+            edge = WATCH_EDGE_RISING;
+        } else if (strcmp(argv[2], "falling") == 0) {
+            edge = WATCH_EDGE_FALLING;
+        } else if (strcmp(argv[2], "both") == 0) {
+            edge = WATCH_EDGE_BOTH;
+        } else {
+            printf("Edge must be rising, falling or both\n");
+            return 1;
+        }
+        gpio_ctrl_pull_t pull = GPIO_CTRL_PULL_NONE;
+        if (argc >= 4 && strcmp(argv[3], "up") == 0) {
+            pull = GPIO_CTRL_PULL_UP;
+        } else if (argc >= 4 && strcmp(argv[3], "down") == 0) {
+            pull = GPIO_CTRL_PULL_DOWN;
+        }
+        esp_err_t err = gpio_watch_add(atoi(argv[1]), edge, pull, argc == 5 ? argv[4] : NULL);
+        if (err == ESP_ERR_NO_MEM) {
+            printf("All %d watch slots are in use\n", SEEDCLAW_WATCH_MAX_PINS);
+            return 1;
+        } else if (err == ESP_ERR_INVALID_STATE) {
+            printf("GPIO%s is an output or used by a pulse counter\n", argv[1]);
+            return 1;
+        } else if (err != ESP_OK) {
+            printf("Invalid pin\n");
+            return 1;
+        }
+    } else if (argc != 1) {
+        printf("Usage: watch [<pin> <rising|falling|both> [up|down|none] [label] | off <pin>]\n");
+        return 1;
+    }
+
+    static const char *const edge_names[] = { "", "rising", "falling", "both" };
+    static const char *const pull_names[] = { "none", "up", "down" };
+    gpio_watch_info_t info[SEEDCLAW_WATCH_MAX_PINS];
+    int n = gpio_watch_list(info, SEEDCLAW_WATCH_MAX_PINS);
+    if (n == 0) {
+        printf("No pins are being watched.\n");
+    }
+    for (int i = 0; i < n; i++) {
+        printf("  GPIO%d: %s, pull %s, level %d, %lu events%s%s\n",
+               info[i].pin, edge_names[info[i].edge], pull_names[info[i].pull],
+               info[i].level, (unsigned long)info[i].events,
+               info[i].label[0] ? ", label " : "", info[i].label);
+    }
+    return 0;
+}
+
 static int cmd_prompt(int argc, char **argv)
 {
     if (argc < 2) {
@@ -338,6 +832,24 @@ static int cmd_prompt(int argc, char **argv)
     return 0;
 }
 
+static int cmd_memory(int argc, char **argv)
+{
+    if (argc == 2 && strcmp(argv[1], "clear") == 0) {
+        esp_err_t err = summary_clear();
+        if (err == ESP_OK) {
+            printf("Conversation summary cleared.\n");
+        } else {
+            printf("Failed to clear summary: %s\n", esp_err_to_name(err));
+        }
+        return 0;
+    }
+    const char *summary = summary_get();
+    printf("=== Conversation Summary (%d bytes%s) ===\n",
+           (int)strlen(summary), summary_pending() ? ", compaction pending" : "");
+    printf("%s\n", summary[0] ? summary : "(none)");
+    return 0;
+}
+
 // ===== コマンド登録ヘルパー =====
 
 static void register_cmd(const char *command, esp_console_cmd_func_t func,
@@ -379,13 +891,19 @@ static void cli_task(void *arg)
     register_cmd("discord_token", cmd_discord_token, "Set Discord bot token", "discord_token <token>");
     register_cmd("discord_channel", cmd_discord_channel, "Set Discord channel ID", "discord_channel <id>");
     register_cmd("webhook", cmd_webhook, "Set webhook URL", "webhook <url>");
+    register_cmd("gateway", cmd_gateway, "Enable/disable Discord Gateway mode", "gateway <on|off>");
+    register_cmd("gateway_url", cmd_gateway_url, "Set Discord Gateway URL", "gateway_url <url>");
     register_cmd("api_key", cmd_api_key, "Set LLM API key", "api_key <key>");
     register_cmd("provider", cmd_provider, "Set LLM provider", "provider <anthropic|openai>");
     register_cmd("model", cmd_model, "Set LLM model", "model <model_name>");
     register_cmd("gpio_read", cmd_gpio_read, "Read GPIO pin", "gpio_read <pin>");
     register_cmd("gpio_write", cmd_gpio_write, "Write GPIO pin", "gpio_write <pin> <0|1>");
-    register_cmd("adc_read", cmd_adc_read, "Read ADC value", "adc_read <pin>");
+    register_cmd("adc_read", cmd_adc_read, "Read ADC value(s)", "adc_read <pin> [<pin> ...]");
+    register_cmd("pulse", cmd_pulse, "Start/read/reset/stop a pulse counter", "pulse <pin> [start [rising|falling|both] [up|down|none] | reset | stop]");
+    register_cmd("freq", cmd_freq, "Measure signal frequency", "freq <pin> [window_ms]");
+    register_cmd("adc_oversample", cmd_adc_oversample, "Show/set ADC oversampling", "adc_oversample [<samples>]");
     register_cmd("pwm_set", cmd_pwm_set, "Set PWM output", "pwm_set <pin> <duty> [freq]");
+    register_cmd("pwm_fade", cmd_pwm_fade, "Fade PWM duty in hardware", "pwm_fade <pin> <duty> <ms> [freq]");
     register_cmd("gpio_status", cmd_gpio_status, "Show GPIO status", NULL);
     register_cmd("status", cmd_status, "Show system status", NULL);
     register_cmd("restart", cmd_restart, "Restart ESP32", NULL);
@@ -393,8 +911,14 @@ static void cli_task(void *arg)
     register_cmd("rule_list", cmd_rule_list, "List monitoring rules", NULL);
     register_cmd("rule_clear", cmd_rule_clear, "Clear all rules", NULL);
     register_cmd("auto_interval", cmd_auto_interval, "Set auto-check interval", "auto_interval <count>");
+    register_cmd("deadband", cmd_deadband, "Show/set ADC change-detection deadband", "deadband [<pin> <mV>]");
+    register_cmd("sample", cmd_sample, "Show/configure background sensor sampling", "sample [<pin> <adc|gpio> <period_s> | off <pin>]");
+    register_cmd("loop", cmd_loop, "Show/configure local control loops", "loop [<out> <in> pid <sp_mv> <kp> <ki> <kd> | <out> <in> hyst <sp_mv> <band_mv> [gpio] | off <out>]");
+    register_cmd("schedule", cmd_schedule, "Show/remove scheduled jobs", "schedule [rm <id>]");
+    register_cmd("watch", cmd_watch, "Show/configure GPIO edge notifications", "watch [<pin> <rising|falling|both> [up|down|none] [label] | off <pin>]");
     register_cmd("auto_off", cmd_auto_off, "Disable auto monitoring", NULL);
     register_cmd("prompt", cmd_prompt, "Set system prompt", "prompt <text>");
+    register_cmd("memory", cmd_memory, "Show or clear conversation summary", "memory [clear]");
 
     // help コマンドは esp_console が自動登録
     esp_console_register_help_command();
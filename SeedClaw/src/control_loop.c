@@ -0,0 +1,389 @@
+#include "control_loop.h"
+#include "gpio_ctrl.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs_flash.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <math.h>
+#include <string.h>
+
+static const char *TAG = "control";
+
+typedef struct {
+    loop_config_t cfg;       // out_pin == 0 なら未使用
+    int64_t next_us;         // 次の実行時刻
+    int64_t last_us;         // 前回入力を読めた時刻 (0 = まだ)
+    int pv_mv;
+    int error_mv;
+    float integral;
+    int written;             // 最後に書いた出力 (-1 = まだ書いていない)
+    bool on;                 // ヒステリシスの状態
+    uint8_t bad_reads;       // 連続の読み取り失敗
+    bool fault;
+    uint32_t iterations;
+    uint32_t read_errors;
+} loop_t;
+
+static loop_t s_loops[SEEDCLAW_LOOP_MAX];
+static SemaphoreHandle_t s_loop_mutex = NULL;
+
+static void lock(void)
+{
+    xSemaphoreTake(s_loop_mutex, portMAX_DELAY);
+}
+
+static void unlock(void)
+{
+    xSemaphoreGive(s_loop_mutex);
+}
+
+static float clampf(float v, float lo, float hi)
+{
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+// ── NVS ──
+
+static void save_config(void)
+{
+    loop_config_t cfg[SEEDCLAW_LOOP_MAX];
+    for (int i = 0; i < SEEDCLAW_LOOP_MAX; i++) {
+        cfg[i] = s_loops[i].cfg;
+    }
+
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(SEEDCLAW_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK) {
+        return;
+    }
+    err = nvs_set_blob(nvs_handle, "ctrl_loops", cfg, sizeof(cfg));
+    if (err == ESP_OK) {
+        nvs_commit(nvs_handle);
+    }
+    nvs_close(nvs_handle);
+}
+
+static int load_config(loop_config_t *cfg)
+{
+    size_t len = sizeof(loop_config_t) * SEEDCLAW_LOOP_MAX;
+    nvs_handle_t nvs_handle;
+    if (nvs_open(SEEDCLAW_NVS_NAMESPACE, NVS_READONLY, &nvs_handle) != ESP_OK) {
+        return 0;
+    }
+    esp_err_t err = nvs_get_blob(nvs_handle, "ctrl_loops", cfg, &len);
+    nvs_close(nvs_handle);
+    if (err != ESP_OK || len != sizeof(loop_config_t) * SEEDCLAW_LOOP_MAX) {
+        return 0;
+    }
+    return SEEDCLAW_LOOP_MAX;
+}
+
+static bool config_valid(const loop_config_t *c)
+{
+    if (!gpio_is_pin_allowed(c->out_pin) || !gpio_is_adc_allowed(c->in_pin) ||
+        c->out_pin == c->in_pin) {
+        return false;
+    }
+    if (c->mode != LOOP_PID && c->mode != LOOP_HYSTERESIS) {
+        return false;
+    }
+    if (c->output != LOOP_OUT_PWM && c->output != LOOP_OUT_GPIO) {
+        return false;
+    }
+    // PIDの連続出力はGPIOでは表せない
+    if (c->mode == LOOP_PID && c->output != LOOP_OUT_PWM) {
+        return false;
+    }
+    if (c->period_ms < SEEDCLAW_LOOP_MIN_PERIOD_MS || c->period_ms > SEEDCLAW_LOOP_MAX_PERIOD_MS) {
+        return false;
+    }
+    if (c->out_min < 0 || c->out_max > 100 || c->out_min >= c->out_max) {
+        return false;
+    }
+    if (c->band_mv < 0 || c->setpoint_mv < 0 || c->pwm_freq <= 0) {
+        return false;
+    }
+    return isfinite(c->kp) && isfinite(c->ki) && isfinite(c->kd);
+}
+
+// ── 制御 ──
+
+static void write_output(loop_t *l, int value)
+{
+    if (value == l->written) {
+        return;
+    }
+    esp_err_t err;
+    if (l->cfg.output == LOOP_OUT_PWM) {
+        err = gpio_ctrl_pwm_set(l->cfg.out_pin, value, l->cfg.pwm_freq);
+    } else {
+        err = gpio_ctrl_write(l->cfg.out_pin, value);
+    }
+    if (err == ESP_OK) {
+        l->written = value;
+    }
+}
+
+static void loop_step(loop_t *l, int64_t now)
+{
+    const loop_config_t *c = &l->cfg;
+    l->iterations++;
+
+    adc_result_t adc;
+    if (gpio_ctrl_adc_read(c->in_pin, &adc) != ESP_OK) {
+        l->read_errors++;
+        if (++l->bad_reads >= SEEDCLAW_LOOP_FAULT_READS && !l->fault) {
+            // 入力が読めないまま出し続けないよう止める（PWMも out_min ではなく 0%）
+            ESP_LOGW(TAG, "Loop GPIO%d: input GPIO%d unreadable, output off", c->out_pin, c->in_pin);
+            l->fault = true;
+            l->integral = 0;
+            write_output(l, 0);
+        }
+        return;
+    }
+    if (l->fault) {
+        ESP_LOGI(TAG, "Loop GPIO%d: input recovered", c->out_pin);
+        l->fault = false;
+        l->last_us = 0;
+    }
+    l->bad_reads = 0;
+
+    int pv = adc.voltage_mv;
+    int error = c->reverse ? pv - c->setpoint_mv : c->setpoint_mv - pv;
+
+    if (c->mode == LOOP_HYSTERESIS) {
+        if (error > c->band_mv / 2) {
+            l->on = true;
+        } else if (error < -(c->band_mv / 2)) {
+            l->on = false;
+        }
+        int value = c->output == LOOP_OUT_PWM ? (l->on ? c->out_max : c->out_min) : (l->on ? 1 : 0);
+        write_output(l, value);
+    } else {
+        float lo = (float)c->out_min;
+        float hi = (float)c->out_max;
+        float dt = l->last_us > 0 ? (float)(now - l->last_us) / 1e6f : (float)c->period_ms / 1000.0f;
+
+        // 微分は入力側で取る（目標値変更で出力が跳ねない）
+        float d = 0.0f;
+        if (l->last_us > 0 && dt > 0.0f) {
+            float dpv = (float)(pv - l->pv_mv) / dt;
+            d = -c->kd * (c->reverse ? -dpv : dpv);
+        }
+        float p = c->kp * (float)error;
+        float integral = l->integral + c->ki * (float)error * dt;
+        float u = p + integral + d;
+
+        // アンチワインドアップ: 飽和している方向へは積分しない
+        if (!((u > hi && error > 0) || (u < lo && error < 0))) {
+            l->integral = clampf(integral, lo - hi, hi);
+        }
+        u = clampf(p + l->integral + d, lo, hi);
+        write_output(l, (int)lroundf(u));
+    }
+
+    l->pv_mv = pv;
+    l->error_mv = error;
+    l->last_us = now;
+}
+
+static void control_task(void *arg)
+{
+    TickType_t last_wake = xTaskGetTickCount();
+
+    while (1) {
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(SEEDCLAW_LOOP_TICK_MS));
+
+        lock();
+        int64_t now = esp_timer_get_time();
+        for (int i = 0; i < SEEDCLAW_LOOP_MAX; i++) {
+            loop_t *l = &s_loops[i];
+            if (l->cfg.out_pin == 0 || now < l->next_us) {
+                continue;
+            }
+            l->next_us += (int64_t)l->cfg.period_ms * 1000;
+            if (l->next_us <= now) {
+                // 大きく遅れたら追いつこうとせず今から数え直す
+                l->next_us = now + (int64_t)l->cfg.period_ms * 1000;
+            }
+            loop_step(l, now);
+        }
+        unlock();
+    }
+}
+
+static void reset_state(loop_t *l)
+{
+    l->next_us = esp_timer_get_time();
+    l->last_us = 0;
+    l->pv_mv = 0;
+    l->error_mv = 0;
+    l->integral = 0;
+    l->written = -1;
+    l->on = false;
+    l->bad_reads = 0;
+    l->fault = false;
+    l->iterations = 0;
+    l->read_errors = 0;
+}
+
+static loop_t *find_loop(int out_pin)
+{
+    for (int i = 0; i < SEEDCLAW_LOOP_MAX; i++) {
+        if (out_pin != 0 && s_loops[i].cfg.out_pin == out_pin) {
+            return &s_loops[i];
+        }
+    }
+    return NULL;
+}
+
+// ── 公開API ──
+
+void control_loop_defaults(loop_config_t *cfg)
+{
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->mode = LOOP_HYSTERESIS;
+    cfg->output = LOOP_OUT_PWM;
+    cfg->out_min = 0;
+    cfg->out_max = 100;
+    cfg->period_ms = SEEDCLAW_LOOP_DEFAULT_PERIOD_MS;
+    cfg->pwm_freq = 1000;
+}
+
+esp_err_t control_loop_start(void)
+{
+    s_loop_mutex = xSemaphoreCreateMutex();
+    if (s_loop_mutex == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    memset(s_loops, 0, sizeof(s_loops));
+    loop_config_t cfg[SEEDCLAW_LOOP_MAX];
+    int n = load_config(cfg);
+    int active = 0;
+    for (int i = 0; i < n; i++) {
+        if (cfg[i].out_pin != 0 && config_valid(&cfg[i])) {
+            s_loops[i].cfg = cfg[i];
+            reset_state(&s_loops[i]);
+            active++;
+        }
+    }
+
+    if (xTaskCreate(control_task, "control", SEEDCLAW_LOOP_TASK_STACK, NULL,
+                    SEEDCLAW_LOOP_TASK_PRIO, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create control task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Control loops started (%d loop(s))", active);
+    return ESP_OK;
+}
+
+esp_err_t control_loop_set(const loop_config_t *cfg)
+{
+    if (!config_valid(cfg)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // gpio_watch が監視中のピンは出力にできない（書くたびに失敗する）
+    if (gpio_ctrl_is_watched(cfg->out_pin)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    lock();
+    // 他のループの入力を出力に使ったり、その逆をしたりしない
+    for (int i = 0; i < SEEDCLAW_LOOP_MAX; i++) {
+        const loop_config_t *o = &s_loops[i].cfg;
+        if (o->out_pin == 0 || o->out_pin == cfg->out_pin) {
+            continue;
+        }
+        if (o->out_pin == cfg->in_pin || o->in_pin == cfg->out_pin) {
+            unlock();
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    loop_t *l = find_loop(cfg->out_pin);
+    if (l == NULL) {
+        for (int i = 0; i < SEEDCLAW_LOOP_MAX; i++) {
+            if (s_loops[i].cfg.out_pin == 0) {
+                l = &s_loops[i];
+                break;
+            }
+        }
+        if (l == NULL) {
+            unlock();
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    l->cfg = *cfg;
+    reset_state(l);
+    save_config();
+    unlock();
+
+    if (cfg->mode == LOOP_PID) {
+        ESP_LOGI(TAG, "Loop GPIO%d <- GPIO%d: PID sp=%dmV kp=%.3f ki=%.3f kd=%.3f every %dms",
+                 cfg->out_pin, cfg->in_pin, cfg->setpoint_mv, cfg->kp, cfg->ki, cfg->kd, cfg->period_ms);
+    } else {
+        ESP_LOGI(TAG, "Loop GPIO%d <- GPIO%d: hysteresis sp=%dmV band=%dmV every %dms",
+                 cfg->out_pin, cfg->in_pin, cfg->setpoint_mv, cfg->band_mv, cfg->period_ms);
+    }
+    return ESP_OK;
+}
+
+esp_err_t control_loop_remove(int out_pin)
+{
+    lock();
+    loop_t *l = find_loop(out_pin);
+    if (l == NULL) {
+        unlock();
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (l->cfg.output == LOOP_OUT_PWM) {
+        gpio_ctrl_pwm_set(out_pin, 0, l->cfg.pwm_freq);
+    } else {
+        gpio_ctrl_write(out_pin, 0);
+    }
+    memset(l, 0, sizeof(*l));
+    save_config();
+    unlock();
+
+    ESP_LOGI(TAG, "Loop GPIO%d removed", out_pin);
+    return ESP_OK;
+}
+
+bool control_loop_owns(int pin)
+{
+    lock();
+    bool owned = find_loop(pin) != NULL;
+    unlock();
+    return owned;
+}
+
+int control_loop_list(loop_status_t *out, int max)
+{
+    int n = 0;
+    lock();
+    int64_t now = esp_timer_get_time();
+    for (int i = 0; i < SEEDCLAW_LOOP_MAX && n < max; i++) {
+        const loop_t *l = &s_loops[i];
+        if (l->cfg.out_pin == 0) {
+            continue;
+        }
+        out[n].cfg = l->cfg;
+        out[n].pv_mv = l->pv_mv;
+        out[n].error_mv = l->error_mv;
+        out[n].output = l->written < 0 ? 0 : l->written;
+        out[n].integral = l->integral;
+        out[n].iterations = l->iterations;
+        out[n].read_errors = l->read_errors;
+        out[n].age_ms = l->last_us > 0 ? (uint32_t)((now - l->last_us) / 1000) : 0;
+        out[n].fault = l->fault;
+        n++;
+    }
+    unlock();
+    return n;
+}
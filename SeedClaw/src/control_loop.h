@@ -0,0 +1,86 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include "seedclaw_config.h"
+#include <stdint.h>
+
+/*
+ * ローカル制御ループ
+ *
+ * ADC入力とPWM/GPIO出力を結ぶ PID またはヒステリシス（バンバン）制御を
+ * 専用タスクで一定周期ごとに回す。LLM はツールで設定と状態確認をするだけで、
+ * ループの中には入らない。ループは出力ピンごとに1つ。
+ */
+
+typedef enum {
+    LOOP_PID,                // 比例・積分・微分（出力はPWMのみ）
+    LOOP_HYSTERESIS,         // 目標値 ± band/2 でON/OFF
+} loop_mode_t;
+
+typedef enum {
+    LOOP_OUT_PWM,            // デューティ out_min〜out_max (%)
+    LOOP_OUT_GPIO,           // ON=HIGH / OFF=LOW
+} loop_output_t;
+
+typedef struct {
+    int out_pin;
+    int in_pin;              // ADCピン (GPIO 2-4)
+    loop_mode_t mode;
+    loop_output_t output;
+    bool reverse;            // true: 出力を上げると入力が下がる（冷却など）
+    int setpoint_mv;
+    int band_mv;             // ヒステリシス幅 (mV)
+    float kp;                // %/mV
+    float ki;                // %/(mV·s)
+    float kd;                // %·s/mV
+    int out_min;             // PWM出力の下限 (%)
+    int out_max;             // PWM出力の上限 (%)
+    int period_ms;           // 制御周期
+    int pwm_freq;            // PWM周波数 (Hz)
+} loop_config_t;
+
+typedef struct {
+    loop_config_t cfg;
+    int pv_mv;               // 最新の入力値
+    int error_mv;            // 目標値との差（正 = 出力を上げる方向）
+    int output;              // 現在の出力 (% または 0/1)
+    float integral;          // PIDの積分項 (%)
+    uint32_t iterations;
+    uint32_t read_errors;
+    uint32_t age_ms;         // 最後に入力を読めてからの経過時間
+    bool fault;              // 入力が連続で読めず出力を止めた（PWMも 0%）
+} loop_status_t;
+
+/**
+ * @brief NVSからループ設定を読み込み、制御タスクを起動
+ */
+esp_err_t control_loop_start(void);
+
+/**
+ * @brief 出力ピンのループを設定/更新（NVSに保存、積分項はリセット）
+ * @return 設定が不正なら ESP_ERR_INVALID_ARG、出力ピンが gpio_watch で監視中なら
+ *         ESP_ERR_INVALID_STATE、空きがなければ ESP_ERR_NO_MEM
+ */
+esp_err_t control_loop_set(const loop_config_t *cfg);
+
+/**
+ * @brief ループを解除して出力をOFF（PWM 0% / LOW）にする（NVSからも削除）
+ */
+esp_err_t control_loop_remove(int out_pin);
+
+/**
+ * @brief ループの状態一覧を取得
+ * @return ループ数
+ */
+int control_loop_list(loop_status_t *out, int max);
+
+/**
+ * @brief ピンがループの出力として使われているか
+ */
+bool control_loop_owns(int pin);
+
+/**
+ * @brief ループ設定の既定値を埋める（period/freq/出力範囲）
+ */
+void control_loop_defaults(loop_config_t *cfg);
@@ -1,4 +1,6 @@
 #include "discord.h"
+#include "discord_json.h"
+#include "discord_ratelimit.h"
 #include "seedclaw_config.h"
 #include "esp_http_client.h"
 #include "esp_log.h"
@@ -6,8 +8,13 @@
 #include "esp_crt_bundle.h"
 #include "cJSON.h"
 #include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 static const char *TAG = "discord";
 
@@ -16,26 +23,43 @@ static char s_channel_id[24] = SEEDCLAW_DEFAULT_CHANNEL_ID;
 static char s_webhook_url[192] = SEEDCLAW_DEFAULT_WEBHOOK_URL;
 static char s_last_msg_id[24] = "0";
 
-typedef struct {
-    char *buffer;
-    size_t size;
-    size_t len;
-} http_response_t;
+// discord.com への常時接続クライアント（ポーリング・Webhook送信で共用）
+static esp_http_client_handle_t s_client = NULL;
+static bool s_connected_this_request = false;
+// 前回のリクエストから張ったままの接続があるか（失敗時に再利用接続の切断か判定する）
+static bool s_conn_open = false;
+static discord_http_stats_t s_http_stats;
+// ポーリング(受信タスク)と送信タスクが同じクライアントを使うため排他する
+static SemaphoreHandle_t s_http_mutex = NULL;
+// s_last_msg_id はGatewayのwsタスクとポーリングの両方が更新する
+static SemaphoreHandle_t s_msg_id_mutex = NULL;
+
+// 直近の応答のレート制限ヘッダ
+static discord_rl_headers_t s_resp_rl;
+
+static esp_err_t outbox_start(void);
 
 static esp_err_t http_event_handler(esp_http_client_event_t *evt)
 {
-    http_response_t *resp = (http_response_t *)evt->user_data;
+    discord_json_parser_t *parser = (discord_json_parser_t *)evt->user_data;
 
     switch (evt->event_id) {
+        case HTTP_EVENT_ON_CONNECTED:
+            // TLSハンドシェイク完了 = 新規接続
+            s_connected_this_request = true;
+            s_conn_open = true;
+            s_http_stats.handshakes++;
+            break;
+        case HTTP_EVENT_DISCONNECTED:
+            s_conn_open = false;
+            break;
+        case HTTP_EVENT_ON_HEADER:
+            discord_ratelimit_parse_header(&s_resp_rl, evt->header_key, evt->header_value);
+            break;
         case HTTP_EVENT_ON_DATA:
-            if (resp->buffer != NULL) {
-                size_t available = resp->size - resp->len - 1;
-                size_t copy_len = (evt->data_len < available) ? evt->data_len : available;
-                if (copy_len > 0) {
-                    memcpy(resp->buffer + resp->len, evt->data, copy_len);
-                    resp->len += copy_len;
-                    resp->buffer[resp->len] = '\0';
-                }
+            // 応答を溜めずにその場で必要なフィールドだけ抽出
+            if (parser != NULL) {
+                discord_json_feed(parser, (const char *)evt->data, evt->data_len);
             }
             break;
         default:
@@ -66,10 +90,197 @@ esp_err_t discord_init(void)
         nvs_close(nvs_handle);
     }
 
+    if (s_http_mutex == NULL) {
+        s_http_mutex = xSemaphoreCreateMutex();
+        s_msg_id_mutex = xSemaphoreCreateMutex();
+        if (s_http_mutex == NULL || s_msg_id_mutex == NULL || discord_ratelimit_init() != ESP_OK) {
+            return ESP_ERR_NO_MEM;
+        }
+        err = outbox_start();
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to start webhook outbox");
+            return err;
+        }
+    }
+
     ESP_LOGI(TAG, "Discord initialized (channel: %s)", s_channel_id);
     return ESP_OK;
 }
 
+// 接続か送信の段階で失敗し、リクエストがサーバーに届いていないことが確かなエラー
+static bool request_not_sent(esp_err_t err)
+{
+    return err == ESP_ERR_HTTP_CONNECT || err == ESP_ERR_HTTP_WRITE_DATA;
+}
+
+/**
+ * 再利用した接続での失敗を張り直して再送してよいか。
+ * GET は何度送っても同じ。POST はリクエストを送り切れなかった場合だけ
+ * （サーバーが処理していないので二重投稿にならない）。応答待ちで切れた POST は
+ * 届いた可能性があるので再送せず、呼び出し側の判断に任せる。
+ */
+static bool safe_to_resend(esp_http_client_method_t method, esp_err_t err)
+{
+    return method == HTTP_METHOD_GET || request_not_sent(err);
+}
+
+/**
+ * 常時接続クライアントでリクエストを送信する。
+ * 接続が生きていればTLSハンドシェイクを省略し、サーバー側で切断済みだった場合は
+ * 再送して安全なときだけ1回再接続して再送する。
+ */
+static esp_err_t discord_http_request_locked(const char *url, esp_http_client_method_t method,
+                                             const char *auth_header, const char *body,
+                                             discord_json_parser_t *parser, int *out_status)
+{
+    if (s_client == NULL) {
+        esp_http_client_config_t config = {
+            .url = url,
+            .method = method,
+            .timeout_ms = SEEDCLAW_HTTP_TIMEOUT_MS,
+            .event_handler = http_event_handler,
+            .keep_alive_enable = true,
+#ifdef SEEDCLAW_DISCORD_TEST_CERT_PEM
+            .cert_pem = SEEDCLAW_DISCORD_TEST_CERT_PEM,
+#else
+            .crt_bundle_attach = esp_crt_bundle_attach,
+#endif
+        };
+        s_client = esp_http_client_init(&config);
+        if (s_client == NULL) {
+            ESP_LOGE(TAG, "Failed to create HTTP client");
+            return ESP_FAIL;
+        }
+    }
+
+    esp_http_client_set_url(s_client, url);
+    esp_http_client_set_method(s_client, method);
+    esp_http_client_set_user_data(s_client, parser);
+
+    if (auth_header != NULL) {
+        esp_http_client_set_header(s_client, "Authorization", auth_header);
+    } else {
+        esp_http_client_delete_header(s_client, "Authorization");
+    }
+
+    if (body != NULL) {
+        esp_http_client_set_header(s_client, "Content-Type", "application/json");
+        esp_http_client_set_post_field(s_client, body, strlen(body));
+    } else {
+        esp_http_client_delete_header(s_client, "Content-Type");
+        esp_http_client_set_post_field(s_client, NULL, 0);
+    }
+
+    esp_err_t err = ESP_FAIL;
+    for (int attempt = 0; attempt < 2; attempt++) {
+        bool reused = s_conn_open;
+        s_connected_this_request = false;
+        discord_ratelimit_clear_headers(&s_resp_rl);
+        if (parser != NULL) {
+            discord_json_reset(parser);
+        }
+
+        err = esp_http_client_perform(s_client);
+        if (err == ESP_OK) {
+            break;
+        }
+
+        // 再利用した接続がサーバー側で閉じられていた → 張り直して1回だけ再送
+        esp_http_client_close(s_client);
+        s_conn_open = false;
+        // 新規接続での失敗は再接続しても同じなので数えずに諦める
+        if (!reused || s_connected_this_request || !safe_to_resend(method, err)) {
+            break;
+        }
+        s_http_stats.reconnects++;
+        ESP_LOGW(TAG, "Keep-alive connection dropped (%s), reconnecting", esp_err_to_name(err));
+    }
+
+    s_http_stats.requests++;
+    if (err == ESP_OK && !s_connected_this_request) {
+        s_http_stats.handshakes_avoided++;
+    }
+
+    *out_status = esp_http_client_get_status_code(s_client);
+    esp_http_client_set_user_data(s_client, NULL);
+    return err;
+}
+
+/**
+ * 排他付きでリクエストを送り、応答のレート制限ヘッダを route のバケットに反映する。
+ * 送信前の discord_ratelimit_acquire() は呼び出し側で行う（待ち方が用途で異なるため）。
+ * 応答が得られなかったときは予約した残量をここで返す。
+ */
+static esp_err_t discord_http_request(const char *route, const char *url,
+                                      esp_http_client_method_t method,
+                                      const char *auth_header, const char *body,
+                                      discord_json_parser_t *parser, int *out_status)
+{
+    xSemaphoreTake(s_http_mutex, portMAX_DELAY);
+    esp_err_t err = discord_http_request_locked(url, method, auth_header, body,
+                                                parser, out_status);
+    if (err == ESP_OK) {
+        // Retry-Afterヘッダが無ければ本文の retry_after を使う
+        if (*out_status == 429 && s_resp_rl.retry_after_ms < 0 &&
+            parser != NULL && parser->retry_after >= 0) {
+            s_resp_rl.retry_after_ms = (int)(parser->retry_after * 1000);
+        }
+        discord_ratelimit_update(route, &s_resp_rl, *out_status);
+    } else {
+        discord_ratelimit_refund(route);
+    }
+    xSemaphoreGive(s_http_mutex);
+    return err;
+}
+
+void discord_get_http_stats(discord_http_stats_t *out)
+{
+    *out = s_http_stats;
+}
+
+const char *discord_get_bot_token(void)
+{
+    return s_bot_token;
+}
+
+const char *discord_get_channel_id(void)
+{
+    return s_channel_id;
+}
+
+// snowflake文字列の大小比較（桁数 → 辞書順）
+static int snowflake_cmp(const char *a, const char *b)
+{
+    size_t la = strlen(a);
+    size_t lb = strlen(b);
+    if (la != lb) {
+        return (la < lb) ? -1 : 1;
+    }
+    return strcmp(a, b);
+}
+
+static void save_last_msg_id(void)
+{
+    nvs_handle_t nvs_handle;
+    if (nvs_open(SEEDCLAW_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) == ESP_OK) {
+        nvs_set_str(nvs_handle, "last_msg_id", s_last_msg_id);
+        nvs_commit(nvs_handle);
+        nvs_close(nvs_handle);
+    }
+}
+
+bool discord_mark_message_seen(const char *msg_id)
+{
+    xSemaphoreTake(s_msg_id_mutex, portMAX_DELAY);
+    bool newer = snowflake_cmp(msg_id, s_last_msg_id) > 0;
+    if (newer) {
+        strncpy(s_last_msg_id, msg_id, sizeof(s_last_msg_id) - 1);
+        save_last_msg_id();
+    }
+    xSemaphoreGive(s_msg_id_mutex);
+    return newer;
+}
+
 int discord_poll(discord_message_t *out_msgs, int max_msgs)
 {
     if (strlen(s_bot_token) == 0 || strlen(s_channel_id) == 0) {
@@ -77,152 +288,295 @@ int discord_poll(discord_message_t *out_msgs, int max_msgs)
     }
 
     char url[256];
+    xSemaphoreTake(s_msg_id_mutex, portMAX_DELAY);
     snprintf(url, sizeof(url),
-             "https://discord.com/api/v10/channels/%s/messages?after=%s&limit=%d",
+             SEEDCLAW_DISCORD_API_BASE "/channels/%s/messages?after=%s&limit=%d",
              s_channel_id, s_last_msg_id, max_msgs);
+    xSemaphoreGive(s_msg_id_mutex);
 
     char auth_header[160];
     snprintf(auth_header, sizeof(auth_header), "Bot %s", s_bot_token);
 
-    char *response_buffer = malloc(SEEDCLAW_HTTP_BUF_SIZE);
-    if (response_buffer == NULL) {
-        ESP_LOGE(TAG, "Failed to allocate response buffer");
-        return -1;
+    // バケットを使い切っていればリセットまでポーリングを見送る（429を踏まない）
+    if (discord_ratelimit_acquire(DISCORD_ROUTE_POLL) > 0) {
+        return 0;
     }
 
-    http_response_t response = {
-        .buffer = response_buffer,
-        .size = SEEDCLAW_HTTP_BUF_SIZE,
-        .len = 0
-    };
-
-    esp_http_client_config_t config = {
-        .url = url,
-        .method = HTTP_METHOD_GET,
-        .timeout_ms = SEEDCLAW_HTTP_TIMEOUT_MS,
-        .event_handler = http_event_handler,
-        .user_data = &response,
-        .crt_bundle_attach = esp_crt_bundle_attach,
-    };
+    discord_json_parser_t parser;
+    discord_json_init(&parser, out_msgs, max_msgs);
 
-    esp_http_client_handle_t client = esp_http_client_init(&config);
-    esp_http_client_set_header(client, "Authorization", auth_header);
-
-    esp_err_t err = esp_http_client_perform(client);
-    int status_code = esp_http_client_get_status_code(client);
-    esp_http_client_cleanup(client);
+    int status_code = 0;
+    esp_err_t err = discord_http_request(DISCORD_ROUTE_POLL, url, HTTP_METHOD_GET,
+                                         auth_header, NULL, &parser, &status_code);
 
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "HTTP request failed: %s", esp_err_to_name(err));
-        free(response_buffer);
         return -1;
     }
 
+    int parsed = discord_json_finish(&parser);
+
     if (status_code == 401) {
         ESP_LOGE(TAG, "Invalid bot token (401 Unauthorized)");
-        free(response_buffer);
         return 0;
     } else if (status_code == 403) {
         ESP_LOGE(TAG, "Missing permissions (403 Forbidden)");
-        free(response_buffer);
         return 0;
     } else if (status_code == 429) {
-        // retry_afterをパースして待機
-        float retry_after = 5.0f;
-        cJSON *err_root = cJSON_Parse(response_buffer);
-        if (err_root != NULL) {
-            cJSON *ra = cJSON_GetObjectItem(err_root, "retry_after");
-            if (ra != NULL && cJSON_IsNumber(ra)) {
-                retry_after = (float)ra->valuedouble;
-            }
-            cJSON_Delete(err_root);
-        }
-        int wait_ms = (int)(retry_after * 1000);
-        if (wait_ms < 1000) wait_ms = 1000;
-        if (wait_ms > 60000) wait_ms = 60000;
-        ESP_LOGW(TAG, "Rate limited (429), waiting %dms", wait_ms);
-        free(response_buffer);
-        vTaskDelay(pdMS_TO_TICKS(wait_ms));
+        // 再開時刻はバケット側に記録済み。ここでは待たずに次周期で見送る
+        ESP_LOGW(TAG, "Rate limited (429), polling deferred");
         return 0;
     } else if (status_code != 200) {
         ESP_LOGE(TAG, "HTTP error: %d", status_code);
-        free(response_buffer);
         return -1;
     }
 
-    // JSONパース
-    cJSON *root = cJSON_Parse(response_buffer);
-    free(response_buffer);
-
-    if (root == NULL) {
+    if (parsed < 0) {
         ESP_LOGE(TAG, "Failed to parse JSON response");
         return -1;
     }
 
-    if (!cJSON_IsArray(root)) {
-        ESP_LOGE(TAG, "Response is not an array");
-        cJSON_Delete(root);
-        return -1;
+    // 配列は新→古の順なので反転して古い方から処理
+    for (int i = 0; i < parsed / 2; i++) {
+        discord_message_t tmp = out_msgs[i];
+        out_msgs[i] = out_msgs[parsed - 1 - i];
+        out_msgs[parsed - 1 - i] = tmp;
     }
 
     int msg_count = 0;
-    int array_size = cJSON_GetArraySize(root);
-
-    // 配列は新→古の順なので、逆順で処理（古い方から）
-    for (int i = array_size - 1; i >= 0 && msg_count < max_msgs; i--) {
-        cJSON *msg = cJSON_GetArrayItem(root, i);
-        if (msg == NULL) continue;
+    bool advanced = false;
+    xSemaphoreTake(s_msg_id_mutex, portMAX_DELAY);
+    for (int i = 0; i < parsed; i++) {
+        discord_message_t *msg = &out_msgs[i];
+        if (msg->id[0] == '\0') {
+            continue;
+        }
 
-        cJSON *id = cJSON_GetObjectItem(msg, "id");
-        cJSON *content = cJSON_GetObjectItem(msg, "content");
-        cJSON *author = cJSON_GetObjectItem(msg, "author");
+        // 最新のメッセージIDは常に更新。Gateway側が受信済みのものは捨てる
+        if (snowflake_cmp(msg->id, s_last_msg_id) <= 0) {
+            continue;
+        }
+        strncpy(s_last_msg_id, msg->id, sizeof(s_last_msg_id) - 1);
+        advanced = true;
 
-        if (id == NULL || content == NULL || author == NULL) {
+        // ボットのメッセージと空のコンテンツはスキップ
+        if (msg->author_is_bot || msg->content[0] == '\0') {
             continue;
         }
 
-        cJSON *author_id = cJSON_GetObjectItem(author, "id");
-        cJSON *is_bot = cJSON_GetObjectItem(author, "bot");
+        if (msg_count != i) {
+            out_msgs[msg_count] = *msg;
+        }
+        msg_count++;
+    }
+
+    // last_msg_id をNVSに保存
+    if (advanced) {
+        save_last_msg_id();
+    }
+    xSemaphoreGive(s_msg_id_mutex);
+
+    ESP_LOGI(TAG, "Polled %d new messages", msg_count);
+    return msg_count;
+}
+
+/* ── Webhook送信アウトボックス ──
+ * 呼び出し元はリングに積むだけで戻り、送信タスクがレート制限に従って順に配送する。
+ * バケット残量が尽きかけているときは、続けて積まれた短文を1回の投稿にまとめる。
+ */
+
+typedef struct {
+    char *text;
+    size_t len;
+    int64_t enqueued_us;
+    uint8_t attempts;         // 通信エラーでの再送回数
+} outbox_item_t;
+
+static outbox_item_t s_outbox[SEEDCLAW_OUTBOX_LEN];
+static int s_outbox_head = 0;
+static int s_outbox_count = 0;
+static SemaphoreHandle_t s_outbox_mutex = NULL;
+static TaskHandle_t s_outbox_task = NULL;
+static discord_outbox_stats_t s_outbox_stats;
+
+// max バイト以内でUTF-8の文字境界に収まる長さを返す（s[max] が存在すること）
+static size_t utf8_cut(const char *s, size_t max)
+{
+    while (max > 0 && ((unsigned char)s[max] & 0xC0) == 0x80) {
+        max--;
+    }
+    return max;
+}
+
+static void outbox_pop(int n, bool delivered)
+{
+    int64_t now_us = esp_timer_get_time();
+
+    xSemaphoreTake(s_outbox_mutex, portMAX_DELAY);
+    for (int i = 0; i < n && s_outbox_count > 0; i++) {
+        outbox_item_t *item = &s_outbox[s_outbox_head];
+        if (delivered) {
+            uint32_t latency_ms = (uint32_t)((now_us - item->enqueued_us) / 1000);
+            s_outbox_stats.last_latency_ms = latency_ms;
+            if (latency_ms > s_outbox_stats.max_latency_ms) {
+                s_outbox_stats.max_latency_ms = latency_ms;
+            }
+            s_outbox_stats.total_latency_ms += latency_ms;
+            s_outbox_stats.delivered++;
+        } else {
+            s_outbox_stats.dropped++;
+        }
+        free(item->text);
+        item->text = NULL;
+        s_outbox_head = (s_outbox_head + 1) % SEEDCLAW_OUTBOX_LEN;
+        s_outbox_count--;
+    }
+    xSemaphoreGive(s_outbox_mutex);
+}
+
+static esp_err_t webhook_post(const char *content, int *out_status)
+{
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddStringToObject(json, "content", content);
+    char *json_str = cJSON_PrintUnformatted(json);
+    cJSON_Delete(json);
+    if (json_str == NULL) {
+        ESP_LOGE(TAG, "Failed to create JSON");
+        discord_ratelimit_refund(DISCORD_ROUTE_WEBHOOK);
+        return ESP_ERR_NO_MEM;
+    }
 
-        // ボットのメッセージはスキップ
-        if (is_bot != NULL && cJSON_IsTrue(is_bot)) {
-            // 最新のメッセージIDは更新
-            strncpy(s_last_msg_id, id->valuestring, sizeof(s_last_msg_id) - 1);
+    esp_err_t err = discord_http_request(DISCORD_ROUTE_WEBHOOK, s_webhook_url, HTTP_METHOD_POST,
+                                         NULL, json_str, NULL, out_status);
+    free(json_str);
+    return err;
+}
+
+static void outbox_task(void *arg)
+{
+    int backoff_ms = 0;
+
+    while (1) {
+        xSemaphoreTake(s_outbox_mutex, portMAX_DELAY);
+        bool empty = (s_outbox_count == 0);
+        xSemaphoreGive(s_outbox_mutex);
+        if (empty) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
             continue;
         }
 
-        // 空のコンテンツはスキップ
-        if (!cJSON_IsString(content) || strlen(content->valuestring) == 0) {
-            strncpy(s_last_msg_id, id->valuestring, sizeof(s_last_msg_id) - 1);
+        // バケットが空ならリセットまで送信タスクだけが待つ（429を踏まない）
+        uint32_t wait_ms = discord_ratelimit_acquire(DISCORD_ROUTE_WEBHOOK);
+        if (wait_ms > 0) {
+            vTaskDelay(pdMS_TO_TICKS(wait_ms));
             continue;
         }
+        int remaining = discord_ratelimit_remaining(DISCORD_ROUTE_WEBHOOK);
+
+        // 先頭から送る分を決める（残量が尽きかけていれば後続の短文をまとめる）
+        xSemaphoreTake(s_outbox_mutex, portMAX_DELAY);
+        outbox_item_t *head = &s_outbox[s_outbox_head];
+        int take = 1;
+        size_t total = head->len;
+        if (remaining >= 0 && remaining <= SEEDCLAW_OUTBOX_COALESCE_REMAINING) {
+            while (take < s_outbox_count) {
+                const outbox_item_t *next = &s_outbox[(s_outbox_head + take) % SEEDCLAW_OUTBOX_LEN];
+                if (total + 1 + next->len > SEEDCLAW_DISCORD_MAX_MSG_LEN) {
+                    break;
+                }
+                total += 1 + next->len;
+                take++;
+            }
+        }
 
-        // メッセージを格納
-        strncpy(out_msgs[msg_count].id, id->valuestring, sizeof(out_msgs[msg_count].id) - 1);
-        strncpy(out_msgs[msg_count].content, content->valuestring, sizeof(out_msgs[msg_count].content) - 1);
-        if (author_id != NULL && cJSON_IsString(author_id)) {
-            strncpy(out_msgs[msg_count].author_id, author_id->valuestring, sizeof(out_msgs[msg_count].author_id) - 1);
+        // 先頭要素は送信タスクしか取り除かないので、ロック外で参照してよい
+        char *joined = NULL;
+        const char *content = head->text;
+        if (take > 1) {
+            joined = malloc(total + 1);
+            if (joined == NULL) {
+                take = 1;
+            } else {
+                size_t pos = 0;
+                for (int i = 0; i < take; i++) {
+                    const outbox_item_t *item = &s_outbox[(s_outbox_head + i) % SEEDCLAW_OUTBOX_LEN];
+                    if (i > 0) {
+                        joined[pos++] = '\n';
+                    }
+                    memcpy(joined + pos, item->text, item->len);
+                    pos += item->len;
+                }
+                joined[pos] = '\0';
+                content = joined;
+            }
         }
-        out_msgs[msg_count].author_is_bot = false;
+        xSemaphoreGive(s_outbox_mutex);
 
-        strncpy(s_last_msg_id, id->valuestring, sizeof(s_last_msg_id) - 1);
-        msg_count++;
-    }
+        int status = 0;
+        esp_err_t err = webhook_post(content, &status);
+        free(joined);
 
-    cJSON_Delete(root);
+        if (err == ESP_OK && status == 429) {
+            // 再開時刻はバケットに記録済み。次周期の acquire で待ってから同じ内容を再送
+            s_outbox_stats.rate_limited++;
+            continue;
+        }
 
-    // last_msg_id をNVSに保存
-    if (msg_count > 0) {
-        nvs_handle_t nvs_handle;
-        if (nvs_open(SEEDCLAW_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) == ESP_OK) {
-            nvs_set_str(nvs_handle, "last_msg_id", s_last_msg_id);
-            nvs_commit(nvs_handle);
-            nvs_close(nvs_handle);
+        if (err != ESP_OK && err != ESP_ERR_NO_MEM && !request_not_sent(err)) {
+            // 送り切った後に応答が途切れた。投稿済みかもしれないので二重投稿を避けて破棄する
+            ESP_LOGE(TAG, "Webhook response lost (%s), not resending", esp_err_to_name(err));
+            s_outbox_stats.unconfirmed += take;
+            outbox_pop(take, false);
+            backoff_ms = 0;
+            continue;
+        }
+
+        if (err != ESP_OK || status >= 500) {
+            // 未送信（接続/送信失敗・JSON作成失敗）/サーバーエラー → 指数バックオフで再送
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "Webhook request failed: %s", esp_err_to_name(err));
+            } else {
+                ESP_LOGE(TAG, "Webhook HTTP error: %d", status);
+            }
+            if (++head->attempts >= SEEDCLAW_OUTBOX_MAX_ATTEMPTS) {
+                ESP_LOGE(TAG, "Webhook delivery abandoned after %d attempts", head->attempts);
+                outbox_pop(take, false);
+                backoff_ms = 0;
+                continue;
+            }
+            s_outbox_stats.retries++;
+            backoff_ms = (backoff_ms == 0) ? 1000 : backoff_ms * 2;
+            if (backoff_ms > 30000) backoff_ms = 30000;
+            vTaskDelay(pdMS_TO_TICKS(backoff_ms));
+            continue;
+        }
+        backoff_ms = 0;
+
+        if (status < 200 || status >= 300) {
+            // 4xx は再送しても通らないので破棄
+            ESP_LOGE(TAG, "Webhook HTTP error: %d", status);
+            outbox_pop(take, false);
+        } else {
+            if (take > 1) {
+                s_outbox_stats.coalesced += take - 1;
+            }
+            outbox_pop(take, true);
+            ESP_LOGI(TAG, "Message sent via webhook");
         }
     }
+}
 
-    ESP_LOGI(TAG, "Polled %d new messages", msg_count);
-    return msg_count;
+static esp_err_t outbox_start(void)
+{
+    s_outbox_mutex = xSemaphoreCreateMutex();
+    if (s_outbox_mutex == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreate(outbox_task, "outbox", SEEDCLAW_OUTBOX_TASK_STACK, NULL,
+                    SEEDCLAW_OUTBOX_TASK_PRIO, &s_outbox_task) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
 }
 
 esp_err_t discord_send_webhook(const char *text)
@@ -236,88 +590,71 @@ esp_err_t discord_send_webhook(const char *text)
         return ESP_OK;
     }
 
-    // 2000文字ごとに分割
+    // 2000バイト以内・UTF-8文字境界で分割
+    outbox_item_t items[SEEDCLAW_OUTBOX_LEN];
+    int n = 0;
     size_t text_len = strlen(text);
     size_t offset = 0;
+    int64_t now_us = esp_timer_get_time();
 
     while (offset < text_len) {
         size_t chunk_len = text_len - offset;
         if (chunk_len > SEEDCLAW_DISCORD_MAX_MSG_LEN) {
-            chunk_len = SEEDCLAW_DISCORD_MAX_MSG_LEN;
+            chunk_len = utf8_cut(text + offset, SEEDCLAW_DISCORD_MAX_MSG_LEN);
         }
-
-        char *chunk = strndup(text + offset, chunk_len);
-        if (chunk == NULL) {
-            ESP_LOGE(TAG, "Failed to allocate chunk");
-            return ESP_ERR_NO_MEM;
+        if (n >= SEEDCLAW_OUTBOX_LEN || chunk_len == 0) {
+            break;
         }
 
-        // JSONボディ作成
-        cJSON *json = cJSON_CreateObject();
-        cJSON_AddStringToObject(json, "content", chunk);
-        char *json_str = cJSON_PrintUnformatted(json);
-        cJSON_Delete(json);
-        free(chunk);
-
-        if (json_str == NULL) {
-            ESP_LOGE(TAG, "Failed to create JSON");
+        items[n].text = strndup(text + offset, chunk_len);
+        if (items[n].text == NULL) {
+            ESP_LOGE(TAG, "Failed to allocate chunk");
+            for (int i = 0; i < n; i++) {
+                free(items[i].text);
+            }
             return ESP_ERR_NO_MEM;
         }
+        items[n].len = chunk_len;
+        items[n].enqueued_us = now_us;
+        items[n].attempts = 0;
+        n++;
+        offset += chunk_len;
+    }
 
-        // HTTP POST (429リトライ付き)
-        int retry_count = 0;
-        esp_err_t send_err = ESP_FAIL;
-        int send_status = 0;
-
-        while (retry_count < 3) {
-            esp_http_client_config_t config = {
-                .url = s_webhook_url,
-                .method = HTTP_METHOD_POST,
-                .timeout_ms = SEEDCLAW_HTTP_TIMEOUT_MS,
-                .crt_bundle_attach = esp_crt_bundle_attach,
-            };
-
-            esp_http_client_handle_t client = esp_http_client_init(&config);
-            esp_http_client_set_header(client, "Content-Type", "application/json");
-            esp_http_client_set_post_field(client, json_str, strlen(json_str));
-
-            send_err = esp_http_client_perform(client);
-            send_status = esp_http_client_get_status_code(client);
-            esp_http_client_cleanup(client);
-
-            if (send_err != ESP_OK) {
-                ESP_LOGE(TAG, "Webhook request failed: %s", esp_err_to_name(send_err));
-                break;
-            }
-
-            if (send_status == 429) {
-                retry_count++;
-                int wait_ms = retry_count * 2000;
-                ESP_LOGW(TAG, "Webhook rate limited (429), retry %d/3 after %dms",
-                         retry_count, wait_ms);
-                vTaskDelay(pdMS_TO_TICKS(wait_ms));
-                continue;
-            }
-            break;
+    // 全チャンクが収まる場合のみ積む（途中までの送信を防ぐ）
+    xSemaphoreTake(s_outbox_mutex, portMAX_DELAY);
+    bool fits = (offset >= text_len) && (s_outbox_count + n <= SEEDCLAW_OUTBOX_LEN);
+    if (fits) {
+        for (int i = 0; i < n; i++) {
+            s_outbox[(s_outbox_head + s_outbox_count) % SEEDCLAW_OUTBOX_LEN] = items[i];
+            s_outbox_count++;
         }
+        s_outbox_stats.enqueued += n;
+    } else {
+        s_outbox_stats.dropped += n;
+    }
+    xSemaphoreGive(s_outbox_mutex);
 
-        free(json_str);
-
-        if (send_err != ESP_OK) {
-            return send_err;
-        }
-        if (send_status < 200 || send_status >= 300) {
-            ESP_LOGE(TAG, "Webhook HTTP error: %d", send_status);
-            return ESP_FAIL;
+    if (!fits) {
+        for (int i = 0; i < n; i++) {
+            free(items[i].text);
         }
-
-        offset += chunk_len;
+        ESP_LOGE(TAG, "Outbox full, message dropped");
+        return ESP_ERR_NO_MEM;
     }
 
-    ESP_LOGI(TAG, "Message sent via webhook");
+    xTaskNotifyGive(s_outbox_task);
     return ESP_OK;
 }
 
+void discord_get_outbox_stats(discord_outbox_stats_t *out)
+{
+    xSemaphoreTake(s_outbox_mutex, portMAX_DELAY);
+    *out = s_outbox_stats;
+    out->depth = (uint32_t)s_outbox_count;
+    xSemaphoreGive(s_outbox_mutex);
+}
+
 esp_err_t discord_set_token(const char *token)
 {
     nvs_handle_t nvs_handle;
@@ -2,6 +2,7 @@
 
 #include "esp_err.h"
 #include <stdbool.h>
+#include <stdint.h>
 
 typedef struct {
     char id[24];           // Discordメッセージ ID (snowflake文字列)
@@ -10,6 +11,27 @@ typedef struct {
     bool author_is_bot;    // ボットかどうか
 } discord_message_t;
 
+typedef struct {
+    uint32_t requests;           // 送信したHTTPリクエスト数
+    uint32_t handshakes;         // 実施したTLSハンドシェイク数
+    uint32_t handshakes_avoided; // 接続再利用で省略したハンドシェイク数
+    uint32_t reconnects;         // サーバー切断による再接続回数
+} discord_http_stats_t;
+
+typedef struct {
+    uint32_t enqueued;           // アウトボックスに積んだチャンク数
+    uint32_t delivered;          // 配送完了したチャンク数
+    uint32_t coalesced;          // 他のチャンクとまとめて投稿した数
+    uint32_t retries;            // 未送信の通信エラー/5xxによる再送回数
+    uint32_t rate_limited;       // 受けた429の数
+    uint32_t dropped;            // 満杯/配送失敗で破棄した数
+    uint32_t unconfirmed;        // うち送信後に応答が途切れ、二重投稿を避けて再送しなかった数
+    uint32_t depth;              // 現在の滞留数
+    uint32_t last_latency_ms;    // 直近の積み込み→配送完了時間
+    uint32_t max_latency_ms;
+    uint64_t total_latency_ms;   // 平均算出用
+} discord_outbox_stats_t;
+
 /**
  * @brief Discordモジュールを初期化 (NVSから設定を読み込み)
  */
@@ -24,11 +46,35 @@ esp_err_t discord_init(void);
 int discord_poll(discord_message_t *out_msgs, int max_msgs);
 
 /**
- * @brief Webhookでメッセージを送信
+ * @brief 設定済みのBot Tokenを返す（Gateway認証用）
+ */
+const char *discord_get_bot_token(void);
+
+/**
+ * @brief 監視対象のチャンネルIDを返す
+ */
+const char *discord_get_channel_id(void);
+
+/**
+ * @brief メッセージIDを処理済みとして記録
+ * @return 未処理の新しいIDなら true（last_msg_id を更新）、処理済みなら false
+ */
+bool discord_mark_message_seen(const char *msg_id);
+
+/**
+ * @brief Webhook送信をアウトボックスに積む（ブロックしない）
+ * 2000バイトごとに分割され、送信タスクがレート制限に従って配送する。
+ * 再送するのは未送信の失敗と5xxだけで、送信後に応答が途切れたものは二重投稿を避けて破棄する。
  * @param text 送信するテキスト
+ * @return アウトボックス満杯なら ESP_ERR_NO_MEM
  */
 esp_err_t discord_send_webhook(const char *text);
 
+/**
+ * @brief Webhookアウトボックスの統計を取得
+ */
+void discord_get_outbox_stats(discord_outbox_stats_t *out);
+
 /**
  * @brief Bot TokenをNVSに保存
  */
@@ -43,3 +89,8 @@ esp_err_t discord_set_channel(const char *channel_id);
  * @brief Webhook URLをNVSに保存
  */
 esp_err_t discord_set_webhook(const char *url);
+
+/**
+ * @brief discord.com 常時接続の統計を取得
+ */
+void discord_get_http_stats(discord_http_stats_t *out);
@@ -0,0 +1,494 @@
+#include "discord_gateway.h"
+#include "discord_json.h"
+#include "seedclaw_config.h"
+#include "esp_websocket_client.h"
+#include "esp_crt_bundle.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "cJSON.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include <string.h>
+#include <stdio.h>
+
+static const char *TAG = "gateway";
+
+// Gateway opcode
+#define GW_OP_DISPATCH          0
+#define GW_OP_HEARTBEAT         1
+#define GW_OP_IDENTIFY          2
+#define GW_OP_RESUME            6
+#define GW_OP_RECONNECT         7
+#define GW_OP_INVALID_SESSION   9
+#define GW_OP_HELLO             10
+#define GW_OP_HEARTBEAT_ACK     11
+
+// GUILD_MESSAGES | MESSAGE_CONTENT
+#define GW_INTENTS              ((1 << 9) | (1 << 15))
+
+static bool s_enabled = false;
+static char s_gateway_url[128] = SEEDCLAW_DISCORD_GATEWAY_URL;
+
+static esp_websocket_client_handle_t s_ws = NULL;
+static QueueHandle_t s_msg_queue = NULL;
+static TaskHandle_t s_hb_task = NULL;
+
+// セッション状態（wsタスクとハートビートタスクから参照）
+static volatile bool s_ready = false;
+static volatile bool s_ack_pending = false;
+static volatile bool s_reconnect_requested = false;
+static volatile bool s_heartbeat_now = false;
+static volatile int s_heartbeat_interval_ms = 0;
+static volatile int32_t s_seq = -1;
+static char s_session_id[72] = "";
+static char s_resume_url[128] = "";
+
+// フレーム再組み立てバッファ
+static char *s_frame_buf = NULL;
+static int s_frame_len = 0;
+static bool s_frame_overflow = false;
+
+// 再組み立てバッファに収まらないフレームはストリーミングで抽出する
+static discord_json_parser_t s_frame_parser;
+static discord_message_t s_frame_msg;
+
+static discord_gateway_stats_t s_stats;
+
+static void gw_send_json(cJSON *payload)
+{
+    char *str = cJSON_PrintUnformatted(payload);
+    cJSON_Delete(payload);
+    if (str == NULL) {
+        return;
+    }
+    if (esp_websocket_client_send_text(s_ws, str, strlen(str), pdMS_TO_TICKS(5000)) < 0) {
+        ESP_LOGW(TAG, "Failed to send gateway payload");
+    }
+    free(str);
+}
+
+static void gw_send_heartbeat(void)
+{
+    cJSON *payload = cJSON_CreateObject();
+    cJSON_AddNumberToObject(payload, "op", GW_OP_HEARTBEAT);
+    if (s_seq >= 0) {
+        cJSON_AddNumberToObject(payload, "d", s_seq);
+    } else {
+        cJSON_AddNullToObject(payload, "d");
+    }
+    s_ack_pending = true;
+    s_stats.heartbeats++;
+    gw_send_json(payload);
+}
+
+static void gw_send_identify(void)
+{
+    cJSON *payload = cJSON_CreateObject();
+    cJSON_AddNumberToObject(payload, "op", GW_OP_IDENTIFY);
+    cJSON *d = cJSON_AddObjectToObject(payload, "d");
+    cJSON_AddStringToObject(d, "token", discord_get_bot_token());
+    cJSON_AddNumberToObject(d, "intents", GW_INTENTS);
+    cJSON *props = cJSON_AddObjectToObject(d, "properties");
+    cJSON_AddStringToObject(props, "os", "esp-idf");
+    cJSON_AddStringToObject(props, "browser", "seedclaw");
+    cJSON_AddStringToObject(props, "device", "seedclaw");
+    s_stats.identifies++;
+    ESP_LOGI(TAG, "Sending IDENTIFY");
+    gw_send_json(payload);
+}
+
+static void gw_send_resume(void)
+{
+    cJSON *payload = cJSON_CreateObject();
+    cJSON_AddNumberToObject(payload, "op", GW_OP_RESUME);
+    cJSON *d = cJSON_AddObjectToObject(payload, "d");
+    cJSON_AddStringToObject(d, "token", discord_get_bot_token());
+    cJSON_AddStringToObject(d, "session_id", s_session_id);
+    cJSON_AddNumberToObject(d, "seq", s_seq);
+    s_stats.resumes++;
+    ESP_LOGI(TAG, "Sending RESUME (seq=%ld)", (long)s_seq);
+    gw_send_json(payload);
+}
+
+// 監視チャンネルの人間の発言をキューに積む
+static void gw_enqueue_message(const char *channel_id, const discord_message_t *msg)
+{
+    if (strcmp(channel_id, discord_get_channel_id()) != 0) {
+        return;
+    }
+    // ポーリングで取得済みのIDは無視（フォールバック切替時の重複防止）
+    if (!discord_mark_message_seen(msg->id)) {
+        return;
+    }
+    if (msg->author_is_bot || msg->content[0] == '\0') {
+        return;
+    }
+
+    if (xQueueSend(s_msg_queue, msg, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "Message queue full, dropping %s", msg->id);
+        s_stats.dropped++;
+        return;
+    }
+    s_stats.messages++;
+}
+
+static void gw_handle_message_create(cJSON *d)
+{
+    cJSON *id = cJSON_GetObjectItem(d, "id");
+    cJSON *channel_id = cJSON_GetObjectItem(d, "channel_id");
+    cJSON *content = cJSON_GetObjectItem(d, "content");
+    cJSON *author = cJSON_GetObjectItem(d, "author");
+
+    if (!cJSON_IsString(id) || !cJSON_IsString(channel_id) || author == NULL) {
+        return;
+    }
+
+    discord_message_t msg;
+    memset(&msg, 0, sizeof(msg));
+    strncpy(msg.id, id->valuestring, sizeof(msg.id) - 1);
+    if (cJSON_IsString(content)) {
+        strncpy(msg.content, content->valuestring, sizeof(msg.content) - 1);
+    }
+    cJSON *author_id = cJSON_GetObjectItem(author, "id");
+    if (cJSON_IsString(author_id)) {
+        strncpy(msg.author_id, author_id->valuestring, sizeof(msg.author_id) - 1);
+    }
+    msg.author_is_bot = cJSON_IsTrue(cJSON_GetObjectItem(author, "bot"));
+
+    gw_enqueue_message(channel_id->valuestring, &msg);
+}
+
+static void gw_handle_dispatch(const char *type, cJSON *d)
+{
+    if (strcmp(type, "MESSAGE_CREATE") == 0) {
+        gw_handle_message_create(d);
+    } else if (strcmp(type, "READY") == 0) {
+        cJSON *session_id = cJSON_GetObjectItem(d, "session_id");
+        cJSON *resume_url = cJSON_GetObjectItem(d, "resume_gateway_url");
+        if (cJSON_IsString(session_id)) {
+            strncpy(s_session_id, session_id->valuestring, sizeof(s_session_id) - 1);
+        }
+        if (cJSON_IsString(resume_url)) {
+            snprintf(s_resume_url, sizeof(s_resume_url), "%s/?v=10&encoding=json",
+                     resume_url->valuestring);
+        }
+        s_ready = true;
+        ESP_LOGI(TAG, "Gateway READY (session %s)", s_session_id);
+    } else if (strcmp(type, "RESUMED") == 0) {
+        s_ready = true;
+        ESP_LOGI(TAG, "Gateway session RESUMED");
+    }
+}
+
+static void gw_handle_frame(const char *data, int len)
+{
+    cJSON *root = cJSON_ParseWithLength(data, len);
+    if (root == NULL) {
+        ESP_LOGW(TAG, "Invalid gateway frame");
+        return;
+    }
+
+    cJSON *op = cJSON_GetObjectItem(root, "op");
+    cJSON *d = cJSON_GetObjectItem(root, "d");
+    cJSON *s = cJSON_GetObjectItem(root, "s");
+    if (cJSON_IsNumber(s)) {
+        s_seq = s->valueint;
+    }
+
+    switch (cJSON_IsNumber(op) ? op->valueint : -1) {
+        case GW_OP_HELLO: {
+            cJSON *interval = cJSON_GetObjectItem(d, "heartbeat_interval");
+            s_heartbeat_interval_ms = cJSON_IsNumber(interval) ? interval->valueint : 41250;
+            s_ack_pending = false;
+            if (s_session_id[0] != '\0' && s_seq >= 0) {
+                gw_send_resume();
+            } else {
+                gw_send_identify();
+            }
+            // ハートビートタスクに間隔を通知
+            xTaskNotifyGive(s_hb_task);
+            break;
+        }
+        case GW_OP_HEARTBEAT_ACK:
+            s_ack_pending = false;
+            break;
+        case GW_OP_HEARTBEAT:
+            s_heartbeat_now = true;
+            xTaskNotifyGive(s_hb_task);
+            break;
+        case GW_OP_RECONNECT:
+            ESP_LOGI(TAG, "Gateway requested reconnect");
+            s_reconnect_requested = true;
+            xTaskNotifyGive(s_hb_task);
+            break;
+        case GW_OP_INVALID_SESSION:
+            ESP_LOGW(TAG, "Invalid session (resumable=%d)", cJSON_IsTrue(d));
+            s_ready = false;
+            if (!cJSON_IsTrue(d)) {
+                s_session_id[0] = '\0';
+                s_resume_url[0] = '\0';
+                s_seq = -1;
+            }
+            // Discordの推奨どおり1〜5秒おいて再接続
+            s_reconnect_requested = true;
+            xTaskNotifyGive(s_hb_task);
+            break;
+        case GW_OP_DISPATCH: {
+            cJSON *t = cJSON_GetObjectItem(root, "t");
+            if (cJSON_IsString(t)) {
+                gw_handle_dispatch(t->valuestring, d);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+
+    cJSON_Delete(root);
+}
+
+// 再組み立てバッファに収まらなかったフレーム。MESSAGE_CREATE なら本文を切り詰めて受け取る
+static void gw_handle_oversized_frame(int len)
+{
+    s_stats.oversized++;
+    int n = discord_json_finish(&s_frame_parser);
+    if (n < 0) {
+        ESP_LOGW(TAG, "Oversized gateway frame (%d bytes) is not valid JSON, skipped", len);
+        s_stats.dropped++;
+        return;
+    }
+    if (s_frame_parser.seq >= 0) {
+        s_seq = s_frame_parser.seq;
+    }
+
+    if (s_frame_parser.op == GW_OP_DISPATCH && strcmp(s_frame_parser.type, "MESSAGE_CREATE") == 0 &&
+        n == 1 && s_frame_msg.id[0] != '\0') {
+        ESP_LOGW(TAG, "Gateway frame too large (%d bytes), message %s truncated", len, s_frame_msg.id);
+        gw_enqueue_message(s_frame_parser.channel_id, &s_frame_msg);
+    } else {
+        ESP_LOGW(TAG, "Gateway frame too large (%d bytes, op %d %s), skipped",
+                 len, s_frame_parser.op, s_frame_parser.type);
+    }
+}
+
+static void gw_event_handler(void *arg, esp_event_base_t base, int32_t event_id, void *event_data)
+{
+    esp_websocket_event_data_t *data = (esp_websocket_event_data_t *)event_data;
+
+    switch (event_id) {
+        case WEBSOCKET_EVENT_CONNECTED:
+            ESP_LOGI(TAG, "Gateway connected");
+            s_stats.connects++;
+            s_frame_len = 0;
+            break;
+        case WEBSOCKET_EVENT_DISCONNECTED:
+        case WEBSOCKET_EVENT_CLOSED:
+            ESP_LOGW(TAG, "Gateway disconnected, falling back to polling");
+            s_ready = false;
+            s_heartbeat_interval_ms = 0;
+            break;
+        case WEBSOCKET_EVENT_DATA:
+            // テキスト(0x1)と継続(0x0)フレームのみ扱う
+            if (data->op_code != 0x1 && data->op_code != 0x0) {
+                break;
+            }
+            if (data->payload_offset == 0) {
+                s_frame_len = 0;
+                s_frame_overflow = false;
+            }
+            if (!s_frame_overflow && s_frame_len + data->data_len >= SEEDCLAW_GATEWAY_FRAME_BUF) {
+                // ここまでの分を抽出器に流し、以降のチャンクは直接流し込む
+                s_frame_overflow = true;
+                discord_json_init_event(&s_frame_parser, &s_frame_msg);
+                discord_json_feed(&s_frame_parser, s_frame_buf, s_frame_len);
+            }
+            if (s_frame_overflow) {
+                discord_json_feed(&s_frame_parser, data->data_ptr, data->data_len);
+            } else {
+                memcpy(s_frame_buf + s_frame_len, data->data_ptr, data->data_len);
+                s_frame_len += data->data_len;
+            }
+            if (data->payload_offset + data->data_len >= data->payload_len) {
+                if (s_frame_overflow) {
+                    gw_handle_oversized_frame(data->payload_len);
+                } else {
+                    gw_handle_frame(s_frame_buf, s_frame_len);
+                }
+                s_frame_len = 0;
+                s_frame_overflow = false;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// 接続を張り直す（Resume URLがあればそちらへ）。ハートビートタスクからのみ呼ぶ
+static void gw_reconnect(void)
+{
+    s_reconnect_requested = false;
+    s_ready = false;
+    s_heartbeat_interval_ms = 0;
+    esp_websocket_client_stop(s_ws);
+    vTaskDelay(pdMS_TO_TICKS(1000 + esp_random() % 4000));
+    const char *url = (s_resume_url[0] != '\0') ? s_resume_url : s_gateway_url;
+    esp_websocket_client_set_uri(s_ws, url);
+    esp_websocket_client_start(s_ws);
+}
+
+// ハートビート送信と再接続を担当（wsイベントハンドラ内ではstop/startできないため）
+static void gw_heartbeat_task(void *arg)
+{
+    bool first_beat = true;
+
+    while (1) {
+        int interval = s_heartbeat_interval_ms;
+        TickType_t wait = portMAX_DELAY;
+        if (interval > 0) {
+            // 初回はDiscord仕様どおり interval * jitter 後に送信
+            int ms = first_beat ? (int)(esp_random() % (uint32_t)interval) : interval;
+            wait = pdMS_TO_TICKS(ms);
+        }
+
+        uint32_t notified = ulTaskNotifyTake(pdTRUE, wait);
+
+        if (s_reconnect_requested) {
+            first_beat = true;
+            gw_reconnect();
+            continue;
+        }
+
+        if (s_heartbeat_interval_ms <= 0 || !esp_websocket_client_is_connected(s_ws)) {
+            first_beat = true;
+            continue;
+        }
+
+        if (notified > 0 && !s_heartbeat_now) {
+            // HELLO受信 → 間隔を再計算して待ち直す
+            first_beat = true;
+            continue;
+        }
+
+        if (s_ack_pending && !s_heartbeat_now) {
+            // 前回のACKが来ていない = ゾンビ接続 → 再接続してResume
+            // 次のインターバルまで待たずにすぐ張り直す
+            ESP_LOGW(TAG, "Heartbeat ACK missing, reconnecting");
+            first_beat = true;
+            gw_reconnect();
+            continue;
+        }
+
+        s_heartbeat_now = false;
+        first_beat = false;
+        gw_send_heartbeat();
+    }
+}
+
+esp_err_t discord_gateway_start(void)
+{
+    nvs_handle_t nvs_handle;
+    if (nvs_open(SEEDCLAW_NVS_NAMESPACE, NVS_READONLY, &nvs_handle) == ESP_OK) {
+        uint8_t enabled = 0;
+        if (nvs_get_u8(nvs_handle, "gw_mode", &enabled) == ESP_OK) {
+            s_enabled = (enabled != 0);
+        }
+        size_t len = sizeof(s_gateway_url);
+        nvs_get_str(nvs_handle, "gw_url", s_gateway_url, &len);
+        nvs_close(nvs_handle);
+    }
+
+    if (!s_enabled) {
+        ESP_LOGI(TAG, "Gateway mode disabled (REST polling)");
+        return ESP_OK;
+    }
+    if (strlen(discord_get_bot_token()) == 0) {
+        ESP_LOGW(TAG, "Bot token not configured, gateway not started");
+        return ESP_OK;
+    }
+
+    s_frame_buf = malloc(SEEDCLAW_GATEWAY_FRAME_BUF);
+    s_msg_queue = xQueueCreate(SEEDCLAW_GATEWAY_QUEUE_LEN, sizeof(discord_message_t));
+    if (s_frame_buf == NULL || s_msg_queue == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate gateway buffers");
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_websocket_client_config_t config = {
+        .uri = s_gateway_url,
+        .buffer_size = 1024,
+        .task_stack = SEEDCLAW_GATEWAY_TASK_STACK,
+        .reconnect_timeout_ms = 5000,
+        .network_timeout_ms = SEEDCLAW_HTTP_TIMEOUT_MS,
+        .crt_bundle_attach = esp_crt_bundle_attach,
+    };
+    s_ws = esp_websocket_client_init(&config);
+    if (s_ws == NULL) {
+        ESP_LOGE(TAG, "Failed to create WebSocket client");
+        return ESP_FAIL;
+    }
+    esp_websocket_register_events(s_ws, WEBSOCKET_EVENT_ANY, gw_event_handler, NULL);
+
+    xTaskCreate(gw_heartbeat_task, "gw_hb", 3072, NULL, 5, &s_hb_task);
+
+    esp_err_t err = esp_websocket_client_start(s_ws);
+    ESP_LOGI(TAG, "Gateway mode enabled (%s)", s_gateway_url);
+    return err;
+}
+
+bool discord_gateway_is_ready(void)
+{
+    return s_enabled && s_ready;
+}
+
+int discord_gateway_receive(discord_message_t *out_msgs, int max_msgs, int timeout_ms)
+{
+    if (s_msg_queue == NULL || max_msgs <= 0) {
+        return 0;
+    }
+
+    int count = 0;
+    if (xQueueReceive(s_msg_queue, &out_msgs[0], pdMS_TO_TICKS(timeout_ms)) != pdTRUE) {
+        return 0;
+    }
+    count++;
+    while (count < max_msgs && xQueueReceive(s_msg_queue, &out_msgs[count], 0) == pdTRUE) {
+        count++;
+    }
+    return count;
+}
+
+esp_err_t discord_gateway_set_enabled(bool enabled)
+{
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(SEEDCLAW_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK) return err;
+
+    err = nvs_set_u8(nvs_handle, "gw_mode", enabled ? 1 : 0);
+    if (err == ESP_OK) {
+        nvs_commit(nvs_handle);
+    }
+    nvs_close(nvs_handle);
+    return err;
+}
+
+esp_err_t discord_gateway_set_url(const char *url)
+{
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(SEEDCLAW_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK) return err;
+
+    err = nvs_set_str(nvs_handle, "gw_url", url);
+    if (err == ESP_OK) {
+        nvs_commit(nvs_handle);
+        strncpy(s_gateway_url, url, sizeof(s_gateway_url) - 1);
+    }
+    nvs_close(nvs_handle);
+    return err;
+}
+
+void discord_gateway_get_stats(discord_gateway_stats_t *out)
+{
+    *out = s_stats;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "esp_err.h"
+#include "discord.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+    uint32_t connects;       // WebSocket接続回数
+    uint32_t identifies;     // Identify送信回数（新規セッション）
+    uint32_t resumes;        // Resume送信回数（セッション再開）
+    uint32_t heartbeats;     // 送信したハートビート数
+    uint32_t messages;       // キューに投入したMESSAGE_CREATE数
+    uint32_t dropped;        // キュー満杯/解析不能で破棄した数
+    uint32_t oversized;      // 再組み立てバッファを超え、抽出器で読んだフレーム数
+} discord_gateway_stats_t;
+
+/**
+ * @brief Gatewayモードが有効なら WebSocket 接続を開始
+ * discord_init() の後に呼ぶ。無効時は何もしない。
+ */
+esp_err_t discord_gateway_start(void);
+
+/**
+ * @brief Gatewayセッションが確立済み (READY/RESUMED 受信後) か
+ * false の間は discord_poll() でフォールバックする
+ */
+bool discord_gateway_is_ready(void);
+
+/**
+ * @brief Gatewayから届いたメッセージを取り出す
+ * @param out_msgs 出力バッファ
+ * @param max_msgs 最大取得数
+ * @param timeout_ms 最初の1件を待つ最大時間
+ * @return 取得したメッセージ数 (0〜max_msgs)
+ */
+int discord_gateway_receive(discord_message_t *out_msgs, int max_msgs, int timeout_ms);
+
+/**
+ * @brief Gatewayモードの有効/無効をNVSに保存（再起動後に反映）
+ */
+esp_err_t discord_gateway_set_enabled(bool enabled);
+
+/**
+ * @brief Gateway接続先URLをNVSに保存（ローカル検証用スタブサーバー向け）
+ */
+esp_err_t discord_gateway_set_url(const char *url);
+
+/**
+ * @brief Gateway統計を取得
+ */
+void discord_gateway_get_stats(discord_gateway_stats_t *out);
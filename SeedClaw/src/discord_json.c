@@ -0,0 +1,436 @@
+#include "discord_json.h"
+#include <string.h>
+#include <stdlib.h>
+
+enum {
+    LEX_NONE,
+    LEX_STRING,
+    LEX_ESCAPE,
+    LEX_UNICODE,
+    LEX_PRIM,
+};
+
+enum {
+    KEY_NONE,
+    KEY_ID,
+    KEY_CONTENT,
+    KEY_AUTHOR,
+    KEY_BOT,
+    KEY_RETRY_AFTER,
+    KEY_CHANNEL_ID,
+    KEY_OP,
+    KEY_SEQ,
+    KEY_TYPE,
+    KEY_DATA,
+};
+
+static bool top_is_object(const discord_json_parser_t *p)
+{
+    return p->depth > 0 && (p->obj_stack & (1u << (p->depth - 1))) != 0;
+}
+
+static bool depth_is_object(const discord_json_parser_t *p, int depth)
+{
+    return depth > 0 && (p->obj_stack & (1u << (depth - 1))) != 0;
+}
+
+// ── 文字列の書き込み（UTF-8の文字単位で打ち切る） ──
+
+static void put_bytes(discord_json_parser_t *p, const char *bytes, size_t n)
+{
+    if (p->dst == NULL || p->dst_full) {
+        return;
+    }
+    if (p->dst_len + n >= p->dst_size) {
+        p->dst_full = true;
+        return;
+    }
+    memcpy(p->dst + p->dst_len, bytes, n);
+    p->dst_len += n;
+}
+
+static void put_codepoint(discord_json_parser_t *p, uint32_t cp)
+{
+    char buf[4];
+    size_t n;
+    if (cp < 0x80) {
+        buf[0] = (char)cp;
+        n = 1;
+    } else if (cp < 0x800) {
+        buf[0] = (char)(0xC0 | (cp >> 6));
+        buf[1] = (char)(0x80 | (cp & 0x3F));
+        n = 2;
+    } else if (cp < 0x10000) {
+        buf[0] = (char)(0xE0 | (cp >> 12));
+        buf[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        buf[2] = (char)(0x80 | (cp & 0x3F));
+        n = 3;
+    } else {
+        buf[0] = (char)(0xF0 | (cp >> 18));
+        buf[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+        buf[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        buf[3] = (char)(0x80 | (cp & 0x3F));
+        n = 4;
+    }
+    put_bytes(p, buf, n);
+}
+
+// 未完結のサロゲート上位を '?' として吐き出す
+static void flush_pending_surrogate(discord_json_parser_t *p)
+{
+    if (p->uni_high != 0) {
+        put_bytes(p, "?", 1);
+        p->uni_high = 0;
+    }
+}
+
+// 生バイトの途中で打ち切られた場合に末尾の不完全なUTF-8列を削る
+static size_t utf8_trim_tail(const char *s, size_t len)
+{
+    size_t i = len;
+    int back = 0;
+    while (i > 0 && back < 4) {
+        unsigned char c = (unsigned char)s[i - 1];
+        if ((c & 0xC0) != 0x80) {
+            size_t need = (c < 0x80) ? 1 : ((c & 0xE0) == 0xC0) ? 2 : ((c & 0xF0) == 0xE0) ? 3 : 4;
+            return (len - (i - 1) >= need) ? len : i - 1;
+        }
+        i--;
+        back++;
+    }
+    return len;
+}
+
+// ── キー/値の判定 ──
+
+static uint8_t match_key(const discord_json_parser_t *p)
+{
+    if (p->key_overflow) {
+        return KEY_NONE;
+    }
+    const char *k = p->key_buf;
+    if (p->depth == 2 && p->cur >= 0) {
+        if (strcmp(k, "id") == 0) return KEY_ID;
+        if (strcmp(k, "content") == 0) return KEY_CONTENT;
+        if (strcmp(k, "author") == 0) return KEY_AUTHOR;
+        if (p->event && strcmp(k, "channel_id") == 0) return KEY_CHANNEL_ID;
+    } else if (p->depth == 3 && p->in_author) {
+        if (strcmp(k, "id") == 0) return KEY_ID;
+        if (strcmp(k, "bot") == 0) return KEY_BOT;
+    } else if (p->depth == 1 && p->event) {
+        if (strcmp(k, "op") == 0) return KEY_OP;
+        if (strcmp(k, "s") == 0) return KEY_SEQ;
+        if (strcmp(k, "t") == 0) return KEY_TYPE;
+        if (strcmp(k, "d") == 0) return KEY_DATA;
+    } else if (p->depth == 1) {
+        if (strcmp(k, "retry_after") == 0) return KEY_RETRY_AFTER;
+    }
+    return KEY_NONE;
+}
+
+static void begin_string(discord_json_parser_t *p)
+{
+    p->lex = LEX_STRING;
+    p->dst = NULL;
+    p->dst_len = 0;
+    p->uni_high = 0;
+    p->dst_full = false;
+
+    if (top_is_object(p) && p->expect_key) {
+        p->dst = p->key_buf;
+        p->dst_size = sizeof(p->key_buf);
+        return;
+    }
+
+    if (p->event && p->depth == 1 && p->key == KEY_TYPE) {
+        p->dst = p->type;
+        p->dst_size = sizeof(p->type);
+        return;
+    }
+    if (p->cur < 0) {
+        return;
+    }
+    discord_message_t *msg = &p->out[p->cur];
+    if (p->depth == 2 && p->key == KEY_ID) {
+        p->dst = msg->id;
+        p->dst_size = sizeof(msg->id);
+    } else if (p->depth == 2 && p->key == KEY_CONTENT) {
+        p->dst = msg->content;
+        p->dst_size = sizeof(msg->content);
+    } else if (p->depth == 2 && p->key == KEY_CHANNEL_ID) {
+        p->dst = p->channel_id;
+        p->dst_size = sizeof(p->channel_id);
+    } else if (p->depth == 3 && p->in_author && p->key == KEY_ID) {
+        p->dst = msg->author_id;
+        p->dst_size = sizeof(msg->author_id);
+    }
+}
+
+static void end_string(discord_json_parser_t *p)
+{
+    flush_pending_surrogate(p);
+    p->lex = LEX_NONE;
+
+    if (top_is_object(p) && p->expect_key) {
+        p->key_overflow = p->dst_full;
+        p->key_buf[p->dst_len] = '\0';
+        p->key = match_key(p);
+        p->expect_key = false;
+        p->dst = NULL;
+        return;
+    }
+
+    if (p->dst != NULL) {
+        if (p->dst_full) {
+            p->dst_len = utf8_trim_tail(p->dst, p->dst_len);
+        }
+        p->dst[p->dst_len] = '\0';
+    }
+    p->dst = NULL;
+}
+
+static void end_primitive(discord_json_parser_t *p)
+{
+    p->prim[p->prim_len] = '\0';
+    p->lex = LEX_NONE;
+
+    if (p->depth == 3 && p->in_author && p->cur >= 0 && p->key == KEY_BOT) {
+        p->out[p->cur].author_is_bot = (strcmp(p->prim, "true") == 0);
+    } else if (p->depth == 1 && p->key == KEY_RETRY_AFTER) {
+        p->retry_after = strtof(p->prim, NULL);
+    } else if (p->depth == 1 && p->key == KEY_OP) {
+        p->op = (int)strtol(p->prim, NULL, 10);
+    } else if (p->depth == 1 && p->key == KEY_SEQ && strcmp(p->prim, "null") != 0) {
+        p->seq = (int32_t)strtol(p->prim, NULL, 10);
+    }
+}
+
+static void begin_container(discord_json_parser_t *p, bool is_object)
+{
+    if (p->depth >= DISCORD_JSON_MAX_DEPTH) {
+        p->error = true;
+        return;
+    }
+
+    int parent_depth = p->depth;
+    uint8_t parent_key = p->key;
+    p->depth++;
+    if (is_object) {
+        p->obj_stack |= (1u << (p->depth - 1));
+    } else {
+        p->obj_stack &= ~(1u << (p->depth - 1));
+    }
+    p->expect_key = is_object;
+    p->key = KEY_NONE;
+
+    bool message = p->event ? (parent_key == KEY_DATA) : !depth_is_object(p, 1);
+    if (is_object && p->depth == 2 && parent_depth == 1 && message) {
+        // メッセージ配列の要素（イベントフレームでは d）
+        if (p->count < p->max_msgs) {
+            p->cur = p->count;
+            memset(&p->out[p->cur], 0, sizeof(discord_message_t));
+        } else {
+            p->cur = -1;
+        }
+    } else if (is_object && p->depth == 3 && p->cur >= 0 && parent_key == KEY_AUTHOR) {
+        p->in_author = true;
+    }
+}
+
+static void end_container(discord_json_parser_t *p, bool is_object)
+{
+    if (p->depth == 0 || top_is_object(p) != is_object) {
+        p->error = true;
+        return;
+    }
+
+    if (p->depth == 3 && p->in_author) {
+        p->in_author = false;
+    } else if (p->depth == 2 && p->cur >= 0) {
+        p->count++;
+        p->cur = -1;
+    }
+
+    p->depth--;
+    p->expect_key = false;
+    p->key = KEY_NONE;
+}
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// ── 公開API ──
+
+void discord_json_init(discord_json_parser_t *p, discord_message_t *out, int max_msgs)
+{
+    p->out = out;
+    p->max_msgs = max_msgs;
+    p->event = false;
+    discord_json_reset(p);
+}
+
+void discord_json_init_event(discord_json_parser_t *p, discord_message_t *out)
+{
+    p->out = out;
+    p->max_msgs = 1;
+    p->event = true;
+    discord_json_reset(p);
+}
+
+void discord_json_reset(discord_json_parser_t *p)
+{
+    discord_message_t *out = p->out;
+    int max_msgs = p->max_msgs;
+    bool event = p->event;
+    memset(p, 0, sizeof(*p));
+    p->out = out;
+    p->max_msgs = max_msgs;
+    p->event = event;
+    p->cur = -1;
+    p->retry_after = -1.0f;
+    p->op = -1;
+    p->seq = -1;
+}
+
+void discord_json_feed(discord_json_parser_t *p, const char *data, size_t len)
+{
+    for (size_t i = 0; i < len && !p->error; i++) {
+        char c = data[i];
+
+        switch (p->lex) {
+            case LEX_STRING:
+                if (c == '"') {
+                    end_string(p);
+                } else if (c == '\\') {
+                    p->lex = LEX_ESCAPE;
+                } else if ((unsigned char)c < 0x20) {
+                    p->error = true;
+                } else {
+                    flush_pending_surrogate(p);
+                    put_bytes(p, &c, 1);
+                }
+                continue;
+
+            case LEX_ESCAPE: {
+                char mapped;
+                p->lex = LEX_STRING;
+                switch (c) {
+                    case 'n': mapped = '\n'; break;
+                    case 't': mapped = '\t'; break;
+                    case 'r': mapped = '\r'; break;
+                    case 'b': mapped = '\b'; break;
+                    case 'f': mapped = '\f'; break;
+                    case '/': mapped = '/'; break;
+                    case '\\': mapped = '\\'; break;
+                    case '"': mapped = '"'; break;
+                    case 'u':
+                        p->lex = LEX_UNICODE;
+                        p->uni = 0;
+                        p->uni_digits = 0;
+                        continue;
+                    default:
+                        p->error = true;
+                        continue;
+                }
+                flush_pending_surrogate(p);
+                put_bytes(p, &mapped, 1);
+                continue;
+            }
+
+            case LEX_UNICODE: {
+                int h = hex_value(c);
+                if (h < 0) {
+                    p->error = true;
+                    continue;
+                }
+                p->uni = (p->uni << 4) | (uint32_t)h;
+                if (++p->uni_digits < 4) {
+                    continue;
+                }
+                p->lex = LEX_STRING;
+                if (p->uni >= 0xD800 && p->uni <= 0xDBFF) {
+                    flush_pending_surrogate(p);
+                    p->uni_high = p->uni;
+                } else if (p->uni >= 0xDC00 && p->uni <= 0xDFFF) {
+                    if (p->uni_high != 0) {
+                        uint32_t cp = 0x10000 + ((p->uni_high - 0xD800) << 10) + (p->uni - 0xDC00);
+                        p->uni_high = 0;
+                        put_codepoint(p, cp);
+                    } else {
+                        put_bytes(p, "?", 1);
+                    }
+                } else {
+                    flush_pending_surrogate(p);
+                    put_codepoint(p, p->uni);
+                }
+                continue;
+            }
+
+            case LEX_PRIM:
+                if (c == ',' || c == '}' || c == ']' || c == ' ' ||
+                    c == '\n' || c == '\r' || c == '\t') {
+                    end_primitive(p);
+                    break;  // 区切り文字として下で処理
+                }
+                if (p->prim_len < sizeof(p->prim) - 1) {
+                    p->prim[p->prim_len++] = c;
+                }
+                continue;
+
+            default:
+                break;
+        }
+
+        // LEX_NONE: 構造文字
+        switch (c) {
+            case ' ': case '\n': case '\r': case '\t': case ':':
+                break;
+            case '{':
+                begin_container(p, true);
+                break;
+            case '[':
+                begin_container(p, false);
+                break;
+            case '}':
+                end_container(p, true);
+                break;
+            case ']':
+                end_container(p, false);
+                break;
+            case ',':
+                if (top_is_object(p)) {
+                    p->expect_key = true;
+                }
+                p->key = KEY_NONE;
+                break;
+            case '"':
+                begin_string(p);
+                break;
+            default:
+                if ((c >= '0' && c <= '9') || c == '-' || c == 't' || c == 'f' || c == 'n') {
+                    p->lex = LEX_PRIM;
+                    p->prim[0] = c;
+                    p->prim_len = 1;
+                } else {
+                    p->error = true;
+                }
+                break;
+        }
+    }
+}
+
+int discord_json_finish(discord_json_parser_t *p)
+{
+    if (p->lex == LEX_PRIM) {
+        end_primitive(p);
+    }
+    if (p->error || p->depth != 0 || p->lex != LEX_NONE) {
+        return -1;
+    }
+    return p->count;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "discord.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Discord REST応答のストリーミング抽出器
+ *
+ * HTTPのデータコールバックから受け取ったチャンクをそのまま流し込み、
+ * メッセージ配列から id / content / author.id / author.bot だけを
+ * discord_message_t に直接書き込む。embeds等の不要なサブツリーは
+ * 深さだけ数えて読み飛ばすため、作業領域は応答サイズによらず固定。
+ * ESP-IDF非依存なのでホスト上でもビルドできる。
+ *
+ * discord_json_init_event() で初期化すると、Gatewayのイベントフレーム
+ * {"op":..,"s":..,"t":..,"d":{メッセージ}} を同じ要領で読み、op / s / t と
+ * d のメッセージ（channel_id を含む）を取り出す。再組み立てバッファに
+ * 収まらない大きなフレームでも本文を切り詰めて受け取れる。
+ */
+
+#define DISCORD_JSON_MAX_DEPTH  32
+
+typedef struct {
+    // 出力先
+    discord_message_t *out;
+    int max_msgs;
+    int count;
+    int cur;                    // 書き込み中のメッセージ (-1 = 読み飛ばし)
+    float retry_after;          // 429応答の retry_after (秒、未受信なら負)
+
+    // Gatewayイベントフレーム（discord_json_init_event() のときのみ）
+    bool event;
+    int op;                     // 未受信なら -1
+    int32_t seq;                // 未受信/null なら -1
+    char type[32];              // t（未受信/null なら空）
+    char channel_id[24];        // d.channel_id
+
+    // 構文状態
+    uint32_t obj_stack;         // 深さごとのコンテナ種別 (1 = object)
+    int depth;
+    bool expect_key;            // object内で次に来る文字列がキーか
+    bool in_author;             // 深さ3の author オブジェクト内か
+    bool error;
+
+    // 文字列/プリミティブの読み取り状態
+    uint8_t lex;                // 字句状態
+    uint8_t key;                // 直前に読んだキーの種別
+    char key_buf[16];
+    bool key_overflow;
+    char *dst;                  // 文字列の書き込み先 (NULL = 捨てる)
+    size_t dst_size;
+    size_t dst_len;
+    bool dst_full;              // 書き込み先が満杯（以降の文字は捨てる）
+    uint32_t uni;               // \uXXXX のデコード中の値
+    uint32_t uni_high;          // サロゲートペアの上位
+    uint8_t uni_digits;
+    char prim[24];              // true/false/数値の読み取り
+    uint8_t prim_len;
+} discord_json_parser_t;
+
+/**
+ * @brief 抽出器を初期化
+ * @param out メッセージ出力バッファ（応答順 = 新しい順に格納）
+ * @param max_msgs 最大格納数（超えた分は読み飛ばす）
+ */
+void discord_json_init(discord_json_parser_t *p, discord_message_t *out, int max_msgs);
+
+/**
+ * @brief Gatewayイベントフレーム用に初期化（d のメッセージを out[0] に格納）
+ */
+void discord_json_init_event(discord_json_parser_t *p, discord_message_t *out);
+
+/**
+ * @brief 受信済みの出力をすべて破棄して最初からやり直す
+ */
+void discord_json_reset(discord_json_parser_t *p);
+
+/**
+ * @brief 受信チャンクを流し込む（任意の位置で分割されていてよい）
+ */
+void discord_json_feed(discord_json_parser_t *p, const char *data, size_t len);
+
+/**
+ * @brief 入力終了を通知し、抽出したメッセージ数を返す
+ * @return メッセージ数、JSONが不正または途中で終わった場合は -1
+ *         （イベントフレームでは d をメッセージとして読めたら 1、それ以外は 0）
+ */
+int discord_json_finish(discord_json_parser_t *p);
@@ -0,0 +1,256 @@
+#include "discord_ratelimit.h"
+#include "seedclaw_config.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+
+static const char *TAG = "discord_rl";
+
+typedef struct {
+    char route[32];
+    char bucket[40];
+    int limit;
+    int remaining;
+    int64_t reset_at_us;      // 残量がリセットされる時刻 (0 = 不明)
+    int64_t blocked_until_us; // 429で指定された再開時刻
+    int reserved;             // acquire で減らし、まだ応答で確定していない残量
+    uint32_t requests;
+    uint32_t deferred;
+    uint32_t hits_429;
+} rl_route_t;
+
+static rl_route_t s_routes[SEEDCLAW_DISCORD_RL_MAX_ROUTES];
+static int s_route_count = 0;
+static int64_t s_global_until_us = 0;
+static SemaphoreHandle_t s_mutex = NULL;
+
+static void rl_lock(void)
+{
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+}
+
+static void rl_unlock(void)
+{
+    xSemaphoreGive(s_mutex);
+}
+
+static rl_route_t *find_route(const char *route, bool create)
+{
+    for (int i = 0; i < s_route_count; i++) {
+        if (strcmp(s_routes[i].route, route) == 0) {
+            return &s_routes[i];
+        }
+    }
+    if (!create || s_route_count >= SEEDCLAW_DISCORD_RL_MAX_ROUTES) {
+        return NULL;
+    }
+    rl_route_t *r = &s_routes[s_route_count++];
+    memset(r, 0, sizeof(*r));
+    strncpy(r->route, route, sizeof(r->route) - 1);
+    r->limit = -1;
+    r->remaining = -1;
+    return r;
+}
+
+// リセット時刻を過ぎていれば残量を満タンに戻す
+static void refresh(rl_route_t *r, int64_t now_us)
+{
+    if (r->reset_at_us != 0 && now_us >= r->reset_at_us) {
+        r->remaining = r->limit;
+        r->reset_at_us = 0;
+        r->reserved = 0;
+    }
+}
+
+esp_err_t discord_ratelimit_init(void)
+{
+    if (s_mutex == NULL) {
+        s_mutex = xSemaphoreCreateMutex();
+        if (s_mutex == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    return ESP_OK;
+}
+
+void discord_ratelimit_clear_headers(discord_rl_headers_t *hdr)
+{
+    hdr->limit = -1;
+    hdr->remaining = -1;
+    hdr->reset_after_ms = -1;
+    hdr->retry_after_ms = -1;
+    hdr->global = false;
+    hdr->bucket[0] = '\0';
+}
+
+void discord_ratelimit_parse_header(discord_rl_headers_t *hdr, const char *key, const char *value)
+{
+    if (strncasecmp(key, "X-RateLimit-", 12) == 0) {
+        const char *k = key + 12;
+        if (strcasecmp(k, "Limit") == 0) {
+            hdr->limit = atoi(value);
+        } else if (strcasecmp(k, "Remaining") == 0) {
+            hdr->remaining = atoi(value);
+        } else if (strcasecmp(k, "Reset-After") == 0) {
+            hdr->reset_after_ms = (int)(strtof(value, NULL) * 1000);
+        } else if (strcasecmp(k, "Bucket") == 0) {
+            strncpy(hdr->bucket, value, sizeof(hdr->bucket) - 1);
+            hdr->bucket[sizeof(hdr->bucket) - 1] = '\0';
+        } else if (strcasecmp(k, "Global") == 0) {
+            hdr->global = (strcasecmp(value, "true") == 0);
+        } else if (strcasecmp(k, "Scope") == 0) {
+            hdr->global = hdr->global || (strcasecmp(value, "global") == 0);
+        }
+    } else if (strcasecmp(key, "Retry-After") == 0) {
+        hdr->retry_after_ms = (int)(strtof(value, NULL) * 1000);
+    }
+}
+
+uint32_t discord_ratelimit_acquire(const char *route)
+{
+    int64_t now_us = esp_timer_get_time();
+    int64_t wait_until_us = 0;
+
+    rl_lock();
+    rl_route_t *r = find_route(route, true);
+
+    if (s_global_until_us > now_us) {
+        wait_until_us = s_global_until_us;
+    }
+    if (r != NULL) {
+        refresh(r, now_us);
+        if (r->blocked_until_us > wait_until_us) {
+            wait_until_us = r->blocked_until_us;
+        }
+        if (r->remaining == 0 && r->reset_at_us > wait_until_us) {
+            wait_until_us = r->reset_at_us;
+        }
+
+        if (wait_until_us > now_us) {
+            r->deferred++;
+        } else {
+            // 応答が返るまでの間に他のタスクが残量を食い潰さないよう先に減らす
+            r->requests++;
+            if (r->remaining > 0) {
+                r->remaining--;
+                r->reserved++;
+            }
+        }
+    }
+    rl_unlock();
+
+    if (wait_until_us <= now_us) {
+        return 0;
+    }
+    return (uint32_t)((wait_until_us - now_us + 999) / 1000);
+}
+
+void discord_ratelimit_refund(const char *route)
+{
+    rl_lock();
+    rl_route_t *r = find_route(route, false);
+    if (r != NULL && r->reserved > 0) {
+        r->reserved--;
+        r->remaining++;
+    }
+    rl_unlock();
+}
+
+void discord_ratelimit_update(const char *route, const discord_rl_headers_t *hdr, int status)
+{
+    int64_t now_us = esp_timer_get_time();
+
+    rl_lock();
+    rl_route_t *r = find_route(route, true);
+    if (r == NULL) {
+        rl_unlock();
+        return;
+    }
+
+    if (hdr->bucket[0] != '\0') {
+        strncpy(r->bucket, hdr->bucket, sizeof(r->bucket) - 1);
+    }
+    if (hdr->limit >= 0) {
+        r->limit = hdr->limit;
+    }
+    if (hdr->remaining >= 0) {
+        r->remaining = hdr->remaining;
+    }
+    if (r->reserved > 0) {
+        r->reserved--;        // 応答が来たので予約は確定
+    }
+    if (hdr->reset_after_ms >= 0) {
+        r->reset_at_us = now_us + (int64_t)hdr->reset_after_ms * 1000;
+    }
+
+    if (status == 429) {
+        r->hits_429++;
+        int retry_ms = (hdr->retry_after_ms > 0) ? hdr->retry_after_ms :
+                       (hdr->reset_after_ms > 0) ? hdr->reset_after_ms : 1000;
+        int64_t until_us = now_us + (int64_t)retry_ms * 1000;
+        if (hdr->global) {
+            s_global_until_us = until_us;
+        } else {
+            r->blocked_until_us = until_us;
+        }
+        ESP_LOGW(TAG, "429 on %s%s, blocked for %dms", route,
+                 hdr->global ? " (global)" : "", retry_ms);
+    }
+
+    // 同じバケットを共有するルートにも残量を反映
+    if (r->bucket[0] != '\0') {
+        for (int i = 0; i < s_route_count; i++) {
+            rl_route_t *o = &s_routes[i];
+            if (o != r && strcmp(o->bucket, r->bucket) == 0) {
+                o->limit = r->limit;
+                o->remaining = r->remaining;
+                o->reset_at_us = r->reset_at_us;
+                o->blocked_until_us = r->blocked_until_us;
+            }
+        }
+    }
+    rl_unlock();
+}
+
+int discord_ratelimit_remaining(const char *route)
+{
+    int remaining = -1;
+
+    rl_lock();
+    rl_route_t *r = find_route(route, false);
+    if (r != NULL) {
+        refresh(r, esp_timer_get_time());
+        remaining = r->remaining;
+    }
+    rl_unlock();
+    return remaining;
+}
+
+int discord_ratelimit_snapshot(discord_rl_route_t *out, int max)
+{
+    int64_t now_us = esp_timer_get_time();
+    int n = 0;
+
+    rl_lock();
+    for (int i = 0; i < s_route_count && n < max; i++) {
+        rl_route_t *r = &s_routes[i];
+        refresh(r, now_us);
+        discord_rl_route_t *o = &out[n++];
+        strncpy(o->route, r->route, sizeof(o->route) - 1);
+        o->route[sizeof(o->route) - 1] = '\0';
+        strncpy(o->bucket, r->bucket, sizeof(o->bucket) - 1);
+        o->bucket[sizeof(o->bucket) - 1] = '\0';
+        o->limit = r->limit;
+        o->remaining = r->remaining;
+        o->reset_in_ms = (r->reset_at_us > now_us) ? (uint32_t)((r->reset_at_us - now_us) / 1000) : 0;
+        o->requests = r->requests;
+        o->deferred = r->deferred;
+        o->hits_429 = r->hits_429;
+    }
+    rl_unlock();
+    return n;
+}
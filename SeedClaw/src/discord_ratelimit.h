@@ -0,0 +1,80 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Discord レート制限バケットの追跡
+ *
+ * 応答ごとの X-RateLimit-* ヘッダをルート単位で記録し、次のリクエストを
+ * 出してよいまでの待ち時間を返す。同じバケットIDを返したルート同士は
+ * 残量を共有する。429を受けてから止まるのではなく、残量が尽きた時点で
+ * リセットまで送信を控えることで429自体を避ける。
+ */
+
+#define DISCORD_ROUTE_POLL     "GET /channels/{id}/messages"
+#define DISCORD_ROUTE_WEBHOOK  "POST /webhooks/{id}"
+
+// 1応答分のレート制限ヘッダ（未受信の項目は -1 / 空文字）
+typedef struct {
+    int limit;               // X-RateLimit-Limit
+    int remaining;           // X-RateLimit-Remaining
+    int reset_after_ms;      // X-RateLimit-Reset-After
+    int retry_after_ms;      // Retry-After (429時)
+    bool global;             // X-RateLimit-Global / X-RateLimit-Scope: global
+    char bucket[40];         // X-RateLimit-Bucket
+} discord_rl_headers_t;
+
+typedef struct {
+    char route[32];
+    char bucket[40];
+    int limit;               // -1 = 不明
+    int remaining;           // -1 = 不明
+    uint32_t reset_in_ms;    // リセットまでの残り時間（0 = リセット済み）
+    uint32_t requests;       // このルートに出したリクエスト数
+    uint32_t deferred;       // 残量切れで見送った回数
+    uint32_t hits_429;       // 受けた429の数
+} discord_rl_route_t;
+
+/**
+ * @brief 追跡テーブルを初期化（discord_init() から呼ばれる）
+ */
+esp_err_t discord_ratelimit_init(void);
+
+/**
+ * @brief ヘッダ構造体を「未受信」状態に初期化
+ */
+void discord_ratelimit_clear_headers(discord_rl_headers_t *hdr);
+
+/**
+ * @brief ヘッダ1行を解析して hdr に反映（HTTP_EVENT_ON_HEADER から呼ぶ）
+ */
+void discord_ratelimit_parse_header(discord_rl_headers_t *hdr, const char *key, const char *value);
+
+/**
+ * @brief route にリクエストを出す前に呼ぶ。待つべき時間を返す
+ * @return 0 なら今すぐ送ってよい（残量を1つ予約する）。正なら待ち時間(ms)
+ */
+uint32_t discord_ratelimit_acquire(const char *route);
+
+/**
+ * @brief acquire で予約した残量を返す（通信エラーで応答が無かったとき）
+ */
+void discord_ratelimit_refund(const char *route);
+
+/**
+ * @brief 応答を受け取ったら呼ぶ。ヘッダからバケット状態を更新する
+ */
+void discord_ratelimit_update(const char *route, const discord_rl_headers_t *hdr, int status);
+
+/**
+ * @brief route の既知の残量を返す（不明なら -1）
+ */
+int discord_ratelimit_remaining(const char *route);
+
+/**
+ * @brief 追跡中のルート一覧を取得
+ * @return 書き込んだ件数
+ */
+int discord_ratelimit_snapshot(discord_rl_route_t *out, int max);
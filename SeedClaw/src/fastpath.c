@@ -0,0 +1,231 @@
+#include "fastpath.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FASTPATH_MAX_TOKENS  5
+#define FASTPATH_NORM_MAX    64
+
+// XIAO ESP32C3 の Dx → GPIO（D9 は BOOT ピンなので対象外）
+static const int s_d_pins[] = { 2, 3, 4, 5, 6, 7, 21, 20, 8, -1, 10 };
+
+// 語として置き換える和文（区切りの助詞は空白にする）
+static const struct {
+    const char *from;
+    const char *to;
+} s_words[] = {
+    { "オン", " on " },
+    { "オフ", " off " },
+    { "にして", " " },
+    { "を", " " },
+    { "は", " " },
+    { "。", " " },
+    { "、", " " },
+    { "\xE3\x80\x80", " " },   // 全角スペース
+};
+
+/*
+ * 小文字の半角ASCIIへ正規化する。全角英数字記号 (U+FF01〜FF5E) は半角にし、
+ * 置き換え表にない非ASCII文字が残れば失敗（=自由文なので LLM に回す）。
+ */
+static bool normalize(const char *text, char *out, size_t out_size)
+{
+    const unsigned char *p = (const unsigned char *)text;
+    size_t len = 0;
+
+    while (*p) {
+        const char *rep = NULL;
+        size_t adv = 0;
+        char ascii = 0;
+
+        if (*p < 0x80) {
+            ascii = (char)tolower(*p);
+            adv = 1;
+        } else if (p[0] == 0xEF && (p[1] == 0xBC || p[1] == 0xBD) && p[2] != 0) {
+            // U+FF01〜FF5E は EF BC 81 〜 EF BD 9E
+            unsigned cp = 0xFF00 | ((p[1] & 0x03) << 6) | (p[2] & 0x3F);
+            if (cp < 0xFF01 || cp > 0xFF5E) {
+                return false;
+            }
+            ascii = (char)tolower((int)(cp - 0xFF01 + 0x21));
+            adv = 3;
+        } else {
+            for (size_t i = 0; i < sizeof(s_words) / sizeof(s_words[0]); i++) {
+                size_t n = strlen(s_words[i].from);
+                if (strncmp((const char *)p, s_words[i].from, n) == 0) {
+                    rep = s_words[i].to;
+                    adv = n;
+                    break;
+                }
+            }
+            if (rep == NULL) {
+                return false;
+            }
+        }
+
+        size_t n = rep ? strlen(rep) : 1;
+        if (len + n >= out_size) {
+            return false;
+        }
+        if (rep) {
+            memcpy(out + len, rep, n);
+        } else {
+            out[len] = ascii;
+        }
+        len += n;
+        p += adv;
+    }
+    out[len] = '\0';
+    return true;
+}
+
+// 10進の非負整数（全体が数字であること）
+static bool parse_uint(const char *s, int *out)
+{
+    if (*s == '\0' || strlen(s) > 5) {
+        return false;
+    }
+    for (const char *c = s; *c; c++) {
+        if (!isdigit((unsigned char)*c)) {
+            return false;
+        }
+    }
+    *out = atoi(s);
+    return true;
+}
+
+// ピン指定を GPIO番号に変換する。"gpio 5" のように番号が次のトークンに分かれていてもよい
+static bool parse_pin(char **tok, int ntok, int *i, int *out_pin)
+{
+    const char *t = tok[*i];
+    int n;
+
+    if (strncmp(t, "gpio", 4) == 0) {
+        if (t[4] == '\0') {
+            if (*i + 1 >= ntok || !parse_uint(tok[*i + 1], &n)) {
+                return false;
+            }
+            (*i)++;
+        } else if (!parse_uint(t + 4, &n)) {
+            return false;
+        }
+        *out_pin = n;
+    } else if (t[0] == 'd' && parse_uint(t + 1, &n)) {
+        if (n >= (int)(sizeof(s_d_pins) / sizeof(s_d_pins[0])) || s_d_pins[n] < 0) {
+            return false;
+        }
+        *out_pin = s_d_pins[n];
+    } else if (t[0] == 'a' && parse_uint(t + 1, &n)) {
+        if (n > 2) {
+            return false;
+        }
+        *out_pin = s_d_pins[n];
+    } else if (parse_uint(t, &n)) {
+        *out_pin = n;
+    } else {
+        return false;
+    }
+    (*i)++;
+    return true;
+}
+
+static int parse_state(const char *t)
+{
+    if (strcmp(t, "on") == 0 || strcmp(t, "high") == 0 || strcmp(t, "1") == 0) {
+        return 1;
+    }
+    if (strcmp(t, "off") == 0 || strcmp(t, "low") == 0 || strcmp(t, "0") == 0) {
+        return 0;
+    }
+    return -1;
+}
+
+bool fastpath_parse(const char *text, fastpath_cmd_t *out)
+{
+    char buf[FASTPATH_NORM_MAX];
+    if (!normalize(text, buf, sizeof(buf))) {
+        return false;
+    }
+
+    // 空白区切りでトークン化（末尾の ! ? . は無視）
+    char *tok[FASTPATH_MAX_TOKENS];
+    int ntok = 0;
+    char *save = NULL;
+    for (char *s = strtok_r(buf, " \t\r\n", &save); s != NULL; s = strtok_r(NULL, " \t\r\n", &save)) {
+        size_t n = strlen(s);
+        while (n > 0 && (s[n - 1] == '!' || s[n - 1] == '?' || s[n - 1] == '.')) {
+            s[--n] = '\0';
+        }
+        if (n == 0) {
+            continue;
+        }
+        if (ntok == FASTPATH_MAX_TOKENS) {
+            return false;
+        }
+        tok[ntok++] = s;
+    }
+    if (ntok == 0) {
+        return false;
+    }
+
+    const char *verb = tok[0];
+    int i = 1;
+    int pin;
+
+    if (strcmp(verb, "status") == 0 || strcmp(verb, "gpio_status") == 0) {
+        if (ntok != 1) {
+            return false;
+        }
+        out->tool = "gpio_status";
+        strcpy(out->input, "{}");
+        return true;
+    }
+
+    if (strcmp(verb, "read") == 0 || strcmp(verb, "gpio_read") == 0 ||
+        strcmp(verb, "adc") == 0 || strcmp(verb, "adc_read") == 0) {
+        if (!parse_pin(tok, ntok, &i, &pin) || i != ntok) {
+            return false;
+        }
+        out->tool = (verb[0] == 'a') ? "adc_read" : "gpio_read";
+        snprintf(out->input, sizeof(out->input), "{\"pin\":%d}", pin);
+        return true;
+    }
+
+    if (strcmp(verb, "pwm") == 0 || strcmp(verb, "pwm_set") == 0) {
+        int duty, freq = 1000;
+        if (!parse_pin(tok, ntok, &i, &pin) || i >= ntok ||
+            !parse_uint(tok[i++], &duty) || duty > 100) {
+            return false;
+        }
+        if (i < ntok && (!parse_uint(tok[i++], &freq) || freq == 0 || freq > 40000)) {
+            return false;
+        }
+        if (i != ntok) {
+            return false;
+        }
+        out->tool = "pwm_set";
+        snprintf(out->input, sizeof(out->input), "{\"pin\":%d,\"duty\":%d,\"freq\":%d}",
+                 pin, duty, freq);
+        return true;
+    }
+
+    // <pin> <state>
+    i = 0;
+    int unused;
+    bool bare_pin = parse_uint(tok[0], &unused);
+    if (!parse_pin(tok, ntok, &i, &pin) || i + 1 != ntok) {
+        return false;
+    }
+    int value = parse_state(tok[i]);
+    if (value < 0) {
+        return false;
+    }
+    // "5 1" のような数字だけの文は雑談とも読めるので LLM に回す
+    if (bare_pin && isdigit((unsigned char)tok[i][0])) {
+        return false;
+    }
+    out->tool = "gpio_write";
+    snprintf(out->input, sizeof(out->input), "{\"pin\":%d,\"value\":%d}", pin, value);
+    return true;
+}
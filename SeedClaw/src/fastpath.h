@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdbool.h>
+
+/*
+ * 定型コマンドの高速パス
+ *
+ * 「GPIO5をON」「D3 off」「adc 3」「pwm 5 50」のような直接コマンドを
+ * 端末上で解釈し、LLMを介さずにツール呼び出しへ変換する。
+ * 文法は下記に限り、少しでも外れたら解釈せずに LLM へ回す。
+ *
+ *   <pin> [を|は] (on|off|high|low|1|0|オン|オフ) [にして]
+ *   (read|gpio_read) <pin>
+ *   (adc|adc_read) <pin>
+ *   (pwm|pwm_set) <pin> <duty 0-100> [freq]
+ *   (status|gpio_status)
+ *
+ * <pin> は GPIO番号、gpioN、dN（XIAOのD0〜D10表記）、aN（A0〜A2）。
+ * 書き込みで <pin> が番号だけのときは、状態を on/off/high/low/オン/オフ の語で
+ * 書いた場合に限る（"5 1" は曖昧なので LLM へ回す）。
+ * 全角英数字・全角スペースは半角として扱う。ESP-IDF非依存なのでホスト上でもビルドできる。
+ */
+
+typedef struct {
+    const char *tool;        // execute_tool() に渡すツール名
+    char input[64];          // ツール入力JSON
+} fastpath_cmd_t;
+
+/**
+ * @brief メッセージを定型コマンドとして解釈
+ * @return 文法に完全一致した場合のみ true
+ */
+bool fastpath_parse(const char *text, fastpath_cmd_t *out);
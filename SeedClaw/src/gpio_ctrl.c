@@ -3,9 +3,15 @@
 #include "driver/gpio.h"
 #include "driver/ledc.h"
 #include "esp_adc/adc_oneshot.h"
+#include "esp_adc/adc_continuous.h"
 #include "esp_adc/adc_cali.h"
 #include "esp_adc/adc_cali_scheme.h"
+#include "soc/soc.h"
+#include "soc/gpio_reg.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "cJSON.h"
 #include <string.h>
 
@@ -17,6 +23,7 @@ typedef enum {
     PIN_MODE_OUTPUT,
     PIN_MODE_ADC,
     PIN_MODE_PWM,
+    PIN_MODE_COUNTER,    // 入力 + パルスカウンタ
 } pin_mode_t;
 
 typedef struct {
@@ -25,14 +32,59 @@ typedef struct {
     int pwm_duty;        // 0-100 (PWM時のみ)
     int pwm_freq;        // Hz (PWM時のみ)
     int pwm_channel;     // LEDCチャンネル番号 (-1なら未割当)
+    int pwm_timer;       // LEDCタイマー番号 (-1なら未割当)
+    int64_t fade_end_us; // ハードウェアフェードの終了予定時刻
+    gpio_ctrl_pull_t pull; // 入力のプル設定（gpio_ctrl_set_input で指定したもの）
 } pin_state_t;
 
 static pin_state_t s_pin_state[22];
-static int s_next_pwm_channel = 0;
+static uint8_t s_isr_owner[22];      // gpio_isr_owner_t（gpio_watch と共有）
 
-static adc_oneshot_unit_handle_t s_adc_handle = NULL;
+// LEDC: 周波数ごとにタイマーを割り当て、同じ周波数のチャンネルはタイマーを共有する
+static int s_timer_freq[LEDC_TIMER_MAX];
+static int s_timer_refs[LEDC_TIMER_MAX];     // タイマーを使っているチャンネル数
+static int8_t s_channel_pin[SEEDCLAW_PWM_MAX_CHANNELS];  // チャンネルを使っているピン (-1 = 空き)
+
+// ピン状態・ADC・LEDCはワーカー/CLI/ルール評価の各タスクから触るので直列化する
+static SemaphoreHandle_t s_gpio_mutex = NULL;
+// 出力レジスタの読み書きを割り込みに割り込まれないようにする
+static portMUX_TYPE s_gpio_out_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static adc_oneshot_unit_handle_t s_adc_handle = NULL;   // 連続モードが使えない場合のフォールバック
 static adc_cali_handle_t s_adc_cali_handle = NULL;
 
+// ADC連続モード（DMA）: 使用中のADCピンだけをスキャンし、読み取り時に最新フレームを平均する
+static adc_continuous_handle_t s_adc_cont = NULL;
+static uint32_t s_adc_scan_mask = 0;     // スキャン中のピン（GPIO番号のビット）
+static bool s_adc_running = false;
+static int s_adc_oversample = SEEDCLAW_ADC_OVERSAMPLE_DEFAULT;
+static uint8_t s_adc_frame[SEEDCLAW_ADC_CONT_FRAME_BYTES];
+
+// パルスカウンタ: ESP32-C3 には PCNT がないので GPIO 割り込みでエッジを数える
+typedef struct {
+    int pin;                         // -1 = 未使用
+    uint8_t edge;                    // pulse_edge_t
+    uint32_t glitch_us;              // 直前のエッジからこれ未満のエッジは無視
+    volatile uint32_t count;         // ISR だけが増やす
+    volatile int64_t last_edge_us;
+    volatile int64_t first_edge_us;  // freq_measure の窓内で最初のエッジ (0 = なし)
+    int64_t start_us;
+    uint32_t snaps[SEEDCLAW_PULSE_HISTORY_S];  // 1秒ごとの count（直近レート用）
+    int snap_head;
+    int snap_len;
+} pulse_counter_t;
+
+static pulse_counter_t s_counters[SEEDCLAW_PULSE_MAX_COUNTERS];
+static esp_timer_handle_t s_pulse_timer = NULL;
+static portMUX_TYPE s_pulse_lock = portMUX_INITIALIZER_UNLOCKED;
+static int64_t s_pulse_last_snap_us = 0;
+
+// ESP32-C3 の ADC1 は CHn = GPIOn（GPIO0-4）
+static adc_channel_t adc_channel_of(int pin)
+{
+    return (adc_channel_t)pin;
+}
+
 static bool is_pin_allowed(int pin)
 {
     if (pin < 0 || pin >= 22) {
@@ -59,35 +111,428 @@ bool gpio_is_adc_allowed(int pin)
     return is_adc_allowed(pin);
 }
 
+// ── ADCバックエンド ──
+
+static esp_err_t adc_backend_init(void)
+{
+#if SEEDCLAW_ADC_CONTINUOUS
+    adc_continuous_handle_cfg_t cont_cfg = {
+        .max_store_buf_size = SEEDCLAW_ADC_CONT_FRAME_BYTES * 2,
+        .conv_frame_size = SEEDCLAW_ADC_CONT_FRAME_BYTES,
+    };
+    esp_err_t err = adc_continuous_new_handle(&cont_cfg, &s_adc_cont);
+    if (err == ESP_OK) {
+        return ESP_OK;
+    }
+    s_adc_cont = NULL;
+    ESP_LOGW(TAG, "ADC continuous init failed: %s (falling back to oneshot)", esp_err_to_name(err));
+#endif
+
+    adc_oneshot_unit_init_cfg_t init_config = {
+        .unit_id = ADC_UNIT_1,
+    };
+    esp_err_t ret = adc_oneshot_new_unit(&init_config, &s_adc_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "ADC oneshot init failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    // チャンネル設定は初期化時に一度だけ行う
+    adc_oneshot_chan_cfg_t config = {
+        .bitwidth = ADC_BITWIDTH_DEFAULT,
+        .atten = ADC_ATTEN_DB_12,
+    };
+    for (int pin = 0; pin < 22; pin++) {
+        if (is_adc_allowed(pin)) {
+            adc_oneshot_config_channel(s_adc_handle, adc_channel_of(pin), &config);
+        }
+    }
+    return ESP_OK;
+}
+
+// スキャン対象を mask に組み替えて再起動（空なら停止したまま）
+static esp_err_t adc_scan_set_locked(uint32_t mask)
+{
+    if (s_adc_running) {
+        adc_continuous_stop(s_adc_cont);
+        s_adc_running = false;
+    }
+    s_adc_scan_mask = mask;
+    if (mask == 0) {
+        return ESP_OK;
+    }
+
+    adc_digi_pattern_config_t pattern[SEEDCLAW_ADC_MULTI_MAX];
+    int n = 0;
+    for (int pin = 0; pin < 22 && n < SEEDCLAW_ADC_MULTI_MAX; pin++) {
+        if (mask & (1UL << pin)) {
+            pattern[n].atten = ADC_ATTEN_DB_12;
+            pattern[n].channel = adc_channel_of(pin);
+            pattern[n].unit = ADC_UNIT_1;
+            pattern[n].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+            n++;
+        }
+    }
+
+    adc_continuous_config_t dig_cfg = {
+        .pattern_num = n,
+        .adc_pattern = pattern,
+        .sample_freq_hz = SEEDCLAW_ADC_CONT_SAMPLE_HZ,
+        .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+        .format = ADC_DIGI_OUTPUT_FORMAT_TYPE2,
+    };
+    esp_err_t err = adc_continuous_config(s_adc_cont, &dig_cfg);
+    if (err == ESP_OK) {
+        err = adc_continuous_start(s_adc_cont);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "ADC continuous start failed: %s", esp_err_to_name(err));
+        s_adc_scan_mask = 0;
+        return err;
+    }
+    s_adc_running = true;
+    ESP_LOGD(TAG, "ADC scan mask: 0x%lx", (unsigned long)mask);
+    return ESP_OK;
+}
+
+// ADCピンをデジタル/PWMで使う前にスキャン対象から外す
+static void adc_release_pin_locked(int pin)
+{
+    if (s_adc_cont != NULL && (s_adc_scan_mask & (1UL << pin))) {
+        adc_scan_set_locked(s_adc_scan_mask & ~(1UL << pin));
+    }
+}
+
+// 連続モード: 溜まった古いフレームを捨て、各ピン s_adc_oversample 個を平均する
+static esp_err_t adc_cont_sample_locked(uint32_t mask, int *raw_avg, int *samples)
+{
+    if ((s_adc_scan_mask & mask) != mask) {
+        esp_err_t err = adc_scan_set_locked(s_adc_scan_mask | mask);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    adc_continuous_flush_pool(s_adc_cont);
+
+    uint32_t sums[22] = {0};
+    int counts[22] = {0};
+    uint32_t pending = mask;
+    for (int frame = 0; pending != 0 && frame < SEEDCLAW_ADC_CONT_MAX_FRAMES; frame++) {
+        uint32_t len = 0;
+        esp_err_t err = adc_continuous_read(s_adc_cont, s_adc_frame, sizeof(s_adc_frame),
+                                            &len, SEEDCLAW_ADC_CONT_READ_TIMEOUT_MS);
+        if (err != ESP_OK) {
+            break;
+        }
+        for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= len; i += SOC_ADC_DIGI_RESULT_BYTES) {
+            const adc_digi_output_data_t *d = (const adc_digi_output_data_t *)&s_adc_frame[i];
+            int pin = d->type2.channel;   // CHn = GPIOn
+            if (d->type2.unit != 0 || !(pending & (1UL << pin))) {
+                continue;
+            }
+            sums[pin] += d->type2.data;
+            if (++counts[pin] >= s_adc_oversample) {
+                pending &= ~(1UL << pin);
+            }
+        }
+    }
+
+    for (int pin = 0; pin < 22; pin++) {
+        if (!(mask & (1UL << pin))) {
+            continue;
+        }
+        if (counts[pin] == 0) {
+            ESP_LOGE(TAG, "ADC GPIO%d: no samples in continuous frame", pin);
+            return ESP_ERR_TIMEOUT;
+        }
+        raw_avg[pin] = (int)(sums[pin] / counts[pin]);
+        if (samples != NULL && (*samples == 0 || counts[pin] < *samples)) {
+            *samples = counts[pin];
+        }
+    }
+    return ESP_OK;
+}
+
+static void adc_fill_result(int pin, int raw, adc_result_t *result)
+{
+    result->raw = raw;
+
+    // 電圧変換
+    int voltage = 0;
+    if (s_adc_cali_handle == NULL ||
+        adc_cali_raw_to_voltage(s_adc_cali_handle, raw, &voltage) != ESP_OK) {
+        voltage = 0;
+    }
+    result->voltage_mv = voltage;
+
+    // パーセンテージ計算 (0-4095 → 0-100%)
+    result->percentage = (raw * 100) / 4095;
+
+    s_pin_state[pin].mode = PIN_MODE_ADC;
+    s_pin_state[pin].value = raw;
+}
+
+// ── パルスカウンタ ──
+
+static void IRAM_ATTR pulse_isr(void *arg)
+{
+    pulse_counter_t *c = (pulse_counter_t *)arg;
+    int64_t now = esp_timer_get_time();
+    if (c->glitch_us > 0 && c->count > 0 && now - c->last_edge_us < c->glitch_us) {
+        return;
+    }
+    if (c->first_edge_us == 0) {
+        c->first_edge_us = now;
+    }
+    c->last_edge_us = now;
+    c->count++;
+}
+
+// 1秒ごとに各カウンタの累計を記録する（esp_timer タスク）
+static void pulse_snapshot_cb(void *arg)
+{
+    portENTER_CRITICAL(&s_pulse_lock);
+    s_pulse_last_snap_us = esp_timer_get_time();
+    for (int i = 0; i < SEEDCLAW_PULSE_MAX_COUNTERS; i++) {
+        pulse_counter_t *c = &s_counters[i];
+        if (c->pin < 0) {
+            continue;
+        }
+        c->snaps[c->snap_head] = c->count;
+        c->snap_head = (c->snap_head + 1) % SEEDCLAW_PULSE_HISTORY_S;
+        if (c->snap_len < SEEDCLAW_PULSE_HISTORY_S) {
+            c->snap_len++;
+        }
+    }
+    portEXIT_CRITICAL(&s_pulse_lock);
+}
+
+static pulse_counter_t *find_counter(int pin)
+{
+    for (int i = 0; i < SEEDCLAW_PULSE_MAX_COUNTERS; i++) {
+        if (s_counters[i].pin == pin) {
+            return &s_counters[i];
+        }
+    }
+    return NULL;
+}
+
+static void pulse_detach_locked(pulse_counter_t *c)
+{
+    gpio_intr_disable(c->pin);
+    gpio_set_intr_type(c->pin, GPIO_INTR_DISABLE);
+    gpio_isr_handler_remove(c->pin);
+    if (s_isr_owner[c->pin] == GPIO_ISR_COUNTER) {
+        s_isr_owner[c->pin] = GPIO_ISR_NONE;
+    }
+    if (s_pin_state[c->pin].mode == PIN_MODE_COUNTER) {
+        s_pin_state[c->pin].mode = PIN_MODE_INPUT;
+    }
+    portENTER_CRITICAL(&s_pulse_lock);
+    c->pin = -1;
+    portEXIT_CRITICAL(&s_pulse_lock);
+}
+
+// カウンタのピンを別の用途に使う前にカウントを止める
+static void pulse_release_pin_locked(int pin)
+{
+    pulse_counter_t *c = find_counter(pin);
+    if (c != NULL) {
+        pulse_detach_locked(c);
+        ESP_LOGI(TAG, "Pulse counter on GPIO%d stopped (pin reused)", pin);
+    }
+}
+
+// gpio_watch が監視中のピンは駆動しない（gpio_reset_pin で割り込みが外れ、監視が黙って止まる）
+static esp_err_t watch_guard_locked(int pin)
+{
+    if (s_isr_owner[pin] == GPIO_ISR_WATCH) {
+        ESP_LOGW(TAG, "GPIO%d is watched by gpio_watch, refusing to drive it", pin);
+        return ESP_ERR_INVALID_STATE;
+    }
+    return ESP_OK;
+}
+
+// ── PWMリソース管理 ──
+
+// freq_hz のタイマーを確保（同じ周波数があれば共有）。空きがなければ -1
+static int pwm_timer_acquire_locked(int freq_hz)
+{
+    for (int t = 0; t < LEDC_TIMER_MAX; t++) {
+        if (s_timer_refs[t] > 0 && s_timer_freq[t] == freq_hz) {
+            s_timer_refs[t]++;
+            return t;
+        }
+    }
+    for (int t = 0; t < LEDC_TIMER_MAX; t++) {
+        if (s_timer_refs[t] > 0) {
+            continue;
+        }
+        ledc_timer_config_t ledc_timer = {
+            .speed_mode       = LEDC_LOW_SPEED_MODE,
+            .timer_num        = t,
+            .duty_resolution  = LEDC_TIMER_10_BIT,
+            .freq_hz          = freq_hz,
+            .clk_cfg          = LEDC_AUTO_CLK
+        };
+        esp_err_t err = ledc_timer_config(&ledc_timer);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "LEDC timer config failed (%dHz): %s", freq_hz, esp_err_to_name(err));
+            return -1;
+        }
+        // 最後のチャンネルが外れたときに一時停止しているので再開する
+        ledc_timer_resume(LEDC_LOW_SPEED_MODE, t);
+        s_timer_freq[t] = freq_hz;
+        s_timer_refs[t] = 1;
+        return t;
+    }
+    ESP_LOGE(TAG, "No free LEDC timer for %dHz (max %d distinct frequencies)", freq_hz, LEDC_TIMER_MAX);
+    return -1;
+}
+
+static void pwm_timer_release_locked(int t)
+{
+    if (t < 0 || s_timer_refs[t] == 0) {
+        return;
+    }
+    if (--s_timer_refs[t] == 0) {
+        ledc_timer_pause(LEDC_LOW_SPEED_MODE, t);
+    }
+}
+
+static void pwm_fade_stop_locked(int pin)
+{
+    pin_state_t *ps = &s_pin_state[pin];
+    if (ps->pwm_channel >= 0 && ps->fade_end_us > esp_timer_get_time()) {
+        ledc_fade_stop(LEDC_LOW_SPEED_MODE, ps->pwm_channel);
+    }
+    ps->fade_end_us = 0;
+}
+
+// PWMのピンを別の用途に使う前にチャンネルとタイマーを返す
+static void pwm_release_pin_locked(int pin)
+{
+    pin_state_t *ps = &s_pin_state[pin];
+    if (ps->pwm_channel < 0) {
+        return;
+    }
+    pwm_fade_stop_locked(pin);
+    ledc_stop(LEDC_LOW_SPEED_MODE, ps->pwm_channel, 0);
+    s_channel_pin[ps->pwm_channel] = -1;
+    pwm_timer_release_locked(ps->pwm_timer);
+    ps->pwm_channel = -1;
+    ps->pwm_timer = -1;
+}
+
+// 動作中のチャンネルの周波数を変える（他のチャンネルの周波数は変えない）
+static esp_err_t pwm_retune_locked(int pin, int freq_hz)
+{
+    pin_state_t *ps = &s_pin_state[pin];
+    int old = ps->pwm_timer;
+
+    // 同じ周波数のタイマーがあれば乗り換える
+    for (int t = 0; t < LEDC_TIMER_MAX; t++) {
+        if (t != old && s_timer_refs[t] > 0 && s_timer_freq[t] == freq_hz) {
+            ledc_bind_channel_timer(LEDC_LOW_SPEED_MODE, ps->pwm_channel, t);
+            s_timer_refs[t]++;
+            pwm_timer_release_locked(old);
+            ps->pwm_timer = t;
+            return ESP_OK;
+        }
+    }
+
+    // タイマーを独占していればそのまま周波数を変える
+    if (s_timer_refs[old] == 1) {
+        esp_err_t err = ledc_set_freq(LEDC_LOW_SPEED_MODE, old, freq_hz);
+        if (err == ESP_OK) {
+            s_timer_freq[old] = freq_hz;
+        }
+        return err;
+    }
+
+    int t = pwm_timer_acquire_locked(freq_hz);
+    if (t < 0) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    ledc_bind_channel_timer(LEDC_LOW_SPEED_MODE, ps->pwm_channel, t);
+    pwm_timer_release_locked(old);
+    ps->pwm_timer = t;
+    return ESP_OK;
+}
+
+// ピンにチャンネルとタイマーを割り当てる（デューティ0で開始）
+static esp_err_t pwm_attach_locked(int pin, int freq_hz)
+{
+    int channel = -1;
+    for (int ch = 0; ch < SEEDCLAW_PWM_MAX_CHANNELS; ch++) {
+        if (s_channel_pin[ch] < 0) {
+            channel = ch;
+            break;
+        }
+    }
+    if (channel < 0) {
+        ESP_LOGE(TAG, "No more PWM channels available");
+        return ESP_ERR_NO_MEM;
+    }
+    int timer = pwm_timer_acquire_locked(freq_hz);
+    if (timer < 0) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    ledc_channel_config_t ledc_channel = {
+        .speed_mode     = LEDC_LOW_SPEED_MODE,
+        .channel        = channel,
+        .timer_sel      = timer,
+        .intr_type      = LEDC_INTR_DISABLE,
+        .gpio_num       = pin,
+        .duty           = 0,
+        .hpoint         = 0
+    };
+    esp_err_t err = ledc_channel_config(&ledc_channel);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "LEDC channel config failed: %s", esp_err_to_name(err));
+        pwm_timer_release_locked(timer);
+        return err;
+    }
+
+    s_channel_pin[channel] = (int8_t)pin;
+    s_pin_state[pin].pwm_channel = channel;
+    s_pin_state[pin].pwm_timer = timer;
+    s_pin_state[pin].pwm_duty = 0;
+    s_pin_state[pin].pwm_freq = freq_hz;
+    s_pin_state[pin].mode = PIN_MODE_PWM;
+    return ESP_OK;
+}
+
 esp_err_t gpio_ctrl_init(void)
 {
+    s_gpio_mutex = xSemaphoreCreateMutex();
+    if (s_gpio_mutex == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
     memset(s_pin_state, 0, sizeof(s_pin_state));
     for (int i = 0; i < 22; i++) {
         s_pin_state[i].mode = PIN_MODE_UNUSED;
         s_pin_state[i].pwm_channel = -1;
+        s_pin_state[i].pwm_timer = -1;
+    }
+    for (int i = 0; i < SEEDCLAW_PULSE_MAX_COUNTERS; i++) {
+        s_counters[i].pin = -1;
+    }
+    for (int ch = 0; ch < SEEDCLAW_PWM_MAX_CHANNELS; ch++) {
+        s_channel_pin[ch] = -1;
     }
 
-    // LEDC タイマー設定
-    ledc_timer_config_t ledc_timer = {
-        .speed_mode       = LEDC_LOW_SPEED_MODE,
-        .timer_num        = LEDC_TIMER_0,
-        .duty_resolution  = LEDC_TIMER_10_BIT,
-        .freq_hz          = 1000,
-        .clk_cfg          = LEDC_AUTO_CLK
-    };
-    esp_err_t err = ledc_timer_config(&ledc_timer);
+    // LEDC タイマーは周波数ごとに pwm_set 時に割り当てる。フェードはハードウェアで行う
+    esp_err_t err = ledc_fade_func_install(0);
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "LEDC timer config failed: %s", esp_err_to_name(err));
+        ESP_LOGE(TAG, "LEDC fade install failed: %s", esp_err_to_name(err));
         return err;
     }
 
-    // ADC oneshot初期化
-    adc_oneshot_unit_init_cfg_t init_config = {
-        .unit_id = ADC_UNIT_1,
-    };
-    err = adc_oneshot_new_unit(&init_config, &s_adc_handle);
+    err = adc_backend_init();
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "ADC oneshot init failed: %s", esp_err_to_name(err));
         return err;
     }
 
@@ -106,35 +551,57 @@ esp_err_t gpio_ctrl_init(void)
     return ESP_OK;
 }
 
-int gpio_ctrl_read(int pin)
+static int gpio_read_locked(int pin)
 {
     if (!is_pin_allowed(pin)) {
         ESP_LOGE(TAG, "Pin %d is not allowed", pin);
         return -1;
     }
+    adc_release_pin_locked(pin);
 
     // OUTPUT/PWMモードの場合は状態を壊さずそのまま読む
     if (s_pin_state[pin].mode == PIN_MODE_OUTPUT || s_pin_state[pin].mode == PIN_MODE_PWM) {
         int level = gpio_get_level(pin);
         s_pin_state[pin].value = level;
-        ESP_LOGI(TAG, "GPIO%d read (output mode): %d", pin, level);
+        ESP_LOGD(TAG, "GPIO%d read (output mode): %d", pin, level);
         return level;
     }
 
-    // 未使用またはINPUT以外→INPUTに設定
-    if (s_pin_state[pin].mode != PIN_MODE_INPUT) {
+    // 未使用またはINPUT以外→INPUTに設定（カウント中のピンは入力のまま読む）
+    if (s_pin_state[pin].mode != PIN_MODE_INPUT && s_pin_state[pin].mode != PIN_MODE_COUNTER) {
         gpio_reset_pin(pin);
         gpio_set_direction(pin, GPIO_MODE_INPUT);
         s_pin_state[pin].mode = PIN_MODE_INPUT;
+        s_pin_state[pin].pull = GPIO_CTRL_PULL_NONE;
     }
 
     int level = gpio_get_level(pin);
     s_pin_state[pin].value = level;
-    ESP_LOGI(TAG, "GPIO%d read: %d", pin, level);
+    ESP_LOGD(TAG, "GPIO%d read: %d", pin, level);
     return level;
 }
 
-esp_err_t gpio_ctrl_write(int pin, int value)
+static int gpio_set_input_locked(int pin, gpio_ctrl_pull_t pull)
+{
+    if (!is_pin_allowed(pin)) {
+        ESP_LOGE(TAG, "Pin %d is not allowed", pin);
+        return -1;
+    }
+    adc_release_pin_locked(pin);
+    pulse_release_pin_locked(pin);
+    pwm_release_pin_locked(pin);
+
+    gpio_reset_pin(pin);
+    gpio_set_direction(pin, GPIO_MODE_INPUT);
+    gpio_set_pull_mode(pin, pull == GPIO_CTRL_PULL_UP ? GPIO_PULLUP_ONLY :
+                            pull == GPIO_CTRL_PULL_DOWN ? GPIO_PULLDOWN_ONLY : GPIO_FLOATING);
+    s_pin_state[pin].mode = PIN_MODE_INPUT;
+    s_pin_state[pin].pull = pull;
+    s_pin_state[pin].value = gpio_get_level(pin);
+    return s_pin_state[pin].value;
+}
+
+static esp_err_t gpio_write_locked(int pin, int value)
 {
     if (!is_pin_allowed(pin)) {
         ESP_LOGE(TAG, "Pin %d is not allowed", pin);
@@ -145,11 +612,15 @@ esp_err_t gpio_ctrl_write(int pin, int value)
         ESP_LOGE(TAG, "Invalid value %d (must be 0 or 1)", value);
         return ESP_ERR_INVALID_ARG;
     }
+    esp_err_t err = watch_guard_locked(pin);
+    if (err != ESP_OK) {
+        return err;
+    }
+    adc_release_pin_locked(pin);
+    pulse_release_pin_locked(pin);
 
     // PWMモードなら停止
-    if (s_pin_state[pin].mode == PIN_MODE_PWM && s_pin_state[pin].pwm_channel >= 0) {
-        ledc_stop(LEDC_LOW_SPEED_MODE, s_pin_state[pin].pwm_channel, 0);
-    }
+    pwm_release_pin_locked(pin);
 
     // OUTPUT以外からの切り替え時のみリセット
     if (s_pin_state[pin].mode != PIN_MODE_OUTPUT) {
@@ -165,81 +636,170 @@ esp_err_t gpio_ctrl_write(int pin, int value)
     return ESP_OK;
 }
 
-esp_err_t gpio_ctrl_adc_read(int pin, adc_result_t *result)
+// ピン群を出力モードにする。新しく出力にするピンは先に目標値を出力レジスタに
+// 書いておくので、切り替え時に反対の値を経由しない
+static void prepare_outputs_locked(uint32_t mask, uint32_t values)
 {
-    if (!is_adc_allowed(pin)) {
-        ESP_LOGE(TAG, "Pin %d is not an ADC pin (only GPIO 2, 3, 4 allowed)", pin);
-        return ESP_ERR_INVALID_ARG;
+    for (int pin = 0; pin < 22; pin++) {
+        if (!(mask & (1UL << pin)) || s_pin_state[pin].mode == PIN_MODE_OUTPUT) {
+            continue;
+        }
+        adc_release_pin_locked(pin);
+        pulse_release_pin_locked(pin);
+        pwm_release_pin_locked(pin);
+        gpio_reset_pin(pin);
+        gpio_set_level(pin, (values >> pin) & 1);
+        gpio_set_direction(pin, GPIO_MODE_INPUT_OUTPUT);  // 入出力両方有効（読み戻し可能）
+        s_pin_state[pin].mode = PIN_MODE_OUTPUT;
     }
+}
 
-    if (result == NULL) {
-        return ESP_ERR_INVALID_ARG;
+static esp_err_t gpio_write_multi_locked(uint32_t mask, uint32_t values)
+{
+    for (int pin = 0; pin < 32; pin++) {
+        if ((mask & (1UL << pin)) && !is_pin_allowed(pin)) {
+            ESP_LOGE(TAG, "Pin %d is not allowed", pin);
+            return ESP_ERR_INVALID_ARG;
+        }
     }
-
-    // ピン番号をADCチャンネルに変換
-    adc_channel_t channel;
-    if (pin == 2) {
-        channel = ADC_CHANNEL_0;
-    } else if (pin == 3) {
-        channel = ADC_CHANNEL_1;
-    } else if (pin == 4) {
-        channel = ADC_CHANNEL_2;
-    } else {
+    if (mask == 0) {
         return ESP_ERR_INVALID_ARG;
     }
+    // 1本でも監視中なら何も書かない
+    for (int pin = 0; pin < 22; pin++) {
+        if ((mask & (1UL << pin)) && watch_guard_locked(pin) != ESP_OK) {
+            return ESP_ERR_INVALID_STATE;
+        }
+    }
+    values &= mask;
 
-    // チャンネル設定
-    adc_oneshot_chan_cfg_t config = {
-        .bitwidth = ADC_BITWIDTH_DEFAULT,
-        .atten = ADC_ATTEN_DB_12,
-    };
-    esp_err_t err = adc_oneshot_config_channel(s_adc_handle, channel, &config);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "ADC channel config failed: %s", esp_err_to_name(err));
-        return err;
+    prepare_outputs_locked(mask, values);
+
+    // 出力レジスタへの1回の書き込みで全ピンを同時に切り替える
+    portENTER_CRITICAL(&s_gpio_out_lock);
+    uint32_t out = REG_READ(GPIO_OUT_REG);
+    REG_WRITE(GPIO_OUT_REG, (out & ~mask) | values);
+    portEXIT_CRITICAL(&s_gpio_out_lock);
+
+    for (int pin = 0; pin < 22; pin++) {
+        if (mask & (1UL << pin)) {
+            s_pin_state[pin].value = (values >> pin) & 1;
+        }
     }
+    ESP_LOGI(TAG, "GPIO write mask=0x%06lx values=0x%06lx",
+             (unsigned long)mask, (unsigned long)values);
+    return ESP_OK;
+}
 
-    // ADC読み取り
-    int raw;
-    err = adc_oneshot_read(s_adc_handle, channel, &raw);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "ADC read failed: %s", esp_err_to_name(err));
-        return err;
+static esp_err_t gpio_read_multi_locked(uint32_t mask, uint32_t *values)
+{
+    for (int pin = 0; pin < 32; pin++) {
+        if ((mask & (1UL << pin)) && !is_pin_allowed(pin)) {
+            ESP_LOGE(TAG, "Pin %d is not allowed", pin);
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    if (mask == 0 || values == NULL) {
+        return ESP_ERR_INVALID_ARG;
     }
 
-    result->raw = raw;
+    // 出力/PWM以外は gpio_read_locked と同じく入力に切り替える
+    for (int pin = 0; pin < 22; pin++) {
+        if (!(mask & (1UL << pin))) {
+            continue;
+        }
+        pin_mode_t mode = s_pin_state[pin].mode;
+        if (mode != PIN_MODE_OUTPUT && mode != PIN_MODE_PWM && mode != PIN_MODE_INPUT &&
+            mode != PIN_MODE_COUNTER) {
+            adc_release_pin_locked(pin);
+            gpio_reset_pin(pin);
+            gpio_set_direction(pin, GPIO_MODE_INPUT);
+            s_pin_state[pin].mode = PIN_MODE_INPUT;
+            s_pin_state[pin].pull = GPIO_CTRL_PULL_NONE;
+        }
+    }
 
-    // 電圧変換
-    if (s_adc_cali_handle != NULL) {
-        int voltage;
-        err = adc_cali_raw_to_voltage(s_adc_cali_handle, raw, &voltage);
-        if (err == ESP_OK) {
-            result->voltage_mv = voltage;
-        } else {
-            result->voltage_mv = 0;
+    // 入力レジスタを1回読んで同じ瞬間の値を返す
+    uint32_t in = REG_READ(GPIO_IN_REG) & mask;
+    for (int pin = 0; pin < 22; pin++) {
+        if (mask & (1UL << pin)) {
+            s_pin_state[pin].value = (in >> pin) & 1;
         }
-    } else {
-        result->voltage_mv = 0;
     }
+    *values = in;
+    ESP_LOGD(TAG, "GPIO read mask=0x%06lx values=0x%06lx",
+             (unsigned long)mask, (unsigned long)in);
+    return ESP_OK;
+}
 
-    // パーセンテージ計算 (0-4095 → 0-100%)
-    result->percentage = (raw * 100) / 4095;
+static esp_err_t adc_read_multi_locked(const int *pins, int n, adc_result_t *results, int *samples)
+{
+    if (results == NULL || n <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
 
-    s_pin_state[pin].mode = PIN_MODE_ADC;
-    s_pin_state[pin].value = raw;
+    uint32_t mask = 0;
+    for (int i = 0; i < n; i++) {
+        if (!is_adc_allowed(pins[i])) {
+            ESP_LOGE(TAG, "Pin %d is not an ADC pin (only GPIO 2, 3, 4 allowed)", pins[i]);
+            return ESP_ERR_INVALID_ARG;
+        }
+        mask |= 1UL << pins[i];
+    }
 
-    ESP_LOGI(TAG, "ADC GPIO%d read: raw=%d, voltage=%dmV, %%=%d",
-             pin, result->raw, result->voltage_mv, result->percentage);
+    int raw_avg[22] = {0};
+    if (samples != NULL) {
+        *samples = 0;
+    }
+    if (s_adc_cont != NULL) {
+        esp_err_t err = adc_cont_sample_locked(mask, raw_avg, samples);
+        if (err != ESP_OK) {
+            return err;
+        }
+    } else {
+        // oneshot: 1回ずつ読んで平均する
+        for (int pin = 0; pin < 22; pin++) {
+            if (!(mask & (1UL << pin))) {
+                continue;
+            }
+            int sum = 0;
+            for (int k = 0; k < s_adc_oversample; k++) {
+                int raw;
+                esp_err_t err = adc_oneshot_read(s_adc_handle, adc_channel_of(pin), &raw);
+                if (err != ESP_OK) {
+                    ESP_LOGE(TAG, "ADC read failed: %s", esp_err_to_name(err));
+                    return err;
+                }
+                sum += raw;
+            }
+            raw_avg[pin] = sum / s_adc_oversample;
+        }
+        if (samples != NULL) {
+            *samples = s_adc_oversample;
+        }
+    }
 
+    for (int i = 0; i < n; i++) {
+        adc_fill_result(pins[i], raw_avg[pins[i]], &results[i]);
+        ESP_LOGD(TAG, "ADC GPIO%d read: raw=%d, voltage=%dmV, %%=%d",
+                 pins[i], results[i].raw, results[i].voltage_mv, results[i].percentage);
+    }
     return ESP_OK;
 }
 
-esp_err_t gpio_ctrl_pwm_set(int pin, int duty_percent, int freq_hz)
+static esp_err_t pwm_set_locked(int pin, int duty_percent, int freq_hz)
 {
     if (!is_pin_allowed(pin)) {
         ESP_LOGE(TAG, "Pin %d is not allowed", pin);
         return ESP_ERR_INVALID_ARG;
     }
+    esp_err_t err = watch_guard_locked(pin);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    adc_release_pin_locked(pin);
+    pulse_release_pin_locked(pin);
 
     // デューティ比をクランプ
     if (duty_percent < 0) duty_percent = 0;
@@ -248,36 +808,20 @@ esp_err_t gpio_ctrl_pwm_set(int pin, int duty_percent, int freq_hz)
     // 周波数デフォルト
     if (freq_hz <= 0) freq_hz = 1000;
 
-    // チャンネル割り当て
+    // チャンネル割り当て / 周波数変更
     if (s_pin_state[pin].pwm_channel < 0) {
-        if (s_next_pwm_channel >= SEEDCLAW_PWM_MAX_CHANNELS) {
-            ESP_LOGE(TAG, "No more PWM channels available");
-            return ESP_ERR_NO_MEM;
-        }
-
-        ledc_channel_config_t ledc_channel = {
-            .speed_mode     = LEDC_LOW_SPEED_MODE,
-            .channel        = s_next_pwm_channel,
-            .timer_sel      = LEDC_TIMER_0,
-            .intr_type      = LEDC_INTR_DISABLE,
-            .gpio_num       = pin,
-            .duty           = 0,
-            .hpoint         = 0
-        };
-        esp_err_t err = ledc_channel_config(&ledc_channel);
-        if (err != ESP_OK) {
-            ESP_LOGE(TAG, "LEDC channel config failed: %s", esp_err_to_name(err));
-            return err;
-        }
-
-        s_pin_state[pin].pwm_channel = s_next_pwm_channel;
-        s_next_pwm_channel++;
+        err = pwm_attach_locked(pin, freq_hz);
+    } else if (s_pin_state[pin].pwm_freq != freq_hz) {
+        err = pwm_retune_locked(pin, freq_hz);
+    } else {
+        err = ESP_OK;
+    }
+    if (err != ESP_OK) {
+        return err;
     }
 
     int channel = s_pin_state[pin].pwm_channel;
-
-    // 周波数設定
-    ledc_set_freq(LEDC_LOW_SPEED_MODE, LEDC_TIMER_0, freq_hz);
+    pwm_fade_stop_locked(pin);
 
     // デューティ設定 (10bit = 0-1023)
     uint32_t duty = (duty_percent * 1023) / 100;
@@ -288,11 +832,175 @@ esp_err_t gpio_ctrl_pwm_set(int pin, int duty_percent, int freq_hz)
     s_pin_state[pin].pwm_duty = duty_percent;
     s_pin_state[pin].pwm_freq = freq_hz;
 
-    ESP_LOGI(TAG, "PWM GPIO%d: duty=%d%%, freq=%dHz", pin, duty_percent, freq_hz);
+    ESP_LOGD(TAG, "PWM GPIO%d: duty=%d%%, freq=%dHz", pin, duty_percent, freq_hz);
     return ESP_OK;
 }
 
-char *gpio_ctrl_status_json(void)
+static esp_err_t pwm_fade_locked(int pin, int duty_percent, int duration_ms, int freq_hz)
+{
+    if (!is_pin_allowed(pin)) {
+        ESP_LOGE(TAG, "Pin %d is not allowed", pin);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (duration_ms < 0 || duration_ms > SEEDCLAW_PWM_FADE_MAX_MS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (duty_percent < 0) duty_percent = 0;
+    if (duty_percent > 100) duty_percent = 100;
+
+    // PWMでなければデューティ0から、周波数指定があれば今のデューティのまま合わせる
+    pin_state_t *ps = &s_pin_state[pin];
+    if (ps->mode != PIN_MODE_PWM || ps->pwm_channel < 0) {
+        esp_err_t err = pwm_set_locked(pin, 0, freq_hz);
+        if (err != ESP_OK) {
+            return err;
+        }
+    } else if (freq_hz > 0 && freq_hz != ps->pwm_freq) {
+        esp_err_t err = pwm_retune_locked(pin, freq_hz);
+        if (err != ESP_OK) {
+            return err;
+        }
+        ps->pwm_freq = freq_hz;
+    }
+
+    pwm_fade_stop_locked(pin);
+    uint32_t duty = (duty_percent * 1023) / 100;
+    esp_err_t err = ledc_set_fade_with_time(LEDC_LOW_SPEED_MODE, ps->pwm_channel, duty, duration_ms);
+    if (err == ESP_OK) {
+        err = ledc_fade_start(LEDC_LOW_SPEED_MODE, ps->pwm_channel, LEDC_FADE_NO_WAIT);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "LEDC fade failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    ESP_LOGI(TAG, "PWM GPIO%d: fade %d%% -> %d%% over %dms", pin, ps->pwm_duty, duty_percent, duration_ms);
+    ps->pwm_duty = duty_percent;   // 到達後の値
+    ps->fade_end_us = esp_timer_get_time() + (int64_t)duration_ms * 1000;
+    return ESP_OK;
+}
+
+// 割り込みハンドラはピンごとに1つしか登録できないので、上書きせずに断る。
+// 入力に切り替えると出力を壊すので、出力/PWMのピンも断る
+static esp_err_t isr_check_locked(int pin, gpio_isr_owner_t owner)
+{
+    if (!is_pin_allowed(pin)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_isr_owner[pin] != GPIO_ISR_NONE && s_isr_owner[pin] != owner) {
+        ESP_LOGW(TAG, "GPIO%d interrupt is already used by %s", pin,
+                 s_isr_owner[pin] == GPIO_ISR_WATCH ? "gpio_watch" : "pulse counter");
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (s_pin_state[pin].mode == PIN_MODE_OUTPUT || s_pin_state[pin].mode == PIN_MODE_PWM) {
+        ESP_LOGW(TAG, "GPIO%d is an output, refusing to switch it to input", pin);
+        return ESP_ERR_INVALID_STATE;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t isr_claim_locked(int pin, gpio_isr_owner_t owner)
+{
+    esp_err_t err = isr_check_locked(pin, owner);
+    if (err == ESP_OK) {
+        s_isr_owner[pin] = (uint8_t)owner;
+    }
+    return err;
+}
+
+static esp_err_t pulse_start_locked(int pin, pulse_edge_t edge, gpio_ctrl_pull_t pull,
+                                    uint32_t glitch_us)
+{
+    if (!is_pin_allowed(pin) || edge < PULSE_EDGE_RISING || edge > PULSE_EDGE_BOTH) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // 既存カウンタを外す前に、監視中や出力中のピンでないことを確かめる
+    esp_err_t err = isr_check_locked(pin, GPIO_ISR_COUNTER);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    pulse_counter_t *c = find_counter(pin);
+    if (c != NULL) {
+        pulse_detach_locked(c);
+    } else {
+        c = find_counter(-1);
+        if (c == NULL) {
+            ESP_LOGE(TAG, "No more pulse counters available");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    if (s_pulse_timer == NULL) {
+        const esp_timer_create_args_t args = {
+            .callback = pulse_snapshot_cb,
+            .name = "pulse_snap",
+        };
+        err = esp_timer_create(&args, &s_pulse_timer);
+        if (err == ESP_OK) {
+            err = esp_timer_start_periodic(s_pulse_timer, 1000000);
+        }
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Pulse snapshot timer failed: %s", esp_err_to_name(err));
+            return err;
+        }
+    }
+    err = gpio_install_isr_service(0);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {   // INVALID_STATE = インストール済み
+        ESP_LOGE(TAG, "GPIO ISR service install failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    s_isr_owner[pin] = GPIO_ISR_COUNTER;
+    if (gpio_set_input_locked(pin, pull) < 0) {
+        s_isr_owner[pin] = GPIO_ISR_NONE;
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&s_pulse_lock);
+    memset(c, 0, sizeof(*c));
+    c->pin = pin;
+    c->edge = (uint8_t)edge;
+    c->glitch_us = glitch_us;
+    c->start_us = esp_timer_get_time();
+    portEXIT_CRITICAL(&s_pulse_lock);
+
+    gpio_set_intr_type(pin, edge == PULSE_EDGE_RISING ? GPIO_INTR_POSEDGE :
+                            edge == PULSE_EDGE_FALLING ? GPIO_INTR_NEGEDGE : GPIO_INTR_ANYEDGE);
+    err = gpio_isr_handler_add(pin, pulse_isr, c);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "ISR handler add failed for GPIO%d: %s", pin, esp_err_to_name(err));
+        s_isr_owner[pin] = GPIO_ISR_NONE;
+        portENTER_CRITICAL(&s_pulse_lock);
+        c->pin = -1;
+        portEXIT_CRITICAL(&s_pulse_lock);
+        return err;
+    }
+    gpio_intr_enable(pin);
+    s_pin_state[pin].mode = PIN_MODE_COUNTER;
+
+    ESP_LOGI(TAG, "Pulse counter on GPIO%d (edge=%d, glitch=%luus)",
+             pin, edge, (unsigned long)glitch_us);
+    return ESP_OK;
+}
+
+// 直近およそ seconds 秒のレート (/s)。記録が足りなければある分だけで計算
+static float pulse_recent_rate(const pulse_counter_t *c, uint32_t count, int64_t now_us, int seconds)
+{
+    int k = c->snap_len < seconds ? c->snap_len : seconds;
+    if (k == 0) {
+        return 0.0f;
+    }
+    // k 個前のスナップショットは s_pulse_last_snap_us の (k-1) 秒前
+    int idx = (c->snap_head - k + SEEDCLAW_PULSE_HISTORY_S) % SEEDCLAW_PULSE_HISTORY_S;
+    float span_s = (float)(now_us - s_pulse_last_snap_us) / 1e6f + (float)(k - 1);
+    if (span_s <= 0.0f) {
+        return 0.0f;
+    }
+    return (float)(count - c->snaps[idx]) / span_s;
+}
+
+static char *status_json_locked(void)
 {
     cJSON *root = cJSON_CreateObject();
     cJSON *pins = cJSON_CreateArray();
@@ -328,18 +1036,26 @@ char *gpio_ctrl_status_json(void)
             case PIN_MODE_OUTPUT: mode_str = "OUTPUT"; break;
             case PIN_MODE_ADC:    mode_str = "ADC"; break;
             case PIN_MODE_PWM:    mode_str = "PWM"; break;
+            case PIN_MODE_COUNTER: mode_str = "COUNTER"; break;
             default: mode_str = "UNUSED"; break;
         }
         cJSON_AddStringToObject(pin_obj, "mode", mode_str);
 
         // 値
-        if (s_pin_state[i].mode == PIN_MODE_INPUT || s_pin_state[i].mode == PIN_MODE_OUTPUT) {
+        if (s_pin_state[i].mode == PIN_MODE_COUNTER) {
+            pulse_counter_t *c = find_counter(i);
+            cJSON_AddNumberToObject(pin_obj, "count", c != NULL ? c->count : 0);
+        } else if (s_pin_state[i].mode == PIN_MODE_INPUT || s_pin_state[i].mode == PIN_MODE_OUTPUT) {
             cJSON_AddNumberToObject(pin_obj, "value", s_pin_state[i].value);
         } else if (s_pin_state[i].mode == PIN_MODE_ADC) {
             cJSON_AddNumberToObject(pin_obj, "raw", s_pin_state[i].value);
         } else if (s_pin_state[i].mode == PIN_MODE_PWM) {
             cJSON_AddNumberToObject(pin_obj, "duty", s_pin_state[i].pwm_duty);
             cJSON_AddNumberToObject(pin_obj, "freq", s_pin_state[i].pwm_freq);
+            cJSON_AddNumberToObject(pin_obj, "timer", s_pin_state[i].pwm_timer);
+            if (s_pin_state[i].fade_end_us > esp_timer_get_time()) {
+                cJSON_AddBoolToObject(pin_obj, "fading", true);
+            }
         }
 
         cJSON_AddItemToArray(pins, pin_obj);
@@ -352,3 +1068,259 @@ char *gpio_ctrl_status_json(void)
 
     return json_str;
 }
+
+// ── 公開API（ミューテックスで直列化） ──
+
+int gpio_ctrl_read(int pin)
+{
+    xSemaphoreTake(s_gpio_mutex, portMAX_DELAY);
+    int level = gpio_read_locked(pin);
+    xSemaphoreGive(s_gpio_mutex);
+    return level;
+}
+
+int gpio_ctrl_set_input(int pin, gpio_ctrl_pull_t pull)
+{
+    xSemaphoreTake(s_gpio_mutex, portMAX_DELAY);
+    int level = gpio_set_input_locked(pin, pull);
+    xSemaphoreGive(s_gpio_mutex);
+    return level;
+}
+
+esp_err_t gpio_ctrl_write(int pin, int value)
+{
+    xSemaphoreTake(s_gpio_mutex, portMAX_DELAY);
+    esp_err_t err = gpio_write_locked(pin, value);
+    xSemaphoreGive(s_gpio_mutex);
+    return err;
+}
+
+esp_err_t gpio_ctrl_write_multi(uint32_t mask, uint32_t values)
+{
+    xSemaphoreTake(s_gpio_mutex, portMAX_DELAY);
+    esp_err_t err = gpio_write_multi_locked(mask, values);
+    xSemaphoreGive(s_gpio_mutex);
+    return err;
+}
+
+esp_err_t gpio_ctrl_read_multi(uint32_t mask, uint32_t *values)
+{
+    xSemaphoreTake(s_gpio_mutex, portMAX_DELAY);
+    esp_err_t err = gpio_read_multi_locked(mask, values);
+    xSemaphoreGive(s_gpio_mutex);
+    return err;
+}
+
+esp_err_t gpio_ctrl_adc_read(int pin, adc_result_t *result)
+{
+    xSemaphoreTake(s_gpio_mutex, portMAX_DELAY);
+    esp_err_t err = adc_read_multi_locked(&pin, 1, result, NULL);
+    xSemaphoreGive(s_gpio_mutex);
+    return err;
+}
+
+esp_err_t gpio_ctrl_adc_read_multi(const int *pins, int n, adc_result_t *results, int *samples)
+{
+    xSemaphoreTake(s_gpio_mutex, portMAX_DELAY);
+    esp_err_t err = adc_read_multi_locked(pins, n, results, samples);
+    xSemaphoreGive(s_gpio_mutex);
+    return err;
+}
+
+esp_err_t gpio_ctrl_adc_set_oversample(int samples)
+{
+    if (samples < 1 || samples > SEEDCLAW_ADC_OVERSAMPLE_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    xSemaphoreTake(s_gpio_mutex, portMAX_DELAY);
+    s_adc_oversample = samples;
+    xSemaphoreGive(s_gpio_mutex);
+    return ESP_OK;
+}
+
+int gpio_ctrl_adc_get_oversample(void)
+{
+    return s_adc_oversample;
+}
+
+const char *gpio_ctrl_adc_backend(void)
+{
+    return s_adc_cont != NULL ? "continuous" : "oneshot";
+}
+
+esp_err_t gpio_ctrl_pwm_set(int pin, int duty_percent, int freq_hz)
+{
+    xSemaphoreTake(s_gpio_mutex, portMAX_DELAY);
+    esp_err_t err = pwm_set_locked(pin, duty_percent, freq_hz);
+    xSemaphoreGive(s_gpio_mutex);
+    return err;
+}
+
+esp_err_t gpio_ctrl_pwm_fade(int pin, int duty_percent, int duration_ms, int freq_hz)
+{
+    xSemaphoreTake(s_gpio_mutex, portMAX_DELAY);
+    esp_err_t err = pwm_fade_locked(pin, duty_percent, duration_ms, freq_hz);
+    xSemaphoreGive(s_gpio_mutex);
+    return err;
+}
+
+esp_err_t gpio_ctrl_pulse_start(int pin, pulse_edge_t edge, gpio_ctrl_pull_t pull, uint32_t glitch_us)
+{
+    xSemaphoreTake(s_gpio_mutex, portMAX_DELAY);
+    esp_err_t err = pulse_start_locked(pin, edge, pull, glitch_us);
+    xSemaphoreGive(s_gpio_mutex);
+    return err;
+}
+
+esp_err_t gpio_ctrl_isr_claim(int pin, gpio_isr_owner_t owner)
+{
+    xSemaphoreTake(s_gpio_mutex, portMAX_DELAY);
+    esp_err_t err = isr_claim_locked(pin, owner);
+    xSemaphoreGive(s_gpio_mutex);
+    return err;
+}
+
+bool gpio_ctrl_is_watched(int pin)
+{
+    if (!is_pin_allowed(pin)) {
+        return false;
+    }
+    xSemaphoreTake(s_gpio_mutex, portMAX_DELAY);
+    bool watched = (s_isr_owner[pin] == GPIO_ISR_WATCH);
+    xSemaphoreGive(s_gpio_mutex);
+    return watched;
+}
+
+void gpio_ctrl_isr_release(int pin, gpio_isr_owner_t owner)
+{
+    if (!is_pin_allowed(pin)) {
+        return;
+    }
+    xSemaphoreTake(s_gpio_mutex, portMAX_DELAY);
+    if (s_isr_owner[pin] == owner) {
+        s_isr_owner[pin] = GPIO_ISR_NONE;
+    }
+    xSemaphoreGive(s_gpio_mutex);
+}
+
+esp_err_t gpio_ctrl_pulse_stop(int pin)
+{
+    xSemaphoreTake(s_gpio_mutex, portMAX_DELAY);
+    pulse_counter_t *c = find_counter(pin);
+    if (c != NULL) {
+        pulse_detach_locked(c);
+    }
+    xSemaphoreGive(s_gpio_mutex);
+    return c != NULL ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t gpio_ctrl_pulse_reset(int pin)
+{
+    xSemaphoreTake(s_gpio_mutex, portMAX_DELAY);
+    pulse_counter_t *c = find_counter(pin);
+    if (c != NULL) {
+        portENTER_CRITICAL(&s_pulse_lock);
+        c->count = 0;
+        c->last_edge_us = 0;
+        c->start_us = esp_timer_get_time();
+        c->snap_len = 0;
+        portEXIT_CRITICAL(&s_pulse_lock);
+    }
+    xSemaphoreGive(s_gpio_mutex);
+    return c != NULL ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t gpio_ctrl_pulse_read(int pin, pulse_stats_t *out)
+{
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    xSemaphoreTake(s_gpio_mutex, portMAX_DELAY);
+    pulse_counter_t *c = find_counter(pin);
+    if (c != NULL && pin >= 0) {
+        portENTER_CRITICAL(&s_pulse_lock);
+        int64_t now = esp_timer_get_time();
+        uint32_t count = c->count;
+        int64_t last_edge_us = c->last_edge_us;
+        out->pin = pin;
+        out->count = count;
+        out->elapsed_ms = (uint32_t)((now - c->start_us) / 1000);
+        out->rate_avg = out->elapsed_ms > 0 ? (float)count * 1000.0f / (float)out->elapsed_ms : 0.0f;
+        out->rate_10s = pulse_recent_rate(c, count, now, 10);
+        out->rate_60s = pulse_recent_rate(c, count, now, SEEDCLAW_PULSE_HISTORY_S);
+        portEXIT_CRITICAL(&s_pulse_lock);
+        out->since_last_edge_ms = count > 0 ? (uint32_t)((now - last_edge_us) / 1000) : UINT32_MAX;
+        err = ESP_OK;
+    }
+    xSemaphoreGive(s_gpio_mutex);
+    return err;
+}
+
+esp_err_t gpio_ctrl_freq_measure(int pin, int window_ms, freq_result_t *out)
+{
+    if (window_ms < 10 || window_ms > SEEDCLAW_FREQ_MAX_WINDOW_MS || out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // カウント中でなければ一時的に立ち上がりエッジのカウンタを付ける。
+    // 入力ピンなら設定済みのプルを引き継ぎ、計測後もそのまま残す
+    xSemaphoreTake(s_gpio_mutex, portMAX_DELAY);
+    pulse_counter_t *c = find_counter(pin);
+    bool temporary = (c == NULL);
+    if (temporary) {
+        gpio_ctrl_pull_t pull = (is_pin_allowed(pin) && s_pin_state[pin].mode == PIN_MODE_INPUT)
+                                    ? s_pin_state[pin].pull : GPIO_CTRL_PULL_NONE;
+        esp_err_t err = pulse_start_locked(pin, PULSE_EDGE_RISING, pull, 0);
+        if (err != ESP_OK) {
+            xSemaphoreGive(s_gpio_mutex);
+            return err;
+        }
+        c = find_counter(pin);
+    }
+    portENTER_CRITICAL(&s_pulse_lock);
+    uint32_t count0 = c->count;
+    c->first_edge_us = 0;
+    portEXIT_CRITICAL(&s_pulse_lock);
+    xSemaphoreGive(s_gpio_mutex);
+
+    // 計測中は GPIO ミューテックスを持たない（他のツールは動ける）
+    vTaskDelay(pdMS_TO_TICKS(window_ms));
+
+    xSemaphoreTake(s_gpio_mutex, portMAX_DELAY);
+    if (c->pin != pin) {
+        // 計測中にピンが別の用途に使われた
+        xSemaphoreGive(s_gpio_mutex);
+        return ESP_ERR_INVALID_STATE;
+    }
+    portENTER_CRITICAL(&s_pulse_lock);
+    uint32_t edges = c->count - count0;
+    int64_t first = c->first_edge_us;
+    int64_t last = c->last_edge_us;
+    portEXIT_CRITICAL(&s_pulse_lock);
+    uint8_t edge = c->edge;
+    if (temporary) {
+        pulse_detach_locked(c);
+    }
+    xSemaphoreGive(s_gpio_mutex);
+
+    out->edges = edges;
+    out->window_ms = window_ms;
+    out->period_us = 0;
+    out->hz = (float)edges * 1000.0f / (float)window_ms;
+    if (edges >= 2 && last > first) {
+        // 最初と最後のエッジの間隔から求めると窓の端数に左右されない
+        out->period_us = (uint32_t)((last - first) / (edges - 1));
+        out->hz = (float)(edges - 1) * 1e6f / (float)(last - first);
+    }
+    if (edge == PULSE_EDGE_BOTH) {
+        out->hz /= 2.0f;
+        out->period_us *= 2;
+    }
+    return ESP_OK;
+}
+
+char *gpio_ctrl_status_json(void)
+{
+    xSemaphoreTake(s_gpio_mutex, portMAX_DELAY);
+    char *json = status_json_locked();
+    xSemaphoreGive(s_gpio_mutex);
+    return json;
+}
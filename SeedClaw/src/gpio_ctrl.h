@@ -2,6 +2,43 @@
 
 #include "esp_err.h"
 #include <stdbool.h>
+#include <stdint.h>
+
+typedef enum {
+    GPIO_CTRL_PULL_NONE,
+    GPIO_CTRL_PULL_UP,
+    GPIO_CTRL_PULL_DOWN,
+} gpio_ctrl_pull_t;
+
+typedef enum {
+    PULSE_EDGE_RISING = 1,
+    PULSE_EDGE_FALLING = 2,
+    PULSE_EDGE_BOTH = 3,
+} pulse_edge_t;
+
+// GPIO割り込みハンドラの持ち主（ピンごとに1つだけ登録できる）
+typedef enum {
+    GPIO_ISR_NONE,
+    GPIO_ISR_COUNTER,        // パルスカウンタ / 周波数測定
+    GPIO_ISR_WATCH,          // gpio_watch のエッジ通知
+} gpio_isr_owner_t;
+
+typedef struct {
+    int pin;
+    uint32_t count;           // 開始（またはリセット）からの累計
+    uint32_t elapsed_ms;      // 開始からの経過時間
+    float rate_avg;           // 開始からの平均 (/s)
+    float rate_10s;           // 直近約10秒 (/s)
+    float rate_60s;           // 直近約60秒 (/s)
+    uint32_t since_last_edge_ms;  // 最後のエッジからの経過（エッジなしなら UINT32_MAX）
+} pulse_stats_t;
+
+typedef struct {
+    uint32_t edges;           // 窓内のエッジ数
+    int window_ms;
+    float hz;                 // 信号の周波数
+    uint32_t period_us;       // 平均周期（エッジが2つ未満なら0）
+} freq_result_t;
 
 typedef struct {
     int raw;          // 0-4095
@@ -20,13 +57,38 @@ esp_err_t gpio_ctrl_init(void);
  */
 int gpio_ctrl_read(int pin);
 
+/**
+ * @brief GPIOピンを入力に設定（プルアップ/プルダウン指定）
+ * @return 現在のピン値 (0 or 1)、エラー時は -1
+ */
+int gpio_ctrl_set_input(int pin, gpio_ctrl_pull_t pull);
+
 /**
  * @brief GPIOピンに値を書き込む
  * @param pin ピン番号
  * @param value 0 (LOW) or 1 (HIGH)
+ * @return gpio_watch が監視中のピンは ESP_ERR_INVALID_STATE
  */
 esp_err_t gpio_ctrl_write(int pin, int value);
 
+/**
+ * @brief 複数のGPIOピンに同時に書き込む
+ *
+ * 出力レジスタへの1回の書き込みで mask の全ピンを切り替える。
+ * @param mask 対象ピンのビットマスク (1 << GPIO番号)
+ * @param values 各ピンの値（mask のビットのみ有効）
+ * @return 許可されていないピンを含む場合は ESP_ERR_INVALID_ARG、
+ *         監視中のピンを含む場合は ESP_ERR_INVALID_STATE（どちらも何も変更しない）
+ */
+esp_err_t gpio_ctrl_write_multi(uint32_t mask, uint32_t values);
+
+/**
+ * @brief 複数のGPIOピンを同時に読み取る
+ * @param mask 対象ピンのビットマスク
+ * @param values 読み取った値（mask のビットのみ有効）
+ */
+esp_err_t gpio_ctrl_read_multi(uint32_t mask, uint32_t *values);
+
 /**
  * @brief ADC値を読み取る
  * @param pin ピン番号 (GPIO 2, 3, 4 のみ)
@@ -34,14 +96,98 @@ esp_err_t gpio_ctrl_write(int pin, int value);
  */
 esp_err_t gpio_ctrl_adc_read(int pin, adc_result_t *result);
 
+/**
+ * @brief 複数のADCピンをまとめて読み取る
+ *
+ * 連続モードでは同じ最新フレームから各ピンを平均して返す。
+ * @param pins ピン番号の配列 (GPIO 2, 3, 4)
+ * @param n ピン数
+ * @param results pins と同じ順で結果を格納する配列
+ * @param samples 平均に使った1ピンあたりのサンプル数（最小値、NULL可）
+ */
+esp_err_t gpio_ctrl_adc_read_multi(const int *pins, int n, adc_result_t *results, int *samples);
+
+/**
+ * @brief ADCのオーバーサンプリング数（平均するサンプル数）を設定
+ * @param samples 1〜SEEDCLAW_ADC_OVERSAMPLE_MAX
+ */
+esp_err_t gpio_ctrl_adc_set_oversample(int samples);
+
+/**
+ * @brief ADCのオーバーサンプリング数を取得
+ */
+int gpio_ctrl_adc_get_oversample(void);
+
+/**
+ * @brief 使用中のADCバックエンド名 ("continuous" / "oneshot")
+ */
+const char *gpio_ctrl_adc_backend(void);
+
 /**
  * @brief PWM出力を設定
  * @param pin ピン番号
  * @param duty_percent デューティ比 0-100 (%)
  * @param freq_hz 周波数 (Hz)、0以下ならデフォルト1000Hz
+ * @note 周波数ごとにLEDCタイマーを割り当てる（異なる周波数は最大4つ）。
+ *       空きタイマーがなければ ESP_ERR_NOT_SUPPORTED、監視中のピンは ESP_ERR_INVALID_STATE
  */
 esp_err_t gpio_ctrl_pwm_set(int pin, int duty_percent, int freq_hz);
 
+/**
+ * @brief 現在のデューティから目標デューティへハードウェアでフェード（待たずに戻る）
+ * @param duty_percent 目標デューティ比 0-100 (%)
+ * @param duration_ms フェード時間 (0〜SEEDCLAW_PWM_FADE_MAX_MS)
+ * @param freq_hz 周波数 (Hz)、0以下なら現在の周波数（未設定なら1000Hz）
+ */
+esp_err_t gpio_ctrl_pwm_fade(int pin, int duty_percent, int duration_ms, int freq_hz);
+
+/**
+ * @brief パルスカウンタを開始（GPIO割り込みでエッジを数える）
+ * @param glitch_us 直前のエッジからこれ未満のエッジを無視（0で無効）
+ */
+esp_err_t gpio_ctrl_pulse_start(int pin, pulse_edge_t edge, gpio_ctrl_pull_t pull, uint32_t glitch_us);
+
+/**
+ * @brief パルスカウンタを停止
+ */
+esp_err_t gpio_ctrl_pulse_stop(int pin);
+
+/**
+ * @brief パルスカウンタの累計をゼロに戻す
+ */
+esp_err_t gpio_ctrl_pulse_reset(int pin);
+
+/**
+ * @brief パルスカウンタの累計とレートを取得
+ * @return カウント中でなければ ESP_ERR_NOT_FOUND
+ */
+esp_err_t gpio_ctrl_pulse_read(int pin, pulse_stats_t *out);
+
+/**
+ * @brief 指定時間エッジを数えて周波数を測る（呼び出し元は window_ms ブロックする）
+ *
+ * カウント中のピンはそのカウンタを使い、そうでなければ立ち上がりエッジで一時的に数える。
+ * 一時的に数えるときも gpio_ctrl_set_input() で設定したプルは保たれる。
+ * @param window_ms 10〜SEEDCLAW_FREQ_MAX_WINDOW_MS
+ */
+esp_err_t gpio_ctrl_freq_measure(int pin, int window_ms, freq_result_t *out);
+
+/**
+ * @brief ピンのGPIO割り込みを予約する（gpio_isr_handler_add の前に呼ぶ）
+ * @return 出力/PWMのピンや別の持ち主が使っているピンは ESP_ERR_INVALID_STATE
+ */
+esp_err_t gpio_ctrl_isr_claim(int pin, gpio_isr_owner_t owner);
+
+/**
+ * @brief gpio_watch が監視中のピンか（監視中のピンへの書き込み/PWMは ESP_ERR_INVALID_STATE）
+ */
+bool gpio_ctrl_is_watched(int pin);
+
+/**
+ * @brief GPIO割り込みの予約を解除（owner が持ち主でなければ何もしない）
+ */
+void gpio_ctrl_isr_release(int pin, gpio_isr_owner_t owner);
+
 /**
  * @brief 全ピン状態をJSON形式で取得
  * @return JSON文字列 (呼び出し元がfree()する)
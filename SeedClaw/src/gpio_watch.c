@@ -0,0 +1,413 @@
+#include "gpio_watch.h"
+#include "discord.h"
+#include "driver/gpio.h"
+#include "soc/soc.h"
+#include "soc/gpio_reg.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs_flash.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "gpio_watch";
+
+_Static_assert((SEEDCLAW_WATCH_RING_LEN & (SEEDCLAW_WATCH_RING_LEN - 1)) == 0,
+               "SEEDCLAW_WATCH_RING_LEN must be a power of two");
+
+// ISR → 監視タスクのエッジイベント
+typedef struct {
+    int64_t t_us;
+    uint8_t pin;
+} edge_event_t;
+
+// NVSに保存する監視設定
+typedef struct {
+    uint8_t pin;             // 0 = 未使用
+    uint8_t edge;            // watch_edge_t
+    uint8_t pull;            // gpio_ctrl_pull_t
+    char label[SEEDCLAW_WATCH_LABEL_LEN];
+} watch_cfg_t;
+
+typedef struct {
+    watch_cfg_t cfg;
+    uint8_t level;           // デバウンス後のレベル
+    bool pending;            // 未確定の変化がある
+    int64_t burst_us;        // 未確定の変化の最初のエッジ時刻
+    int64_t last_edge_us;    // 最後のエッジ時刻（ここから安定時間を数える）
+    uint32_t events;
+} watch_t;
+
+static watch_t s_watches[SEEDCLAW_WATCH_MAX_PINS];
+static SemaphoreHandle_t s_watch_mutex = NULL;
+static TaskHandle_t s_watch_task = NULL;
+static gpio_watch_stats_t s_stats;
+
+// 単一生産者（GPIO ISR）/単一消費者（監視タスク）リング
+// head は ISR だけが、tail はタスクだけが進める
+static edge_event_t s_ring[SEEDCLAW_WATCH_RING_LEN];
+static volatile uint32_t s_ring_head = 0;
+static volatile uint32_t s_ring_tail = 0;
+static volatile uint32_t s_isr_edges = 0;
+static volatile uint32_t s_ring_dropped = 0;
+
+static void lock(void)
+{
+    xSemaphoreTake(s_watch_mutex, portMAX_DELAY);
+}
+
+static void unlock(void)
+{
+    xSemaphoreGive(s_watch_mutex);
+}
+
+// ── ISR ──
+
+static void IRAM_ATTR edge_isr(void *arg)
+{
+    int pin = (int)(intptr_t)arg;
+    uint32_t head = s_ring_head;
+    uint32_t tail = __atomic_load_n(&s_ring_tail, __ATOMIC_ACQUIRE);
+
+    s_isr_edges++;
+    if (head - tail >= SEEDCLAW_WATCH_RING_LEN) {
+        s_ring_dropped++;
+    } else {
+        edge_event_t *ev = &s_ring[head & (SEEDCLAW_WATCH_RING_LEN - 1)];
+        ev->t_us = esp_timer_get_time();
+        ev->pin = (uint8_t)pin;
+        __atomic_store_n(&s_ring_head, head + 1, __ATOMIC_RELEASE);
+    }
+
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(s_watch_task, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+static bool ring_pop(edge_event_t *out)
+{
+    uint32_t tail = s_ring_tail;
+    if (tail == __atomic_load_n(&s_ring_head, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+    *out = s_ring[tail & (SEEDCLAW_WATCH_RING_LEN - 1)];
+    __atomic_store_n(&s_ring_tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+// ── NVS ──
+
+static void save_config(void)
+{
+    watch_cfg_t cfg[SEEDCLAW_WATCH_MAX_PINS];
+    for (int i = 0; i < SEEDCLAW_WATCH_MAX_PINS; i++) {
+        cfg[i] = s_watches[i].cfg;
+    }
+
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(SEEDCLAW_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK) {
+        return;
+    }
+    err = nvs_set_blob(nvs_handle, "gpio_watch", cfg, sizeof(cfg));
+    if (err == ESP_OK) {
+        nvs_commit(nvs_handle);
+    }
+    nvs_close(nvs_handle);
+}
+
+static int load_config(watch_cfg_t *cfg)
+{
+    size_t len = sizeof(watch_cfg_t) * SEEDCLAW_WATCH_MAX_PINS;
+    nvs_handle_t nvs_handle;
+    if (nvs_open(SEEDCLAW_NVS_NAMESPACE, NVS_READONLY, &nvs_handle) != ESP_OK) {
+        return 0;
+    }
+    esp_err_t err = nvs_get_blob(nvs_handle, "gpio_watch", cfg, &len);
+    nvs_close(nvs_handle);
+    if (err != ESP_OK || len != sizeof(watch_cfg_t) * SEEDCLAW_WATCH_MAX_PINS) {
+        return 0;
+    }
+    return SEEDCLAW_WATCH_MAX_PINS;
+}
+
+// ── 監視タスク ──
+
+static watch_t *find_watch(int pin)
+{
+    for (int i = 0; i < SEEDCLAW_WATCH_MAX_PINS; i++) {
+        if (pin != 0 && s_watches[i].cfg.pin == pin) {
+            return &s_watches[i];
+        }
+    }
+    return NULL;
+}
+
+static void append_event(char *report, size_t size, const watch_t *w)
+{
+    size_t len = strlen(report);
+    if (len > 0 && len < size - 1) {
+        report[len++] = '\n';
+        report[len] = '\0';
+    }
+    const char *name = w->cfg.label[0] != '\0' ? w->cfg.label : "";
+    snprintf(report + len, size - len, "**[入力検知]** GPIO%d%s%s%s: %s（%s）",
+             w->cfg.pin, name[0] ? "「" : "", name, name[0] ? "」" : "",
+             w->level ? "HIGH" : "LOW", w->level ? "立ち上がり" : "立ち下がり");
+}
+
+// 安定時間を過ぎた変化を確定し、通知が必要なら report に追記する
+// 戻り値: まだ未確定のピンがあれば次に確認するまでの時間 (ms)、なければ -1
+static int settle_pending(char *report, size_t size, int64_t *first_burst_us)
+{
+    int64_t now = esp_timer_get_time();
+    int64_t debounce_us = (int64_t)SEEDCLAW_WATCH_DEBOUNCE_MS * 1000;
+    int next_ms = -1;
+
+    for (int i = 0; i < SEEDCLAW_WATCH_MAX_PINS; i++) {
+        watch_t *w = &s_watches[i];
+        if (w->cfg.pin == 0 || !w->pending) {
+            continue;
+        }
+        int64_t stable_us = now - w->last_edge_us;
+        if (stable_us < debounce_us) {
+            int wait_ms = (int)((debounce_us - stable_us) / 1000) + 1;
+            if (next_ms < 0 || wait_ms < next_ms) {
+                next_ms = wait_ms;
+            }
+            continue;
+        }
+
+        // 確定値はレジスタから読む（リングが溢れて最後のエッジを落としても正しい）
+        w->pending = false;
+        uint8_t level = (REG_READ(GPIO_IN_REG) >> w->cfg.pin) & 1;
+        if (level == w->level) {
+            s_stats.bounces++;   // 元のレベルに戻った（チャタリング/ノイズ）
+            continue;
+        }
+        w->level = level;
+        watch_edge_t edge = w->level ? WATCH_EDGE_RISING : WATCH_EDGE_FALLING;
+        if ((w->cfg.edge & edge) == 0) {
+            continue;
+        }
+        w->events++;
+        s_stats.notified++;
+        append_event(report, size, w);
+        if (*first_burst_us == 0 || w->burst_us < *first_burst_us) {
+            *first_burst_us = w->burst_us;
+        }
+    }
+    return next_ms;
+}
+
+static void watch_task(void *arg)
+{
+    static char report[SEEDCLAW_WATCH_REPORT_SIZE];
+    int next_ms = -1;
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, next_ms < 0 ? portMAX_DELAY : pdMS_TO_TICKS(next_ms) + 1);
+
+        lock();
+        edge_event_t ev;
+        while (ring_pop(&ev)) {
+            watch_t *w = find_watch(ev.pin);
+            if (w == NULL) {
+                continue;
+            }
+            if (!w->pending) {
+                w->pending = true;
+                w->burst_us = ev.t_us;
+            }
+            w->last_edge_us = ev.t_us;
+        }
+        s_stats.isr_edges = s_isr_edges;
+        s_stats.ring_dropped = s_ring_dropped;
+
+        report[0] = '\0';
+        int64_t first_burst_us = 0;
+        next_ms = settle_pending(report, sizeof(report), &first_burst_us);
+        unlock();
+
+        if (report[0] != '\0') {
+            discord_send_webhook(report);
+            uint32_t latency = (uint32_t)(esp_timer_get_time() - first_burst_us);
+            lock();
+            s_stats.last_latency_us = latency;
+            if (latency > s_stats.max_latency_us) {
+                s_stats.max_latency_us = latency;
+            }
+            unlock();
+        }
+    }
+}
+
+// ── 公開API ──
+
+static esp_err_t attach_locked(watch_t *w)
+{
+    int pin = w->cfg.pin;
+    // パルスカウンタと割り込みハンドラを取り合わないよう、先に予約する
+    esp_err_t err = gpio_ctrl_isr_claim(pin, GPIO_ISR_WATCH);
+    if (err != ESP_OK) {
+        return err;
+    }
+    int level = gpio_ctrl_set_input(pin, (gpio_ctrl_pull_t)w->cfg.pull);
+    if (level < 0) {
+        gpio_ctrl_isr_release(pin, GPIO_ISR_WATCH);
+        return ESP_ERR_INVALID_ARG;
+    }
+    w->level = (uint8_t)level;
+    w->pending = false;
+
+    gpio_set_intr_type(pin, GPIO_INTR_ANYEDGE);
+    err = gpio_isr_handler_add(pin, edge_isr, (void *)(intptr_t)pin);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "ISR handler add failed for GPIO%d: %s", pin, esp_err_to_name(err));
+        gpio_ctrl_isr_release(pin, GPIO_ISR_WATCH);
+        return err;
+    }
+    gpio_intr_enable(pin);
+    return ESP_OK;
+}
+
+static void detach_locked(watch_t *w)
+{
+    gpio_intr_disable(w->cfg.pin);
+    gpio_set_intr_type(w->cfg.pin, GPIO_INTR_DISABLE);
+    gpio_isr_handler_remove(w->cfg.pin);
+    gpio_ctrl_isr_release(w->cfg.pin, GPIO_ISR_WATCH);
+}
+
+esp_err_t gpio_watch_start(void)
+{
+    s_watch_mutex = xSemaphoreCreateMutex();
+    if (s_watch_mutex == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    memset(s_watches, 0, sizeof(s_watches));
+
+    if (xTaskCreate(watch_task, "gpio_watch", SEEDCLAW_WATCH_TASK_STACK, NULL,
+                    SEEDCLAW_WATCH_TASK_PRIO, &s_watch_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create watch task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t err = gpio_install_isr_service(0);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {   // INVALID_STATE = インストール済み
+        ESP_LOGE(TAG, "GPIO ISR service install failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    watch_cfg_t cfg[SEEDCLAW_WATCH_MAX_PINS];
+    int n = load_config(cfg);
+    int active = 0;
+    lock();
+    for (int i = 0; i < n; i++) {
+        if (cfg[i].pin == 0 || !gpio_is_pin_allowed(cfg[i].pin)) {
+            continue;
+        }
+        s_watches[i].cfg = cfg[i];
+        s_watches[i].cfg.label[SEEDCLAW_WATCH_LABEL_LEN - 1] = '\0';
+        if (attach_locked(&s_watches[i]) == ESP_OK) {
+            active++;
+        } else {
+            memset(&s_watches[i], 0, sizeof(s_watches[i]));
+        }
+    }
+    unlock();
+
+    ESP_LOGI(TAG, "GPIO watch started (%d pin(s), debounce %dms)", active, SEEDCLAW_WATCH_DEBOUNCE_MS);
+    return ESP_OK;
+}
+
+esp_err_t gpio_watch_add(int pin, watch_edge_t edge, gpio_ctrl_pull_t pull, const char *label)
+{
+    if (!gpio_is_pin_allowed(pin) || edge < WATCH_EDGE_RISING || edge > WATCH_EDGE_BOTH) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    lock();
+    watch_t *w = find_watch(pin);
+    if (w == NULL) {
+        for (int i = 0; i < SEEDCLAW_WATCH_MAX_PINS; i++) {
+            if (s_watches[i].cfg.pin == 0) {
+                w = &s_watches[i];
+                break;
+            }
+        }
+        if (w == NULL) {
+            unlock();
+            return ESP_ERR_NO_MEM;
+        }
+    } else {
+        detach_locked(w);
+    }
+
+    memset(w, 0, sizeof(*w));
+    w->cfg.pin = (uint8_t)pin;
+    w->cfg.edge = (uint8_t)edge;
+    w->cfg.pull = (uint8_t)pull;
+    if (label != NULL) {
+        strncpy(w->cfg.label, label, sizeof(w->cfg.label) - 1);
+    }
+    esp_err_t err = attach_locked(w);
+    if (err != ESP_OK) {
+        memset(w, 0, sizeof(*w));
+    }
+    save_config();
+    unlock();
+
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "Watching GPIO%d (edge=%d, pull=%d)", pin, edge, pull);
+    }
+    return err;
+}
+
+esp_err_t gpio_watch_remove(int pin)
+{
+    lock();
+    watch_t *w = find_watch(pin);
+    if (w == NULL) {
+        unlock();
+        return ESP_ERR_NOT_FOUND;
+    }
+    detach_locked(w);
+    memset(w, 0, sizeof(*w));
+    save_config();
+    unlock();
+    return ESP_OK;
+}
+
+int gpio_watch_list(gpio_watch_info_t *out, int max)
+{
+    int n = 0;
+    lock();
+    for (int i = 0; i < SEEDCLAW_WATCH_MAX_PINS && n < max; i++) {
+        const watch_t *w = &s_watches[i];
+        if (w->cfg.pin == 0) {
+            continue;
+        }
+        out[n].pin = w->cfg.pin;
+        out[n].edge = (watch_edge_t)w->cfg.edge;
+        out[n].pull = (gpio_ctrl_pull_t)w->cfg.pull;
+        memcpy(out[n].label, w->cfg.label, sizeof(out[n].label));
+        out[n].level = w->level;
+        out[n].events = w->events;
+        n++;
+    }
+    unlock();
+    return n;
+}
+
+void gpio_watch_get_stats(gpio_watch_stats_t *stats)
+{
+    lock();
+    *stats = s_stats;
+    stats->isr_edges = s_isr_edges;
+    stats->ring_dropped = s_ring_dropped;
+    unlock();
+}
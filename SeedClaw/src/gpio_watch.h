@@ -0,0 +1,65 @@
+#pragma once
+
+#include "esp_err.h"
+#include "gpio_ctrl.h"
+#include "seedclaw_config.h"
+#include <stdint.h>
+
+/*
+ * GPIO入力のエッジ監視
+ *
+ * 登録したピンのエッジ割り込みを ISR でタイムスタンプ付きのイベントにして
+ * ロックなしの単一生産者/単一消費者リングに積み、監視タスクがデバウンスして
+ * 確定したエッジだけを Discord に通知する。LLM は介さない。
+ */
+
+typedef enum {
+    WATCH_EDGE_RISING = 1,
+    WATCH_EDGE_FALLING = 2,
+    WATCH_EDGE_BOTH = 3,
+} watch_edge_t;
+
+typedef struct {
+    int pin;
+    watch_edge_t edge;
+    gpio_ctrl_pull_t pull;
+    char label[SEEDCLAW_WATCH_LABEL_LEN];
+    int level;               // デバウンス後の現在レベル
+    uint32_t events;         // 通知したエッジ数
+} gpio_watch_info_t;
+
+typedef struct {
+    uint32_t isr_edges;      // ISR が受けた生のエッジ数
+    uint32_t ring_dropped;   // リングが満杯で捨てたエッジ数
+    uint32_t bounces;        // デバウンスで捨てた（元のレベルに戻った）変化
+    uint32_t notified;       // 通知したエッジ数
+    uint32_t last_latency_us;  // 最初のエッジから通知を積むまで
+    uint32_t max_latency_us;
+} gpio_watch_stats_t;
+
+/**
+ * @brief ISRサービスと監視タスクを起動し、NVSの監視設定を復元
+ */
+esp_err_t gpio_watch_start(void);
+
+/**
+ * @brief ピンの監視を追加/更新（NVSに保存）
+ * @param label 通知に使う名前（NULL/空ならピン名のみ）
+ */
+esp_err_t gpio_watch_add(int pin, watch_edge_t edge, gpio_ctrl_pull_t pull, const char *label);
+
+/**
+ * @brief ピンの監視を解除（NVSからも削除）
+ */
+esp_err_t gpio_watch_remove(int pin);
+
+/**
+ * @brief 監視中のピン一覧を取得
+ * @return ピン数
+ */
+int gpio_watch_list(gpio_watch_info_t *out, int max);
+
+/**
+ * @brief 統計を取得
+ */
+void gpio_watch_get_stats(gpio_watch_stats_t *stats);
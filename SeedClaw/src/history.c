@@ -0,0 +1,290 @@
+#include "history.h"
+#include "esp_log.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "history";
+
+#define SLOT(h, i) (((h)->rec_head + (i)) % SEEDCLAW_HISTORY_MAX_RECORDS)
+#define REC(h, i)  (&(h)->recs[SLOT(h, i)])
+
+esp_err_t history_init(history_t *h, size_t arena_size)
+{
+    memset(h, 0, sizeof(*h));
+    h->arena = malloc(arena_size);
+    if (h->arena == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate history arena (%u bytes)", (unsigned)arena_size);
+        return ESP_ERR_NO_MEM;
+    }
+    h->arena_size = arena_size;
+    return ESP_OK;
+}
+
+void history_set_evict_hook(history_t *h, history_evict_cb_t cb, void *ctx)
+{
+    h->on_evict = cb;
+    h->evict_ctx = ctx;
+}
+
+void history_clear(history_t *h)
+{
+    h->arena_head = 0;
+    h->arena_tail = 0;
+    h->rec_head = 0;
+    h->rec_count = 0;
+    h->exchanges = 0;
+}
+
+// n バイトを置ける位置を探す（レコードは折り返さずに連続配置する）
+static bool arena_find(const history_t *h, size_t n, size_t *out_off)
+{
+    if (h->rec_count == 0) {
+        *out_off = 0;
+        return n <= h->arena_size;
+    }
+    if (h->arena_tail > h->arena_head) {
+        if (h->arena_size - h->arena_tail >= n) {
+            *out_off = h->arena_tail;
+            return true;
+        }
+        // 末尾の余りは捨てて先頭に折り返す
+        if (h->arena_head >= n) {
+            *out_off = 0;
+            return true;
+        }
+        return false;
+    }
+    if (h->arena_tail < h->arena_head && h->arena_head - h->arena_tail >= n) {
+        *out_off = h->arena_tail;
+        return true;
+    }
+    return false;
+}
+
+static void pop_front(history_t *h)
+{
+    history_rec_t *r = REC(h, 0);
+    if (!r->dead && r->kind == HISTORY_USER_TEXT) {
+        h->exchanges--;
+    }
+    if (r->partner != HISTORY_NO_PARTNER) {
+        // 相手は孤立する
+        h->recs[r->partner].partner = HISTORY_NO_PARTNER;
+    }
+    h->rec_head = (h->rec_head + 1) % SEEDCLAW_HISTORY_MAX_RECORDS;
+    h->rec_count--;
+    if (h->rec_count == 0) {
+        h->arena_head = 0;
+        h->arena_tail = 0;
+    } else {
+        h->arena_head = REC(h, 0)->off;
+    }
+}
+
+static bool is_live_user_text(const history_t *h, int i)
+{
+    const history_rec_t *r = REC(h, i);
+    return !r->dead && r->kind == HISTORY_USER_TEXT;
+}
+
+// 先頭レコードを押し出しフックに渡してから捨てる
+static void evict_front(history_t *h)
+{
+    history_entry_t e;
+    if (h->on_evict != NULL && history_get(h, 0, &e)) {
+        h->on_evict(&e, h->evict_ctx);
+    }
+    pop_front(h);
+}
+
+void history_drop_oldest_exchange(history_t *h)
+{
+    if (h->rec_count == 0) {
+        return;
+    }
+    evict_front(h);
+    while (h->rec_count > 0 && !is_live_user_text(h, 0)) {
+        evict_front(h);
+    }
+}
+
+// 最新のユーザー発言の位置。なければ -1
+static int current_exchange_start(const history_t *h)
+{
+    for (int i = h->rec_count - 1; i >= 0; i--) {
+        if (is_live_user_text(h, i)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// 直近の tool_use の並びから、同じIDでまだ結果のない tool_use を探す
+static int find_pending_tool_use(const history_t *h, const char *tool_use_id)
+{
+    for (int i = h->rec_count - 1; i >= 0; i--) {
+        const history_rec_t *r = REC(h, i);
+        if (r->kind != HISTORY_TOOL_USE && r->kind != HISTORY_TOOL_RESULT) {
+            break;
+        }
+        if (!r->dead && r->kind == HISTORY_TOOL_USE && r->partner == HISTORY_NO_PARTNER &&
+            strcmp(h->arena + r->off, tool_use_id) == 0) {
+            return SLOT(h, i);
+        }
+    }
+    return -1;
+}
+
+esp_err_t history_append(history_t *h, history_kind_t kind, const char *tool_use_id,
+                         const char *tool_name, const char *content)
+{
+    if (h->arena == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (tool_use_id == NULL) tool_use_id = "";
+    if (tool_name == NULL) tool_name = "";
+
+    size_t id_len = strnlen(tool_use_id, 63);
+    size_t name_len = strnlen(tool_name, 63);
+    size_t content_len = strlen(content);
+    size_t n = id_len + 1 + name_len + 1 + content_len + 1;
+    // 本文は切り詰めない（JSONが壊れるため）。アリーナ全体にも収まらないなら何も捨てずに断る
+    if (n > h->arena_size) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // 進行中の往復（最新のユーザー発言以降）は押し出さない。
+    // 新しいユーザー発言を追加するときは直前の往復も押し出してよい
+    size_t off;
+    while (h->rec_count == SEEDCLAW_HISTORY_MAX_RECORDS || !arena_find(h, n, &off)) {
+        if (h->rec_count == 0 || (kind != HISTORY_USER_TEXT && current_exchange_start(h) == 0)) {
+            return ESP_ERR_NO_MEM;
+        }
+        history_drop_oldest_exchange(h);
+    }
+
+    char *p = h->arena + off;
+    memcpy(p, tool_use_id, id_len);
+    p[id_len] = '\0';
+    p += id_len + 1;
+    memcpy(p, tool_name, name_len);
+    p[name_len] = '\0';
+    p += name_len + 1;
+    memcpy(p, content, content_len);
+    p[content_len] = '\0';
+
+    if (h->rec_count == 0) {
+        h->arena_head = off;
+    }
+    h->arena_tail = off + n;
+
+    int slot = SLOT(h, h->rec_count);
+    history_rec_t *r = &h->recs[slot];
+    r->off = (uint16_t)off;
+    r->size = (uint16_t)n;
+    r->kind = (uint8_t)kind;
+    r->partner = HISTORY_NO_PARTNER;
+    r->dead = false;
+
+    if (kind == HISTORY_TOOL_RESULT) {
+        int use = find_pending_tool_use(h, h->arena + off);
+        if (use >= 0) {
+            r->partner = (uint8_t)use;
+            h->recs[use].partner = (uint8_t)slot;
+        }
+    } else if (kind == HISTORY_USER_TEXT) {
+        h->exchanges++;
+    }
+    h->rec_count++;
+    return ESP_OK;
+}
+
+// レコードの入力トークン数の見積もり（UTF-8の和文は1文字3バイトで概ね1トークン、
+// 英数字はそれより少ないので安全側に倒れる）。メッセージの枠の分を足す。
+static size_t estimate_tokens(const history_rec_t *r)
+{
+    return 4 + (r->size + 2) / 3;
+}
+
+int history_suffix_start(const history_t *h, size_t budget_tokens, size_t *out_tokens)
+{
+    size_t total = 0;
+    size_t chosen_tokens = 0;
+    int start = h->rec_count;
+
+    for (int i = h->rec_count - 1; i >= 0; i--) {
+        const history_rec_t *r = REC(h, i);
+        if (r->dead) {
+            continue;
+        }
+        total += estimate_tokens(r);
+        if (r->kind != HISTORY_USER_TEXT) {
+            continue;
+        }
+        // 往復の境界。最新の往復は無条件に採用する
+        if (start != h->rec_count && total > budget_tokens) {
+            break;
+        }
+        start = i;
+        chosen_tokens = total;
+    }
+
+    if (out_tokens != NULL) {
+        *out_tokens = chosen_tokens;
+    }
+    return start;
+}
+
+int history_exchanges(const history_t *h)
+{
+    return h->exchanges;
+}
+
+int history_count(const history_t *h)
+{
+    return h->rec_count;
+}
+
+bool history_get(const history_t *h, int i, history_entry_t *out)
+{
+    const history_rec_t *r = REC(h, i);
+    if (r->dead) {
+        return false;
+    }
+    const char *p = h->arena + r->off;
+    out->kind = (history_kind_t)r->kind;
+    out->tool_use_id = p;
+    p += strlen(p) + 1;
+    out->tool_name = p;
+    p += strlen(p) + 1;
+    out->content = p;
+    return true;
+}
+
+size_t history_bytes_used(const history_t *h)
+{
+    if (h->rec_count == 0) {
+        return 0;
+    }
+    if (h->arena_tail > h->arena_head) {
+        return h->arena_tail - h->arena_head;
+    }
+    return h->arena_size - h->arena_head + h->arena_tail;
+}
+
+void history_sanitize(history_t *h)
+{
+    // 先頭がユーザー発言になるまで除去
+    while (h->rec_count > 0 && !is_live_user_text(h, 0)) {
+        pop_front(h);
+    }
+
+    // 対のない tool_use / tool_result に墓標を立てる（対応は追加時に付けてあるので1パス）
+    for (int i = 0; i < h->rec_count; i++) {
+        history_rec_t *r = REC(h, i);
+        if ((r->kind == HISTORY_TOOL_USE || r->kind == HISTORY_TOOL_RESULT) &&
+            r->partner == HISTORY_NO_PARTNER) {
+            r->dead = true;
+        }
+    }
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "esp_err.h"
+#include "seedclaw_config.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * 会話履歴（可変長レコードのリングアリーナ）
+ *
+ * 各レコードは "tool_use_id\0tool_name\0content\0" としてアリーナに詰めて置き、
+ * 位置と種別だけを固定長のインデックスリングで持つ。古い往復は先頭から
+ * 順に捨てるだけなので memmove は発生しない。途中のレコードを除去する場合は
+ * 墓標 (dead) を立て、先頭に来た時点で領域ごと解放される。
+ *
+ * tool_use と tool_result は追加時に対応付け、互いのスロット番号を持つ。
+ * 片方が捨てられると相手は孤立扱いになるので、整合性チェックは
+ * 孤立レコードに墓標を立てるだけの1パスで済む。
+ */
+
+#define HISTORY_NO_PARTNER  0xFF
+
+#if SEEDCLAW_HISTORY_MAX_RECORDS >= HISTORY_NO_PARTNER
+#error "SEEDCLAW_HISTORY_MAX_RECORDS must be less than 255"
+#endif
+
+typedef enum {
+    HISTORY_USER_TEXT,       // ユーザー発言（往復の起点）
+    HISTORY_ASSISTANT_TEXT,  // 最終応答
+    HISTORY_TOOL_USE,        // assistant の tool_use（content は入力JSON）
+    HISTORY_TOOL_RESULT,     // user の tool_result（content は結果文字列）
+} history_kind_t;
+
+typedef struct {
+    uint16_t off;            // アリーナ内の位置
+    uint16_t size;           // 使用バイト数（NUL込み）
+    uint8_t kind;            // history_kind_t
+    uint8_t partner;         // 対になる tool_use / tool_result のスロット (HISTORY_NO_PARTNER = 孤立)
+    bool dead;               // 除去済み（墓標）
+} history_rec_t;
+
+typedef struct history_entry history_entry_t;
+
+/** @brief 往復が押し出される直前に、生きている各レコードについて呼ばれる */
+typedef void (*history_evict_cb_t)(const history_entry_t *e, void *ctx);
+
+typedef struct {
+    char *arena;
+    size_t arena_size;
+    size_t arena_head;       // 最古レコードの位置
+    size_t arena_tail;       // 次の書き込み位置
+    history_rec_t recs[SEEDCLAW_HISTORY_MAX_RECORDS];
+    int rec_head;
+    int rec_count;           // 墓標を含むレコード数
+    int exchanges;           // 生きているユーザー発言の数
+    history_evict_cb_t on_evict;
+    void *evict_ctx;
+} history_t;
+
+struct history_entry {
+    history_kind_t kind;
+    const char *tool_use_id; // テキストなら ""
+    const char *tool_name;   // tool_use以外は ""
+    const char *content;
+};
+
+/**
+ * @brief 履歴を初期化（アリーナをヒープに確保）
+ */
+esp_err_t history_init(history_t *h, size_t arena_size);
+
+/**
+ * @brief 古い往復を押し出すときのフックを登録（history_clear() では呼ばれない）
+ */
+void history_set_evict_hook(history_t *h, history_evict_cb_t cb, void *ctx);
+
+/**
+ * @brief 全レコードを破棄
+ */
+void history_clear(history_t *h);
+
+/**
+ * @brief レコードを末尾に追加（入り切らなければ古い往復から捨てる）
+ * content は切り詰めずにそのまま置く（大きさの上限はアリーナの空きだけ）。
+ * 進行中の往復（最新のユーザー発言以降）は押し出さない。
+ * @return 進行中の往復だけでアリーナかインデックスが埋まっている、または
+ *         レコードがアリーナより大きければ ESP_ERR_NO_MEM
+ */
+esp_err_t history_append(history_t *h, history_kind_t kind, const char *tool_use_id,
+                         const char *tool_name, const char *content);
+
+/**
+ * @brief 最古の往復（先頭のユーザー発言から次のユーザー発言の手前まで）を捨てる
+ */
+void history_drop_oldest_exchange(history_t *h);
+
+/**
+ * @brief 孤立した tool_use / tool_result を除去し、先頭をユーザー発言に揃える
+ */
+void history_sanitize(history_t *h);
+
+/**
+ * @brief 予算に収まる最長の末尾（往復単位）の開始位置を返す
+ *
+ * 各レコードの入力トークン数をバイト数から見積もり、末尾から往復ごとに積み上げる。
+ * 往復の途中では切らないので tool_use / tool_result の対は崩れない。
+ * 最新の往復は予算を超えていても必ず含める。
+ * @param budget_tokens 履歴に割り当てる入力トークン数
+ * @param out_tokens 選んだ範囲の見積もりトークン数（NULL可）
+ * @return history_get() の添字（この位置から末尾までを送る）
+ */
+int history_suffix_start(const history_t *h, size_t budget_tokens, size_t *out_tokens);
+
+/**
+ * @brief 往復数（生きているユーザー発言の数）
+ */
+int history_exchanges(const history_t *h);
+
+/**
+ * @brief 墓標を含むレコード数（history_get() の添字の上限）
+ */
+int history_count(const history_t *h);
+
+/**
+ * @brief i 番目（0 = 最古）のレコードを取得
+ * @return 除去済みなら false
+ */
+bool history_get(const history_t *h, int i, history_entry_t *out);
+
+/**
+ * @brief アリーナの使用バイト数
+ */
+size_t history_bytes_used(const history_t *h);
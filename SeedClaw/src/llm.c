@@ -6,6 +6,7 @@
 #include "esp_crt_bundle.h"
 #include "cJSON.h"
 #include "nvs.h"
+#include "esp_timer.h"
 #include <string.h>
 #include <stdio.h>
 
@@ -15,35 +16,507 @@ static char s_api_key[128] = SEEDCLAW_DEFAULT_API_KEY;
 static char s_provider[16] = SEEDCLAW_LLM_DEFAULT_PROVIDER;
 static char s_model[64] = SEEDCLAW_LLM_DEFAULT_MODEL;
 static char s_system_prompt[1024] = SEEDCLAW_DEFAULT_SYSTEM_PROMPT;
+static char s_memory[SEEDCLAW_SUMMARY_MAX_LEN];   // 会話要約（システムプロンプトの後ろに付ける）
 
-typedef struct {
-    char *buffer;
-    size_t size;
+// model / system / tools を描画済みのリクエスト接頭辞（`..."messages":` まで）
+static const char *s_tools_json = NULL;
+static char *s_request_prefix = NULL;
+static size_t s_request_prefix_len = 0;
+static bool s_prefix_dirty = true;   // 設定変更時に立て、次のリクエスト前に組み立て直す
+
+// リクエスト本文の書き込み先（チャンク単位でソケットへ送る）
+#define LLM_CHUNK_HEAD  10   // チャンクサイズ行 "<hex>\r\n" の予約領域
+
+struct llm_writer {
+    esp_http_client_handle_t client;
     size_t len;
-} http_response_t;
+    size_t total;
+    bool failed;
+    char buf[LLM_CHUNK_HEAD + SEEDCLAW_LLM_IO_CHUNK + 2];  // サイズ行 + データ + "\r\n"
+};
+
+// SSEストリームの受信状態（1リクエスト分、サイズ固定）
+typedef enum {
+    SSE_BLOCK_NONE,
+    SSE_BLOCK_TEXT,
+    SSE_BLOCK_TOOL_USE,
+} sse_block_type_t;
+
+typedef struct {
+    // 行バッファ: "data: {...}" 1行ずつ処理する
+    char line[SEEDCLAW_LLM_SSE_LINE_MAX];
+    size_t line_len;
+    bool line_overflow;
+    size_t bytes_received;
+
+    // HTTPエラー時のボディ（SSEではなく通常のJSON）
+    char err_body[256];
+    size_t err_len;
+
+    // テキスト出力先（呼び出し元のバッファ）
+    char *out;
+    size_t out_size;
+    size_t out_len;
+    bool truncated;
+
+    // 受信中のcontentブロック
+    sse_block_type_t block;
+    char tool_id[48];
+    char tool_name[32];
+    char tool_input[SEEDCLAW_LLM_TOOL_INPUT_MAX];
+    size_t tool_input_len;
+    bool tool_input_overflow;
+    int tool_count;
+
+    char stop_reason[24];
+    bool got_error;
+
+    // usage（message_start / message_delta）
+    bool got_usage;
+    uint32_t usage_input;
+    uint32_t usage_cache_write;
+    uint32_t usage_cache_read;
+    uint32_t usage_output;
+
+    // tool_useの通知先（NULLなら collected にJSON配列で蓄積）
+    llm_tool_use_cb_t on_tool_use;
+    void *user_ctx;
+    cJSON *collected;
+
+    // 送受信バッファ
+    llm_writer_t writer;
+    char rx[SEEDCLAW_LLM_IO_CHUNK];
+} sse_ctx_t;
+
+// api.anthropic.com へのプール済みセッション（ReActラウンド・メッセージ間で再利用）
+static esp_http_client_handle_t s_session = NULL;
+static int64_t s_session_last_used_us = 0;
+static int64_t s_request_start_us = 0;
+static int64_t s_connect_us = -1;   // 今回のリクエストで接続に要した時間 (-1 = 再利用)
+static llm_session_stats_t s_session_stats;
+static llm_usage_stats_t s_usage_stats;
+
+// UTF-8の文字境界を壊さないようにテキストを出力バッファへ追記
+static void sse_append_text(sse_ctx_t *ctx, const char *text)
+{
+    size_t len = strlen(text);
+    size_t avail = ctx->out_size - ctx->out_len - 1;
+    if (len > avail) {
+        len = avail;
+        while (len > 0 && ((unsigned char)text[len] & 0xC0) == 0x80) {
+            len--;
+        }
+        if (!ctx->truncated) {
+            ESP_LOGW(TAG, "LLM text exceeds %u bytes, truncating", (unsigned)ctx->out_size);
+            ctx->truncated = true;
+        }
+    }
+    memcpy(ctx->out + ctx->out_len, text, len);
+    ctx->out_len += len;
+    ctx->out[ctx->out_len] = '\0';
+}
+
+static void sse_finish_tool_use(sse_ctx_t *ctx)
+{
+    // 溢れた入力は途中が欠けており、別の有効な入力に見えることがあるので渡さない
+    const char *input = NULL;
+    if (ctx->tool_input_overflow) {
+        ESP_LOGW(TAG, "Tool input for %s exceeds %d bytes, not dispatching",
+                 ctx->tool_name, SEEDCLAW_LLM_TOOL_INPUT_MAX);
+    } else {
+        input = (ctx->tool_input_len > 0) ? ctx->tool_input : "{}";
+    }
+    ctx->tool_count++;
+
+    if (ctx->on_tool_use != NULL) {
+        // content_block_stop 到着時点で即ディスパッチ
+        ctx->on_tool_use(ctx->tool_id, ctx->tool_name, input, ctx->user_ctx);
+        return;
+    }
+
+    cJSON *item = cJSON_CreateObject();
+    cJSON_AddStringToObject(item, "tool_use_id", ctx->tool_id);
+    cJSON_AddStringToObject(item, "name", ctx->tool_name);
+    cJSON *input_obj = (input != NULL) ? cJSON_Parse(input) : NULL;
+    if (input_obj != NULL) {
+        cJSON_AddItemToObject(item, "input", input_obj);
+    } else {
+        cJSON_AddStringToObject(item, "error", input != NULL ? "invalid input" : "input too large");
+    }
+    cJSON_AddItemToArray(ctx->collected, item);
+}
+
+// usageオブジェクトの各トークン数を取り込む（含まれる項目だけ上書き）
+static void sse_read_usage(sse_ctx_t *ctx, const cJSON *usage)
+{
+    if (!cJSON_IsObject(usage)) {
+        return;
+    }
+    const cJSON *v;
+    if (cJSON_IsNumber(v = cJSON_GetObjectItem(usage, "input_tokens"))) {
+        ctx->usage_input = (uint32_t)v->valuedouble;
+    }
+    if (cJSON_IsNumber(v = cJSON_GetObjectItem(usage, "cache_creation_input_tokens"))) {
+        ctx->usage_cache_write = (uint32_t)v->valuedouble;
+    }
+    if (cJSON_IsNumber(v = cJSON_GetObjectItem(usage, "cache_read_input_tokens"))) {
+        ctx->usage_cache_read = (uint32_t)v->valuedouble;
+    }
+    if (cJSON_IsNumber(v = cJSON_GetObjectItem(usage, "output_tokens"))) {
+        ctx->usage_output = (uint32_t)v->valuedouble;
+    }
+    ctx->got_usage = true;
+}
+
+// SSEイベント1件（data: 行のJSON）を処理
+static void sse_handle_event(sse_ctx_t *ctx, const char *json)
+{
+    cJSON *ev = cJSON_Parse(json);
+    if (ev == NULL) {
+        return;
+    }
+    cJSON *type = cJSON_GetObjectItem(ev, "type");
+    const char *t = cJSON_IsString(type) ? type->valuestring : "";
+
+    if (strcmp(t, "message_start") == 0) {
+        cJSON *message = cJSON_GetObjectItem(ev, "message");
+        sse_read_usage(ctx, cJSON_GetObjectItem(message, "usage"));
+    } else if (strcmp(t, "content_block_start") == 0) {
+        cJSON *block = cJSON_GetObjectItem(ev, "content_block");
+        cJSON *btype = cJSON_GetObjectItem(block, "type");
+        ctx->block = SSE_BLOCK_NONE;
+        if (cJSON_IsString(btype) && strcmp(btype->valuestring, "tool_use") == 0) {
+            cJSON *id = cJSON_GetObjectItem(block, "id");
+            cJSON *name = cJSON_GetObjectItem(block, "name");
+            ctx->block = SSE_BLOCK_TOOL_USE;
+            ctx->tool_id[0] = '\0';
+            ctx->tool_name[0] = '\0';
+            if (cJSON_IsString(id)) {
+                strncpy(ctx->tool_id, id->valuestring, sizeof(ctx->tool_id) - 1);
+            }
+            if (cJSON_IsString(name)) {
+                strncpy(ctx->tool_name, name->valuestring, sizeof(ctx->tool_name) - 1);
+            }
+            ctx->tool_input_len = 0;
+            ctx->tool_input[0] = '\0';
+            ctx->tool_input_overflow = false;
+        } else if (cJSON_IsString(btype) && strcmp(btype->valuestring, "text") == 0) {
+            ctx->block = SSE_BLOCK_TEXT;
+        }
+    } else if (strcmp(t, "content_block_delta") == 0) {
+        cJSON *delta = cJSON_GetObjectItem(ev, "delta");
+        cJSON *text = cJSON_GetObjectItem(delta, "text");
+        cJSON *partial = cJSON_GetObjectItem(delta, "partial_json");
+        if (ctx->block == SSE_BLOCK_TEXT && cJSON_IsString(text)) {
+            sse_append_text(ctx, text->valuestring);
+        } else if (ctx->block == SSE_BLOCK_TOOL_USE && cJSON_IsString(partial) &&
+                   !ctx->tool_input_overflow) {
+            // 一度溢れたら以降の断片も捨てる（末尾だけ繋がると別の入力になる）
+            size_t len = strlen(partial->valuestring);
+            if (ctx->tool_input_len + len < sizeof(ctx->tool_input)) {
+                memcpy(ctx->tool_input + ctx->tool_input_len, partial->valuestring, len + 1);
+                ctx->tool_input_len += len;
+            } else {
+                ctx->tool_input_overflow = true;
+            }
+        }
+    } else if (strcmp(t, "content_block_stop") == 0) {
+        if (ctx->block == SSE_BLOCK_TOOL_USE) {
+            sse_finish_tool_use(ctx);
+        }
+        ctx->block = SSE_BLOCK_NONE;
+    } else if (strcmp(t, "message_delta") == 0) {
+        cJSON *delta = cJSON_GetObjectItem(ev, "delta");
+        cJSON *stop_reason = cJSON_GetObjectItem(delta, "stop_reason");
+        if (cJSON_IsString(stop_reason)) {
+            strncpy(ctx->stop_reason, stop_reason->valuestring, sizeof(ctx->stop_reason) - 1);
+        }
+        sse_read_usage(ctx, cJSON_GetObjectItem(ev, "usage"));
+    } else if (strcmp(t, "error") == 0) {
+        cJSON *error = cJSON_GetObjectItem(ev, "error");
+        cJSON *message = cJSON_GetObjectItem(error, "message");
+        ctx->got_error = true;
+        ESP_LOGE(TAG, "LLM stream error: %s",
+                 cJSON_IsString(message) ? message->valuestring : "unknown");
+        snprintf(ctx->out, ctx->out_size, "LLM API エラー: %.200s",
+                 cJSON_IsString(message) ? message->valuestring : "unknown");
+        ctx->out_len = strlen(ctx->out);
+    }
+
+    cJSON_Delete(ev);
+}
+
+// 受信チャンクを行単位に分割してSSEイベントを処理
+static void sse_feed(sse_ctx_t *ctx, const char *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        char c = data[i];
+        if (c == '\n') {
+            ctx->line[ctx->line_len] = '\0';
+            if (ctx->line_overflow) {
+                ESP_LOGW(TAG, "SSE line exceeds %d bytes, skipped", SEEDCLAW_LLM_SSE_LINE_MAX);
+            } else if (strncmp(ctx->line, "data:", 5) == 0) {
+                const char *payload = ctx->line + 5;
+                while (*payload == ' ') payload++;
+                sse_handle_event(ctx, payload);
+            }
+            ctx->line_len = 0;
+            ctx->line_overflow = false;
+        } else if (c == '\r') {
+            continue;
+        } else if (ctx->line_len < sizeof(ctx->line) - 1) {
+            ctx->line[ctx->line_len++] = c;
+        } else {
+            ctx->line_overflow = true;
+        }
+    }
+}
+
+static void sse_reset(sse_ctx_t *ctx)
+{
+    ctx->line_len = 0;
+    ctx->line_overflow = false;
+    ctx->bytes_received = 0;
+    ctx->err_len = 0;
+    ctx->err_body[0] = '\0';
+    ctx->out_len = 0;
+    ctx->out[0] = '\0';
+    ctx->truncated = false;
+    ctx->block = SSE_BLOCK_NONE;
+    ctx->tool_count = 0;
+    ctx->stop_reason[0] = '\0';
+    ctx->got_error = false;
+}
 
 static esp_err_t http_event_handler(esp_http_client_event_t *evt)
 {
-    http_response_t *resp = (http_response_t *)evt->user_data;
-
-    switch (evt->event_id) {
-        case HTTP_EVENT_ON_DATA:
-            if (resp->buffer != NULL) {
-                size_t available = resp->size - resp->len - 1;
-                size_t copy_len = (evt->data_len < available) ? evt->data_len : available;
-                if (copy_len > 0) {
-                    memcpy(resp->buffer + resp->len, evt->data, copy_len);
-                    resp->len += copy_len;
-                    resp->buffer[resp->len] = '\0';
-                }
+    // 応答本文は session_post() の読み取りループで直接処理する
+    if (evt->event_id == HTTP_EVENT_ON_CONNECTED) {
+        s_connect_us = esp_timer_get_time() - s_request_start_us;
+    }
+    return ESP_OK;
+}
+
+// 受信データを振り分け（200以外のエラー応答はSSEではないので先頭だけ保持）
+static void handle_response_data(sse_ctx_t *ctx, int status, const char *data, size_t len)
+{
+    ctx->bytes_received += len;
+    if (status != 200) {
+        size_t avail = sizeof(ctx->err_body) - ctx->err_len - 1;
+        size_t copy_len = (len < avail) ? len : avail;
+        memcpy(ctx->err_body + ctx->err_len, data, copy_len);
+        ctx->err_len += copy_len;
+        ctx->err_body[ctx->err_len] = '\0';
+    } else {
+        sse_feed(ctx, data, len);
+    }
+}
+
+// ── リクエスト本文の書き込み ──
+
+static void writer_flush(llm_writer_t *w)
+{
+    if (w->len == 0 || w->failed) {
+        return;
+    }
+    // チャンク転送: "<size hex>\r\n<data>\r\n" を1回の書き込みで送る
+    char size_line[LLM_CHUNK_HEAD + 1];
+    int n = snprintf(size_line, sizeof(size_line), "%x\r\n", (unsigned)w->len);
+    char *start = w->buf + LLM_CHUNK_HEAD - n;
+    memcpy(start, size_line, n);
+    memcpy(w->buf + LLM_CHUNK_HEAD + w->len, "\r\n", 2);
+    int total = n + (int)w->len + 2;
+    if (esp_http_client_write(w->client, start, total) != total) {
+        w->failed = true;
+    }
+    w->total += w->len;
+    w->len = 0;
+}
+
+void llm_writer_raw(llm_writer_t *w, const char *s, size_t len)
+{
+    while (len > 0 && !w->failed) {
+        size_t space = SEEDCLAW_LLM_IO_CHUNK - w->len;
+        size_t n = (len < space) ? len : space;
+        memcpy(w->buf + LLM_CHUNK_HEAD + w->len, s, n);
+        w->len += n;
+        s += n;
+        len -= n;
+        if (w->len == SEEDCLAW_LLM_IO_CHUNK) {
+            writer_flush(w);
+        }
+    }
+}
+
+static void writer_putc(llm_writer_t *w, char c)
+{
+    llm_writer_raw(w, &c, 1);
+}
+
+// 先頭バイト p から始まる正しいUTF-8列の長さ（不正なら0）
+static int utf8_seq_len(const unsigned char *p)
+{
+    if ((p[0] & 0xE0) == 0xC0) {
+        return (p[0] >= 0xC2 && (p[1] & 0xC0) == 0x80) ? 2 : 0;
+    }
+    if ((p[0] & 0xF0) == 0xE0) {
+        if ((p[1] & 0xC0) != 0x80 || (p[2] & 0xC0) != 0x80) {
+            return 0;
+        }
+        // サロゲート (U+D800-U+DFFF) を除外
+        unsigned int cp = ((p[0] & 0x0F) << 12) | ((p[1] & 0x3F) << 6) | (p[2] & 0x3F);
+        return (cp >= 0x800 && (cp < 0xD800 || cp > 0xDFFF)) ? 3 : 0;
+    }
+    if ((p[0] & 0xF8) == 0xF0) {
+        return ((p[1] & 0xC0) == 0x80 && (p[2] & 0xC0) == 0x80 && (p[3] & 0xC0) == 0x80) ? 4 : 0;
+    }
+    return 0;
+}
+
+void llm_writer_str(llm_writer_t *w, const char *s)
+{
+    const unsigned char *p = (const unsigned char *)s;
+    writer_putc(w, '"');
+    while (*p) {
+        // エスケープ不要なASCIIの連続はまとめて書く
+        const unsigned char *run = p;
+        while (*p >= 0x20 && *p < 0x80 && *p != '"' && *p != '\\') {
+            p++;
+        }
+        if (p > run) {
+            llm_writer_raw(w, (const char *)run, p - run);
+            continue;
+        }
+
+        unsigned char c = *p;
+        if (c == '"' || c == '\\') {
+            char esc[2] = { '\\', (char)c };
+            llm_writer_raw(w, esc, 2);
+            p++;
+        } else if (c < 0x20) {
+            char esc[8];
+            int n;
+            switch (c) {
+                case '\n': n = snprintf(esc, sizeof(esc), "\\n"); break;
+                case '\r': n = snprintf(esc, sizeof(esc), "\\r"); break;
+                case '\t': n = snprintf(esc, sizeof(esc), "\\t"); break;
+                default:   n = snprintf(esc, sizeof(esc), "\\u%04x", c); break;
             }
-            break;
-        default:
-            break;
+            llm_writer_raw(w, esc, n);
+            p++;
+        } else {
+            int n = utf8_seq_len(p);
+            if (n > 0) {
+                llm_writer_raw(w, (const char *)p, n);
+                p += n;
+            } else {
+                writer_putc(w, '?');
+                p++;
+            }
+        }
+    }
+    writer_putc(w, '"');
+}
+
+static cJSON *cache_control_ephemeral(void)
+{
+    cJSON *cc = cJSON_CreateObject();
+    cJSON_AddStringToObject(cc, "type", "ephemeral");
+    return cc;
+}
+
+// リクエストJSONを印字し、末尾の "}" を外して messages キーを続けた接頭辞にする
+static char *print_request_prefix(cJSON *req, size_t *out_len)
+{
+    char *printed = cJSON_PrintUnformatted(req);
+    if (printed == NULL) {
+        return NULL;
+    }
+
+    static const char messages_key[] = ",\"messages\":";
+    size_t len = strlen(printed) - 1;
+    char *prefix = malloc(len + sizeof(messages_key));
+    if (prefix != NULL) {
+        memcpy(prefix, printed, len);
+        memcpy(prefix + len, messages_key, sizeof(messages_key));
+        *out_len = len + sizeof(messages_key) - 1;
     }
+    free(printed);
+    return prefix;
+}
+
+// model / system / tools をまとめて描画（設定変更時のみ。ラウンドごとには行わない）
+static esp_err_t render_request_prefix(void)
+{
+    cJSON *req = cJSON_CreateObject();
+    cJSON_AddStringToObject(req, "model", s_model);
+    cJSON_AddNumberToObject(req, "max_tokens", SEEDCLAW_LLM_MAX_TOKENS);
+    cJSON_AddBoolToObject(req, "stream", true);
+
+    // system / tools は毎ラウンド同一なので cache_control でプロンプトキャッシュに載せる
+    // （キャッシュは tools → system の順の接頭辞に対して効く）
+    cJSON *system = cJSON_AddArrayToObject(req, "system");
+    cJSON *system_block = cJSON_CreateObject();
+    cJSON_AddStringToObject(system_block, "type", "text");
+    cJSON_AddStringToObject(system_block, "text", s_system_prompt);
+    cJSON_AddItemToObject(system_block, "cache_control", cache_control_ephemeral());
+    cJSON_AddItemToArray(system, system_block);
+
+    // 会話要約はキャッシュ境界の後ろに置き、更新されても tools/system のキャッシュを壊さない
+    if (s_memory[0] != '\0') {
+        char *memory_text = malloc(strlen(s_memory) + 64);
+        if (memory_text != NULL) {
+            sprintf(memory_text, "これまでの会話の要約:\n%s", s_memory);
+            cJSON *memory_block = cJSON_CreateObject();
+            cJSON_AddStringToObject(memory_block, "type", "text");
+            cJSON_AddStringToObject(memory_block, "text", memory_text);
+            cJSON_AddItemToArray(system, memory_block);
+            free(memory_text);
+        }
+    }
+
+    if (s_tools_json != NULL) {
+        cJSON *tools = cJSON_Parse(s_tools_json);
+        if (tools != NULL) {
+            int n = cJSON_GetArraySize(tools);
+            if (n > 0) {
+                cJSON_AddItemToObject(cJSON_GetArrayItem(tools, n - 1), "cache_control",
+                                      cache_control_ephemeral());
+            }
+            cJSON_AddItemToObject(req, "tools", tools);
+        } else {
+            ESP_LOGE(TAG, "Invalid tools JSON, sending without tools");
+        }
+    }
+
+    size_t len;
+    char *prefix = print_request_prefix(req, &len);
+    cJSON_Delete(req);
+    if (prefix == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    free(s_request_prefix);
+    s_request_prefix = prefix;
+    s_request_prefix_len = len;
+    s_prefix_dirty = false;
+    ESP_LOGI(TAG, "Request prefix rendered (%u bytes)", (unsigned)s_request_prefix_len);
     return ESP_OK;
 }
 
+void llm_set_tools(const char *tools_json)
+{
+    s_tools_json = tools_json;
+    s_prefix_dirty = true;
+}
+
+void llm_set_memory(const char *summary)
+{
+    strncpy(s_memory, summary, sizeof(s_memory) - 1);
+    s_memory[sizeof(s_memory) - 1] = '\0';
+    s_prefix_dirty = true;
+}
+
 esp_err_t llm_init(void)
 {
     nvs_handle_t nvs_handle;
@@ -70,195 +543,284 @@ esp_err_t llm_init(void)
     return ESP_OK;
 }
 
-static esp_err_t llm_chat_anthropic(const char *messages_json, const char *tools_json,
-                                     char *out_buf, size_t out_buf_size,
-                                     llm_response_type_t *out_type)
+static void session_close(void)
 {
-    // リクエストJSON作成
-    cJSON *req = cJSON_CreateObject();
-    cJSON_AddStringToObject(req, "model", s_model);
-    cJSON_AddNumberToObject(req, "max_tokens", SEEDCLAW_LLM_MAX_TOKENS);
-    cJSON_AddBoolToObject(req, "stream", false);
-    cJSON_AddStringToObject(req, "system", s_system_prompt);
+    if (s_session != NULL) {
+        esp_http_client_cleanup(s_session);
+        s_session = NULL;
+    }
+}
 
-    // messages
-    cJSON *messages = cJSON_Parse(messages_json);
-    if (messages == NULL) {
-        cJSON_Delete(req);
-        return ESP_ERR_INVALID_ARG;
+void llm_evict_idle(void)
+{
+    if (s_session != NULL &&
+        esp_timer_get_time() - s_session_last_used_us > (int64_t)SEEDCLAW_LLM_IDLE_EVICT_MS * 1000) {
+        ESP_LOGI(TAG, "Evicting idle LLM session");
+        session_close();
+        s_session_stats.evictions++;
     }
-    cJSON_AddItemToObject(req, "messages", messages);
+}
 
-    // tools
-    if (tools_json != NULL) {
-        cJSON *tools = cJSON_Parse(tools_json);
-        if (tools != NULL) {
-            cJSON_AddItemToObject(req, "tools", tools);
+void llm_get_session_stats(llm_session_stats_t *out)
+{
+    *out = s_session_stats;
+}
+
+void llm_get_usage_stats(llm_usage_stats_t *out)
+{
+    *out = s_usage_stats;
+}
+
+static void record_usage(const sse_ctx_t *ctx)
+{
+    s_usage_stats.requests++;
+    s_usage_stats.last_input_tokens = ctx->usage_input;
+    s_usage_stats.last_cache_write_tokens = ctx->usage_cache_write;
+    s_usage_stats.last_cache_read_tokens = ctx->usage_cache_read;
+    s_usage_stats.last_output_tokens = ctx->usage_output;
+    s_usage_stats.total_input_tokens += ctx->usage_input;
+    s_usage_stats.total_cache_write_tokens += ctx->usage_cache_write;
+    s_usage_stats.total_cache_read_tokens += ctx->usage_cache_read;
+    s_usage_stats.total_output_tokens += ctx->usage_output;
+    ESP_LOGI(TAG, "tokens: input=%lu cache_write=%lu cache_read=%lu output=%lu",
+             (unsigned long)ctx->usage_input, (unsigned long)ctx->usage_cache_write,
+             (unsigned long)ctx->usage_cache_read, (unsigned long)ctx->usage_output);
+}
+
+// 接頭辞 + messages + "}" をチャンク転送で送り、終端チャンクを書く
+static esp_err_t write_request_body(sse_ctx_t *ctx, const char *prefix, size_t prefix_len,
+                                    llm_messages_writer_t write_messages, void *writer_ctx)
+{
+    llm_writer_t *w = &ctx->writer;
+    w->client = s_session;
+    w->len = 0;
+    w->total = 0;
+    w->failed = false;
+
+    llm_writer_raw(w, prefix, prefix_len);
+    write_messages(w, writer_ctx);
+    writer_putc(w, '}');
+    writer_flush(w);
+
+    if (w->failed || esp_http_client_write(s_session, "0\r\n\r\n", 5) != 5) {
+        return ESP_ERR_HTTP_WRITE_DATA;
+    }
+    return ESP_OK;
+}
+
+// 応答ヘッダを待ち、本文を最後まで読んで SSE パーサに流す
+static esp_err_t read_response(sse_ctx_t *ctx, int *out_status)
+{
+    if (esp_http_client_fetch_headers(s_session) < 0) {
+        return ESP_ERR_HTTP_FETCH_HEADER;
+    }
+    int status = esp_http_client_get_status_code(s_session);
+    *out_status = status;
+
+    while (1) {
+        int n = esp_http_client_read(s_session, ctx->rx, sizeof(ctx->rx));
+        if (n < 0) {
+            return ESP_FAIL;
+        }
+        if (n == 0) {
+            break;
         }
+        handle_response_data(ctx, status, ctx->rx, n);
     }
 
-    char *req_str = cJSON_PrintUnformatted(req);
-    cJSON_Delete(req);
+    // 読み切れていない接続は再利用できない
+    if (!esp_http_client_is_complete_data_received(s_session)) {
+        esp_http_client_close(s_session);
+    }
+    return ESP_OK;
+}
 
-    if (req_str == NULL) {
-        ESP_LOGE(TAG, "Failed to create request JSON");
-        return ESP_ERR_NO_MEM;
+/**
+ * プール済みセッションでPOSTを実行する。
+ * 本文は中間バッファを作らず write_messages から直接チャンク転送で送る。
+ * アイドル時間を超えたセッションは破棄して張り直し、再利用した接続が
+ * サーバー側で閉じられていた場合は1回だけ再接続して再送する。
+ */
+static esp_err_t session_post(const char *prefix, size_t prefix_len,
+                              llm_messages_writer_t write_messages, void *writer_ctx,
+                              sse_ctx_t *ctx, int *out_status)
+{
+    llm_evict_idle();
+
+    if (s_session == NULL) {
+        esp_http_client_config_t config = {
+            .url = SEEDCLAW_ANTHROPIC_API_URL,
+            .method = HTTP_METHOD_POST,
+            .timeout_ms = SEEDCLAW_LLM_TIMEOUT_MS,
+            .event_handler = http_event_handler,
+            .keep_alive_enable = true,
+            .crt_bundle_attach = esp_crt_bundle_attach,
+        };
+        s_session = esp_http_client_init(&config);
+        if (s_session == NULL) {
+            ESP_LOGE(TAG, "Failed to create HTTP client");
+            return ESP_FAIL;
+        }
+        esp_http_client_set_header(s_session, "anthropic-version", SEEDCLAW_ANTHROPIC_VERSION);
+        esp_http_client_set_header(s_session, "content-type", "application/json");
     }
 
-    // HTTPリクエスト
-    char *response_buffer = malloc(SEEDCLAW_LLM_RESP_BUF_SIZE);
-    if (response_buffer == NULL) {
-        free(req_str);
-        ESP_LOGE(TAG, "Failed to allocate response buffer");
-        return ESP_ERR_NO_MEM;
+    // APIキーはCLIで変更され得るので毎回設定
+    esp_http_client_set_header(s_session, "x-api-key", s_api_key);
+
+    esp_err_t err = ESP_FAIL;
+    *out_status = 0;
+    for (int attempt = 0; attempt < 2; attempt++) {
+        sse_reset(ctx);
+        s_connect_us = -1;
+        s_request_start_us = esp_timer_get_time();
+
+        // 長さ -1 で開くと Transfer-Encoding: chunked になる
+        err = esp_http_client_open(s_session, -1);
+        if (err == ESP_OK) {
+            err = write_request_body(ctx, prefix, prefix_len, write_messages, writer_ctx);
+        }
+        if (err == ESP_OK) {
+            err = read_response(ctx, out_status);
+        }
+        // 受信済みデータがあれば（ツール実行済みの可能性があるため）再送しない
+        if (err == ESP_OK || s_connect_us >= 0 || ctx->bytes_received > 0) {
+            break;
+        }
+        // 再利用した接続が切れていた → 張り直して再送
+        esp_http_client_close(s_session);
+        ESP_LOGW(TAG, "Pooled connection dropped (%s), reconnecting", esp_err_to_name(err));
     }
 
-    http_response_t response = {
-        .buffer = response_buffer,
-        .size = SEEDCLAW_LLM_RESP_BUF_SIZE,
-        .len = 0
-    };
+    int64_t now = esp_timer_get_time();
+    int64_t total_us = now - s_request_start_us;
+    s_session_last_used_us = now;
 
-    esp_http_client_config_t config = {
-        .url = SEEDCLAW_ANTHROPIC_API_URL,
-        .method = HTTP_METHOD_POST,
-        .timeout_ms = SEEDCLAW_LLM_TIMEOUT_MS,
-        .event_handler = http_event_handler,
-        .user_data = &response,
-        .crt_bundle_attach = esp_crt_bundle_attach,
-    };
+    if (err != ESP_OK) {
+        // 状態が不明なセッションは持ち越さない
+        session_close();
+        return err;
+    }
 
-    esp_http_client_handle_t client = esp_http_client_init(&config);
-    esp_http_client_set_header(client, "x-api-key", s_api_key);
-    esp_http_client_set_header(client, "anthropic-version", SEEDCLAW_ANTHROPIC_VERSION);
-    esp_http_client_set_header(client, "content-type", "application/json");
-    esp_http_client_set_post_field(client, req_str, strlen(req_str));
+    // 統計: 接続時間とリクエスト時間（接続後〜応答受信完了）を分けて集計
+    uint32_t connect_ms = (s_connect_us >= 0) ? (uint32_t)(s_connect_us / 1000) : 0;
+    uint32_t request_ms = (uint32_t)(total_us / 1000) - connect_ms;
+    s_session_stats.requests++;
+    if (s_connect_us >= 0) {
+        s_session_stats.connects++;
+        s_session_stats.total_connect_ms += connect_ms;
+    }
+    s_session_stats.total_request_ms += request_ms;
+    s_session_stats.last_connect_ms = connect_ms;
+    s_session_stats.last_request_ms = request_ms;
 
-    esp_err_t err = esp_http_client_perform(client);
-    int status_code = esp_http_client_get_status_code(client);
-    esp_http_client_cleanup(client);
+    ESP_LOGI(TAG, "LLM request: %u bytes sent, connect=%lums (%s), request=%lums",
+             (unsigned)ctx->writer.total, (unsigned long)connect_ms,
+             (s_connect_us >= 0) ? "new" : "reused", (unsigned long)request_ms);
+    return ESP_OK;
+}
 
-    free(req_str);
+// 描画済みの接頭辞でリクエストを送り、応答を out_buf / on_tool_use に振り分ける
+static esp_err_t anthropic_post(const char *prefix, size_t prefix_len,
+                                llm_messages_writer_t write_messages, void *writer_ctx,
+                                llm_tool_use_cb_t on_tool_use, void *user_ctx,
+                                char *out_buf, size_t out_buf_size,
+                                llm_response_type_t *out_type)
+{
+    // SSE受信状態（応答の長さに関係なく固定サイズ）
+    sse_ctx_t *ctx = calloc(1, sizeof(sse_ctx_t));
+    if (ctx == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate stream context");
+        return ESP_ERR_NO_MEM;
+    }
+    ctx->out = out_buf;
+    ctx->out_size = out_buf_size;
+    ctx->on_tool_use = on_tool_use;
+    ctx->user_ctx = user_ctx;
+    if (on_tool_use == NULL) {
+        ctx->collected = cJSON_CreateArray();
+    }
+
+    int status_code = 0;
+    esp_err_t err = session_post(prefix, prefix_len, write_messages, writer_ctx, ctx, &status_code);
+
+    if (err == ESP_OK && status_code == 200 && ctx->got_usage) {
+        record_usage(ctx);
+    }
 
     if (err == ESP_ERR_HTTP_FETCH_HEADER || err == ESP_ERR_HTTP_CONNECT) {
         ESP_LOGE(TAG, "HTTP connection failed: %s", esp_err_to_name(err));
         snprintf(out_buf, out_buf_size, "ネットワーク接続エラー。WiFi接続を確認してください。");
-        free(response_buffer);
         *out_type = LLM_RESP_ERROR;
-        return err;
-    }
-    if (err != ESP_OK) {
+    } else if (err != ESP_OK) {
         ESP_LOGE(TAG, "HTTP request failed: %s", esp_err_to_name(err));
         snprintf(out_buf, out_buf_size, "LLM API応答タイムアウト。しばらく待ってから再試行してください。");
-        free(response_buffer);
         *out_type = LLM_RESP_ERROR;
-        return err;
-    }
-
-    if (status_code == 429) {
+    } else if (status_code == 429) {
         ESP_LOGW(TAG, "LLM API rate limited (429)");
         snprintf(out_buf, out_buf_size, "APIレート制限中です。10秒後に再試行してください。");
-        free(response_buffer);
         *out_type = LLM_RESP_ERROR;
         vTaskDelay(pdMS_TO_TICKS(10000));
-        return ESP_FAIL;
-    }
-
-    if (status_code != 200) {
-        ESP_LOGE(TAG, "LLM API error: %d, body: %.500s", status_code, response_buffer);
-        snprintf(out_buf, out_buf_size, "LLM API エラー (HTTP %d): %.200s", status_code, response_buffer);
-        free(response_buffer);
-        *out_type = LLM_RESP_ERROR;
-        return ESP_FAIL;
-    }
-
-    // レスポンスパース
-    cJSON *root = cJSON_Parse(response_buffer);
-    free(response_buffer);
-
-    if (root == NULL) {
-        ESP_LOGE(TAG, "Failed to parse LLM response");
+        err = ESP_FAIL;
+    } else if (status_code != 200) {
+        ESP_LOGE(TAG, "LLM API error: %d, body: %s", status_code, ctx->err_body);
+        snprintf(out_buf, out_buf_size, "LLM API エラー (HTTP %d): %.200s", status_code, ctx->err_body);
         *out_type = LLM_RESP_ERROR;
-        return ESP_FAIL;
-    }
-
-    cJSON *content = cJSON_GetObjectItem(root, "content");
-    if (content == NULL || !cJSON_IsArray(content)) {
-        cJSON_Delete(root);
+        err = ESP_FAIL;
+    } else if (ctx->got_error) {
         *out_type = LLM_RESP_ERROR;
-        return ESP_FAIL;
-    }
-
-    // stop_reasonを確認してツール呼び出しかどうか判定
-    cJSON *stop_reason = cJSON_GetObjectItem(root, "stop_reason");
-    bool is_tool_use = (stop_reason != NULL && cJSON_IsString(stop_reason) &&
-                        strcmp(stop_reason->valuestring, "tool_use") == 0);
-
-    // content配列から全tool_useブロックとtextブロックを収集
-    cJSON *tool_use_array = cJSON_CreateArray();
-    cJSON *text_block = NULL;
-    int content_size = cJSON_GetArraySize(content);
-    for (int ci = 0; ci < content_size; ci++) {
-        cJSON *block = cJSON_GetArrayItem(content, ci);
-        cJSON *btype = cJSON_GetObjectItem(block, "type");
-        if (btype == NULL || !cJSON_IsString(btype)) continue;
-
-        if (strcmp(btype->valuestring, "tool_use") == 0) {
-            cJSON *id = cJSON_GetObjectItem(block, "id");
-            cJSON *name = cJSON_GetObjectItem(block, "name");
-            cJSON *input = cJSON_GetObjectItem(block, "input");
-            if (id && name && input) {
-                cJSON *item = cJSON_CreateObject();
-                cJSON_AddStringToObject(item, "tool_use_id", id->valuestring);
-                cJSON_AddStringToObject(item, "name", name->valuestring);
-                cJSON_AddItemToObject(item, "input", cJSON_Duplicate(input, true));
-                cJSON_AddItemToArray(tool_use_array, item);
+        err = ESP_FAIL;
+    } else if (strcmp(ctx->stop_reason, "tool_use") == 0 && ctx->tool_count > 0) {
+        // ツール呼び出し（コールバック未指定時はJSON配列で全tool_useを返す）
+        *out_type = LLM_RESP_TOOL_USE;
+        if (ctx->collected != NULL) {
+            char *result_str = cJSON_PrintUnformatted(ctx->collected);
+            if (result_str != NULL) {
+                strncpy(out_buf, result_str, out_buf_size - 1);
+                out_buf[out_buf_size - 1] = '\0';
+                free(result_str);
+            } else {
+                *out_type = LLM_RESP_ERROR;
             }
-        } else if (strcmp(btype->valuestring, "text") == 0) {
-            text_block = block;
         }
+    } else if (ctx->out_len > 0) {
+        *out_type = LLM_RESP_TEXT;
+    } else {
+        *out_type = LLM_RESP_ERROR;
+        err = ESP_FAIL;
     }
 
-    int tool_count = cJSON_GetArraySize(tool_use_array);
-
-    if (is_tool_use && tool_count > 0) {
-        // ツール呼び出し（JSON配列で全tool_useを返す）
-        char *result_str = cJSON_PrintUnformatted(tool_use_array);
-        cJSON_Delete(tool_use_array);
+    if (ctx->collected != NULL) {
+        cJSON_Delete(ctx->collected);
+    }
+    free(ctx);
+    return err;
+}
 
-        if (result_str != NULL) {
-            strncpy(out_buf, result_str, out_buf_size - 1);
-            out_buf[out_buf_size - 1] = '\0';
-            free(result_str);
-            *out_type = LLM_RESP_TOOL_USE;
-        } else {
-            *out_type = LLM_RESP_ERROR;
-        }
-    } else {
-        cJSON_Delete(tool_use_array);
-        if (text_block != NULL) {
-            // テキスト応答
-            cJSON *text = cJSON_GetObjectItem(text_block, "text");
-            if (text != NULL && cJSON_IsString(text)) {
-                strncpy(out_buf, text->valuestring, out_buf_size - 1);
-                out_buf[out_buf_size - 1] = '\0';
-                *out_type = LLM_RESP_TEXT;
-            } else {
-                *out_type = LLM_RESP_ERROR;
-            }
-        } else {
+static esp_err_t llm_chat_anthropic(llm_messages_writer_t write_messages, void *writer_ctx,
+                                     llm_tool_use_cb_t on_tool_use, void *user_ctx,
+                                     char *out_buf, size_t out_buf_size,
+                                     llm_response_type_t *out_type)
+{
+    // 設定が変わっていれば接頭辞を組み立て直す
+    if (s_prefix_dirty || s_request_prefix == NULL) {
+        if (render_request_prefix() != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to create request JSON");
             *out_type = LLM_RESP_ERROR;
+            return ESP_ERR_NO_MEM;
         }
     }
-
-    cJSON_Delete(root);
-    return ESP_OK;
+    return anthropic_post(s_request_prefix, s_request_prefix_len, write_messages, writer_ctx,
+                          on_tool_use, user_ctx, out_buf, out_buf_size, out_type);
 }
 
-esp_err_t llm_chat(const char *messages_json, const char *tools_json,
-                   char *out_buf, size_t out_buf_size,
-                   llm_response_type_t *out_type)
+esp_err_t llm_chat_stream(llm_messages_writer_t write_messages, void *writer_ctx,
+                          llm_tool_use_cb_t on_tool_use, void *user_ctx,
+                          char *out_buf, size_t out_buf_size,
+                          llm_response_type_t *out_type)
 {
+    out_buf[0] = '\0';
+
     if (strlen(s_api_key) == 0) {
         ESP_LOGE(TAG, "API key not configured");
         *out_type = LLM_RESP_ERROR;
@@ -266,7 +828,8 @@ esp_err_t llm_chat(const char *messages_json, const char *tools_json,
     }
 
     if (strcmp(s_provider, "anthropic") == 0) {
-        return llm_chat_anthropic(messages_json, tools_json, out_buf, out_buf_size, out_type);
+        return llm_chat_anthropic(write_messages, writer_ctx, on_tool_use, user_ctx,
+                                  out_buf, out_buf_size, out_type);
     } else {
         ESP_LOGE(TAG, "Unsupported provider: %s (Phase 1 supports anthropic only)", s_provider);
         *out_type = LLM_RESP_ERROR;
@@ -274,6 +837,65 @@ esp_err_t llm_chat(const char *messages_json, const char *tools_json,
     }
 }
 
+// 整形済みの messages JSON をそのまま書く（llm_chat() 用）
+static void write_raw_messages(llm_writer_t *w, void *writer_ctx)
+{
+    const char *messages_json = (const char *)writer_ctx;
+    llm_writer_raw(w, messages_json, strlen(messages_json));
+}
+
+// 単一のユーザー発言を messages として書く（llm_complete() 用）
+static void write_single_user_message(llm_writer_t *w, void *writer_ctx)
+{
+    llm_writer_lit(w, "[{\"role\":\"user\",\"content\":");
+    llm_writer_str(w, (const char *)writer_ctx);
+    llm_writer_lit(w, "}]");
+}
+
+esp_err_t llm_complete(const char *model, const char *system, const char *user_text,
+                       int max_tokens, char *out_buf, size_t out_buf_size)
+{
+    out_buf[0] = '\0';
+
+    if (strlen(s_api_key) == 0 || strcmp(s_provider, "anthropic") != 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // ツールもキャッシュも使わない使い捨ての接頭辞
+    cJSON *req = cJSON_CreateObject();
+    cJSON_AddStringToObject(req, "model", model);
+    cJSON_AddNumberToObject(req, "max_tokens", max_tokens);
+    cJSON_AddBoolToObject(req, "stream", true);
+    cJSON_AddStringToObject(req, "system", system);
+    size_t len;
+    char *prefix = print_request_prefix(req, &len);
+    cJSON_Delete(req);
+    if (prefix == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    llm_response_type_t type;
+    esp_err_t err = anthropic_post(prefix, len,
+                                   write_single_user_message, (void *)user_text,
+                                   NULL, NULL, out_buf, out_buf_size, &type);
+    free(prefix);
+    if (err == ESP_OK && type != LLM_RESP_TEXT) {
+        err = ESP_FAIL;
+    }
+    return err;
+}
+
+esp_err_t llm_chat(const char *messages_json, const char *tools_json,
+                   char *out_buf, size_t out_buf_size,
+                   llm_response_type_t *out_type)
+{
+    if (tools_json != s_tools_json) {
+        llm_set_tools(tools_json);
+    }
+    return llm_chat_stream(write_raw_messages, (void *)messages_json, NULL, NULL,
+                           out_buf, out_buf_size, out_type);
+}
+
 esp_err_t llm_set_api_key(const char *key)
 {
     nvs_handle_t nvs_handle;
@@ -299,6 +921,7 @@ esp_err_t llm_set_model(const char *model)
     if (err == ESP_OK) {
         nvs_commit(nvs_handle);
         strncpy(s_model, model, sizeof(s_model) - 1);
+        s_prefix_dirty = true;
     }
     nvs_close(nvs_handle);
     return err;
@@ -329,6 +952,7 @@ esp_err_t llm_set_system_prompt(const char *prompt)
     if (err == ESP_OK) {
         nvs_commit(nvs_handle);
         strncpy(s_system_prompt, prompt, sizeof(s_system_prompt) - 1);
+        s_prefix_dirty = true;
     }
     nvs_close(nvs_handle);
     return err;
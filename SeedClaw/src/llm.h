@@ -1,6 +1,8 @@
 #pragma once
 
 #include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
 
 typedef enum {
     LLM_RESP_TEXT,       // テキスト応答（最終的な返答）
@@ -8,6 +10,28 @@ typedef enum {
     LLM_RESP_ERROR,      // エラー
 } llm_response_type_t;
 
+typedef struct {
+    uint32_t requests;          // 完了したリクエスト数
+    uint32_t connects;          // 新規TLS接続数（残りは再利用）
+    uint32_t evictions;         // アイドルで破棄したセッション数
+    uint32_t last_connect_ms;   // 直近リクエストの接続時間（再利用時は0）
+    uint32_t last_request_ms;   // 直近リクエストの送信〜応答完了時間
+    uint64_t total_connect_ms;
+    uint64_t total_request_ms;
+} llm_session_stats_t;
+
+typedef struct {
+    uint32_t requests;                 // usageを受信したリクエスト数
+    uint32_t last_input_tokens;        // 直近のキャッシュ対象外の入力トークン
+    uint32_t last_cache_write_tokens;  // 直近の cache_creation_input_tokens
+    uint32_t last_cache_read_tokens;   // 直近の cache_read_input_tokens
+    uint32_t last_output_tokens;
+    uint64_t total_input_tokens;
+    uint64_t total_cache_write_tokens;
+    uint64_t total_cache_read_tokens;
+    uint64_t total_output_tokens;
+} llm_usage_stats_t;
+
 /**
  * @brief LLMモジュールを初期化 (NVSから設定を読み込み)
  */
@@ -17,7 +41,8 @@ esp_err_t llm_init(void);
  * @brief LLM APIを呼び出す
  * @param messages_json JSON配列文字列: [{"role":"user","content":"..."},...]
  * @param tools_json ツール定義JSON配列文字列（NULLならツールなし）
- * @param out_buf 出力バッファ（テキスト応答 or tool_use JSON）
+ * @param out_buf 出力バッファ（テキスト応答 or tool_use JSON。
+ *                入力が大きすぎる/不正な tool_use は input の代わりに error を持つ）
  * @param out_buf_size 出力バッファサイズ
  * @param out_type 応答タイプ
  */
@@ -29,6 +54,86 @@ esp_err_t llm_chat(
     llm_response_type_t *out_type
 );
 
+/**
+ * @brief tool_useブロック受信完了（content_block_stop）時のコールバック
+ * @param tool_use_id Anthropic tool_use ID
+ * @param name ツール名
+ * @param input_json ツール入力JSON文字列（SEEDCLAW_LLM_TOOL_INPUT_MAX を超えたら NULL。実行しないこと）
+ * @param user_ctx llm_chat_stream() に渡したポインタ
+ */
+typedef void (*llm_tool_use_cb_t)(const char *tool_use_id, const char *name,
+                                  const char *input_json, void *user_ctx);
+
+/**
+ * リクエスト本文の書き込み先（チャンク転送でソケットへ直接送る）
+ */
+typedef struct llm_writer llm_writer_t;
+
+/**
+ * @brief 生のJSON断片を書き込む（呼び出し側が正しいJSONであることを保証する）
+ */
+void llm_writer_raw(llm_writer_t *w, const char *s, size_t len);
+
+/** @brief 文字列リテラルを書き込む */
+#define llm_writer_lit(w, lit)  llm_writer_raw((w), (lit), sizeof(lit) - 1)
+
+/**
+ * @brief 文字列をJSON文字列リテラルとして書き込む
+ * エスケープに加え、不正なUTF-8バイトは '?' に置き換える（APIがstrict UTF-8を要求するため）。
+ */
+void llm_writer_str(llm_writer_t *w, const char *s);
+
+/**
+ * @brief messages 配列（"[" 〜 "]"）を書き込むコールバック
+ * 接続が切れて再送する場合は同じ内容で再度呼ばれる。
+ */
+typedef void (*llm_messages_writer_t)(llm_writer_t *w, void *writer_ctx);
+
+/**
+ * @brief ツール定義JSON配列を登録（文字列は呼び出し側が保持し続けること）
+ * model / system / tools からなるリクエスト接頭辞は設定変更時にだけ組み立て直す。
+ */
+void llm_set_tools(const char *tools_json);
+
+/**
+ * @brief LLM APIをストリーミング (SSE) で呼び出す
+ * リクエストは事前に組み立てた接頭辞に write_messages の出力を続けて、
+ * 中間のJSONツリーを作らずにチャンク転送で送る。
+ * テキストは受信しながら out_buf に組み立て、tool_use はブロック完了ごとに
+ * on_tool_use を呼び出す。受信に使うヒープは応答の長さによらず一定。
+ * @param write_messages messages 配列の書き込みコールバック
+ * @param writer_ctx write_messages に渡すポインタ
+ * @param on_tool_use tool_useコールバック（NULLなら llm_chat() と同じくJSON配列を out_buf に返す）
+ * @param user_ctx コールバックに渡すポインタ
+ */
+esp_err_t llm_chat_stream(
+    llm_messages_writer_t write_messages,
+    void *writer_ctx,
+    llm_tool_use_cb_t on_tool_use,
+    void *user_ctx,
+    char *out_buf,
+    size_t out_buf_size,
+    llm_response_type_t *out_type
+);
+
+/**
+ * @brief ツールなしの単発テキスト生成（要約など裏方の処理用）
+ * メイン会話の接頭辞やキャッシュとは独立に、指定モデルで1往復だけ問い合わせる。
+ * @param model 使用するモデル名
+ * @param system システムプロンプト
+ * @param user_text ユーザー発言
+ * @param max_tokens 最大出力トークン数
+ * @return ESP_OK ならテキスト応答が out_buf に入っている
+ */
+esp_err_t llm_complete(const char *model, const char *system, const char *user_text,
+                       int max_tokens, char *out_buf, size_t out_buf_size);
+
+/**
+ * @brief 会話要約をシステムプロンプトの後ろに付ける（空文字列なら付けない）
+ * キャッシュ境界より後ろに置くので、更新しても tools/system のキャッシュは保たれる。
+ */
+void llm_set_memory(const char *summary);
+
 /**
  * @brief LLM API KeyをNVSに保存
  */
@@ -48,3 +153,18 @@ esp_err_t llm_set_provider(const char *provider);
  * @brief システムプロンプトをNVSに保存
  */
 esp_err_t llm_set_system_prompt(const char *prompt);
+
+/**
+ * @brief アイドル時間を超えたLLMセッションを破棄してTLSメモリを解放
+ */
+void llm_evict_idle(void);
+
+/**
+ * @brief LLMセッションの接続/リクエスト時間統計を取得
+ */
+void llm_get_session_stats(llm_session_stats_t *out);
+
+/**
+ * @brief トークン使用量とプロンプトキャッシュの統計を取得
+ */
+void llm_get_usage_stats(llm_usage_stats_t *out);
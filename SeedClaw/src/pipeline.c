@@ -0,0 +1,182 @@
+#include "pipeline.h"
+#include "seedclaw_config.h"
+#include "discord.h"
+#include "llm.h"
+#include "tools.h"
+#include "summary.h"
+#include "rules.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "pipeline";
+
+typedef enum {
+    JOB_USER_MSG,
+    JOB_AUTO_CHECK,
+} job_type_t;
+
+typedef struct {
+    job_type_t type;
+    char *text;               // JOB_USER_MSG の本文（受け取った側が free()）
+    int64_t enqueued_us;
+} work_job_t;
+
+static QueueHandle_t s_work_queue = NULL;
+static volatile bool s_auto_pending = false;
+static pipeline_stats_t s_stats;
+
+static uint32_t elapsed_ms(int64_t since_us)
+{
+    return (uint32_t)((esp_timer_get_time() - since_us) / 1000);
+}
+
+static void record_dequeue(pipeline_stage_stats_t *st, int64_t enqueued_us)
+{
+    uint32_t wait_ms = elapsed_ms(enqueued_us);
+    st->last_wait_ms = wait_ms;
+    if (wait_ms > st->max_wait_ms) {
+        st->max_wait_ms = wait_ms;
+    }
+    st->total_wait_ms += wait_ms;
+}
+
+// ── LLM/ツールワーカー ──
+
+// ワーカーの手が空いているときの裏方仕事（1回に1つ）
+static void run_background_work(void)
+{
+    if (rules_compile_pending()) {
+        rules_compile_next();
+    } else if (summary_pending()) {
+        summary_compact();
+    }
+}
+
+static void worker_task(void *arg)
+{
+    work_job_t job;
+
+    while (1) {
+        if (xQueueReceive(s_work_queue, &job, pdMS_TO_TICKS(SEEDCLAW_POLL_INTERVAL_MS)) != pdTRUE) {
+            run_background_work();
+            // 待機中にアイドルなLLMセッションを解放
+            llm_evict_idle();
+            continue;
+        }
+
+        record_dequeue(&s_stats.work, job.enqueued_us);
+        s_stats.worker_busy = true;
+        int64_t start_us = esp_timer_get_time();
+
+        char *reply = NULL;
+        if (job.type == JOB_USER_MSG) {
+            ESP_LOGI(TAG, "Processing message: %s", job.text);
+            s_stats.user_messages++;
+            reply = tools_fastpath(job.text);
+            if (reply != NULL) {
+                s_stats.fastpath_hits++;
+            } else {
+                reply = react_loop(job.text);
+            }
+            free(job.text);
+        } else {
+            s_auto_pending = false;
+            reply = autonomous_check();
+        }
+
+        if (reply != NULL) {
+            discord_send_webhook(reply);
+            free(reply);
+        }
+
+        s_stats.work.last_run_ms = elapsed_ms(start_us);
+        s_stats.work.processed++;
+
+        // 次のジョブがなければ、ルール変換や会話要約を進める
+        if (uxQueueMessagesWaiting(s_work_queue) == 0) {
+            run_background_work();
+        }
+        s_stats.worker_busy = false;
+    }
+}
+
+// ── 公開API ──
+
+esp_err_t pipeline_start(void)
+{
+    s_work_queue = xQueueCreate(SEEDCLAW_PIPELINE_WORK_QUEUE_LEN, sizeof(work_job_t));
+    if (s_work_queue == NULL) {
+        ESP_LOGE(TAG, "Failed to create work queue");
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (xTaskCreate(worker_task, "llm_worker", SEEDCLAW_WORKER_TASK_STACK, NULL,
+                    SEEDCLAW_WORKER_TASK_PRIO, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create worker task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Pipeline started (work queue: %d)", SEEDCLAW_PIPELINE_WORK_QUEUE_LEN);
+    return ESP_OK;
+}
+
+int pipeline_work_capacity(void)
+{
+    if (s_work_queue == NULL) {
+        return 0;
+    }
+    return (int)uxQueueSpacesAvailable(s_work_queue);
+}
+
+esp_err_t pipeline_submit_message(const char *text)
+{
+    work_job_t job = {
+        .type = JOB_USER_MSG,
+        .text = strdup(text),
+        .enqueued_us = esp_timer_get_time(),
+    };
+    if (job.text == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (xQueueSend(s_work_queue, &job, 0) != pdTRUE) {
+        free(job.text);
+        s_stats.work.rejected++;
+        ESP_LOGW(TAG, "Work queue full, message rejected");
+        return ESP_ERR_TIMEOUT;
+    }
+    s_stats.work.enqueued++;
+    return ESP_OK;
+}
+
+esp_err_t pipeline_submit_auto_check(void)
+{
+    if (s_auto_pending) {
+        return ESP_ERR_INVALID_STATE;   // 前回の依頼が未処理（何も積んでいない）
+    }
+
+    work_job_t job = {
+        .type = JOB_AUTO_CHECK,
+        .text = NULL,
+        .enqueued_us = esp_timer_get_time(),
+    };
+    s_auto_pending = true;
+    if (xQueueSend(s_work_queue, &job, 0) != pdTRUE) {
+        s_auto_pending = false;
+        s_stats.work.rejected++;
+        return ESP_ERR_TIMEOUT;
+    }
+    s_stats.work.enqueued++;
+    return ESP_OK;
+}
+
+void pipeline_get_stats(pipeline_stats_t *out)
+{
+    *out = s_stats;
+    out->work.depth = s_work_queue ? (uint32_t)uxQueueMessagesWaiting(s_work_queue) : 0;
+}
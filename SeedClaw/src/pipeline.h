@@ -0,0 +1,61 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * 受信 → LLMワーカー → 送信 のタスクパイプライン
+ *
+ * 受信(メインタスク)はジョブキューに投入するだけで戻り、LLM呼び出しと
+ * ツール実行はワーカータスクで行う。返信は discord_send_webhook() の
+ * アウトボックスに積まれ、Discordモジュールの送信タスクが配送する。
+ * ジョブキューは長さ固定で、満杯なら受信側が取り込みを控える。
+ */
+
+typedef struct {
+    uint32_t enqueued;        // 投入数
+    uint32_t processed;       // 処理完了数
+    uint32_t rejected;        // キュー満杯で投入できなかった数
+    uint32_t depth;           // 現在のキュー滞留数
+    uint32_t last_wait_ms;    // 直近のキュー待ち時間
+    uint32_t max_wait_ms;     // 最大キュー待ち時間
+    uint64_t total_wait_ms;   // キュー待ち時間の合計（平均算出用）
+    uint32_t last_run_ms;     // 直近の処理時間
+} pipeline_stage_stats_t;
+
+typedef struct {
+    pipeline_stage_stats_t work;  // LLM/ツールワーカー
+    bool worker_busy;             // ワーカーが処理中か
+    uint32_t user_messages;       // 処理したユーザーメッセージ数
+    uint32_t fastpath_hits;       // うちLLMを介さず高速パスで処理した数
+} pipeline_stats_t;
+
+/**
+ * @brief ジョブキューを作成し、ワーカータスクを起動
+ * discord_init() / llm_init() / tools_init() の後に呼ぶ。
+ */
+esp_err_t pipeline_start(void);
+
+/**
+ * @brief ジョブキューの空き数（受信側はこれを超えて取り込まない）
+ */
+int pipeline_work_capacity(void);
+
+/**
+ * @brief ユーザーメッセージをワーカーに渡す（文字列はコピーされる）
+ * @return キュー満杯なら ESP_ERR_TIMEOUT
+ */
+esp_err_t pipeline_submit_message(const char *text);
+
+/**
+ * @brief 自律チェックをワーカーに依頼
+ * @return ESP_OK はジョブを積んだときだけ。未処理の依頼があれば ESP_ERR_INVALID_STATE、
+ *         キューが満杯なら ESP_ERR_TIMEOUT
+ */
+esp_err_t pipeline_submit_auto_check(void);
+
+/**
+ * @brief パイプライン統計を取得
+ */
+void pipeline_get_stats(pipeline_stats_t *out);
@@ -0,0 +1,682 @@
+#include "rules.h"
+#include "seedclaw_config.h"
+#include "llm.h"
+#include "gpio_ctrl.h"
+#include "control_loop.h"
+#include "esp_log.h"
+#include "cJSON.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "rules";
+
+typedef enum {
+    SRC_GPIO,
+    SRC_ADC_MV,
+    SRC_ADC_PCT,
+    SRC_ADC_RAW,
+} rule_source_t;
+
+typedef enum {
+    OP_GT,
+    OP_LT,
+    OP_GE,
+    OP_LE,
+    OP_EQ,
+    OP_NE,
+} rule_op_t;
+
+typedef enum {
+    ACT_NONE,
+    ACT_GPIO_WRITE,
+    ACT_PWM_SET,
+} rule_act_type_t;
+
+typedef struct {
+    uint8_t type;            // rule_act_type_t
+    uint8_t pin;
+    uint8_t value;           // gpio_write: 0/1, pwm_set: duty (%)
+    uint16_t freq;           // pwm_set の周波数
+} rule_action_t;
+
+// 変換済みルール（LLMの出力を検証して詰め直したもの）
+typedef struct {
+    uint8_t source;          // rule_source_t
+    uint8_t pin;
+    uint8_t op;              // rule_op_t
+    int32_t threshold;
+    int32_t hysteresis;      // 解除側のしきい値のずらし幅
+    rule_action_t action;        // 成立時
+    rule_action_t clear_action;  // 解除時
+    char message[SEEDCLAW_RULE_MSG_LEN];        // 成立時の報告（{value} = 測定値）
+    char clear_message[SEEDCLAW_RULE_MSG_LEN];  // 解除時の報告（空なら報告しない）
+} rule_prog_t;
+
+// LLM評価ルールが参照する入力（変化検出ゲート用）
+typedef struct {
+    uint8_t source;          // rule_source_t（gpio はデジタル、adc_* は電圧で比較）
+    uint8_t pin;
+} rule_input_t;
+
+typedef struct {
+    char text[SEEDCLAW_MAX_RULE_LEN];
+    uint8_t state;           // rule_state_t
+    uint8_t attempts;        // 変換の試行回数
+    bool active;             // 条件成立中
+    uint32_t id;             // 追加ごとの通し番号（変換中に削除/差し替えされたかの判定）
+    rule_prog_t prog;
+    rule_input_t inputs[SEEDCLAW_RULE_MAX_INPUTS];
+    uint8_t n_inputs;
+    bool gateable;           // 判断が inputs の値だけで決まる（変化がなければ LLM 不要）
+} rule_t;
+
+static rule_t s_rules[SEEDCLAW_MAX_RULES];
+static int s_rules_count = 0;
+static int s_auto_interval = 0;  // 0 = 無効
+static uint32_t s_next_id = 1;
+static rules_stats_t s_stats;
+static SemaphoreHandle_t s_rules_mutex = NULL;
+
+// 変化検出ゲート: ピンごとに最後に LLM へ渡した時点の値と不感帯
+#define GATE_PINS 22
+static int32_t s_gate_last[GATE_PINS];
+static int32_t s_gate_sample[GATE_PINS];
+static uint32_t s_gate_valid_mask = 0;     // s_gate_last が有効なピン
+static uint32_t s_gate_sampled_mask = 0;   // 直近の rules_gate_check() で読んだピン
+static uint16_t s_deadband_mv[GATE_PINS];
+static int s_gate_skips = 0;               // 連続スキップ数
+
+static const char *const s_source_names[] = { "gpio", "adc_mv", "adc_pct", "adc_raw" };
+
+#define COMPILE_SYSTEM_PROMPT \
+"監視ルールを、端末上で評価できるJSONに変換せよ。JSONだけを出力すること。\n" \
+"形式: {\"source\":\"gpio|adc_mv|adc_pct|adc_raw\",\"pin\":GPIO番号,\"op\":\">|<|>=|<=|==|!=\"," \
+"\"threshold\":整数,\"hysteresis\":整数,\"action\":動作,\"clear_action\":動作," \
+"\"message\":\"成立時の報告文\",\"clear_message\":\"解除時の報告文\"}\n" \
+"動作: null / {\"type\":\"gpio_write\",\"pin\":N,\"value\":0|1} / {\"type\":\"pwm_set\",\"pin\":N,\"duty\":0-100,\"freq\":Hz}\n" \
+"- clear_action は条件が解除されたときの動作（例: 暗くなったら点灯→明るくなったら消灯）。不要なら null\n" \
+"- hysteresis は解除側のしきい値の余裕（ADCなら50〜100mV程度、gpioなら0）\n" \
+"- 報告文は日本語で短く。{value} が測定値に置き換わる。clear_message は不要なら空文字列\n" \
+"- adc_mv=電圧(mV), adc_pct=0-100%, adc_raw=0-4095, gpio=0/1\n" \
+"ピン: D0/A0=GPIO2, D1/A1=GPIO3, D2/A2=GPIO4 (ADC可), D3=5, D4=6, D5=7, D6=21, D7=20, D8=8, D10=10\n" \
+"時刻・Web取得・複数センサーの組み合わせなど、1つの値としきい値の比較で表せないルールは " \
+"{\"compilable\":false,\"inputs\":[{\"source\":\"gpio|adc_mv\",\"pin\":N}],\"inputs_only\":true|false} と出力せよ。\n" \
+"inputs はルールが読むピン。inputs_only は判断がそれらのピンの値だけで決まる（時刻・Web・経過時間に依存しない）なら true。"
+
+static void lock(void)
+{
+    xSemaphoreTake(s_rules_mutex, portMAX_DELAY);
+}
+
+static void unlock(void)
+{
+    xSemaphoreGive(s_rules_mutex);
+}
+
+// ── ルール管理 ──
+
+esp_err_t rules_init(void)
+{
+    s_rules_mutex = xSemaphoreCreateMutex();
+    if (s_rules_mutex == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    s_rules_count = 0;
+    s_auto_interval = 0;
+    for (int i = 0; i < GATE_PINS; i++) {
+        s_deadband_mv[i] = SEEDCLAW_GATE_DEADBAND_MV;
+    }
+    return ESP_OK;
+}
+
+int rules_count(void)
+{
+    lock();
+    int n = s_rules_count;
+    unlock();
+    return n;
+}
+
+esp_err_t rules_add(const char *rule_text)
+{
+    lock();
+    if (s_rules_count >= SEEDCLAW_MAX_RULES) {
+        unlock();
+        return ESP_ERR_NO_MEM;
+    }
+    rule_t *r = &s_rules[s_rules_count];
+    memset(r, 0, sizeof(*r));
+    strncpy(r->text, rule_text, SEEDCLAW_MAX_RULE_LEN - 1);
+    r->state = RULE_PENDING;
+    r->id = s_next_id++;
+    s_rules_count++;
+    unlock();
+    return ESP_OK;
+}
+
+esp_err_t rules_remove(int index)
+{
+    lock();
+    if (index < 0 || index >= s_rules_count) {
+        unlock();
+        return ESP_ERR_INVALID_ARG;
+    }
+    memmove(&s_rules[index], &s_rules[index + 1], sizeof(rule_t) * (s_rules_count - index - 1));
+    s_rules_count--;
+    if (s_rules_count == 0) {
+        s_auto_interval = 0;
+    }
+    unlock();
+    return ESP_OK;
+}
+
+static const char *state_label(uint8_t state)
+{
+    switch (state) {
+        case RULE_COMPILED: return "local";
+        case RULE_LLM:      return "LLM";
+        default:            return "compiling";
+    }
+}
+
+void rules_list(void)
+{
+    lock();
+    if (s_rules_count == 0) {
+        printf("No monitoring rules defined.\n");
+    }
+    for (int i = 0; i < s_rules_count; i++) {
+        printf("  [%d] (%s%s) %s\n", i, state_label(s_rules[i].state),
+               s_rules[i].active ? ", active" : "", s_rules[i].text);
+    }
+    unlock();
+}
+
+void rules_clear(void)
+{
+    lock();
+    s_rules_count = 0;
+    s_auto_interval = 0;
+    memset(s_rules, 0, sizeof(s_rules));
+    unlock();
+}
+
+int auto_interval_get(void)
+{
+    return s_auto_interval;
+}
+
+void auto_interval_set(int interval)
+{
+    s_auto_interval = interval;
+}
+
+rule_state_t rules_get(int index, char *text, size_t text_size)
+{
+    lock();
+    if (index < 0 || index >= s_rules_count) {
+        unlock();
+        return RULE_NONE;
+    }
+    rule_state_t state = (rule_state_t)s_rules[index].state;
+    if (text != NULL && text_size > 0) {
+        strncpy(text, s_rules[index].text, text_size - 1);
+        text[text_size - 1] = '\0';
+    }
+    unlock();
+    return state;
+}
+
+int rules_llm_count(void)
+{
+    int n = 0;
+    lock();
+    for (int i = 0; i < s_rules_count; i++) {
+        if (s_rules[i].state != RULE_COMPILED) {
+            n++;
+        }
+    }
+    unlock();
+    return n;
+}
+
+bool rules_compile_pending(void)
+{
+    bool pending = false;
+    lock();
+    for (int i = 0; i < s_rules_count && !pending; i++) {
+        pending = (s_rules[i].state == RULE_PENDING);
+    }
+    unlock();
+    return pending;
+}
+
+void rules_get_stats(rules_stats_t *out)
+{
+    *out = s_stats;
+}
+
+// ── 変換（LLMの出力JSONを検証して rule_prog_t に詰める） ──
+
+static bool parse_action(const cJSON *obj, rule_action_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    if (obj == NULL || cJSON_IsNull(obj)) {
+        return true;
+    }
+    const cJSON *type = cJSON_GetObjectItem(obj, "type");
+    const cJSON *pin = cJSON_GetObjectItem(obj, "pin");
+    if (!cJSON_IsString(type) || !cJSON_IsNumber(pin) || !gpio_is_pin_allowed(pin->valueint)) {
+        return false;
+    }
+    out->pin = (uint8_t)pin->valueint;
+
+    if (strcmp(type->valuestring, "gpio_write") == 0) {
+        const cJSON *value = cJSON_GetObjectItem(obj, "value");
+        if (!cJSON_IsNumber(value) || (value->valueint != 0 && value->valueint != 1)) {
+            return false;
+        }
+        out->type = ACT_GPIO_WRITE;
+        out->value = (uint8_t)value->valueint;
+    } else if (strcmp(type->valuestring, "pwm_set") == 0) {
+        const cJSON *duty = cJSON_GetObjectItem(obj, "duty");
+        const cJSON *freq = cJSON_GetObjectItem(obj, "freq");
+        if (!cJSON_IsNumber(duty) || duty->valueint < 0 || duty->valueint > 100) {
+            return false;
+        }
+        out->type = ACT_PWM_SET;
+        out->value = (uint8_t)duty->valueint;
+        out->freq = (cJSON_IsNumber(freq) && freq->valueint > 0 && freq->valueint <= 40000)
+                        ? (uint16_t)freq->valueint : 1000;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// UTF-8の文字境界で切り詰めてコピー
+static void copy_message(char *dst, size_t dst_size, const cJSON *src)
+{
+    dst[0] = '\0';
+    if (!cJSON_IsString(src)) {
+        return;
+    }
+    size_t len = strlen(src->valuestring);
+    if (len >= dst_size) {
+        len = dst_size - 1;
+        while (len > 0 && ((unsigned char)src->valuestring[len] & 0xC0) == 0x80) {
+            len--;
+        }
+    }
+    memcpy(dst, src->valuestring, len);
+    dst[len] = '\0';
+}
+
+static int parse_source(const cJSON *source)
+{
+    if (!cJSON_IsString(source)) {
+        return -1;
+    }
+    for (int i = 0; i < (int)(sizeof(s_source_names) / sizeof(s_source_names[0])); i++) {
+        if (strcmp(source->valuestring, s_source_names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static bool source_pin_allowed(int source, int pin)
+{
+    return source == SRC_GPIO ? gpio_is_pin_allowed(pin) : gpio_is_adc_allowed(pin);
+}
+
+// 変換不可と判定されたルールの参照入力を読む（読めなければゲート対象外）
+static void parse_inputs(const cJSON *root, rule_t *r)
+{
+    const cJSON *inputs = cJSON_GetObjectItem(root, "inputs");
+    r->n_inputs = 0;
+    r->gateable = false;
+    if (!cJSON_IsArray(inputs) || cJSON_GetArraySize(inputs) == 0 ||
+        cJSON_GetArraySize(inputs) > SEEDCLAW_RULE_MAX_INPUTS) {
+        return;
+    }
+    const cJSON *in;
+    cJSON_ArrayForEach(in, inputs) {
+        int src = parse_source(cJSON_GetObjectItem(in, "source"));
+        const cJSON *pin = cJSON_GetObjectItem(in, "pin");
+        if (src < 0 || !cJSON_IsNumber(pin) || !source_pin_allowed(src, pin->valueint)) {
+            r->n_inputs = 0;
+            return;
+        }
+        r->inputs[r->n_inputs].source = (uint8_t)src;
+        r->inputs[r->n_inputs].pin = (uint8_t)pin->valueint;
+        r->n_inputs++;
+    }
+    r->gateable = cJSON_IsTrue(cJSON_GetObjectItem(root, "inputs_only"));
+}
+
+static cJSON *parse_output_json(const char *text)
+{
+    // 説明文が付いていても最初の { から最後の } までを読む
+    const char *start = strchr(text, '{');
+    const char *end = strrchr(text, '}');
+    if (start == NULL || end == NULL || end < start) {
+        return NULL;
+    }
+    return cJSON_ParseWithLength(start, end - start + 1);
+}
+
+static bool parse_program(const cJSON *root, rule_prog_t *out)
+{
+    const cJSON *compilable = cJSON_GetObjectItem(root, "compilable");
+    const cJSON *source = cJSON_GetObjectItem(root, "source");
+    const cJSON *pin = cJSON_GetObjectItem(root, "pin");
+    const cJSON *op = cJSON_GetObjectItem(root, "op");
+    const cJSON *threshold = cJSON_GetObjectItem(root, "threshold");
+    const cJSON *hysteresis = cJSON_GetObjectItem(root, "hysteresis");
+
+    memset(out, 0, sizeof(*out));
+    if (cJSON_IsFalse(compilable) || !cJSON_IsNumber(pin) ||
+        !cJSON_IsString(op) || !cJSON_IsNumber(threshold)) {
+        return false;
+    }
+
+    static const char *const ops[] = { ">", "<", ">=", "<=", "==", "!=" };
+    int src = parse_source(source);
+    int cmp = -1;
+    for (int i = 0; i < (int)(sizeof(ops) / sizeof(ops[0])); i++) {
+        if (strcmp(op->valuestring, ops[i]) == 0) cmp = i;
+    }
+    if (src < 0 || cmp < 0 || !source_pin_allowed(src, pin->valueint)) {
+        return false;
+    }
+
+    out->source = (uint8_t)src;
+    out->pin = (uint8_t)pin->valueint;
+    out->op = (uint8_t)cmp;
+    out->threshold = (int32_t)threshold->valuedouble;
+    out->hysteresis = cJSON_IsNumber(hysteresis) && hysteresis->valueint > 0 ? hysteresis->valueint : 0;
+    if (!parse_action(cJSON_GetObjectItem(root, "action"), &out->action) ||
+        !parse_action(cJSON_GetObjectItem(root, "clear_action"), &out->clear_action)) {
+        return false;
+    }
+    copy_message(out->message, sizeof(out->message), cJSON_GetObjectItem(root, "message"));
+    copy_message(out->clear_message, sizeof(out->clear_message),
+                 cJSON_GetObjectItem(root, "clear_message"));
+    return true;
+}
+
+esp_err_t rules_compile_next(void)
+{
+
+    // 変換待ちのルールを1つ取り出す（LLM呼び出し中はロックを持たない）
+    char text[SEEDCLAW_MAX_RULE_LEN];
+    uint32_t id = 0;
+    lock();
+    for (int i = 0; i < s_rules_count; i++) {
+        if (s_rules[i].state == RULE_PENDING) {
+            memcpy(text, s_rules[i].text, sizeof(text));
+            id = s_rules[i].id;
+            s_rules[i].attempts++;
+            break;
+        }
+    }
+    unlock();
+    if (id == 0) {
+        return ESP_OK;
+    }
+
+    char *out = malloc(SEEDCLAW_RULE_COMPILE_OUT_SIZE);
+    if (out == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t err = llm_complete(SEEDCLAW_RULE_COMPILE_MODEL, COMPILE_SYSTEM_PROMPT, text,
+                                 SEEDCLAW_RULE_COMPILE_MAX_TOKENS, out, SEEDCLAW_RULE_COMPILE_OUT_SIZE);
+    cJSON *root = (err == ESP_OK) ? parse_output_json(out) : NULL;
+    free(out);
+    rule_prog_t prog;
+    bool compiled = (root != NULL) && parse_program(root, &prog);
+
+    lock();
+    for (int i = 0; i < s_rules_count; i++) {
+        rule_t *r = &s_rules[i];
+        if (r->id != id || r->state != RULE_PENDING) {
+            continue;
+        }
+        if (compiled) {
+            r->prog = prog;
+            r->state = RULE_COMPILED;
+            r->active = false;
+            s_stats.compiles++;
+            ESP_LOGI(TAG, "Rule %d compiled (source=%d pin=%d op=%d threshold=%ld)",
+                     i, prog.source, prog.pin, prog.op, (long)prog.threshold);
+        } else if (err == ESP_OK || r->attempts >= SEEDCLAW_RULE_COMPILE_ATTEMPTS) {
+            // 変換不可と判定された、または通信エラーが続いた → LLM で評価する
+            r->state = RULE_LLM;
+            if (root != NULL) {
+                parse_inputs(root, r);
+            }
+            s_stats.compile_failures++;
+            ESP_LOGI(TAG, "Rule %d left to LLM evaluation (%d inputs, %s)", i, r->n_inputs,
+                     (r->gateable && r->n_inputs > 0) ? "gated" : "always checked");
+        }
+        break;
+    }
+    unlock();
+    cJSON_Delete(root);
+    return err;
+}
+
+// ── インタプリタ ──
+
+static bool read_source(const rule_prog_t *p, int *out)
+{
+    if (p->source == SRC_GPIO) {
+        int v = gpio_ctrl_read(p->pin);
+        if (v < 0) {
+            return false;
+        }
+        *out = v;
+        return true;
+    }
+
+    adc_result_t adc;
+    if (gpio_ctrl_adc_read(p->pin, &adc) != ESP_OK) {
+        return false;
+    }
+    switch (p->source) {
+        case SRC_ADC_MV:  *out = adc.voltage_mv; break;
+        case SRC_ADC_PCT: *out = adc.percentage; break;
+        default:          *out = adc.raw; break;
+    }
+    return true;
+}
+
+static bool compare(uint8_t op, int v, int32_t t)
+{
+    switch (op) {
+        case OP_GT: return v > t;
+        case OP_LT: return v < t;
+        case OP_GE: return v >= t;
+        case OP_LE: return v <= t;
+        case OP_EQ: return v == t;
+        default:    return v != t;
+    }
+}
+
+// 成立中の解除判定はしきい値をヒステリシス分だけ戻した側で行う
+static int32_t clear_threshold(const rule_prog_t *p)
+{
+    switch (p->op) {
+        case OP_GT: case OP_GE: return p->threshold - p->hysteresis;
+        case OP_LT: case OP_LE: return p->threshold + p->hysteresis;
+        default:                return p->threshold;
+    }
+}
+
+static void run_action(const rule_action_t *a)
+{
+    if (a->type != ACT_NONE && control_loop_owns(a->pin)) {
+        // 制御ループの出力は奪わない
+        ESP_LOGW(TAG, "GPIO%d is driven by a control loop, rule action skipped", a->pin);
+        return;
+    }
+    if (a->type == ACT_GPIO_WRITE) {
+        gpio_ctrl_write(a->pin, a->value);
+    } else if (a->type == ACT_PWM_SET) {
+        gpio_ctrl_pwm_set(a->pin, a->value, a->freq);
+    }
+}
+
+// 報告文テンプレートの {value} を測定値に置き換えて report に追記
+static void append_report(char *report, size_t size, const char *tmpl, int value)
+{
+    size_t len = strlen(report);
+    if (len > 0 && len < size - 1) {
+        report[len++] = '\n';
+        report[len] = '\0';
+    }
+    const char *mark = strstr(tmpl, "{value}");
+    if (mark != NULL) {
+        snprintf(report + len, size - len, "**[自律監視]** %.*s%d%s",
+                 (int)(mark - tmpl), tmpl, value, mark + strlen("{value}"));
+    } else {
+        snprintf(report + len, size - len, "**[自律監視]** %s", tmpl);
+    }
+}
+
+char *rules_tick(void)
+{
+    char report[SEEDCLAW_RULE_REPORT_SIZE];
+    report[0] = '\0';
+
+    lock();
+    for (int i = 0; i < s_rules_count; i++) {
+        rule_t *r = &s_rules[i];
+        if (r->state != RULE_COMPILED) {
+            continue;
+        }
+        int value;
+        if (!read_source(&r->prog, &value)) {
+            continue;
+        }
+        s_stats.local_evals++;
+
+        if (!r->active && compare(r->prog.op, value, r->prog.threshold)) {
+            r->active = true;
+            run_action(&r->prog.action);
+            if (r->prog.message[0] != '\0') {
+                append_report(report, sizeof(report), r->prog.message, value);
+                s_stats.local_fires++;
+            }
+        } else if (r->active && !compare(r->prog.op, value, clear_threshold(&r->prog))) {
+            r->active = false;
+            run_action(&r->prog.clear_action);
+            if (r->prog.clear_message[0] != '\0') {
+                append_report(report, sizeof(report), r->prog.clear_message, value);
+                s_stats.local_fires++;
+            }
+        }
+    }
+    unlock();
+
+    return report[0] != '\0' ? strdup(report) : NULL;
+}
+
+// ── 変化検出ゲート ──
+
+static bool gate_read(const rule_input_t *in, int32_t *out)
+{
+    if (in->source == SRC_GPIO) {
+        int v = gpio_ctrl_read(in->pin);
+        *out = v;
+        return v >= 0;
+    }
+    adc_result_t adc;
+    if (gpio_ctrl_adc_read(in->pin, &adc) != ESP_OK) {
+        return false;
+    }
+    *out = adc.voltage_mv;
+    return true;
+}
+
+bool rules_gate_check(void)
+{
+    bool changed = false;
+    uint32_t sampled = 0;
+
+    lock();
+    for (int i = 0; i < s_rules_count; i++) {
+        const rule_t *r = &s_rules[i];
+        if (r->state == RULE_COMPILED) {
+            continue;
+        }
+        if (r->state == RULE_PENDING || !r->gateable || r->n_inputs == 0) {
+            // 入力が分からないルールは毎回 LLM で確認する
+            changed = true;
+            continue;
+        }
+        for (int k = 0; k < r->n_inputs; k++) {
+            const rule_input_t *in = &r->inputs[k];
+            uint32_t bit = 1u << in->pin;
+            if (sampled & bit) {
+                continue;
+            }
+            int32_t v;
+            if (!gate_read(in, &v)) {
+                changed = true;
+                continue;
+            }
+            sampled |= bit;
+            s_gate_sample[in->pin] = v;
+
+            int32_t deadband = (in->source == SRC_GPIO) ? 0 : s_deadband_mv[in->pin];
+            int32_t diff = v - s_gate_last[in->pin];
+            if (!(s_gate_valid_mask & bit) || diff > deadband || -diff > deadband) {
+                changed = true;
+            }
+        }
+    }
+
+    // 経過時間で判断が変わるルールもあるので、一定回数ごとには必ず確認する
+    if (!changed && ++s_gate_skips >= SEEDCLAW_GATE_MAX_SKIPS) {
+        changed = true;
+    }
+    if (!changed) {
+        s_stats.gate_skipped++;
+    }
+    s_gate_sampled_mask = sampled;
+    unlock();
+    return changed;
+}
+
+void rules_gate_commit(void)
+{
+    lock();
+    for (int pin = 0; pin < GATE_PINS; pin++) {
+        if (s_gate_sampled_mask & (1u << pin)) {
+            s_gate_last[pin] = s_gate_sample[pin];
+        }
+    }
+    s_gate_valid_mask |= s_gate_sampled_mask;
+    s_gate_skips = 0;
+    s_stats.gate_executed++;
+    unlock();
+}
+
+esp_err_t rules_set_deadband(int pin, int deadband_mv)
+{
+    if (!gpio_is_adc_allowed(pin) || deadband_mv < 0 || deadband_mv > 3300) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_deadband_mv[pin] = (uint16_t)deadband_mv;
+    return ESP_OK;
+}
+
+int rules_get_deadband(int pin)
+{
+    return gpio_is_adc_allowed(pin) ? s_deadband_mv[pin] : -1;
+}
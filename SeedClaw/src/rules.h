@@ -0,0 +1,102 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * 自律監視ルール
+ *
+ * 自然文のルールは追加時に一度だけ LLM で小さな構造化プログラム
+ * （センサー源・比較・ヒステリシス・動作・報告文テンプレート）に変換し、
+ * 以降は端末上のインタプリタがポーリングのたびに評価する。
+ * 変換できないルールだけが従来どおり自律チェックで LLM に渡される。
+ */
+
+typedef enum {
+    RULE_NONE = -1,          // 範囲外
+    RULE_PENDING,            // 変換待ち（変換されるまでは LLM で評価）
+    RULE_COMPILED,           // 端末上で評価
+    RULE_LLM,                // 変換不可。LLM で評価
+} rule_state_t;
+
+typedef struct {
+    uint32_t local_evals;    // 端末上で評価した回数（ルール単位）
+    uint32_t local_fires;    // うち条件成立/解除で報告した回数
+    uint32_t compiles;       // 変換に成功した数
+    uint32_t compile_failures;
+    uint32_t gate_executed;  // 変化ありで LLM チェックを実行した回数
+    uint32_t gate_skipped;   // 変化なしで LLM チェックを省いた回数
+} rules_stats_t;
+
+/**
+ * @brief ルールモジュールを初期化
+ */
+esp_err_t rules_init(void);
+
+int rules_count(void);
+esp_err_t rules_add(const char *rule_text);
+esp_err_t rules_remove(int index);
+void rules_list(void);
+void rules_clear(void);
+
+int auto_interval_get(void);
+void auto_interval_set(int interval);
+
+/**
+ * @brief ルール本文と状態を取得
+ * @return 範囲外なら RULE_NONE
+ */
+rule_state_t rules_get(int index, char *text, size_t text_size);
+
+/**
+ * @brief LLM で評価する必要のあるルール数（変換待ちを含む）
+ */
+int rules_llm_count(void);
+
+/**
+ * @brief 変換待ちのルールがあるか
+ */
+bool rules_compile_pending(void);
+
+/**
+ * @brief 変換待ちのルールを1つ LLM で変換する
+ * LLM呼び出しを伴うので LLMワーカーの手が空いているときに呼ぶ。
+ */
+esp_err_t rules_compile_next(void);
+
+/**
+ * @brief 変換済みルールを評価し、条件の成立/解除に応じて動作を実行
+ * @return Discord に報告するテキスト（呼び出し元が free()）。報告不要なら NULL
+ */
+char *rules_tick(void);
+
+/**
+ * @brief LLM評価ルールの参照ピンを読み、前回 LLM に渡した値から意味のある変化があるか判定
+ *
+ * デジタル入力は値が変われば、ADC入力はピンごとの不感帯 (mV) を超えれば変化ありとする。
+ * 参照ピンが分からないルールがある場合と、連続スキップが上限に達した場合は常に true。
+ * @return LLM チェックを実行すべきなら true
+ */
+bool rules_gate_check(void);
+
+/**
+ * @brief 直近の rules_gate_check() で読んだ値を「LLMに渡した値」として確定
+ */
+void rules_gate_commit(void);
+
+/**
+ * @brief ADCピンの変化検出の不感帯を設定
+ */
+esp_err_t rules_set_deadband(int pin, int deadband_mv);
+
+/**
+ * @brief ADCピンの不感帯 (mV)。ADCピンでなければ -1
+ */
+int rules_get_deadband(int pin);
+
+/**
+ * @brief ルール評価の統計を取得
+ */
+void rules_get_stats(rules_stats_t *out);
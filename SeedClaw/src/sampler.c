@@ -0,0 +1,444 @@
+#include "sampler.h"
+#include "gpio_ctrl.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs_flash.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <string.h>
+
+static const char *TAG = "sampler";
+
+#define ESCAPE      0x80     // 1バイト差分に収まらない: 続く2バイトが int16 の絶対値
+#define MISSED      0x81     // 欠測（読み取り失敗）: 値は変えずに周期の枠だけ進める
+#define DELTA_MIN   (-126)   // 0x81 (-127) を欠測に使うので1バイト差分は -126〜127
+#define ENTRY_MAX   3
+
+// NVSに保存するチャンネル設定
+typedef struct {
+    uint8_t pin;             // 0 = 未使用
+    uint8_t kind;            // sampler_kind_t
+    uint16_t period_s;
+} channel_cfg_t;
+
+typedef struct {
+    channel_cfg_t cfg;
+    uint8_t ring[SEEDCLAW_SAMPLER_RING_BYTES];
+    uint16_t head;           // 最古エントリの位置
+    uint16_t used;           // 使用バイト数
+    uint32_t count;          // 保持しているサンプル数
+    int32_t oldest;          // 最古サンプルの値（以降は差分を積み上げて復元）
+    int32_t newest;          // 最新サンプルの値（次の差分の基準）
+    int64_t newest_us;       // 最新サンプルの時刻
+    uint32_t countdown;      // 次のサンプリングまでのティック数
+    uint32_t total;
+    uint32_t missed;
+} channel_t;
+
+static channel_t s_channels[SEEDCLAW_SAMPLER_MAX_CHANNELS];
+static SemaphoreHandle_t s_sampler_mutex = NULL;
+
+static void lock(void)
+{
+    xSemaphoreTake(s_sampler_mutex, portMAX_DELAY);
+}
+
+static void unlock(void)
+{
+    xSemaphoreGive(s_sampler_mutex);
+}
+
+// ── リング（差分符号化） ──
+
+static uint8_t ring_at(const channel_t *ch, uint32_t pos)
+{
+    return ch->ring[pos % SEEDCLAW_SAMPLER_RING_BYTES];
+}
+
+// pos のエントリを直前の値 *value に適用し、エントリのバイト数を返す
+// （欠測エントリは *value をそのまま残す）
+static int apply_entry(const channel_t *ch, uint32_t pos, int32_t *value)
+{
+    uint8_t b = ring_at(ch, pos);
+    if (b == MISSED) {
+        return 1;
+    }
+    if (b != ESCAPE) {
+        *value += (int8_t)b;
+        return 1;
+    }
+    *value = (int16_t)(ring_at(ch, pos + 1) | (ring_at(ch, pos + 2) << 8));
+    return 3;
+}
+
+static void drop_oldest(channel_t *ch)
+{
+    int32_t skipped = 0;
+    int n = apply_entry(ch, ch->head, &skipped);
+    ch->head = (ch->head + n) % SEEDCLAW_SAMPLER_RING_BYTES;
+    ch->used -= n;
+    ch->count--;
+    if (ch->count > 0) {
+        // 新しい最古エントリを適用して最古値を進める
+        apply_entry(ch, ch->head, &ch->oldest);
+    }
+}
+
+static void ring_reset(channel_t *ch)
+{
+    ch->head = 0;
+    ch->used = 0;
+    ch->count = 0;
+    ch->oldest = 0;
+    ch->newest = 0;
+    ch->newest_us = 0;
+    ch->total = 0;
+    ch->missed = 0;
+}
+
+static void ring_push_entry(channel_t *ch, const uint8_t *entry, int n, int32_t value, int64_t now_us)
+{
+    while (ch->count > 0 && SEEDCLAW_SAMPLER_RING_BYTES - ch->used < n) {
+        drop_oldest(ch);
+    }
+
+    uint32_t tail = (ch->head + ch->used) % SEEDCLAW_SAMPLER_RING_BYTES;
+    for (int i = 0; i < n; i++) {
+        ch->ring[(tail + i) % SEEDCLAW_SAMPLER_RING_BYTES] = entry[i];
+    }
+    ch->used += n;
+    if (ch->count == 0) {
+        ch->oldest = value;
+    }
+    ch->count++;
+    ch->newest = value;
+    ch->newest_us = now_us;
+    ch->total++;
+}
+
+static void ring_push(channel_t *ch, int32_t value, int64_t now_us)
+{
+    if (value < INT16_MIN || value > INT16_MAX) {
+        value = value < 0 ? INT16_MIN : INT16_MAX;
+    }
+    int32_t delta = value - ch->newest;
+    uint8_t entry[ENTRY_MAX];
+    int n;
+    if (ch->count > 0 && delta >= DELTA_MIN && delta <= 127) {
+        entry[0] = (uint8_t)(int8_t)delta;
+        n = 1;
+    } else {
+        // 最初のサンプルと大きな変化は絶対値で持つ
+        entry[0] = ESCAPE;
+        entry[1] = (uint8_t)(value & 0xFF);
+        entry[2] = (uint8_t)((value >> 8) & 0xFF);
+        n = 3;
+    }
+    ring_push_entry(ch, entry, n, value, now_us);
+}
+
+// 読めなかった周期。時刻は周期から復元するので枠は埋めるが、値は記録しない
+static void ring_push_missed(channel_t *ch, int64_t now_us)
+{
+    const uint8_t entry = MISSED;
+    ring_push_entry(ch, &entry, 1, ch->newest, now_us);
+    ch->missed++;
+}
+
+// ── NVS ──
+
+static void save_config(void)
+{
+    channel_cfg_t cfg[SEEDCLAW_SAMPLER_MAX_CHANNELS];
+    for (int i = 0; i < SEEDCLAW_SAMPLER_MAX_CHANNELS; i++) {
+        cfg[i] = s_channels[i].cfg;
+    }
+
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(SEEDCLAW_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK) {
+        return;
+    }
+    err = nvs_set_blob(nvs_handle, "sampler", cfg, sizeof(cfg));
+    if (err == ESP_OK) {
+        nvs_commit(nvs_handle);
+    }
+    nvs_close(nvs_handle);
+}
+
+static void load_config(void)
+{
+    channel_cfg_t cfg[SEEDCLAW_SAMPLER_MAX_CHANNELS];
+    size_t len = sizeof(cfg);
+    nvs_handle_t nvs_handle;
+    if (nvs_open(SEEDCLAW_NVS_NAMESPACE, NVS_READONLY, &nvs_handle) != ESP_OK) {
+        return;
+    }
+    esp_err_t err = nvs_get_blob(nvs_handle, "sampler", cfg, &len);
+    nvs_close(nvs_handle);
+    if (err != ESP_OK || len != sizeof(cfg)) {
+        return;
+    }
+
+    for (int i = 0; i < SEEDCLAW_SAMPLER_MAX_CHANNELS; i++) {
+        const channel_cfg_t *c = &cfg[i];
+        bool valid = c->pin != 0 && c->period_s > 0 &&
+                     (c->kind == SAMPLER_ADC_MV ? gpio_is_adc_allowed(c->pin)
+                                                : gpio_is_pin_allowed(c->pin));
+        if (valid) {
+            s_channels[i].cfg = *c;
+        }
+    }
+}
+
+// ── サンプリングタスク ──
+
+static bool read_channel(const channel_cfg_t *cfg, int32_t *out)
+{
+    if (cfg->kind == SAMPLER_ADC_MV) {
+        adc_result_t adc;
+        if (gpio_ctrl_adc_read(cfg->pin, &adc) != ESP_OK) {
+            return false;
+        }
+        *out = adc.voltage_mv;
+        return true;
+    }
+    int level = gpio_ctrl_read(cfg->pin);
+    if (level < 0) {
+        return false;
+    }
+    *out = level;
+    return true;
+}
+
+static void sampler_task(void *arg)
+{
+    TickType_t last_wake = xTaskGetTickCount();
+
+    while (1) {
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(SEEDCLAW_SAMPLER_TICK_MS));
+
+        lock();
+        int64_t now = esp_timer_get_time();
+        for (int i = 0; i < SEEDCLAW_SAMPLER_MAX_CHANNELS; i++) {
+            channel_t *ch = &s_channels[i];
+            if (ch->cfg.pin == 0 || --ch->countdown > 0) {
+                continue;
+            }
+            ch->countdown = ch->cfg.period_s * 1000 / SEEDCLAW_SAMPLER_TICK_MS;
+
+            int32_t value;
+            if (read_channel(&ch->cfg, &value)) {
+                ring_push(ch, value, now);
+            } else if (ch->count > 0) {
+                // 前回値で埋めると集計が偽の値を含むので、欠測として残す
+                ring_push_missed(ch, now);
+            }
+        }
+        unlock();
+    }
+}
+
+// ── 公開API ──
+
+esp_err_t sampler_start(void)
+{
+    s_sampler_mutex = xSemaphoreCreateMutex();
+    if (s_sampler_mutex == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    memset(s_channels, 0, sizeof(s_channels));
+    load_config();
+    int active = 0;
+    for (int i = 0; i < SEEDCLAW_SAMPLER_MAX_CHANNELS; i++) {
+        s_channels[i].countdown = 1;
+        if (s_channels[i].cfg.pin != 0) {
+            active++;
+        }
+    }
+
+    if (xTaskCreate(sampler_task, "sampler", SEEDCLAW_SAMPLER_TASK_STACK, NULL,
+                    SEEDCLAW_SAMPLER_TASK_PRIO, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create sampler task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Sampler started (%d channel(s), %d bytes each)",
+             active, SEEDCLAW_SAMPLER_RING_BYTES);
+    return ESP_OK;
+}
+
+esp_err_t sampler_configure(int pin, sampler_kind_t kind, int period_s)
+{
+    if (period_s <= 0 || period_s > UINT16_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (kind == SAMPLER_ADC_MV ? !gpio_is_adc_allowed(pin) : !gpio_is_pin_allowed(pin)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    lock();
+    channel_t *slot = NULL;
+    for (int i = 0; i < SEEDCLAW_SAMPLER_MAX_CHANNELS; i++) {
+        if (s_channels[i].cfg.pin == pin) {
+            slot = &s_channels[i];
+            break;
+        }
+        if (slot == NULL && s_channels[i].cfg.pin == 0) {
+            slot = &s_channels[i];
+        }
+    }
+    if (slot == NULL) {
+        unlock();
+        return ESP_ERR_NO_MEM;
+    }
+
+    slot->cfg.pin = (uint8_t)pin;
+    slot->cfg.kind = (uint8_t)kind;
+    slot->cfg.period_s = (uint16_t)period_s;
+    slot->countdown = 1;
+    ring_reset(slot);
+    save_config();
+    unlock();
+
+    ESP_LOGI(TAG, "Sampling GPIO%d (%s) every %ds", pin,
+             kind == SAMPLER_ADC_MV ? "adc" : "gpio", period_s);
+    return ESP_OK;
+}
+
+esp_err_t sampler_remove(int pin)
+{
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    lock();
+    for (int i = 0; i < SEEDCLAW_SAMPLER_MAX_CHANNELS; i++) {
+        if (pin != 0 && s_channels[i].cfg.pin == pin) {
+            memset(&s_channels[i].cfg, 0, sizeof(s_channels[i].cfg));
+            ring_reset(&s_channels[i]);
+            save_config();
+            err = ESP_OK;
+            break;
+        }
+    }
+    unlock();
+    return err;
+}
+
+esp_err_t sampler_summarize(int pin, int seconds, int last_n, sampler_summary_t *out)
+{
+    if (out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (last_n < 0) {
+        last_n = 0;
+    } else if (last_n > SEEDCLAW_SAMPLER_LAST_MAX) {
+        last_n = SEEDCLAW_SAMPLER_LAST_MAX;
+    }
+    memset(out, 0, sizeof(*out));
+
+    lock();
+    const channel_t *ch = NULL;
+    for (int i = 0; i < SEEDCLAW_SAMPLER_MAX_CHANNELS; i++) {
+        if (pin != 0 && s_channels[i].cfg.pin == pin) {
+            ch = &s_channels[i];
+            break;
+        }
+    }
+    if (ch == NULL) {
+        unlock();
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    out->pin = pin;
+    out->kind = (sampler_kind_t)ch->cfg.kind;
+    out->period_s = ch->cfg.period_s;
+    if (ch->count == 0) {
+        unlock();
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // 期間内のサンプル数（周期固定なので件数で切り出せる）
+    uint32_t window = ch->count;
+    if (seconds > 0) {
+        uint32_t n = (uint32_t)seconds / ch->cfg.period_s;
+        if (n == 0) {
+            n = 1;
+        }
+        if (n < window) {
+            window = n;
+        }
+    }
+    uint32_t skip = ch->count - window;
+
+    // 最古から順に差分を積み上げて復元する
+    int32_t recent[SEEDCLAW_SAMPLER_LAST_MAX];
+    bool recent_missed[SEEDCLAW_SAMPLER_LAST_MAX];
+    int64_t sum = 0;
+    uint32_t valid = 0;
+    int32_t value = 0;
+    uint32_t pos = ch->head;
+    for (uint32_t i = 0; i < ch->count; i++) {
+        bool missed = ring_at(ch, pos) == MISSED;
+        pos += apply_entry(ch, pos, &value);
+        if (i == 0) {
+            // 最古エントリの差分の基準はもう押し出されているので保持値を使う
+            value = ch->oldest;
+        }
+        if (i < skip) {
+            continue;
+        }
+        if (last_n > 0) {
+            recent[(i - skip) % last_n] = value;
+            recent_missed[(i - skip) % last_n] = missed;
+        }
+        if (missed) {
+            out->missed++;
+            continue;
+        }
+
+        if (valid == 0 || value < out->min) {
+            out->min = value;
+        }
+        if (valid == 0 || value > out->max) {
+            out->max = value;
+        }
+        sum += value;
+        valid++;
+    }
+
+    out->samples = valid;
+    out->window_s = window * ch->cfg.period_s;
+    out->age_s = (uint32_t)((esp_timer_get_time() - ch->newest_us) / 1000000);
+    out->mean = valid > 0 ? (int32_t)(sum / valid) : 0;
+    out->last_count = (int)(window < (uint32_t)last_n ? window : (uint32_t)last_n);
+    for (int k = 0; k < out->last_count; k++) {
+        out->last[k] = recent[(window - 1 - k) % last_n];
+        out->last_missed[k] = recent_missed[(window - 1 - k) % last_n];
+    }
+    unlock();
+    return valid > 0 ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+int sampler_list(sampler_channel_info_t *out, int max)
+{
+    int n = 0;
+    lock();
+    for (int i = 0; i < SEEDCLAW_SAMPLER_MAX_CHANNELS && n < max; i++) {
+        const channel_t *ch = &s_channels[i];
+        if (ch->cfg.pin == 0) {
+            continue;
+        }
+        out[n].pin = ch->cfg.pin;
+        out[n].kind = (sampler_kind_t)ch->cfg.kind;
+        out[n].period_s = ch->cfg.period_s;
+        out[n].stored = ch->count;
+        out[n].bytes_used = ch->used;
+        out[n].total = ch->total;
+        out[n].missed = ch->missed;
+        n++;
+    }
+    unlock();
+    return n;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include "seedclaw_config.h"
+#include <stdint.h>
+
+/*
+ * バックグラウンドのセンサーサンプラー
+ *
+ * 設定したピンを専用タスクで一定周期ごとに読み、チャンネルごとの固定長
+ * リングに差分符号化で記録する。各サンプルは直前の値との差を 1 バイト
+ * （-127〜127）で、収まらない場合はエスケープ + 2 バイトの絶対値で持つ。
+ * 周期は固定なので時刻は最新サンプルの時刻と周期から復元する。読めなかった
+ * 周期は欠測バイトで枠だけ埋め、集計からは外して欠測数として報告する。
+ * 集計（最小/最大/平均/直近N件）は端末上で行い、LLM には要約だけを渡す。
+ */
+
+typedef enum {
+    SAMPLER_DIGITAL,         // gpio_ctrl_read() の 0/1
+    SAMPLER_ADC_MV,          // ADC 電圧 (mV)
+} sampler_kind_t;
+
+typedef struct {
+    int pin;
+    sampler_kind_t kind;
+    int period_s;            // サンプリング周期（秒）
+    uint32_t samples;        // 集計対象のサンプル数（欠測を除く）
+    uint32_t missed;         // 期間内の欠測（読み取り失敗）の周期数
+    uint32_t window_s;       // 集計対象の期間（秒）
+    uint32_t age_s;          // 最新サンプルからの経過秒
+    int32_t min;
+    int32_t max;
+    int32_t mean;
+    int32_t last[SEEDCLAW_SAMPLER_LAST_MAX];  // 新しい順
+    bool last_missed[SEEDCLAW_SAMPLER_LAST_MAX];  // true なら欠測（last[] の値は無意味）
+    int last_count;
+} sampler_summary_t;
+
+typedef struct {
+    int pin;
+    sampler_kind_t kind;
+    int period_s;
+    uint32_t stored;         // リングに残っているサンプル数
+    uint32_t bytes_used;     // リングの使用バイト数
+    uint32_t total;          // 記録した総サンプル数（欠測を含む）
+    uint32_t missed;         // 記録した欠測の総数
+} sampler_channel_info_t;
+
+/**
+ * @brief NVSからチャンネル設定を読み込み、サンプリングタスクを起動
+ */
+esp_err_t sampler_start(void);
+
+/**
+ * @brief ピンのサンプリングを設定（NVSに保存、既存の記録は破棄）
+ * @param period_s サンプリング周期（秒、1以上）
+ */
+esp_err_t sampler_configure(int pin, sampler_kind_t kind, int period_s);
+
+/**
+ * @brief ピンのサンプリングを停止（NVSからも削除）
+ */
+esp_err_t sampler_remove(int pin);
+
+/**
+ * @brief 記録の集計を取得
+ * @param seconds 直近何秒分を集計するか（0 なら記録全体）
+ * @param last_n 新しい順に返す生サンプル数（SEEDCLAW_SAMPLER_LAST_MAX まで）
+ * @return 未設定のピンなら ESP_ERR_NOT_FOUND、期間内に読めたサンプルがなければ ESP_ERR_INVALID_STATE
+ */
+esp_err_t sampler_summarize(int pin, int seconds, int last_n, sampler_summary_t *out);
+
+/**
+ * @brief 設定済みチャンネルの情報を取得
+ * @return チャンネル数
+ */
+int sampler_list(sampler_channel_info_t *out, int max);
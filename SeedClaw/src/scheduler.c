@@ -0,0 +1,689 @@
+#include "scheduler.h"
+#include "tools.h"
+#include "discord.h"
+#include "esp_log.h"
+#include "esp_netif_sntp.h"
+#include "nvs_flash.h"
+#include "nvs.h"
+#include "cJSON.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+
+static const char *TAG = "scheduler";
+
+_Static_assert((SEEDCLAW_SCHED_WHEEL_SLOTS & (SEEDCLAW_SCHED_WHEEL_SLOTS - 1)) == 0,
+               "SEEDCLAW_SCHED_WHEEL_SLOTS must be a power of two");
+
+#define WHEEL_MASK          (SEEDCLAW_SCHED_WHEEL_SLOTS - 1)
+#define MIN_VALID_EPOCH     1704067200LL   // 2024-01-01: これより前なら時刻未同期
+#define CRON_SEARCH_DAYS    1500           // 2/29 指定でも次の閏年まで探せる
+
+// スケジュールから呼べるツール（出力操作のみ）
+static const char *const s_allowed_tools[] = {
+    "gpio_write", "gpio_write_multi", "pwm_set", "pwm_fade", "loop_set",
+};
+
+// パース済みの cron 式（各フィールドは値のビット集合）
+typedef struct {
+    uint64_t minute;         // bit 0-59
+    uint32_t hour;           // bit 0-23
+    uint32_t dom;            // bit 1-31
+    uint16_t month;          // bit 1-12
+    uint8_t dow;             // bit 0-6 (0 = 日曜)
+    bool dom_any;
+    bool dow_any;
+} cron_t;
+
+// NVSに保存するジョブ（1ジョブ1キー）
+typedef struct {
+    uint16_t id;             // 0 = 未使用
+    sched_job_t job;
+    int64_t end_due;         // 終了動作の予定時刻（再起動をまたいでも必ず実行する）
+} job_cfg_t;
+
+typedef struct {
+    job_cfg_t cfg;
+    cron_t cron;
+    uint32_t runs;
+    bool last_ok;
+} job_t;
+
+// タイマーホイール: ノードはジョブごとに開始/終了の2つ
+typedef struct {
+    int64_t due;
+    int8_t next;             // 同じスロットの次のノード (-1 = 終端)
+    bool armed;
+} timer_node_t;
+
+#define NODE_START(i)   ((i) * 2)
+#define NODE_END(i)     ((i) * 2 + 1)
+
+static job_t s_jobs[SEEDCLAW_SCHED_MAX_JOBS];
+static timer_node_t s_nodes[SEEDCLAW_SCHED_MAX_JOBS * 2];
+static int8_t s_wheel[SEEDCLAW_SCHED_WHEEL_SLOTS];
+static int64_t s_wheel_now = 0;      // 処理済みの秒
+static bool s_armed = false;         // 時刻同期後にジョブをホイールに載せたか
+static uint16_t s_next_id = 1;
+static SemaphoreHandle_t s_sched_mutex = NULL;
+
+static void lock(void)
+{
+    xSemaphoreTake(s_sched_mutex, portMAX_DELAY);
+}
+
+static void unlock(void)
+{
+    xSemaphoreGive(s_sched_mutex);
+}
+
+// ── cron ──
+
+// "*", "n", "a-b" に "/step" を付けた項目のカンマ区切り
+static bool cron_field(char *text, int lo, int hi, uint64_t *mask)
+{
+    *mask = 0;
+    char *save = NULL;
+    for (char *item = strtok_r(text, ",", &save); item != NULL; item = strtok_r(NULL, ",", &save)) {
+        int from = lo;
+        int to = hi;
+        int step = 1;
+        char *slash = strchr(item, '/');
+        if (slash != NULL) {
+            *slash = '\0';
+            step = atoi(slash + 1);
+            if (step <= 0) {
+                return false;
+            }
+        }
+        if (strcmp(item, "*") != 0) {
+            char *end;
+            from = (int)strtol(item, &end, 10);
+            to = from;
+            if (*end == '-') {
+                to = (int)strtol(end + 1, &end, 10);
+            } else if (slash != NULL) {
+                to = hi;     // "n/step" は n から最後まで
+            }
+            if (*end != '\0' || end == item) {
+                return false;
+            }
+        }
+        if (from < lo || to > hi || from > to) {
+            return false;
+        }
+        for (int v = from; v <= to; v += step) {
+            *mask |= 1ULL << v;
+        }
+    }
+    return *mask != 0;
+}
+
+static bool cron_parse(const char *expr, cron_t *out)
+{
+    char buf[SEEDCLAW_SCHED_CRON_LEN];
+    strncpy(buf, expr, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+
+    char *fields[5];
+    int n = 0;
+    char *save = NULL;
+    for (char *f = strtok_r(buf, " \t", &save); f != NULL; f = strtok_r(NULL, " \t", &save)) {
+        if (n == 5) {
+            return false;
+        }
+        fields[n++] = f;
+    }
+    if (n != 5) {
+        return false;
+    }
+
+    memset(out, 0, sizeof(*out));
+    out->dom_any = strcmp(fields[2], "*") == 0;
+    out->dow_any = strcmp(fields[4], "*") == 0;
+    uint64_t m;
+    if (!cron_field(fields[0], 0, 59, &m)) return false;
+    out->minute = m;
+    if (!cron_field(fields[1], 0, 23, &m)) return false;
+    out->hour = (uint32_t)m;
+    if (!cron_field(fields[2], 1, 31, &m)) return false;
+    out->dom = (uint32_t)m;
+    if (!cron_field(fields[3], 1, 12, &m)) return false;
+    out->month = (uint16_t)m;
+    if (!cron_field(fields[4], 0, 7, &m)) return false;
+    out->dow = (uint8_t)((m | (m >> 7)) & 0x7F);     // 7 も日曜
+    return true;
+}
+
+static bool cron_day_matches(const cron_t *c, const struct tm *tm)
+{
+    if (!(c->month & (1U << (tm->tm_mon + 1)))) {
+        return false;
+    }
+    bool dom = (c->dom & (1UL << tm->tm_mday)) != 0;
+    bool dow = (c->dow & (1U << tm->tm_wday)) != 0;
+    // 日と曜日の両方が指定されていればどちらか一致で実行（cron と同じ）
+    if (c->dom_any || c->dow_any) {
+        return dom && dow;
+    }
+    return dom || dow;
+}
+
+// after より後で最初に一致する時刻（ローカル時刻で分単位）。見つからなければ -1
+static int64_t cron_next(const cron_t *c, int64_t after)
+{
+    time_t t = (time_t)((after / 60 + 1) * 60);
+    struct tm tm;
+    localtime_r(&t, &tm);
+
+    for (int day = 0; day < CRON_SEARCH_DAYS; day++) {
+        if (cron_day_matches(c, &tm)) {
+            for (int h = tm.tm_hour; h < 24; h++) {
+                if (!(c->hour & (1UL << h))) {
+                    continue;
+                }
+                for (int m = (h == tm.tm_hour) ? tm.tm_min : 0; m < 60; m++) {
+                    if (c->minute & (1ULL << m)) {
+                        tm.tm_hour = h;
+                        tm.tm_min = m;
+                        tm.tm_sec = 0;
+                        tm.tm_isdst = -1;
+                        return (int64_t)mktime(&tm);
+                    }
+                }
+            }
+        }
+        tm.tm_mday++;
+        tm.tm_hour = 0;
+        tm.tm_min = 0;
+        tm.tm_sec = 0;
+        tm.tm_isdst = -1;
+        mktime(&tm);     // 月末の繰り上がりと曜日を正規化
+    }
+    return -1;
+}
+
+// ── タイマーホイール ──
+
+static void wheel_cancel(int node)
+{
+    timer_node_t *n = &s_nodes[node];
+    if (!n->armed) {
+        return;
+    }
+    for (int s = 0; s < SEEDCLAW_SCHED_WHEEL_SLOTS; s++) {
+        int8_t *link = &s_wheel[s];
+        while (*link >= 0) {
+            if (*link == node) {
+                *link = n->next;
+                n->armed = false;
+                return;
+            }
+            link = &s_nodes[*link].next;
+        }
+    }
+}
+
+static void wheel_insert(int node, int64_t due)
+{
+    wheel_cancel(node);
+    // 過ぎた時刻は次に処理するスロットに入れる
+    int64_t slot_time = due > s_wheel_now ? due : s_wheel_now + 1;
+    int slot = (int)(slot_time & WHEEL_MASK);
+    s_nodes[node].due = due;
+    s_nodes[node].next = s_wheel[slot];
+    s_nodes[node].armed = true;
+    s_wheel[slot] = (int8_t)node;
+}
+
+// スロット内で期限が来たノードを1つ外して返す。なければ -1
+static int wheel_pop_due(int slot, int64_t now)
+{
+    int8_t *link = &s_wheel[slot];
+    while (*link >= 0) {
+        int node = *link;
+        if (s_nodes[node].due <= now) {
+            *link = s_nodes[node].next;
+            s_nodes[node].armed = false;
+            return node;
+        }
+        link = &s_nodes[node].next;
+    }
+    return -1;
+}
+
+// ── NVS ──
+
+static void job_key(int index, char *key, size_t size)
+{
+    snprintf(key, size, "sched%d", index);
+}
+
+static void save_job(int index)
+{
+    nvs_handle_t nvs_handle;
+    if (nvs_open(SEEDCLAW_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) != ESP_OK) {
+        return;
+    }
+    char key[12];
+    job_key(index, key, sizeof(key));
+    esp_err_t err;
+    if (s_jobs[index].cfg.id == 0) {
+        err = nvs_erase_key(nvs_handle, key);
+        if (err == ESP_ERR_NVS_NOT_FOUND) {
+            err = ESP_OK;
+        }
+    } else {
+        err = nvs_set_blob(nvs_handle, key, &s_jobs[index].cfg, sizeof(job_cfg_t));
+    }
+    if (err == ESP_OK) {
+        nvs_commit(nvs_handle);
+    }
+    nvs_close(nvs_handle);
+}
+
+static void load_jobs(void)
+{
+    nvs_handle_t nvs_handle;
+    if (nvs_open(SEEDCLAW_NVS_NAMESPACE, NVS_READONLY, &nvs_handle) != ESP_OK) {
+        return;
+    }
+    for (int i = 0; i < SEEDCLAW_SCHED_MAX_JOBS; i++) {
+        char key[12];
+        job_key(i, key, sizeof(key));
+        job_cfg_t cfg;
+        size_t len = sizeof(cfg);
+        if (nvs_get_blob(nvs_handle, key, &cfg, &len) != ESP_OK || len != sizeof(cfg) || cfg.id == 0) {
+            continue;
+        }
+        job_t *j = &s_jobs[i];
+        j->cfg = cfg;
+        if (cfg.job.kind == SCHED_CRON && !cron_parse(cfg.job.cron, &j->cron)) {
+            memset(j, 0, sizeof(*j));
+            continue;
+        }
+        if (cfg.id >= s_next_id) {
+            s_next_id = cfg.id + 1;
+        }
+    }
+    nvs_close(nvs_handle);
+}
+
+// ── 実行 ──
+
+static bool time_valid(void)
+{
+    return (int64_t)time(NULL) >= MIN_VALID_EPOCH;
+}
+
+static void time_sync_cb(struct timeval *tv)
+{
+    ESP_LOGI(TAG, "Time synced: %lld", (long long)tv->tv_sec);
+}
+
+// ジョブを現在時刻からホイールに載せる
+static void arm_job_locked(int index, int64_t now)
+{
+    job_t *j = &s_jobs[index];
+    if (j->cfg.end_due > 0) {
+        // 終了動作は期限切れでも必ず実行する（ポンプを止め忘れない）
+        wheel_insert(NODE_END(index), j->cfg.end_due);
+    }
+    if (j->cfg.job.kind == SCHED_CRON) {
+        int64_t next = cron_next(&j->cron, now);
+        if (next > 0) {
+            wheel_insert(NODE_START(index), next);
+        }
+    } else if (j->cfg.end_due == 0) {
+        if (j->cfg.job.at < now - SEEDCLAW_SCHED_GRACE_S) {
+            ESP_LOGW(TAG, "Job #%d missed its time, dropped", j->cfg.id);
+            memset(j, 0, sizeof(*j));
+            save_job(index);
+            return;
+        }
+        wheel_insert(NODE_START(index), j->cfg.job.at);
+    }
+}
+
+static void notify(const job_cfg_t *cfg, bool end, const char *tool, const char *error)
+{
+    char text[SEEDCLAW_SCHED_REPORT_SIZE];
+    const char *name = cfg->job.label;
+    int len = snprintf(text, sizeof(text), "**[スケジュール]** #%d%s%s%s: %s%s",
+                       cfg->id, name[0] ? "「" : "", name, name[0] ? "」" : "",
+                       end ? "終了動作 " : "", tool);
+    if (len > 0 && (size_t)len < sizeof(text)) {
+        if (error != NULL) {
+            snprintf(text + len, sizeof(text) - len, " 失敗: %s", error);
+        } else {
+            snprintf(text + len, sizeof(text) - len, " 実行");
+        }
+    }
+    discord_send_webhook(text);
+}
+
+// ツールを実行してエラー文字列（成功なら NULL）を buf に返す
+static const char *run_tool(const char *tool, const char *input, char *buf, size_t size)
+{
+    char *result = tools_execute(tool, input);
+    if (result == NULL) {
+        return "no result";
+    }
+    const char *error = NULL;
+    cJSON *root = cJSON_Parse(result);
+    const char *msg = cJSON_GetStringValue(cJSON_GetObjectItem(root, "error"));
+    if (msg != NULL) {
+        strncpy(buf, msg, size - 1);
+        buf[size - 1] = '\0';
+        error = buf;
+    }
+    cJSON_Delete(root);
+    free(result);
+    return error;
+}
+
+// 期限が来たノードを処理（ロック中に呼び、ツール実行の間だけロックを外す）
+static void fire_locked(int node, int64_t now)
+{
+    int index = node / 2;
+    bool end = (node & 1) != 0;
+    job_t *j = &s_jobs[index];
+    if (j->cfg.id == 0) {
+        return;
+    }
+
+    job_cfg_t cfg = j->cfg;
+    if (end) {
+        j->cfg.end_due = 0;
+    } else {
+        j->runs++;
+        if (cfg.job.duration_s > 0 && cfg.job.end_tool[0] != '\0') {
+            j->cfg.end_due = now + cfg.job.duration_s;
+            wheel_insert(NODE_END(index), j->cfg.end_due);
+        }
+        if (cfg.job.kind == SCHED_CRON) {
+            int64_t next = cron_next(&j->cron, now);
+            if (next > 0) {
+                wheel_insert(NODE_START(index), next);
+            }
+        }
+    }
+    // 一回限りのジョブはもう何も残っていなければ削除
+    if (cfg.job.kind == SCHED_ONCE && j->cfg.end_due == 0) {
+        memset(j, 0, sizeof(*j));
+    }
+    // 毎回の cron 実行では保存内容が変わらないのでフラッシュに書かない
+    if (j->cfg.id == 0 || j->cfg.end_due != cfg.end_due) {
+        save_job(index);
+    }
+    unlock();
+
+    const char *tool = end ? cfg.job.end_tool : cfg.job.tool;
+    char err_buf[96];
+    const char *error = run_tool(tool, end ? cfg.job.end_input : cfg.job.input, err_buf, sizeof(err_buf));
+    ESP_LOGI(TAG, "Job #%d %s: %s %s", cfg.id, end ? "end" : "start", tool, error ? error : "ok");
+    notify(&cfg, end, tool, error);
+
+    lock();
+    if (j->cfg.id == cfg.id) {
+        j->last_ok = (error == NULL);
+    }
+}
+
+static void scheduler_task(void *arg)
+{
+    TickType_t last_wake = xTaskGetTickCount();
+
+    while (1) {
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(1000));
+        if (!time_valid()) {
+            continue;
+        }
+
+        lock();
+        int64_t now = (int64_t)time(NULL);
+        if (!s_armed) {
+            s_wheel_now = now - 1;
+            for (int i = 0; i < SEEDCLAW_SCHED_MAX_JOBS; i++) {
+                if (s_jobs[i].cfg.id != 0) {
+                    arm_job_locked(i, now);
+                }
+            }
+            s_armed = true;
+        }
+
+        if (now < s_wheel_now) {
+            // 時刻が戻った: 載っているノードは未来のまま待つ
+            s_wheel_now = now;
+        } else if (now - s_wheel_now > SEEDCLAW_SCHED_WHEEL_SLOTS) {
+            // 大きく進んだ: 全スロットを1周だけ見れば期限切れはすべて拾える
+            s_wheel_now = now - SEEDCLAW_SCHED_WHEEL_SLOTS;
+        }
+        while (s_wheel_now < now) {
+            s_wheel_now++;
+            int slot = (int)(s_wheel_now & WHEEL_MASK);
+            int node;
+            while ((node = wheel_pop_due(slot, s_wheel_now)) >= 0) {
+                fire_locked(node, now);
+            }
+        }
+        unlock();
+    }
+}
+
+// ── 公開API ──
+
+bool scheduler_tool_allowed(const char *tool)
+{
+    for (size_t i = 0; i < sizeof(s_allowed_tools) / sizeof(s_allowed_tools[0]); i++) {
+        if (strcmp(tool, s_allowed_tools[i]) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool scheduler_time_synced(void)
+{
+    return time_valid();
+}
+
+esp_err_t scheduler_start(void)
+{
+    s_sched_mutex = xSemaphoreCreateMutex();
+    if (s_sched_mutex == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    setenv("TZ", SEEDCLAW_TIMEZONE, 1);
+    tzset();
+
+    esp_sntp_config_t config = ESP_NETIF_SNTP_DEFAULT_CONFIG(SEEDCLAW_SNTP_SERVER);
+    config.sync_cb = time_sync_cb;
+    esp_err_t err = esp_netif_sntp_init(&config);
+    if (err != ESP_OK) {
+        // 時刻が合うまでジョブは動かないだけなので起動は続ける
+        ESP_LOGW(TAG, "SNTP init failed: %s", esp_err_to_name(err));
+    }
+
+    memset(s_jobs, 0, sizeof(s_jobs));
+    memset(s_wheel, -1, sizeof(s_wheel));
+    load_jobs();
+    int active = 0;
+    for (int i = 0; i < SEEDCLAW_SCHED_MAX_JOBS; i++) {
+        if (s_jobs[i].cfg.id != 0) {
+            active++;
+        }
+    }
+
+    if (xTaskCreate(scheduler_task, "scheduler", SEEDCLAW_SCHED_TASK_STACK, NULL,
+                    SEEDCLAW_SCHED_TASK_PRIO, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create scheduler task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Scheduler started (%d job(s), TZ=%s)", active, SEEDCLAW_TIMEZONE);
+    return ESP_OK;
+}
+
+static bool input_valid(const char *tool, const char *input)
+{
+    if (!scheduler_tool_allowed(tool)) {
+        return false;
+    }
+    cJSON *root = cJSON_Parse(input);
+    bool ok = cJSON_IsObject(root);
+    cJSON_Delete(root);
+    return ok;
+}
+
+esp_err_t scheduler_add(const sched_job_t *job, int *id_out)
+{
+    cron_t cron = {0};
+    if (job->kind == SCHED_CRON) {
+        if (!cron_parse(job->cron, &cron)) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        if (time_valid() && cron_next(&cron, (int64_t)time(NULL)) < 0) {
+            return ESP_ERR_INVALID_ARG;     // 2/30 など来ない日付
+        }
+    } else if (job->kind != SCHED_ONCE || job->at < MIN_VALID_EPOCH) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!input_valid(job->tool, job->input) || job->duration_s > SEEDCLAW_SCHED_MAX_DURATION_S) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (job->duration_s > 0 && !input_valid(job->end_tool, job->end_input)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    lock();
+    int index = -1;
+    for (int i = 0; i < SEEDCLAW_SCHED_MAX_JOBS; i++) {
+        if (s_jobs[i].cfg.id == 0) {
+            index = i;
+            break;
+        }
+    }
+    if (index < 0) {
+        unlock();
+        return ESP_ERR_NO_MEM;
+    }
+
+    job_t *j = &s_jobs[index];
+    memset(j, 0, sizeof(*j));
+    j->cfg.id = s_next_id++;
+    j->cfg.job = *job;
+    j->cfg.job.label[SEEDCLAW_SCHED_LABEL_LEN - 1] = '\0';
+    j->cron = cron;
+    j->last_ok = true;
+    if (s_next_id == 0) {
+        s_next_id = 1;
+    }
+    save_job(index);
+    if (s_armed) {
+        arm_job_locked(index, (int64_t)time(NULL));
+    }
+    int id = j->cfg.id;
+    unlock();
+
+    if (id_out != NULL) {
+        *id_out = id;
+    }
+    ESP_LOGI(TAG, "Job #%d added: %s %s", id,
+             job->kind == SCHED_CRON ? job->cron : "once", job->tool);
+    return ESP_OK;
+}
+
+esp_err_t scheduler_remove(int id)
+{
+    lock();
+    int index = -1;
+    for (int i = 0; i < SEEDCLAW_SCHED_MAX_JOBS; i++) {
+        if (id > 0 && s_jobs[i].cfg.id == id) {
+            index = i;
+            break;
+        }
+    }
+    if (index < 0) {
+        unlock();
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    job_cfg_t cfg = s_jobs[index].cfg;
+    wheel_cancel(NODE_START(index));
+    wheel_cancel(NODE_END(index));
+    memset(&s_jobs[index], 0, sizeof(s_jobs[index]));
+    save_job(index);
+    unlock();
+
+    if (cfg.end_due > 0) {
+        // 実行中のジョブを消すときは出しっぱなしにしない
+        char err_buf[96];
+        run_tool(cfg.job.end_tool, cfg.job.end_input, err_buf, sizeof(err_buf));
+    }
+    ESP_LOGI(TAG, "Job #%d removed", id);
+    return ESP_OK;
+}
+
+int scheduler_list(sched_info_t *out, int max)
+{
+    int n = 0;
+    lock();
+    for (int i = 0; i < SEEDCLAW_SCHED_MAX_JOBS && n < max; i++) {
+        const job_t *j = &s_jobs[i];
+        if (j->cfg.id == 0) {
+            continue;
+        }
+        out[n].id = j->cfg.id;
+        out[n].job = j->cfg.job;
+        out[n].next_run = s_nodes[NODE_START(i)].armed ? s_nodes[NODE_START(i)].due : 0;
+        out[n].end_due = j->cfg.end_due;
+        out[n].runs = j->runs;
+        out[n].last_ok = j->last_ok;
+        n++;
+    }
+    unlock();
+    return n;
+}
+
+esp_err_t scheduler_parse_at(const char *text, int64_t *out)
+{
+    if (!time_valid()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    time_t now = time(NULL);
+    struct tm tm;
+    localtime_r(&now, &tm);
+
+    int y, mo, d, h, mi;
+    char tail;
+    if (sscanf(text, "%d-%d-%d %d:%d%c", &y, &mo, &d, &h, &mi, &tail) == 5) {
+        tm.tm_year = y - 1900;
+        tm.tm_mon = mo - 1;
+        tm.tm_mday = d;
+    } else if (sscanf(text, "%d:%d%c", &h, &mi, &tail) != 2) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (h < 0 || h > 23 || mi < 0 || mi > 59) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    tm.tm_hour = h;
+    tm.tm_min = mi;
+    tm.tm_sec = 0;
+    tm.tm_isdst = -1;
+    time_t t = mktime(&tm);
+    if (strchr(text, '-') == NULL && t <= now) {
+        t += 24 * 3600;      // "HH:MM" が過ぎていれば明日
+    }
+    if (t <= now) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out = (int64_t)t;
+    return ESP_OK;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include "seedclaw_config.h"
+#include <stdint.h>
+
+/*
+ * 端末上のスケジューラ
+ *
+ * SNTPで時刻を合わせ、1秒刻みのタイマーホイールで一回限り/cron形式の
+ * ジョブを回す。ジョブはツール呼び出し（gpio_write など）を端末上で
+ * 実行するので、LLM が関わるのは登録時だけ。duration_s を付けると
+ * 開始から指定秒後に終了動作（OFF）を実行する。ジョブはNVSに保存される。
+ */
+
+typedef enum {
+    SCHED_ONCE,              // at の時刻に1回
+    SCHED_CRON,              // cron 式 "分 時 日 月 曜日"（ローカル時刻）
+} sched_kind_t;
+
+typedef struct {
+    sched_kind_t kind;
+    int64_t at;                                  // SCHED_ONCE: UNIX時刻
+    char cron[SEEDCLAW_SCHED_CRON_LEN];          // SCHED_CRON: 例 "0 7 * * *"
+    uint32_t duration_s;                         // 0 = 終了動作なし
+    char label[SEEDCLAW_SCHED_LABEL_LEN];
+    char tool[SEEDCLAW_SCHED_TOOL_LEN];          // 開始時に実行するツール
+    char input[SEEDCLAW_SCHED_INPUT_LEN];        // ツール入力 (JSON)
+    char end_tool[SEEDCLAW_SCHED_TOOL_LEN];      // 終了時に実行するツール
+    char end_input[SEEDCLAW_SCHED_INPUT_LEN];
+} sched_job_t;
+
+typedef struct {
+    int id;
+    sched_job_t job;
+    int64_t next_run;        // 次の開始時刻 (0 = 未定)
+    int64_t end_due;         // 実行中の終了予定時刻 (0 = なし)
+    uint32_t runs;           // 起動後の実行回数
+    bool last_ok;            // 直近の実行が成功したか
+} sched_info_t;
+
+/**
+ * @brief SNTPを開始し、NVSのジョブを読み込んでスケジューラタスクを起動
+ */
+esp_err_t scheduler_start(void);
+
+/**
+ * @brief 時刻がSNTPで合っているか
+ */
+bool scheduler_time_synced(void);
+
+/**
+ * @brief ジョブを追加（NVSに保存）
+ * @param id_out 割り当てたID（NULL可）
+ * @return 不正な cron/ツール/入力なら ESP_ERR_INVALID_ARG、空きがなければ ESP_ERR_NO_MEM
+ */
+esp_err_t scheduler_add(const sched_job_t *job, int *id_out);
+
+/**
+ * @brief ジョブを削除（終了動作が未実行ならすぐ実行する）
+ */
+esp_err_t scheduler_remove(int id);
+
+/**
+ * @brief ジョブ一覧を取得
+ * @return ジョブ数
+ */
+int scheduler_list(sched_info_t *out, int max);
+
+/**
+ * @brief "YYYY-MM-DD HH:MM" または "HH:MM"（次に来るその時刻）をUNIX時刻に変換
+ * @return 形式が不正なら ESP_ERR_INVALID_ARG、時刻未同期なら ESP_ERR_INVALID_STATE
+ */
+esp_err_t scheduler_parse_at(const char *text, int64_t *out);
+
+/**
+ * @brief スケジュールから実行できるツールか
+ */
+bool scheduler_tool_allowed(const char *tool);
@@ -1,40 +1,65 @@
 #include "seedclaw_config.h"
 #include "wifi.h"
 #include "discord.h"
+#include "discord_gateway.h"
 #include "llm.h"
+#include "summary.h"
 #include "gpio_ctrl.h"
+#include "sampler.h"
+#include "gpio_watch.h"
+#include "control_loop.h"
+#include "scheduler.h"
 #include "tools.h"
+#include "rules.h"
+#include "pipeline.h"
 #include "cli.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "nvs_flash.h"
 #include "esp_event.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include <stdlib.h>
 
 static const char *TAG = "seedclaw";
 
+/**
+ * 受信ループ（メインタスク）
+ * メッセージの取り込みと自律チェックの発火だけを行い、LLM処理と送信は
+ * パイプラインのタスクに任せるため、応答待ちの間も受信が止まらない。
+ */
 static void main_loop(void)
 {
     ESP_LOGI(TAG, "Starting main loop");
-    int auto_counter = 0;
+    int64_t next_auto_us = 0;   // 次にLLMの自律チェックを積む時刻 (0 = 未設定)
     int backoff_ms = 0;
 
     while (1) {
-        // STEP 1: Discordポーリング
+        // STEP 1: ワーカーのキューに空きがある分だけ取り込む（背圧）
+        int capacity = pipeline_work_capacity();
+        if (capacity > SEEDCLAW_MAX_POLL_MSGS) {
+            capacity = SEEDCLAW_MAX_POLL_MSGS;
+        }
+
         discord_message_t msgs[SEEDCLAW_MAX_POLL_MSGS];
-        int msg_count = discord_poll(msgs, SEEDCLAW_MAX_POLL_MSGS);
+        bool via_gateway = false;
+        int msg_count = 0;
+        if (capacity > 0) {
+            // Gatewayイベント受信（未接続ならRESTポーリングにフォールバック）
+            via_gateway = discord_gateway_is_ready();
+            if (via_gateway) {
+                msg_count = discord_gateway_receive(msgs, capacity,
+                                                    SEEDCLAW_POLL_INTERVAL_MS);
+            } else {
+                msg_count = discord_poll(msgs, capacity);
+            }
+        }
 
-        // STEP 2: 各メッセージを処理
+        // STEP 2: 各メッセージをワーカーに渡す
         if (msg_count > 0) {
             backoff_ms = 0;
             for (int i = 0; i < msg_count; i++) {
-                ESP_LOGI(TAG, "Processing message: %s", msgs[i].content);
-
-                char *reply = react_loop(msgs[i].content);
-                if (reply != NULL) {
-                    discord_send_webhook(reply);
-                    free(reply);
-                }
+                pipeline_submit_message(msgs[i].content);
             }
         } else if (msg_count == 0) {
             backoff_ms = 0;
@@ -51,22 +76,41 @@ static void main_loop(void)
             continue;
         }
 
-        // STEP 3: 自律チェック
+        // STEP 3: 自律監視
         int interval = auto_interval_get();
         if (interval > 0 && rules_count() > 0) {
-            auto_counter++;
-            if (auto_counter >= interval) {
-                char *report = autonomous_check();
-                if (report != NULL) {
-                    discord_send_webhook(report);
-                    free(report);
+            // 変換済みルールは毎ティック端末上で評価（LLM不要）
+            char *report = rules_tick();
+            if (report != NULL) {
+                discord_send_webhook(report);
+                free(report);
+            }
+
+            // 変換できないルールだけ間隔ごとに LLM へ。Gateway受信ではメッセージが来るたびに
+            // ループが回るので、回数ではなく経過時間で数える（ワーカーが処理中でも時計は進む）
+            // 参照ピンに意味のある変化がなければ LLM は呼ばない
+            if (rules_llm_count() > 0) {
+                int64_t now = esp_timer_get_time();
+                int64_t period_us = (int64_t)interval * SEEDCLAW_POLL_INTERVAL_MS * 1000;
+                if (next_auto_us == 0 || next_auto_us - now > period_us) {
+                    // 初回、または間隔が短く変更された
+                    next_auto_us = now + period_us;
+                } else if (now >= next_auto_us) {
+                    next_auto_us = now + period_us;
+                    // ゲートの基準値はジョブを実際に積んだときだけ更新する
+                    if (rules_gate_check() && pipeline_submit_auto_check() == ESP_OK) {
+                        rules_gate_commit();
+                    }
                 }
-                auto_counter = 0;
+            } else {
+                next_auto_us = 0;
             }
         }
 
-        // 次のポーリングまで待機
-        vTaskDelay(pdMS_TO_TICKS(SEEDCLAW_POLL_INTERVAL_MS));
+        // 次のポーリングまで待機（Gateway受信時はキュー待ちで待機済み）
+        if (!via_gateway) {
+            vTaskDelay(pdMS_TO_TICKS(SEEDCLAW_POLL_INTERVAL_MS));
+        }
     }
 }
 
@@ -99,19 +143,34 @@ void app_main(void)
     // GPIO制御初期化
     ESP_LOGI(TAG, "Initializing GPIO control...");
     ESP_ERROR_CHECK(gpio_ctrl_init());
+    ESP_ERROR_CHECK(sampler_start());
+    ESP_ERROR_CHECK(gpio_watch_start());
+    ESP_ERROR_CHECK(control_loop_start());
 
     // Discord初期化
     ESP_LOGI(TAG, "Initializing Discord...");
     ESP_ERROR_CHECK(discord_init());
 
+    // Discord Gateway (有効時のみ)
+    discord_gateway_start();
+
     // LLM初期化
     ESP_LOGI(TAG, "Initializing LLM...");
     ESP_ERROR_CHECK(llm_init());
+    summary_init();
 
     // ツールモジュール初期化
     ESP_LOGI(TAG, "Initializing tools...");
     tools_init();
 
+    // LLMワーカー起動
+    ESP_LOGI(TAG, "Starting pipeline...");
+    ESP_ERROR_CHECK(pipeline_start());
+
+    // スケジューラ起動（ツールを使うので tools_init の後）
+    ESP_LOGI(TAG, "Starting scheduler...");
+    ESP_ERROR_CHECK(scheduler_start());
+
     // CLI起動
     ESP_LOGI(TAG, "Starting CLI...");
     ESP_ERROR_CHECK(cli_init());
@@ -124,9 +183,9 @@ void app_main(void)
         vTaskDelay(pdMS_TO_TICKS(3000));
         esp_err_t send_err = discord_send_webhook("🌱 **SeedClaw 起動完了！** GPIO制御の準備ができました。メッセージを送ってください。");
         if (send_err == ESP_OK) {
-            ESP_LOGI(TAG, "Startup notification sent to Discord");
+            ESP_LOGI(TAG, "Startup notification queued");
         } else {
-            ESP_LOGE(TAG, "Failed to send startup notification: %s", esp_err_to_name(send_err));
+            ESP_LOGE(TAG, "Failed to queue startup notification: %s", esp_err_to_name(send_err));
         }
     }
 
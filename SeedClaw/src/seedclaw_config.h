@@ -28,14 +28,30 @@
 #define SEEDCLAW_MAX_POLL_MSGS          3       /* 1回のポーリングで取得する最大メッセージ数 */
 #define SEEDCLAW_DISCORD_MAX_MSG_LEN    2000    /* Discordメッセージ文字数制限 */
 #define SEEDCLAW_HTTP_TIMEOUT_MS        10000   /* HTTP タイムアウト */
-#define SEEDCLAW_HTTP_BUF_SIZE          8192    /* HTTPレスポンスバッファ (Discord用) */
+#define SEEDCLAW_DISCORD_API_BASE       "https://discord.com/api/v10"
+#define SEEDCLAW_DISCORD_GATEWAY_URL    "wss://gateway.discord.gg/?v=10&encoding=json"
+#define SEEDCLAW_GATEWAY_FRAME_BUF      4096    /* Gatewayフレーム再組み立てバッファ */
+#define SEEDCLAW_GATEWAY_QUEUE_LEN      4       /* 受信メッセージキュー長 */
+#define SEEDCLAW_GATEWAY_TASK_STACK     6144
+#define SEEDCLAW_DISCORD_RL_MAX_ROUTES  4       /* レート制限を追跡するルート数 */
+#define SEEDCLAW_OUTBOX_LEN             8       /* Webhookアウトボックスの最大チャンク数 */
+#define SEEDCLAW_OUTBOX_MAX_ATTEMPTS    5       /* 通信エラー時の最大送信試行回数 */
+#define SEEDCLAW_OUTBOX_COALESCE_REMAINING 1    /* 今回の送信後の残量がこれ以下なら短文をまとめて投稿 */
+#define SEEDCLAW_OUTBOX_TASK_STACK      6144
+#define SEEDCLAW_OUTBOX_TASK_PRIO       4
+/* ローカルTLSスタブサーバーで検証する場合は自己署名証明書のPEMを定義する
+ * #define SEEDCLAW_DISCORD_TEST_CERT_PEM  "-----BEGIN CERTIFICATE-----\n..." */
 
 /* ── LLM ── */
 #define SEEDCLAW_LLM_DEFAULT_PROVIDER   "anthropic"
 #define SEEDCLAW_LLM_DEFAULT_MODEL      "claude-haiku-4-5-20251001"
 #define SEEDCLAW_LLM_MAX_TOKENS         1024
-#define SEEDCLAW_LLM_RESP_BUF_SIZE      8192    /* LLMレスポンスバッファ */
+#define SEEDCLAW_LLM_RESP_BUF_SIZE      8192    /* LLMテキスト応答バッファ */
+#define SEEDCLAW_LLM_SSE_LINE_MAX       2048    /* SSE 1行 (1イベント) の最大長 */
+#define SEEDCLAW_LLM_TOOL_INPUT_MAX     1024    /* tool_use入力JSONの最大長 */
+#define SEEDCLAW_LLM_IO_CHUNK           1024    /* リクエスト送信チャンク/応答読み取りの単位 */
 #define SEEDCLAW_LLM_TIMEOUT_MS         30000   /* LLM API タイムアウト */
+#define SEEDCLAW_LLM_IDLE_EVICT_MS      60000   /* この時間使われなかったセッションは破棄 */
 
 #define SEEDCLAW_ANTHROPIC_API_URL      "https://api.anthropic.com/v1/messages"
 #define SEEDCLAW_ANTHROPIC_VERSION      "2023-06-01"
@@ -44,6 +60,19 @@
 /* ── ReAct ── */
 #define SEEDCLAW_MAX_TOOL_CALLS         5       /* 1メッセージあたりの最大ツール呼び出し回数 */
 #define SEEDCLAW_MAX_HISTORY            3       /* 会話履歴の最大往復数 */
+#define SEEDCLAW_HISTORY_MAX_RECORDS    48      /* 履歴レコード数の上限（インデックスリング） */
+#define SEEDCLAW_HISTORY_ARENA_SIZE     8192    /* ユーザー会話履歴のアリーナ */
+#define SEEDCLAW_AUTO_HISTORY_ARENA_SIZE 4096   /* 自律監視用履歴のアリーナ */
+#define SEEDCLAW_HISTORY_TOKEN_BUDGET   3000    /* 1リクエストで送る履歴の入力トークン予算（見積もり） */
+#define SEEDCLAW_LOW_HEAP_THRESHOLD     40000   /* 空きヒープがこれ未満なら履歴予算を半分にする */
+
+/* ── 会話要約 ── */
+#define SEEDCLAW_SUMMARY_MODEL          "claude-haiku-4-5-20251001" /* 要約に使う安価なモデル */
+#define SEEDCLAW_SUMMARY_MAX_LEN        768     /* 要約の最大バイト数（NVSに保存） */
+#define SEEDCLAW_SUMMARY_PENDING_MAX    2048    /* 要約待ちの押し出された会話の最大バイト数 */
+#define SEEDCLAW_SUMMARY_MAX_TOKENS     400
+#define SEEDCLAW_SUMMARY_SNIPPET_MAX    160     /* ツール入出力は先頭だけ要約に回す */
+#define SEEDCLAW_SUMMARY_RETRY_MS       60000   /* 要約に失敗したら再試行まで待つ時間 */
 
 /* ── GPIO ── */
 #define SEEDCLAW_GPIO_ALLOWED_MASK      ((1ULL<<2)|(1ULL<<3)|(1ULL<<4)|(1ULL<<5)|\
@@ -51,16 +80,84 @@
                                          (1ULL<<20)|(1ULL<<21))
 #define SEEDCLAW_ADC_ALLOWED_MASK       ((1ULL<<2)|(1ULL<<3)|(1ULL<<4))
 #define SEEDCLAW_PWM_MAX_CHANNELS       6
+#define SEEDCLAW_PWM_FADE_MAX_MS        60000   /* pwm_fade の最大フェード時間 */
+#define SEEDCLAW_ADC_CONTINUOUS         1       /* 1: ADC連続モード(DMA)、0: oneshot のみ */
+#define SEEDCLAW_ADC_CONT_SAMPLE_HZ     20000   /* 連続モードの変換レート（スキャン中の全ピン合計） */
+#define SEEDCLAW_ADC_CONT_FRAME_BYTES   256     /* DMAフレーム長（4バイト/サンプル） */
+#define SEEDCLAW_ADC_CONT_MAX_FRAMES    8       /* 1回の読み取りで待つ最大フレーム数 */
+#define SEEDCLAW_ADC_CONT_READ_TIMEOUT_MS 50
+#define SEEDCLAW_ADC_OVERSAMPLE_DEFAULT 16      /* 1回の読み取りで平均するサンプル数 */
+#define SEEDCLAW_ADC_OVERSAMPLE_MAX     64
+#define SEEDCLAW_ADC_MULTI_MAX          3       /* ADC対応ピン数（adc_read_multi の上限） */
+#define SEEDCLAW_PULSE_MAX_COUNTERS     4       /* 同時に使えるパルスカウンタ数 */
+#define SEEDCLAW_PULSE_HISTORY_S        60      /* 直近レート用に1秒ごとの累計を残す秒数 */
+#define SEEDCLAW_FREQ_MAX_WINDOW_MS     5000    /* freq_measure の最大計測時間 */
+
+/* ── センサーサンプラー ── */
+#define SEEDCLAW_SAMPLER_MAX_CHANNELS   4       /* 同時に記録できるピン数 */
+#define SEEDCLAW_SAMPLER_RING_BYTES     1536    /* 1チャンネルの差分符号化リング（変化が小さければ約1500サンプル） */
+#define SEEDCLAW_SAMPLER_TICK_MS        1000    /* サンプリングタスクの刻み（周期はこの倍数） */
+#define SEEDCLAW_SAMPLER_LAST_MAX       10      /* sensor_history が返す生サンプルの最大数 */
+#define SEEDCLAW_SAMPLER_TASK_STACK     3072
+#define SEEDCLAW_SAMPLER_TASK_PRIO      2
+
+/* ── 制御ループ ── */
+#define SEEDCLAW_LOOP_MAX               4       /* 同時に回せるループ数（出力ピンごとに1つ） */
+#define SEEDCLAW_LOOP_TICK_MS           10      /* 制御タスクの刻み */
+#define SEEDCLAW_LOOP_MIN_PERIOD_MS     50      /* ADC読み取り（オーバーサンプリング込み）に余裕を持たせる */
+#define SEEDCLAW_LOOP_MAX_PERIOD_MS     60000
+#define SEEDCLAW_LOOP_DEFAULT_PERIOD_MS 200
+#define SEEDCLAW_LOOP_FAULT_READS       5       /* 連続でこの回数入力が読めなければ出力をOFFにする */
+#define SEEDCLAW_LOOP_TASK_STACK        3072
+#define SEEDCLAW_LOOP_TASK_PRIO         6       /* 制御周期を守るため他のタスクより高い */
+
+/* ── スケジューラ ── */
+#define SEEDCLAW_SNTP_SERVER            "pool.ntp.org"
+#define SEEDCLAW_TIMEZONE               "JST-9"  /* POSIX TZ。cron 式と時刻指定はこのローカル時刻 */
+#define SEEDCLAW_SCHED_MAX_JOBS         8
+#define SEEDCLAW_SCHED_LABEL_LEN        24
+#define SEEDCLAW_SCHED_CRON_LEN         32
+#define SEEDCLAW_SCHED_TOOL_LEN         20
+#define SEEDCLAW_SCHED_INPUT_LEN        128     /* ジョブが実行するツール入力 JSON */
+#define SEEDCLAW_SCHED_WHEEL_SLOTS      64      /* 1秒刻みのタイマーホイール（2の累乗） */
+#define SEEDCLAW_SCHED_GRACE_S          300     /* 停電などで過ぎた一回限りジョブをこの秒数までは実行 */
+#define SEEDCLAW_SCHED_MAX_DURATION_S   86400
+#define SEEDCLAW_SCHED_REPORT_SIZE      256
+#define SEEDCLAW_SCHED_TASK_STACK       4096
+#define SEEDCLAW_SCHED_TASK_PRIO        4
+
+/* ── GPIO入力監視（エッジ割り込み） ── */
+#define SEEDCLAW_WATCH_MAX_PINS         4
+#define SEEDCLAW_WATCH_LABEL_LEN        32      /* 通知に付けるピンの名前 */
+#define SEEDCLAW_WATCH_RING_LEN         32      /* ISR→タスクのエッジイベントリング（2の累乗） */
+#define SEEDCLAW_WATCH_DEBOUNCE_MS      30      /* この時間レベルが安定したらエッジとして確定 */
+#define SEEDCLAW_WATCH_REPORT_SIZE      512
+#define SEEDCLAW_WATCH_TASK_STACK       4096
+#define SEEDCLAW_WATCH_TASK_PRIO        5       /* 通知遅延を小さくするためワーカーより高い */
 
 /* ── 自律監視 ── */
 #define SEEDCLAW_MAX_RULES              5
 #define SEEDCLAW_MAX_RULE_LEN           256
 #define SEEDCLAW_AUTO_CHECK_INTERVAL_DEFAULT  10 /* ポーリング回数ごと */
+#define SEEDCLAW_RULE_COMPILE_MODEL     "claude-haiku-4-5-20251001" /* ルール変換に使うモデル */
+#define SEEDCLAW_RULE_COMPILE_MAX_TOKENS 300
+#define SEEDCLAW_RULE_COMPILE_OUT_SIZE  1024
+#define SEEDCLAW_RULE_COMPILE_ATTEMPTS  2       /* 通信エラー時の変換試行回数（超えたら LLM 評価） */
+#define SEEDCLAW_RULE_MSG_LEN           96      /* 変換済みルールの報告文テンプレート長 */
+#define SEEDCLAW_RULE_REPORT_SIZE       512     /* 1ティック分の報告の最大長 */
+#define SEEDCLAW_RULE_MAX_INPUTS        4       /* LLM評価ルール1つが参照するピンの最大数 */
+#define SEEDCLAW_GATE_DEADBAND_MV       50      /* 変化検出ゲートのADC不感帯の既定値 (mV) */
+#define SEEDCLAW_GATE_MAX_SKIPS         10      /* 変化がなくてもこの回数ごとに LLM で確認 */
 
 /* ── WiFi ── */
 #define SEEDCLAW_WIFI_MAX_RETRY         10
 #define SEEDCLAW_WIFI_CONNECT_TIMEOUT_MS 30000
 
+/* ── タスクパイプライン ── */
+#define SEEDCLAW_PIPELINE_WORK_QUEUE_LEN 4      /* LLMワーカーのジョブキュー長 */
+#define SEEDCLAW_WORKER_TASK_STACK      8192
+#define SEEDCLAW_WORKER_TASK_PRIO       3
+
 /* ── CLI ── */
 #define SEEDCLAW_CLI_STACK              4096
 #define SEEDCLAW_CLI_PRIO               3
@@ -82,4 +179,6 @@
 "- 「監視やめて」「止めて」→ rule_clear\n" \
 "- interval=3で約9秒ごと、10で約30秒ごと\n" \
 "\n" \
+"センサー履歴: 「さっきから」「最近の推移」など過去の値は sensor_history で記録を集計して答える\n" \
+"\n" \
 "簡潔に日本語で答えてください"
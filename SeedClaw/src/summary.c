@@ -0,0 +1,214 @@
+#include "summary.h"
+#include "seedclaw_config.h"
+#include "llm.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "summary";
+
+static char s_summary[SEEDCLAW_SUMMARY_MAX_LEN];
+static char s_pending[SEEDCLAW_SUMMARY_PENDING_MAX];
+static size_t s_pending_len = 0;
+static int64_t s_retry_after_us = 0;   // 失敗後はしばらく再試行しない
+static uint32_t s_generation = 0;      // summary_clear() のたびに進める
+static SemaphoreHandle_t s_summary_mutex = NULL;
+
+#define SUMMARY_SYSTEM_PROMPT \
+"あなたはIoTデバイスの会話ログを要約する係です。\n" \
+"既存の要約と、新たに古くなった会話を統合し、今後の会話に必要な事実だけを残した要約を作れ。\n" \
+"残すもの: 配線・ピン割り当て、接続機器、ユーザーの設定や好み、継続中の依頼。\n" \
+"捨てるもの: 挨拶、一時的なセンサー値、ツール呼び出しの詳細。\n" \
+"日本語の箇条書きで、要約本文だけを出力せよ。"
+
+static void lock(void)
+{
+    xSemaphoreTake(s_summary_mutex, portMAX_DELAY);
+}
+
+static void unlock(void)
+{
+    xSemaphoreGive(s_summary_mutex);
+}
+
+// UTF-8の文字境界で len バイト以内に収まる長さを返す
+static size_t utf8_fit(const char *s, size_t len)
+{
+    while (len > 0 && ((unsigned char)s[len] & 0xC0) == 0x80) {
+        len--;
+    }
+    return len;
+}
+
+// 要約待ちバッファに先頭 max_len バイトまで追記（溢れた分は捨てる）
+static void pending_append_n(const char *text, size_t max_len)
+{
+    size_t room = sizeof(s_pending) - 1 - s_pending_len;
+    size_t n = strlen(text);
+    if (n > max_len) {
+        n = max_len;
+    }
+    if (n > room) {
+        n = room;
+    }
+    if (n < strlen(text)) {
+        n = utf8_fit(text, n);
+    }
+    memcpy(s_pending + s_pending_len, text, n);
+    s_pending_len += n;
+    s_pending[s_pending_len] = '\0';
+}
+
+static void pending_append(const char *text)
+{
+    pending_append_n(text, SIZE_MAX);
+}
+
+static esp_err_t save_summary(void)
+{
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(SEEDCLAW_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK) return err;
+
+    err = nvs_set_str(nvs_handle, "summary", s_summary);
+    if (err == ESP_OK) {
+        nvs_commit(nvs_handle);
+    }
+    nvs_close(nvs_handle);
+    return err;
+}
+
+esp_err_t summary_init(void)
+{
+    s_summary_mutex = xSemaphoreCreateMutex();
+    if (s_summary_mutex == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(SEEDCLAW_NVS_NAMESPACE, NVS_READONLY, &nvs_handle);
+    if (err == ESP_OK) {
+        size_t len = sizeof(s_summary);
+        nvs_get_str(nvs_handle, "summary", s_summary, &len);
+        nvs_close(nvs_handle);
+    }
+    llm_set_memory(s_summary);
+    ESP_LOGI(TAG, "Summary loaded (%u bytes)", (unsigned)strlen(s_summary));
+    return ESP_OK;
+}
+
+void summary_on_evict(const history_entry_t *e, void *ctx)
+{
+    lock();
+    switch (e->kind) {
+        case HISTORY_USER_TEXT:
+            pending_append("ユーザー: ");
+            pending_append(e->content);
+            break;
+        case HISTORY_ASSISTANT_TEXT:
+            pending_append("アシスタント: ");
+            pending_append(e->content);
+            break;
+        case HISTORY_TOOL_USE:
+            pending_append("ツール ");
+            pending_append(e->tool_name);
+            pending_append(" ");
+            pending_append_n(e->content, SEEDCLAW_SUMMARY_SNIPPET_MAX);
+            break;
+        case HISTORY_TOOL_RESULT:
+            pending_append("結果: ");
+            pending_append_n(e->content, SEEDCLAW_SUMMARY_SNIPPET_MAX);
+            break;
+    }
+    pending_append("\n");
+    unlock();
+}
+
+bool summary_pending(void)
+{
+    lock();
+    bool pending = s_pending_len > 0 && esp_timer_get_time() >= s_retry_after_us;
+    unlock();
+    return pending;
+}
+
+esp_err_t summary_compact(void)
+{
+    lock();
+    if (s_pending_len == 0) {
+        unlock();
+        return ESP_OK;
+    }
+
+    size_t prompt_size = sizeof(s_summary) + s_pending_len + 128;
+    char *prompt = malloc(prompt_size);
+    char *out = malloc(SEEDCLAW_SUMMARY_MAX_TOKENS * 4);
+    if (prompt == NULL || out == NULL) {
+        unlock();
+        free(prompt);
+        free(out);
+        return ESP_ERR_NO_MEM;
+    }
+    snprintf(prompt, prompt_size,
+             "既存の要約:\n%s\n\n新たに古くなった会話:\n%s\n\n%d バイト以内で要約せよ。",
+             s_summary[0] ? s_summary : "（なし）", s_pending, SEEDCLAW_SUMMARY_MAX_LEN - 1);
+    size_t consumed = s_pending_len;
+    uint32_t generation = s_generation;
+    unlock();
+
+    // LLM呼び出しの間はロックを放す（CLIの memory clear を待たせない）
+    esp_err_t err = llm_complete(SEEDCLAW_SUMMARY_MODEL, SUMMARY_SYSTEM_PROMPT, prompt,
+                                 SEEDCLAW_SUMMARY_MAX_TOKENS, out, SEEDCLAW_SUMMARY_MAX_TOKENS * 4);
+    free(prompt);
+
+    lock();
+    if (generation != s_generation) {
+        // 要約中に消去された。消す前の会話から作った要約は捨てる
+        ESP_LOGI(TAG, "Summary cleared during compaction, result discarded");
+        err = ESP_OK;
+    } else if (err == ESP_OK) {
+        size_t len = strlen(out);
+        if (len >= sizeof(s_summary)) {
+            len = utf8_fit(out, sizeof(s_summary) - 1);
+        }
+        memcpy(s_summary, out, len);
+        s_summary[len] = '\0';
+        // 要約に使った分だけ取り除く
+        memmove(s_pending, s_pending + consumed, s_pending_len - consumed + 1);
+        s_pending_len -= consumed;
+        llm_set_memory(s_summary);
+        save_summary();
+        ESP_LOGI(TAG, "Summary updated (%u bytes)", (unsigned)len);
+    } else {
+        // 要約待ちは残し、間を空けてから再試行する
+        ESP_LOGW(TAG, "Summary compaction failed: %s", esp_err_to_name(err));
+        s_retry_after_us = esp_timer_get_time() + (int64_t)SEEDCLAW_SUMMARY_RETRY_MS * 1000;
+    }
+    unlock();
+    free(out);
+    return err;
+}
+
+const char *summary_get(void)
+{
+    return s_summary;
+}
+
+esp_err_t summary_clear(void)
+{
+    lock();
+    s_generation++;
+    s_summary[0] = '\0';
+    s_pending_len = 0;
+    s_pending[0] = '\0';
+    llm_set_memory(s_summary);
+    esp_err_t err = save_summary();
+    unlock();
+    return err;
+}
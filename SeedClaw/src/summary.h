@@ -0,0 +1,46 @@
+#pragma once
+
+#include "esp_err.h"
+#include "history.h"
+#include <stdbool.h>
+
+/*
+ * 会話要約メモリ
+ *
+ * 履歴から押し出された往復をいったん要約待ちバッファに溜め、LLMワーカーが
+ * 空いたときに安価なモデルで既存の要約へ畳み込む。要約は長さの上限付きで
+ * NVSに保存し、システムプロンプトの後ろに付けて送る。履歴は予算内に保たれるので、
+ * 会話が長く続いてもリクエストごとの入力トークンは増えない。
+ */
+
+/**
+ * @brief NVSから要約を読み込み、LLMのシステムプロンプトに反映
+ */
+esp_err_t summary_init(void);
+
+/**
+ * @brief 押し出されたレコードを要約待ちに追加（history_evict_cb_t として登録する）
+ */
+void summary_on_evict(const history_entry_t *e, void *ctx);
+
+/**
+ * @brief 要約待ちの会話があるか
+ */
+bool summary_pending(void);
+
+/**
+ * @brief 要約待ちの会話を既存の要約に畳み込み、NVSに保存
+ * LLM呼び出しを伴うので LLMワーカーの手が空いているときに呼ぶ。
+ */
+esp_err_t summary_compact(void);
+
+/**
+ * @brief 現在の要約（空文字列なら未作成）
+ */
+const char *summary_get(void);
+
+/**
+ * @brief 要約と要約待ちの会話を消去（NVSからも削除）
+ * 実行中の summary_compact() とは排他され、その結果は捨てられる。
+ */
+esp_err_t summary_clear(void);
@@ -2,6 +2,14 @@
 #include "seedclaw_config.h"
 #include "llm.h"
 #include "gpio_ctrl.h"
+#include "history.h"
+#include "summary.h"
+#include "fastpath.h"
+#include "rules.h"
+#include "sampler.h"
+#include "gpio_watch.h"
+#include "control_loop.h"
+#include "scheduler.h"
 #include "esp_log.h"
 #include "esp_http_client.h"
 #include "esp_crt_bundle.h"
@@ -9,17 +17,11 @@
 #include "nvs.h"
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
 
 static const char *TAG = "tools";
 
-// null終端を保証する安全な文字列コピー
-static void safe_strncpy(char *dest, const char *src, size_t dest_size)
-{
-    if (dest_size == 0) return;
-    strncpy(dest, src, dest_size - 1);
-    dest[dest_size - 1] = '\0';
-}
-
 // ツール定義JSON
 static const char *TOOLS_JSON =
 "["
@@ -46,6 +48,35 @@ static const char *TOOLS_JSON =
       "\"required\":[\"pin\",\"value\"]"
     "}"
   "},"
+  "{"
+    "\"name\":\"gpio_write_multi\","
+    "\"description\":\"複数のGPIOピンに同時に出力する（1回のレジスタ書き込みで同じ瞬間に切り替わる）。2つ以上のピンを操作するときはgpio_writeを繰り返さずこれを使う。\","
+    "\"input_schema\":{"
+      "\"type\":\"object\","
+      "\"properties\":{"
+        "\"writes\":{\"type\":\"array\",\"items\":{"
+          "\"type\":\"object\","
+          "\"properties\":{"
+            "\"pin\":{\"type\":\"integer\"},"
+            "\"value\":{\"type\":\"integer\",\"enum\":[0,1]}"
+          "},"
+          "\"required\":[\"pin\",\"value\"]"
+        "},\"description\":\"書き込むピンと値の一覧\"}"
+      "},"
+      "\"required\":[\"writes\"]"
+    "}"
+  "},"
+  "{"
+    "\"name\":\"gpio_read_multi\","
+    "\"description\":\"複数のGPIOピンのデジタル値を同じ瞬間に読み取る。\","
+    "\"input_schema\":{"
+      "\"type\":\"object\","
+      "\"properties\":{"
+        "\"pins\":{\"type\":\"array\",\"items\":{\"type\":\"integer\"},\"description\":\"GPIOピン番号の一覧\"}"
+      "},"
+      "\"required\":[\"pins\"]"
+    "}"
+  "},"
   "{"
     "\"name\":\"adc_read\","
     "\"description\":\"GPIOピンのアナログ値を読み取る (0-4095)。温度、光、距離などのアナログセンサーに使う。使用可能ピン: D0/A0=GPIO2, D1/A1=GPIO3, D2/A2=GPIO4。\","
@@ -57,6 +88,17 @@ static const char *TOOLS_JSON =
       "\"required\":[\"pin\"]"
     "}"
   "},"
+  "{"
+    "\"name\":\"adc_read_multi\","
+    "\"description\":\"複数のアナログピンを同時に読み取る。2つ以上のADCピンを読むときはadc_readを繰り返さずこれを使う。\","
+    "\"input_schema\":{"
+      "\"type\":\"object\","
+      "\"properties\":{"
+        "\"pins\":{\"type\":\"array\",\"items\":{\"type\":\"integer\"},\"description\":\"ADC対応GPIOピン番号 (2,3,4)。省略時は全て\"}"
+      "},"
+      "\"required\":[]"
+    "}"
+  "},"
   "{"
     "\"name\":\"pwm_set\","
     "\"description\":\"GPIOピンにPWM信号を出力する。LEDの明るさ調整やモーターの速度制御に使う。duty=0で停止、duty=100で全開。\","
@@ -70,6 +112,20 @@ static const char *TOOLS_JSON =
       "\"required\":[\"pin\",\"duty\"]"
     "}"
   "},"
+  "{"
+    "\"name\":\"pwm_fade\","
+    "\"description\":\"PWMのデューティを現在値から目標値へハードウェアで滑らかに変化させる。LEDのフェードイン/アウトに使う。呼び出しはすぐ戻り、フェードはバックグラウンドで進む。異なる周波数は同時に最大4つまで。\","
+    "\"input_schema\":{"
+      "\"type\":\"object\","
+      "\"properties\":{"
+        "\"pin\":{\"type\":\"integer\",\"description\":\"GPIOピン番号\"},"
+        "\"duty\":{\"type\":\"integer\",\"description\":\"目標デューティ比 0-100(%)\"},"
+        "\"duration_ms\":{\"type\":\"integer\",\"description\":\"フェード時間(ms)。最大60000\"},"
+        "\"freq\":{\"type\":\"integer\",\"description\":\"PWM周波数(Hz)。省略時は現在の周波数\"}"
+      "},"
+      "\"required\":[\"pin\",\"duty\",\"duration_ms\"]"
+    "}"
+  "},"
   "{"
     "\"name\":\"gpio_status\","
     "\"description\":\"設定済み全GPIOピンの現在状態を取得する。\","
@@ -141,243 +197,290 @@ static const char *TOOLS_JSON =
       "\"properties\":{},"
       "\"required\":[]"
     "}"
+  "},"
+  "{"
+    "\"name\":\"pulse_count\","
+    "\"description\":\"パルス（エッジ）をバックグラウンドで数える。流量計、風速計、ファンのタコメータなどに使う。start で開始し、read で累計と平均/直近のレートを取得。\","
+    "\"input_schema\":{"
+      "\"type\":\"object\","
+      "\"properties\":{"
+        "\"pin\":{\"type\":\"integer\",\"description\":\"GPIOピン番号\"},"
+        "\"action\":{\"type\":\"string\",\"enum\":[\"start\",\"read\",\"reset\",\"stop\"]},"
+        "\"edge\":{\"type\":\"string\",\"enum\":[\"rising\",\"falling\",\"both\"],\"description\":\"start時に数えるエッジ（省略時rising）\"},"
+        "\"pull\":{\"type\":\"string\",\"enum\":[\"up\",\"down\",\"none\"],\"description\":\"start時の内部プル抵抗（オープンコレクタ出力はup）\"},"
+        "\"glitch_us\":{\"type\":\"integer\",\"description\":\"start時、直前のエッジからこの時間(us)未満のエッジを無視（リードスイッチのチャタリング対策）\"}"
+      "},"
+      "\"required\":[\"pin\",\"action\"]"
+    "}"
+  "},"
+  "{"
+    "\"name\":\"freq_measure\","
+    "\"description\":\"ピンの信号の周波数を端末上で測定する（window_msの間エッジを数える）。\","
+    "\"input_schema\":{"
+      "\"type\":\"object\","
+      "\"properties\":{"
+        "\"pin\":{\"type\":\"integer\",\"description\":\"GPIOピン番号\"},"
+        "\"window_ms\":{\"type\":\"integer\",\"description\":\"計測時間 (10-5000ms、省略時1000)\"}"
+      "},"
+      "\"required\":[\"pin\"]"
+    "}"
+  "},"
+  "{"
+    "\"name\":\"gpio_watch\","
+    "\"description\":\"入力ピンのエッジ（ボタン押下など）を割り込みで監視し、変化したら即座にDiscordへ通知する（LLMは使わない）。「ボタンが押されたら教えて」に使う。edge=offで解除。\","
+    "\"input_schema\":{"
+      "\"type\":\"object\","
+      "\"properties\":{"
+        "\"pin\":{\"type\":\"integer\",\"description\":\"GPIOピン番号\"},"
+        "\"edge\":{\"type\":\"string\",\"enum\":[\"rising\",\"falling\",\"both\",\"off\"],\"description\":\"通知するエッジ (rising=LOW→HIGH, falling=HIGH→LOW)\"},"
+        "\"pull\":{\"type\":\"string\",\"enum\":[\"up\",\"down\",\"none\"],\"description\":\"内部プル抵抗（省略時none。GNDに落とすボタンはup+falling）\"},"
+        "\"label\":{\"type\":\"string\",\"description\":\"通知に使う名前（例: 玄関ボタン）\"}"
+      "},"
+      "\"required\":[\"pin\",\"edge\"]"
+    "}"
+  "},"
+  "{"
+    "\"name\":\"sensor_history\","
+    "\"description\":\"バックグラウンドで記録しているピンの値の履歴を端末上で集計して返す（min/max/mean/直近の値）。読み取りに失敗した周期は集計に含めず missed に数える（直近の値では null）。過去の推移や平均はadc_readを繰り返さずこれを使う。\","
+    "\"input_schema\":{"
+      "\"type\":\"object\","
+      "\"properties\":{"
+        "\"pin\":{\"type\":\"integer\",\"description\":\"GPIO番号\"},"
+        "\"seconds\":{\"type\":\"integer\",\"description\":\"直近何秒を集計するか（省略で記録全体）\"},"
+        "\"last_n\":{\"type\":\"integer\",\"description\":\"新しい順に返す生サンプル数 (0-10、省略時5)\"}"
+      "},"
+      "\"required\":[\"pin\"]"
+    "}"
+  "},"
+  "{"
+    "\"name\":\"loop_set\","
+    "\"description\":\"ADC入力とPWM/GPIO出力を結ぶ制御ループを端末上で回す（温度・明るさの一定制御など）。設定後は自動で制御され、監視やpwm_setでの調整は不要。出力ピンごとに1つ、最大4つ。mode=offで解除して出力をOFF。\","
+    "\"input_schema\":{"
+      "\"type\":\"object\","
+      "\"properties\":{"
+        "\"output_pin\":{\"type\":\"integer\",\"description\":\"出力GPIO番号\"},"
+        "\"mode\":{\"type\":\"string\",\"enum\":[\"pid\",\"hysteresis\",\"off\"],\"description\":\"pid=PWMを連続調整, hysteresis=目標±band/2でON/OFF\"},"
+        "\"input_pin\":{\"type\":\"integer\",\"description\":\"入力ADCピン (GPIO 2-4)\"},"
+        "\"setpoint_mv\":{\"type\":\"integer\",\"description\":\"目標の入力電圧(mV)\"},"
+        "\"output\":{\"type\":\"string\",\"enum\":[\"pwm\",\"gpio\"],\"description\":\"出力の種類（pidはpwmのみ、省略時pwm）\"},"
+        "\"reverse\":{\"type\":\"boolean\",\"description\":\"出力を上げると入力が下がる場合true（冷却ファンなど）\"},"
+        "\"band_mv\":{\"type\":\"integer\",\"description\":\"hysteresisの幅(mV)\"},"
+        "\"kp\":{\"type\":\"number\",\"description\":\"比例ゲイン (%/mV)\"},"
+        "\"ki\":{\"type\":\"number\",\"description\":\"積分ゲイン (%/(mV·s))\"},"
+        "\"kd\":{\"type\":\"number\",\"description\":\"微分ゲイン (%·s/mV)\"},"
+        "\"out_min\":{\"type\":\"integer\",\"description\":\"PWMの下限(%)。省略時0\"},"
+        "\"out_max\":{\"type\":\"integer\",\"description\":\"PWMの上限(%)。省略時100\"},"
+        "\"period_ms\":{\"type\":\"integer\",\"description\":\"制御周期(ms, 50-60000)。省略時200\"},"
+        "\"freq\":{\"type\":\"integer\",\"description\":\"PWM周波数(Hz)。省略時1000\"}"
+      "},"
+      "\"required\":[\"output_pin\",\"mode\"]"
+    "}"
+  "},"
+  "{"
+    "\"name\":\"loop_status\","
+    "\"description\":\"制御ループの設定と現在の状態（入力値、誤差、出力、故障）を返す。\","
+    "\"input_schema\":{"
+      "\"type\":\"object\","
+      "\"properties\":{},"
+      "\"required\":[]"
+    "}"
+  "},"
+  "{"
+    "\"name\":\"schedule_add\","
+    "\"description\":\"決まった時刻や繰り返しでツールを端末上で実行するジョブを登録する（例: 毎日7:00にポンプを10分ON）。登録後はLLMなしで実行される。監視ルールで時刻を扱わずこれを使う。実行できるツール: gpio_write, gpio_write_multi, pwm_set, pwm_fade, loop_set。cron/at/in_sのどれか1つを指定。\","
+    "\"input_schema\":{"
+      "\"type\":\"object\","
+      "\"properties\":{"
+        "\"tool\":{\"type\":\"string\",\"description\":\"実行するツール名\"},"
+        "\"input\":{\"type\":\"object\",\"description\":\"ツールの入力（例: {\\\"pin\\\":5,\\\"value\\\":1}）\"},"
+        "\"cron\":{\"type\":\"string\",\"description\":\"繰り返し: cron式 '分 時 日 月 曜日'（ローカル時刻、例 '0 7 * * *' = 毎日7:00、'30 18 * * 1-5' = 平日18:30）\"},"
+        "\"at\":{\"type\":\"string\",\"description\":\"一回限り: 'YYYY-MM-DD HH:MM' または 'HH:MM'（次に来るその時刻）\"},"
+        "\"in_s\":{\"type\":\"integer\",\"description\":\"一回限り: 今から何秒後\"},"
+        "\"duration_s\":{\"type\":\"integer\",\"description\":\"開始から何秒後に終了動作を実行するか。gpio_write/pwm_set/pwm_fade/loop_setはOFFが自動で決まる\"},"
+        "\"end_tool\":{\"type\":\"string\",\"description\":\"終了動作のツール（省略時は自動）\"},"
+        "\"end_input\":{\"type\":\"object\",\"description\":\"終了動作のツール入力\"},"
+        "\"label\":{\"type\":\"string\",\"description\":\"通知に使う名前（例: 朝の水やり）\"}"
+      "},"
+      "\"required\":[\"tool\",\"input\"]"
+    "}"
+  "},"
+  "{"
+    "\"name\":\"schedule_list\","
+    "\"description\":\"登録済みのスケジュールジョブと次の実行時刻を返す。\","
+    "\"input_schema\":{"
+      "\"type\":\"object\","
+      "\"properties\":{},"
+      "\"required\":[]"
+    "}"
+  "},"
+  "{"
+    "\"name\":\"schedule_remove\","
+    "\"description\":\"スケジュールジョブを削除する。実行中（duration中）なら終了動作をすぐ実行する。\","
+    "\"input_schema\":{"
+      "\"type\":\"object\","
+      "\"properties\":{"
+        "\"id\":{\"type\":\"integer\",\"description\":\"ジョブID\"}"
+      "},"
+      "\"required\":[\"id\"]"
+    "}"
   "}"
 "]";
 
-// 会話履歴
-typedef struct {
-    char role[16];         // "user", "assistant"
-    char content[1024];    // メッセージ内容 or JSON
-    char tool_use_id[48];  // Anthropic tool_use ID（余裕を持たせる）
-    char tool_name[24];    // ツール名（set_auto_interval=17）
-    bool is_tool_use;
-    bool is_tool_result;
-} history_entry_t;
-
-static history_entry_t s_history[SEEDCLAW_MAX_HISTORY * 2 + 6];
-static int s_history_count = 0;
-
-// ── 監視ルール ──
-static char s_rules[SEEDCLAW_MAX_RULES][SEEDCLAW_MAX_RULE_LEN];
-static int s_rules_count = 0;
-static int s_auto_interval = 0;  // 0 = 無効
-
-int rules_count(void)
-{
-    return s_rules_count;
-}
+// 会話履歴（ユーザー会話と自律監視で別々に持つ）
+static history_t s_chat_history;
+static history_t s_auto_history;
+static int s_last_sent_records = 0;
+static size_t s_last_sent_tokens = 0;
 
-esp_err_t rules_add(const char *rule_text)
+// messages 配列に書き出す範囲（トークン予算で決めた末尾）
+typedef struct {
+    const history_t *h;
+    int start;
+} messages_ctx_t;
+
+// 自律チェックで禁止するツール（ルールは設定済みなので再設定させない）
+static const char *const AUTO_DENIED_TOOLS[] = {
+    "rule_add", "rule_remove", "rule_clear", "set_auto_interval", "get_rules",
+};
+// 自律チェックで使えるツール名の一覧（TOOLS_JSON から生成するので追加漏れがない）
+static char s_auto_tools[512];
+
+static void build_auto_tool_list(void)
 {
-    if (s_rules_count >= SEEDCLAW_MAX_RULES) {
-        return ESP_ERR_NO_MEM;
+    size_t off = 0;
+    s_auto_tools[0] = '\0';
+    const char *p = TOOLS_JSON;
+    while ((p = strstr(p, "\"name\":\"")) != NULL) {
+        p += strlen("\"name\":\"");
+        const char *end = strchr(p, '"');
+        if (end == NULL) {
+            break;
+        }
+        int len = (int)(end - p);
+        bool denied = false;
+        for (size_t i = 0; i < sizeof(AUTO_DENIED_TOOLS) / sizeof(AUTO_DENIED_TOOLS[0]); i++) {
+            if ((int)strlen(AUTO_DENIED_TOOLS[i]) == len && strncmp(p, AUTO_DENIED_TOOLS[i], len) == 0) {
+                denied = true;
+                break;
+            }
+        }
+        if (!denied && off + len + 3 < sizeof(s_auto_tools)) {
+            off += snprintf(s_auto_tools + off, sizeof(s_auto_tools) - off, "%s%.*s",
+                            off > 0 ? ", " : "", len, p);
+        }
+        p = end;
     }
-    strncpy(s_rules[s_rules_count], rule_text, SEEDCLAW_MAX_RULE_LEN - 1);
-    s_rules[s_rules_count][SEEDCLAW_MAX_RULE_LEN - 1] = '\0';
-    s_rules_count++;
-    return ESP_OK;
 }
 
-esp_err_t rules_remove(int index)
+void tools_init(void)
 {
-    if (index < 0 || index >= s_rules_count) {
-        return ESP_ERR_INVALID_ARG;
-    }
-    for (int i = index; i < s_rules_count - 1; i++) {
-        memcpy(s_rules[i], s_rules[i + 1], SEEDCLAW_MAX_RULE_LEN);
-    }
-    s_rules_count--;
-    if (s_rules_count == 0) {
-        s_auto_interval = 0;
-    }
-    return ESP_OK;
+    history_init(&s_chat_history, SEEDCLAW_HISTORY_ARENA_SIZE);
+    history_init(&s_auto_history, SEEDCLAW_AUTO_HISTORY_ARENA_SIZE);
+    // ユーザー会話から押し出された往復は要約に畳み込む
+    history_set_evict_hook(&s_chat_history, summary_on_evict, NULL);
+    rules_init();
+    llm_set_tools(TOOLS_JSON);
+    build_auto_tool_list();
+    ESP_LOGI(TAG, "Tools initialized");
 }
 
-void rules_list(void)
+static void add_user_message(history_t *h, const char *content)
 {
-    if (s_rules_count == 0) {
-        printf("No monitoring rules defined.\n");
-        return;
+    while (history_exchanges(h) >= SEEDCLAW_MAX_HISTORY) {
+        history_drop_oldest_exchange(h);
     }
-    for (int i = 0; i < s_rules_count; i++) {
-        printf("  [%d] %s\n", i, s_rules[i]);
+    // トークン予算に入らなくなった古い往復も押し出す（要約側に移る）
+    while (history_suffix_start(h, SEEDCLAW_HISTORY_TOKEN_BUDGET, NULL) > 0) {
+        history_drop_oldest_exchange(h);
     }
+    history_sanitize(h);
+    history_append(h, HISTORY_USER_TEXT, NULL, NULL, content);
 }
 
-void rules_clear(void)
-{
-    s_rules_count = 0;
-    s_auto_interval = 0;
-    memset(s_rules, 0, sizeof(s_rules));
-}
-
-int auto_interval_get(void)
+// 履歴を messages 配列としてリクエスト本文に直接書き込む（llm_messages_writer_t）
+static void write_messages(llm_writer_t *w, void *writer_ctx)
 {
-    return s_auto_interval;
-}
-
-void auto_interval_set(int interval)
-{
-    s_auto_interval = interval;
-}
-
-void tools_init(void)
-{
-    s_history_count = 0;
-    s_rules_count = 0;
-    s_auto_interval = 0;
-    ESP_LOGI(TAG, "Tools initialized");
-}
-
-// tool_use/tool_resultペアの整合性を検証し、孤立エントリを除去
-static void sanitize_history(void)
-{
-    // 1. 全tool_use IDを収集
-    // 2. 対応するIDがないtool_resultを除去
-    // 3. 対応するtool_resultがないtool_useも除去
-    // 4. 先頭がuserテキストになるまで除去
-
-    bool changed = true;
-    while (changed) {
-        changed = false;
-
-        for (int i = 0; i < s_history_count; i++) {
-            if (s_history[i].is_tool_result) {
-                // このtool_resultに対応するtool_useがあるか？
-                bool found = false;
-                for (int j = 0; j < i; j++) {
-                    if (s_history[j].is_tool_use &&
-                        strcmp(s_history[j].tool_use_id, s_history[i].tool_use_id) == 0) {
-                        found = true;
-                        break;
-                    }
+    const messages_ctx_t *ctx = (const messages_ctx_t *)writer_ctx;
+    const history_t *h = ctx->h;
+    int n = history_count(h);
+    int i = ctx->start;
+    bool first = true;
+
+    llm_writer_lit(w, "[");
+    while (i < n) {
+        history_entry_t e;
+        if (!history_get(h, i, &e)) {
+            i++;
+            continue;
+        }
+        if (!first) {
+            llm_writer_lit(w, ",");
+        }
+        first = false;
+
+        if (e.kind == HISTORY_TOOL_USE || e.kind == HISTORY_TOOL_RESULT) {
+            // 連続するtool_use / tool_resultを1メッセージにマージ
+            history_kind_t run = e.kind;
+            bool first_block = true;
+            if (run == HISTORY_TOOL_USE) {
+                llm_writer_lit(w, "{\"role\":\"assistant\",\"content\":[");
+            } else {
+                llm_writer_lit(w, "{\"role\":\"user\",\"content\":[");
+            }
+            for (; i < n; i++) {
+                if (!history_get(h, i, &e)) {
+                    continue;
                 }
-                if (!found) {
-                    memmove(&s_history[i], &s_history[i + 1],
-                            sizeof(history_entry_t) * (s_history_count - i - 1));
-                    s_history_count--;
-                    changed = true;
+                if (e.kind != run) {
                     break;
                 }
-            } else if (s_history[i].is_tool_use) {
-                // このtool_useに対応するtool_resultがあるか？
-                bool found = false;
-                for (int j = i + 1; j < s_history_count; j++) {
-                    if (s_history[j].is_tool_result &&
-                        strcmp(s_history[j].tool_use_id, s_history[i].tool_use_id) == 0) {
-                        found = true;
-                        break;
-                    }
+                if (!first_block) {
+                    llm_writer_lit(w, ",");
                 }
-                if (!found) {
-                    memmove(&s_history[i], &s_history[i + 1],
-                            sizeof(history_entry_t) * (s_history_count - i - 1));
-                    s_history_count--;
-                    changed = true;
-                    break;
+                first_block = false;
+                if (run == HISTORY_TOOL_USE) {
+                    llm_writer_lit(w, "{\"type\":\"tool_use\",\"id\":");
+                    llm_writer_str(w, e.tool_use_id);
+                    llm_writer_lit(w, ",\"name\":");
+                    llm_writer_str(w, e.tool_name);
+                    // 入力JSONは履歴に追加する時点で検証済み
+                    llm_writer_lit(w, ",\"input\":");
+                    llm_writer_raw(w, e.content, strlen(e.content));
+                } else {
+                    llm_writer_lit(w, "{\"type\":\"tool_result\",\"tool_use_id\":");
+                    llm_writer_str(w, e.tool_use_id);
+                    llm_writer_lit(w, ",\"content\":");
+                    llm_writer_str(w, e.content);
+                    // {"error":...} の結果は失敗としてLLMに伝える
+                    if (strncmp(e.content, "{\"error\":", 9) == 0) {
+                        llm_writer_lit(w, ",\"is_error\":true");
+                    }
                 }
+                llm_writer_lit(w, "}");
             }
-        }
-    }
-
-    // 先頭がuserテキストになるまで除去
-    while (s_history_count > 0 &&
-           (s_history[0].is_tool_result || s_history[0].is_tool_use ||
-            strcmp(s_history[0].role, "user") != 0)) {
-        memmove(&s_history[0], &s_history[1],
-                sizeof(history_entry_t) * (s_history_count - 1));
-        s_history_count--;
-    }
-}
-
-static void trim_history_safe(int need_slots)
-{
-    int max_entries = SEEDCLAW_MAX_HISTORY * 2 + 6;
-    while (s_history_count + need_slots > max_entries && s_history_count > 0) {
-        int trim = (s_history_count >= 2) ? 2 : 1;
-        memmove(&s_history[0], &s_history[trim],
-                sizeof(history_entry_t) * (s_history_count - trim));
-        s_history_count -= trim;
-    }
-    sanitize_history();
-}
-
-static void add_user_message(const char *content)
-{
-    trim_history_safe(1);
-
-    memset(&s_history[s_history_count], 0, sizeof(history_entry_t));
-    strcpy(s_history[s_history_count].role, "user");
-    safe_strncpy(s_history[s_history_count].content, content, sizeof(s_history[0].content));
-    s_history_count++;
-}
-
-static void add_assistant_text(const char *text)
-{
-    trim_history_safe(1);
-
-    memset(&s_history[s_history_count], 0, sizeof(history_entry_t));
-    strcpy(s_history[s_history_count].role, "assistant");
-    safe_strncpy(s_history[s_history_count].content, text, sizeof(s_history[0].content));
-    s_history_count++;
-}
-
-static char *build_messages_json(void)
-{
-    cJSON *messages = cJSON_CreateArray();
-    int i = 0;
-
-    while (i < s_history_count) {
-        if (s_history[i].is_tool_use) {
-            // 連続するassistant tool_useを1メッセージにマージ
-            cJSON *msg = cJSON_CreateObject();
-            cJSON_AddStringToObject(msg, "role", "assistant");
-            cJSON *content_array = cJSON_CreateArray();
-
-            while (i < s_history_count && s_history[i].is_tool_use) {
-                cJSON *tool_use = cJSON_CreateObject();
-                cJSON_AddStringToObject(tool_use, "type", "tool_use");
-                cJSON_AddStringToObject(tool_use, "id", s_history[i].tool_use_id);
-                cJSON_AddStringToObject(tool_use, "name", s_history[i].tool_name);
-                cJSON *input = cJSON_Parse(s_history[i].content);
-                if (input == NULL) input = cJSON_CreateObject();
-                cJSON_AddItemToObject(tool_use, "input", input);
-                cJSON_AddItemToArray(content_array, tool_use);
-                i++;
-            }
-
-            cJSON_AddItemToObject(msg, "content", content_array);
-            cJSON_AddItemToArray(messages, msg);
-        } else if (s_history[i].is_tool_result) {
-            // 連続するuser tool_resultを1メッセージにマージ
-            cJSON *msg = cJSON_CreateObject();
-            cJSON_AddStringToObject(msg, "role", "user");
-            cJSON *content_array = cJSON_CreateArray();
-
-            while (i < s_history_count && s_history[i].is_tool_result) {
-                cJSON *tool_result = cJSON_CreateObject();
-                cJSON_AddStringToObject(tool_result, "type", "tool_result");
-                cJSON_AddStringToObject(tool_result, "tool_use_id", s_history[i].tool_use_id);
-                cJSON_AddStringToObject(tool_result, "content", s_history[i].content);
-                cJSON_AddItemToArray(content_array, tool_result);
-                i++;
-            }
-
-            cJSON_AddItemToObject(msg, "content", content_array);
-            cJSON_AddItemToArray(messages, msg);
+            llm_writer_lit(w, "]}");
         } else {
             // 通常のテキスト
-            cJSON *msg = cJSON_CreateObject();
-            cJSON_AddStringToObject(msg, "role", s_history[i].role);
-            cJSON_AddStringToObject(msg, "content", s_history[i].content);
-            cJSON_AddItemToArray(messages, msg);
+            if (e.kind == HISTORY_USER_TEXT) {
+                llm_writer_lit(w, "{\"role\":\"user\",\"content\":");
+            } else {
+                llm_writer_lit(w, "{\"role\":\"assistant\",\"content\":");
+            }
+            llm_writer_str(w, e.content);
+            llm_writer_lit(w, "}");
             i++;
         }
     }
+    llm_writer_lit(w, "]");
+}
 
-    char *json_str = cJSON_PrintUnformatted(messages);
-    cJSON_Delete(messages);
-    return json_str;
+// tool_use入力が履歴にそのまま書けるJSONオブジェクトか（不正なら false）
+static bool is_json_object(const char *json)
+{
+    cJSON *obj = cJSON_Parse(json);
+    bool ok = cJSON_IsObject(obj);
+    cJSON_Delete(obj);
+    return ok;
 }
 
 // 不正なUTF-8バイトを '?' に置換（Claude APIがstrict UTF-8を要求するため）
@@ -409,6 +512,68 @@ static void sanitize_utf8(char *buf)
     }
 }
 
+// duration_s 付きジョブの終了動作（OFF）を開始動作から決める
+static bool derive_end_action(const char *tool, const cJSON *input, sched_job_t *job)
+{
+    cJSON *end = NULL;
+    const cJSON *pin = cJSON_GetObjectItem(input, "pin");
+    if (strcmp(tool, "gpio_write") == 0 && cJSON_IsNumber(pin)) {
+        end = cJSON_CreateObject();
+        cJSON_AddNumberToObject(end, "pin", pin->valueint);
+        cJSON_AddNumberToObject(end, "value", 0);
+        strcpy(job->end_tool, "gpio_write");
+    } else if ((strcmp(tool, "pwm_set") == 0 || strcmp(tool, "pwm_fade") == 0) && cJSON_IsNumber(pin)) {
+        end = cJSON_CreateObject();
+        cJSON_AddNumberToObject(end, "pin", pin->valueint);
+        cJSON_AddNumberToObject(end, "duty", 0);
+        strcpy(job->end_tool, "pwm_set");
+    } else if (strcmp(tool, "loop_set") == 0 && cJSON_IsNumber(cJSON_GetObjectItem(input, "output_pin"))) {
+        end = cJSON_CreateObject();
+        cJSON_AddNumberToObject(end, "output_pin", cJSON_GetObjectItem(input, "output_pin")->valueint);
+        cJSON_AddStringToObject(end, "mode", "off");
+        strcpy(job->end_tool, "loop_set");
+    } else {
+        return false;
+    }
+    char *text = cJSON_PrintUnformatted(end);
+    cJSON_Delete(end);
+    if (text == NULL) {
+        return false;
+    }
+    bool fits = strlen(text) < sizeof(job->end_input);
+    if (fits) {
+        strcpy(job->end_input, text);
+    }
+    free(text);
+    return fits;
+}
+
+// cJSON オブジェクトを固定長バッファに書き出す（収まらなければ false）
+static bool print_json_to(const cJSON *obj, char *dst, size_t size)
+{
+    char *text = cJSON_PrintUnformatted(obj);
+    if (text == NULL) {
+        return false;
+    }
+    bool fits = strlen(text) < size;
+    if (fits) {
+        strcpy(dst, text);
+    }
+    free(text);
+    return fits;
+}
+
+static void format_local_time(int64_t t, char *buf, size_t size)
+{
+    time_t tt = (time_t)t;
+    struct tm tm;
+    localtime_r(&tt, &tm);
+    strftime(buf, size, "%Y-%m-%d %H:%M", &tm);
+}
+
+// gpio_watch が監視中のピンを駆動しようとしたときのエラー
+#define WATCHED_PIN_ERROR "Pin is watched by gpio_watch (gpio_watch edge 'off' first)"
+
 static char *execute_tool(const char *name, const char *input_json)
 {
     cJSON *input = cJSON_Parse(input_json);
@@ -444,6 +609,9 @@ static char *execute_tool(const char *name, const char *input_json)
         cJSON *value_obj = cJSON_GetObjectItem(input, "value");
         if (pin_obj == NULL || value_obj == NULL || !cJSON_IsNumber(pin_obj) || !cJSON_IsNumber(value_obj)) {
             cJSON_AddStringToObject(result, "error", "Missing or invalid 'pin' or 'value' parameter");
+        } else if (control_loop_owns(pin_obj->valueint)) {
+            cJSON_AddStringToObject(result, "error",
+                "Pin is driven by a control loop (loop_set mode=off first)");
         } else {
             int pin = pin_obj->valueint;
             int value = value_obj->valueint;
@@ -453,12 +621,97 @@ static char *execute_tool(const char *name, const char *input_json)
                 cJSON_AddNumberToObject(result, "value", value);
                 cJSON_AddStringToObject(result, "state", value ? "HIGH" : "LOW");
                 cJSON_AddBoolToObject(result, "ok", true);
+            } else if (err == ESP_ERR_INVALID_STATE) {
+                cJSON_AddStringToObject(result, "error", WATCHED_PIN_ERROR);
             } else {
                 char error_msg[100];
                 snprintf(error_msg, sizeof(error_msg), "Failed to write GPIO%d", pin);
                 cJSON_AddStringToObject(result, "error", error_msg);
             }
         }
+    } else if (strcmp(name, "gpio_write_multi") == 0) {
+        cJSON *writes = cJSON_GetObjectItem(input, "writes");
+        uint32_t mask = 0;
+        uint32_t values = 0;
+        esp_err_t err;
+        bool valid = cJSON_IsArray(writes) && cJSON_GetArraySize(writes) > 0;
+        cJSON *item;
+        cJSON_ArrayForEach(item, writes) {
+            cJSON *pin_obj = cJSON_GetObjectItem(item, "pin");
+            cJSON *value_obj = cJSON_GetObjectItem(item, "value");
+            if (!cJSON_IsNumber(pin_obj) || !cJSON_IsNumber(value_obj) ||
+                !gpio_is_pin_allowed(pin_obj->valueint) ||
+                (value_obj->valueint != 0 && value_obj->valueint != 1)) {
+                valid = false;
+                break;
+            }
+            mask |= 1UL << pin_obj->valueint;
+            if (value_obj->valueint) {
+                values |= 1UL << pin_obj->valueint;
+            } else {
+                values &= ~(1UL << pin_obj->valueint);
+            }
+        }
+        int owned = -1;
+        for (int pin = 0; valid && pin < 22; pin++) {
+            if ((mask & (1UL << pin)) && control_loop_owns(pin)) {
+                owned = pin;
+                break;
+            }
+        }
+        if (!valid) {
+            cJSON_AddStringToObject(result, "error", "Invalid 'writes' (each needs an allowed 'pin' and 'value' 0/1)");
+        } else if (owned >= 0) {
+            char error_msg[100];
+            snprintf(error_msg, sizeof(error_msg),
+                     "GPIO%d is driven by a control loop (loop_set mode=off first)", owned);
+            cJSON_AddStringToObject(result, "error", error_msg);
+        } else if ((err = gpio_ctrl_write_multi(mask, values)) == ESP_ERR_INVALID_STATE) {
+            cJSON_AddStringToObject(result, "error", WATCHED_PIN_ERROR);
+        } else if (err != ESP_OK) {
+            cJSON_AddStringToObject(result, "error", "Failed to write GPIOs");
+        } else {
+            cJSON *states = cJSON_CreateArray();
+            for (int pin = 0; pin < 22; pin++) {
+                if (mask & (1UL << pin)) {
+                    cJSON *st = cJSON_CreateObject();
+                    cJSON_AddNumberToObject(st, "pin", pin);
+                    cJSON_AddStringToObject(st, "state", (values >> pin) & 1 ? "HIGH" : "LOW");
+                    cJSON_AddItemToArray(states, st);
+                }
+            }
+            cJSON_AddItemToObject(result, "pins", states);
+            cJSON_AddBoolToObject(result, "ok", true);
+        }
+    } else if (strcmp(name, "gpio_read_multi") == 0) {
+        cJSON *pins = cJSON_GetObjectItem(input, "pins");
+        uint32_t mask = 0;
+        bool valid = cJSON_IsArray(pins) && cJSON_GetArraySize(pins) > 0;
+        cJSON *item;
+        cJSON_ArrayForEach(item, pins) {
+            if (!cJSON_IsNumber(item) || !gpio_is_pin_allowed(item->valueint)) {
+                valid = false;
+                break;
+            }
+            mask |= 1UL << item->valueint;
+        }
+        uint32_t values = 0;
+        if (!valid) {
+            cJSON_AddStringToObject(result, "error", "Invalid 'pins' (allowed GPIO numbers only)");
+        } else if (gpio_ctrl_read_multi(mask, &values) != ESP_OK) {
+            cJSON_AddStringToObject(result, "error", "Failed to read GPIOs");
+        } else {
+            cJSON *readings = cJSON_CreateArray();
+            for (int pin = 0; pin < 22; pin++) {
+                if (mask & (1UL << pin)) {
+                    cJSON *r = cJSON_CreateObject();
+                    cJSON_AddNumberToObject(r, "pin", pin);
+                    cJSON_AddNumberToObject(r, "value", (values >> pin) & 1);
+                    cJSON_AddItemToArray(readings, r);
+                }
+            }
+            cJSON_AddItemToObject(result, "readings", readings);
+        }
     } else if (strcmp(name, "adc_read") == 0) {
         cJSON *pin_obj = cJSON_GetObjectItem(input, "pin");
         if (pin_obj == NULL || !cJSON_IsNumber(pin_obj)) {
@@ -478,12 +731,55 @@ static char *execute_tool(const char *name, const char *input_json)
                 cJSON_AddStringToObject(result, "error", error_msg);
             }
         }
+    } else if (strcmp(name, "adc_read_multi") == 0) {
+        int pins[SEEDCLAW_ADC_MULTI_MAX];
+        int n = 0;
+        cJSON *pins_obj = cJSON_GetObjectItem(input, "pins");
+        if (cJSON_IsArray(pins_obj) && cJSON_GetArraySize(pins_obj) > 0) {
+            cJSON *item;
+            cJSON_ArrayForEach(item, pins_obj) {
+                if (!cJSON_IsNumber(item) || n >= SEEDCLAW_ADC_MULTI_MAX) {
+                    n = -1;
+                    break;
+                }
+                pins[n++] = item->valueint;
+            }
+        } else {
+            for (int pin = 0; pin < 22 && n < SEEDCLAW_ADC_MULTI_MAX; pin++) {
+                if (gpio_is_adc_allowed(pin)) {
+                    pins[n++] = pin;
+                }
+            }
+        }
+
+        adc_result_t adc_results[SEEDCLAW_ADC_MULTI_MAX];
+        int samples = 0;
+        if (n <= 0) {
+            cJSON_AddStringToObject(result, "error", "Invalid 'pins' (up to 3 of GPIO 2, 3, 4)");
+        } else if (gpio_ctrl_adc_read_multi(pins, n, adc_results, &samples) != ESP_OK) {
+            cJSON_AddStringToObject(result, "error", "Failed to read ADC (not an ADC pin or error)");
+        } else {
+            cJSON *readings = cJSON_CreateArray();
+            for (int i = 0; i < n; i++) {
+                cJSON *r = cJSON_CreateObject();
+                cJSON_AddNumberToObject(r, "pin", pins[i]);
+                cJSON_AddNumberToObject(r, "raw", adc_results[i].raw);
+                cJSON_AddNumberToObject(r, "voltage_mv", adc_results[i].voltage_mv);
+                cJSON_AddNumberToObject(r, "percentage", adc_results[i].percentage);
+                cJSON_AddItemToArray(readings, r);
+            }
+            cJSON_AddItemToObject(result, "readings", readings);
+            cJSON_AddNumberToObject(result, "samples_averaged", samples);
+        }
     } else if (strcmp(name, "pwm_set") == 0) {
         cJSON *pin_obj = cJSON_GetObjectItem(input, "pin");
         cJSON *duty_obj = cJSON_GetObjectItem(input, "duty");
         cJSON *freq_obj = cJSON_GetObjectItem(input, "freq");
         if (pin_obj == NULL || duty_obj == NULL || !cJSON_IsNumber(pin_obj) || !cJSON_IsNumber(duty_obj)) {
             cJSON_AddStringToObject(result, "error", "Missing or invalid 'pin' or 'duty' parameter");
+        } else if (control_loop_owns(pin_obj->valueint)) {
+            cJSON_AddStringToObject(result, "error",
+                "Pin is driven by a control loop (loop_set mode=off first)");
         } else {
             int pin = pin_obj->valueint;
             int duty = duty_obj->valueint;
@@ -494,9 +790,46 @@ static char *execute_tool(const char *name, const char *input_json)
                 cJSON_AddNumberToObject(result, "duty", duty);
                 cJSON_AddNumberToObject(result, "freq", freq);
                 cJSON_AddBoolToObject(result, "ok", true);
+            } else {
+                char error_msg[128];
+                if (err == ESP_ERR_NOT_SUPPORTED) {
+                    snprintf(error_msg, sizeof(error_msg),
+                             "No free PWM timer for %dHz on GPIO%d (max 4 distinct frequencies)", freq, pin);
+                } else if (err == ESP_ERR_INVALID_STATE) {
+                    snprintf(error_msg, sizeof(error_msg), "%s", WATCHED_PIN_ERROR);
+                } else {
+                    snprintf(error_msg, sizeof(error_msg), "Failed to set PWM on GPIO%d", pin);
+                }
+                cJSON_AddStringToObject(result, "error", error_msg);
+            }
+        }
+    } else if (strcmp(name, "pwm_fade") == 0) {
+        cJSON *pin_obj = cJSON_GetObjectItem(input, "pin");
+        cJSON *duty_obj = cJSON_GetObjectItem(input, "duty");
+        cJSON *ms_obj = cJSON_GetObjectItem(input, "duration_ms");
+        cJSON *freq_obj = cJSON_GetObjectItem(input, "freq");
+        if (!cJSON_IsNumber(pin_obj) || !cJSON_IsNumber(duty_obj) || !cJSON_IsNumber(ms_obj)) {
+            cJSON_AddStringToObject(result, "error", "Missing or invalid 'pin', 'duty' or 'duration_ms' parameter");
+        } else if (control_loop_owns(pin_obj->valueint)) {
+            cJSON_AddStringToObject(result, "error",
+                "Pin is driven by a control loop (loop_set mode=off first)");
+        } else {
+            int pin = pin_obj->valueint;
+            int duty = duty_obj->valueint;
+            int ms = ms_obj->valueint;
+            int freq = cJSON_IsNumber(freq_obj) ? freq_obj->valueint : 0;
+            esp_err_t err = gpio_ctrl_pwm_fade(pin, duty, ms, freq);
+            if (err == ESP_OK) {
+                cJSON_AddNumberToObject(result, "pin", pin);
+                cJSON_AddNumberToObject(result, "duty", duty);
+                cJSON_AddNumberToObject(result, "duration_ms", ms);
+                cJSON_AddBoolToObject(result, "ok", true);
+            } else if (err == ESP_ERR_INVALID_STATE) {
+                cJSON_AddStringToObject(result, "error", WATCHED_PIN_ERROR);
             } else {
                 char error_msg[100];
-                snprintf(error_msg, sizeof(error_msg), "Failed to set PWM on GPIO%d", pin);
+                snprintf(error_msg, sizeof(error_msg), "Failed to fade PWM on GPIO%d: %s",
+                         pin, esp_err_to_name(err));
                 cJSON_AddStringToObject(result, "error", error_msg);
             }
         }
@@ -578,8 +911,8 @@ static char *execute_tool(const char *name, const char *input_json)
             esp_err_t err = rules_add(text_obj->valuestring);
             if (err == ESP_OK) {
                 cJSON_AddBoolToObject(result, "ok", true);
-                cJSON_AddNumberToObject(result, "total_rules", s_rules_count);
-                cJSON_AddNumberToObject(result, "auto_interval", s_auto_interval);
+                cJSON_AddNumberToObject(result, "total_rules", rules_count());
+                cJSON_AddNumberToObject(result, "auto_interval", auto_interval_get());
             } else {
                 char msg[80];
                 snprintf(msg, sizeof(msg), "Max rules reached (%d)", SEEDCLAW_MAX_RULES);
@@ -594,7 +927,7 @@ static char *execute_tool(const char *name, const char *input_json)
             esp_err_t err = rules_remove(idx_obj->valueint);
             if (err == ESP_OK) {
                 cJSON_AddBoolToObject(result, "ok", true);
-                cJSON_AddNumberToObject(result, "remaining_rules", s_rules_count);
+                cJSON_AddNumberToObject(result, "remaining_rules", rules_count());
             } else {
                 cJSON_AddStringToObject(result, "error", "Invalid rule index");
             }
@@ -619,12 +952,399 @@ static char *execute_tool(const char *name, const char *input_json)
         }
     } else if (strcmp(name, "get_rules") == 0) {
         cJSON *rules_arr = cJSON_CreateArray();
-        for (int ri = 0; ri < s_rules_count; ri++) {
-            cJSON_AddItemToArray(rules_arr, cJSON_CreateString(s_rules[ri]));
+        char rule_text[SEEDCLAW_MAX_RULE_LEN];
+        for (int ri = 0; rules_get(ri, rule_text, sizeof(rule_text)) != RULE_NONE; ri++) {
+            cJSON_AddItemToArray(rules_arr, cJSON_CreateString(rule_text));
         }
         cJSON_AddItemToObject(result, "rules", rules_arr);
-        cJSON_AddNumberToObject(result, "total_rules", s_rules_count);
-        cJSON_AddNumberToObject(result, "auto_interval", s_auto_interval);
+        cJSON_AddNumberToObject(result, "total_rules", rules_count());
+        cJSON_AddNumberToObject(result, "auto_interval", auto_interval_get());
+    } else if (strcmp(name, "pulse_count") == 0) {
+        cJSON *pin_obj = cJSON_GetObjectItem(input, "pin");
+        const char *action = cJSON_GetStringValue(cJSON_GetObjectItem(input, "action"));
+        if (pin_obj == NULL || !cJSON_IsNumber(pin_obj) || action == NULL) {
+            cJSON_AddStringToObject(result, "error", "Missing 'pin' or 'action' parameter");
+        } else {
+            int pin = pin_obj->valueint;
+            esp_err_t err = ESP_ERR_INVALID_ARG;
+            if (strcmp(action, "start") == 0) {
+                const char *edge_str = cJSON_GetStringValue(cJSON_GetObjectItem(input, "edge"));
+                const char *pull_str = cJSON_GetStringValue(cJSON_GetObjectItem(input, "pull"));
+                cJSON *glitch_obj = cJSON_GetObjectItem(input, "glitch_us");
+                pulse_edge_t edge = PULSE_EDGE_RISING;
+                if (edge_str != NULL && strcmp(edge_str, "falling") == 0) {
+                    edge = PULSE_EDGE_FALLING;
+                } else if (edge_str != NULL && strcmp(edge_str, "both") == 0) {
+                    edge = PULSE_EDGE_BOTH;
+                }
+                gpio_ctrl_pull_t pull = GPIO_CTRL_PULL_NONE;
+                if (pull_str != NULL && strcmp(pull_str, "up") == 0) {
+                    pull = GPIO_CTRL_PULL_UP;
+                } else if (pull_str != NULL && strcmp(pull_str, "down") == 0) {
+                    pull = GPIO_CTRL_PULL_DOWN;
+                }
+                uint32_t glitch_us = cJSON_IsNumber(glitch_obj) && glitch_obj->valueint > 0 ?
+                                     (uint32_t)glitch_obj->valueint : 0;
+                err = gpio_ctrl_pulse_start(pin, edge, pull, glitch_us);
+            } else if (strcmp(action, "reset") == 0) {
+                err = gpio_ctrl_pulse_reset(pin);
+            } else if (strcmp(action, "stop") == 0) {
+                err = gpio_ctrl_pulse_stop(pin);
+            } else if (strcmp(action, "read") == 0) {
+                err = ESP_OK;
+            }
+
+            pulse_stats_t ps;
+            if (err == ESP_OK && strcmp(action, "stop") != 0 && gpio_ctrl_pulse_read(pin, &ps) == ESP_OK) {
+                cJSON_AddNumberToObject(result, "pin", pin);
+                cJSON_AddNumberToObject(result, "count", ps.count);
+                cJSON_AddNumberToObject(result, "elapsed_s", ps.elapsed_ms / 1000.0);
+                cJSON_AddNumberToObject(result, "rate_avg_per_s", ps.rate_avg);
+                cJSON_AddNumberToObject(result, "rate_10s_per_s", ps.rate_10s);
+                cJSON_AddNumberToObject(result, "rate_60s_per_s", ps.rate_60s);
+                if (ps.since_last_edge_ms != UINT32_MAX) {
+                    cJSON_AddNumberToObject(result, "since_last_edge_ms", ps.since_last_edge_ms);
+                }
+            } else if (err == ESP_OK && strcmp(action, "stop") == 0) {
+                cJSON_AddBoolToObject(result, "ok", true);
+            } else if (err == ESP_ERR_NO_MEM) {
+                cJSON_AddStringToObject(result, "error", "No free pulse counters");
+            } else if (err == ESP_ERR_INVALID_STATE) {
+                cJSON_AddStringToObject(result, "error", "Pin is an output or watched by gpio_watch");
+            } else if (strcmp(action, "start") == 0 || err == ESP_ERR_INVALID_ARG) {
+                cJSON_AddStringToObject(result, "error", "Invalid pin or action");
+            } else {
+                cJSON_AddStringToObject(result, "error", "Pin is not counting (use action 'start')");
+            }
+        }
+    } else if (strcmp(name, "freq_measure") == 0) {
+        cJSON *pin_obj = cJSON_GetObjectItem(input, "pin");
+        cJSON *window_obj = cJSON_GetObjectItem(input, "window_ms");
+        if (pin_obj == NULL || !cJSON_IsNumber(pin_obj)) {
+            cJSON_AddStringToObject(result, "error", "Missing 'pin' parameter");
+        } else {
+            int window_ms = cJSON_IsNumber(window_obj) ? window_obj->valueint : 1000;
+            freq_result_t fr;
+            esp_err_t err = gpio_ctrl_freq_measure(pin_obj->valueint, window_ms, &fr);
+            if (err == ESP_OK) {
+                cJSON_AddNumberToObject(result, "pin", pin_obj->valueint);
+                cJSON_AddNumberToObject(result, "hz", fr.hz);
+                cJSON_AddNumberToObject(result, "edges", fr.edges);
+                cJSON_AddNumberToObject(result, "window_ms", fr.window_ms);
+                if (fr.period_us > 0) {
+                    cJSON_AddNumberToObject(result, "period_us", fr.period_us);
+                }
+            } else if (err == ESP_ERR_INVALID_STATE) {
+                cJSON_AddStringToObject(result, "error", "Pin is an output or watched by gpio_watch");
+            } else {
+                cJSON_AddStringToObject(result, "error", "Failed to measure (invalid pin or window 10-5000ms)");
+            }
+        }
+    } else if (strcmp(name, "gpio_watch") == 0) {
+        cJSON *pin_obj = cJSON_GetObjectItem(input, "pin");
+        const char *edge_str = cJSON_GetStringValue(cJSON_GetObjectItem(input, "edge"));
+        const char *pull_str = cJSON_GetStringValue(cJSON_GetObjectItem(input, "pull"));
+        const char *label = cJSON_GetStringValue(cJSON_GetObjectItem(input, "label"));
+        if (pin_obj == NULL || !cJSON_IsNumber(pin_obj) || edge_str == NULL) {
+            cJSON_AddStringToObject(result, "error", "Missing 'pin' or 'edge' parameter");
+        } else if (strcmp(edge_str, "off") == 0) {
+            if (gpio_watch_remove(pin_obj->valueint) == ESP_OK) {
+                cJSON_AddBoolToObject(result, "ok", true);
+                cJSON_AddStringToObject(result, "message", "Watch removed");
+            } else {
+                cJSON_AddStringToObject(result, "error", "Pin is not being watched");
+            }
+        } else {
+            watch_edge_t edge = strcmp(edge_str, "rising") == 0 ? WATCH_EDGE_RISING :
+                                strcmp(edge_str, "falling") == 0 ? WATCH_EDGE_FALLING :
+                                strcmp(edge_str, "both") == 0 ? WATCH_EDGE_BOTH : 0;
+            gpio_ctrl_pull_t pull = GPIO_CTRL_PULL_NONE;
+            if (pull_str != NULL && strcmp(pull_str, "up") == 0) {
+                pull = GPIO_CTRL_PULL_UP;
+            } else if (pull_str != NULL && strcmp(pull_str, "down") == 0) {
+                pull = GPIO_CTRL_PULL_DOWN;
+            }
+            esp_err_t err = gpio_watch_add(pin_obj->valueint, edge, pull, label);
+            if (err == ESP_OK) {
+                cJSON_AddBoolToObject(result, "ok", true);
+                cJSON_AddNumberToObject(result, "pin", pin_obj->valueint);
+                cJSON_AddStringToObject(result, "edge", edge_str);
+                cJSON_AddStringToObject(result, "message", "Edges will be reported to Discord immediately");
+            } else if (err == ESP_ERR_NO_MEM) {
+                cJSON_AddStringToObject(result, "error", "Too many watched pins");
+            } else if (err == ESP_ERR_INVALID_STATE) {
+                cJSON_AddStringToObject(result, "error", "Pin is an output or used by pulse_count");
+            } else {
+                cJSON_AddStringToObject(result, "error", "Invalid pin or edge");
+            }
+        }
+    } else if (strcmp(name, "sensor_history") == 0) {
+        cJSON *pin_obj = cJSON_GetObjectItem(input, "pin");
+        cJSON *sec_obj = cJSON_GetObjectItem(input, "seconds");
+        cJSON *last_obj = cJSON_GetObjectItem(input, "last_n");
+        if (pin_obj == NULL || !cJSON_IsNumber(pin_obj)) {
+            cJSON_AddStringToObject(result, "error", "Missing 'pin' parameter");
+        } else {
+            int seconds = cJSON_IsNumber(sec_obj) ? sec_obj->valueint : 0;
+            int last_n = cJSON_IsNumber(last_obj) ? last_obj->valueint : 5;
+            sampler_summary_t sum;
+            esp_err_t err = sampler_summarize(pin_obj->valueint, seconds, last_n, &sum);
+            if (err == ESP_OK) {
+                cJSON_AddNumberToObject(result, "pin", sum.pin);
+                cJSON_AddStringToObject(result, "unit", sum.kind == SAMPLER_ADC_MV ? "mV" : "level");
+                cJSON_AddNumberToObject(result, "period_s", sum.period_s);
+                cJSON_AddNumberToObject(result, "samples", sum.samples);
+                if (sum.missed > 0) {
+                    cJSON_AddNumberToObject(result, "missed", sum.missed);
+                }
+                cJSON_AddNumberToObject(result, "window_s", sum.window_s);
+                cJSON_AddNumberToObject(result, "min", sum.min);
+                cJSON_AddNumberToObject(result, "max", sum.max);
+                cJSON_AddNumberToObject(result, "mean", sum.mean);
+                cJSON *last_arr = cJSON_CreateArray();
+                for (int k = 0; k < sum.last_count; k++) {
+                    cJSON_AddItemToArray(last_arr, sum.last_missed[k] ? cJSON_CreateNull()
+                                                                      : cJSON_CreateNumber(sum.last[k]));
+                }
+                cJSON_AddItemToObject(result, "last_newest_first", last_arr);
+                cJSON_AddNumberToObject(result, "age_s", sum.age_s);
+            } else if (err == ESP_ERR_INVALID_STATE) {
+                cJSON_AddStringToObject(result, "error", "No readable samples in the window (pin read failed or nothing recorded yet)");
+            } else {
+                cJSON_AddStringToObject(result, "error", "Pin is not being sampled (configure with CLI 'sample')");
+                sampler_channel_info_t info[SEEDCLAW_SAMPLER_MAX_CHANNELS];
+                int n = sampler_list(info, SEEDCLAW_SAMPLER_MAX_CHANNELS);
+                cJSON *pins = cJSON_CreateArray();
+                for (int k = 0; k < n; k++) {
+                    cJSON_AddItemToArray(pins, cJSON_CreateNumber(info[k].pin));
+                }
+                cJSON_AddItemToObject(result, "sampled_pins", pins);
+            }
+        }
+    } else if (strcmp(name, "loop_set") == 0) {
+        cJSON *out_obj = cJSON_GetObjectItem(input, "output_pin");
+        const char *mode = cJSON_GetStringValue(cJSON_GetObjectItem(input, "mode"));
+        if (!cJSON_IsNumber(out_obj) || mode == NULL) {
+            cJSON_AddStringToObject(result, "error", "Missing 'output_pin' or 'mode' parameter");
+        } else if (strcmp(mode, "off") == 0) {
+            if (control_loop_remove(out_obj->valueint) == ESP_OK) {
+                cJSON_AddBoolToObject(result, "ok", true);
+            } else {
+                cJSON_AddStringToObject(result, "error", "No loop on that output pin");
+            }
+        } else if (strcmp(mode, "pid") != 0 && strcmp(mode, "hysteresis") != 0) {
+            cJSON_AddStringToObject(result, "error", "mode must be 'pid', 'hysteresis' or 'off'");
+        } else {
+            loop_config_t cfg;
+            control_loop_defaults(&cfg);
+            cfg.out_pin = out_obj->valueint;
+            cfg.mode = strcmp(mode, "pid") == 0 ? LOOP_PID : LOOP_HYSTERESIS;
+            const char *output = cJSON_GetStringValue(cJSON_GetObjectItem(input, "output"));
+            if (output != NULL && strcmp(output, "gpio") == 0) {
+                cfg.output = LOOP_OUT_GPIO;
+            }
+            cfg.reverse = cJSON_IsTrue(cJSON_GetObjectItem(input, "reverse"));
+
+            cJSON *v;
+            if (cJSON_IsNumber(v = cJSON_GetObjectItem(input, "input_pin"))) cfg.in_pin = v->valueint;
+            if (cJSON_IsNumber(v = cJSON_GetObjectItem(input, "setpoint_mv"))) cfg.setpoint_mv = v->valueint;
+            if (cJSON_IsNumber(v = cJSON_GetObjectItem(input, "band_mv"))) cfg.band_mv = v->valueint;
+            if (cJSON_IsNumber(v = cJSON_GetObjectItem(input, "kp"))) cfg.kp = (float)v->valuedouble;
+            if (cJSON_IsNumber(v = cJSON_GetObjectItem(input, "ki"))) cfg.ki = (float)v->valuedouble;
+            if (cJSON_IsNumber(v = cJSON_GetObjectItem(input, "kd"))) cfg.kd = (float)v->valuedouble;
+            if (cJSON_IsNumber(v = cJSON_GetObjectItem(input, "out_min"))) cfg.out_min = v->valueint;
+            if (cJSON_IsNumber(v = cJSON_GetObjectItem(input, "out_max"))) cfg.out_max = v->valueint;
+            if (cJSON_IsNumber(v = cJSON_GetObjectItem(input, "period_ms"))) cfg.period_ms = v->valueint;
+            if (cJSON_IsNumber(v = cJSON_GetObjectItem(input, "freq"))) cfg.pwm_freq = v->valueint;
+
+            esp_err_t err = control_loop_set(&cfg);
+            if (err == ESP_OK) {
+                cJSON_AddNumberToObject(result, "output_pin", cfg.out_pin);
+                cJSON_AddNumberToObject(result, "input_pin", cfg.in_pin);
+                cJSON_AddStringToObject(result, "mode", mode);
+                cJSON_AddNumberToObject(result, "period_ms", cfg.period_ms);
+                cJSON_AddBoolToObject(result, "ok", true);
+            } else if (err == ESP_ERR_NO_MEM) {
+                cJSON_AddStringToObject(result, "error", "All loops are in use");
+            } else if (err == ESP_ERR_INVALID_STATE) {
+                cJSON_AddStringToObject(result, "error", WATCHED_PIN_ERROR);
+            } else {
+                cJSON_AddStringToObject(result, "error",
+                    "Invalid loop (input must be ADC GPIO 2-4, pid needs pwm output, period 50-60000ms, out_min < out_max)");
+            }
+        }
+    } else if (strcmp(name, "loop_status") == 0) {
+        loop_status_t st[SEEDCLAW_LOOP_MAX];
+        int n = control_loop_list(st, SEEDCLAW_LOOP_MAX);
+        cJSON *loops = cJSON_CreateArray();
+        for (int i = 0; i < n; i++) {
+            const loop_config_t *c = &st[i].cfg;
+            cJSON *l = cJSON_CreateObject();
+            cJSON_AddNumberToObject(l, "output_pin", c->out_pin);
+            cJSON_AddNumberToObject(l, "input_pin", c->in_pin);
+            cJSON_AddStringToObject(l, "mode", c->mode == LOOP_PID ? "pid" : "hysteresis");
+            cJSON_AddStringToObject(l, "output", c->output == LOOP_OUT_PWM ? "pwm" : "gpio");
+            cJSON_AddNumberToObject(l, "setpoint_mv", c->setpoint_mv);
+            if (c->mode == LOOP_PID) {
+                cJSON_AddNumberToObject(l, "kp", c->kp);
+                cJSON_AddNumberToObject(l, "ki", c->ki);
+                cJSON_AddNumberToObject(l, "kd", c->kd);
+                cJSON_AddNumberToObject(l, "integral", st[i].integral);
+            } else {
+                cJSON_AddNumberToObject(l, "band_mv", c->band_mv);
+            }
+            cJSON_AddNumberToObject(l, "pv_mv", st[i].pv_mv);
+            cJSON_AddNumberToObject(l, "error_mv", st[i].error_mv);
+            cJSON_AddNumberToObject(l, "output_value", st[i].output);
+            cJSON_AddNumberToObject(l, "period_ms", c->period_ms);
+            cJSON_AddNumberToObject(l, "iterations", st[i].iterations);
+            cJSON_AddNumberToObject(l, "age_ms", st[i].age_ms);
+            if (st[i].fault) {
+                cJSON_AddBoolToObject(l, "fault", true);
+            }
+            cJSON_AddItemToArray(loops, l);
+        }
+        cJSON_AddItemToObject(result, "loops", loops);
+    } else if (strcmp(name, "schedule_add") == 0) {
+        const char *tool = cJSON_GetStringValue(cJSON_GetObjectItem(input, "tool"));
+        cJSON *tool_input = cJSON_GetObjectItem(input, "input");
+        const char *cron = cJSON_GetStringValue(cJSON_GetObjectItem(input, "cron"));
+        const char *at = cJSON_GetStringValue(cJSON_GetObjectItem(input, "at"));
+        cJSON *in_obj = cJSON_GetObjectItem(input, "in_s");
+        cJSON *dur_obj = cJSON_GetObjectItem(input, "duration_s");
+        const char *end_tool = cJSON_GetStringValue(cJSON_GetObjectItem(input, "end_tool"));
+        cJSON *end_input = cJSON_GetObjectItem(input, "end_input");
+        const char *label = cJSON_GetStringValue(cJSON_GetObjectItem(input, "label"));
+
+        sched_job_t job;
+        memset(&job, 0, sizeof(job));
+        const char *error = NULL;
+        if (tool == NULL || !cJSON_IsObject(tool_input)) {
+            error = "Missing 'tool' or 'input' parameter";
+        } else if (!scheduler_tool_allowed(tool)) {
+            error = "Tool cannot be scheduled (allowed: gpio_write, gpio_write_multi, pwm_set, pwm_fade, loop_set)";
+        } else if (strlen(tool) >= sizeof(job.tool) || !print_json_to(tool_input, job.input, sizeof(job.input))) {
+            error = "Tool input is too long";
+        } else if (cron != NULL) {
+            job.kind = SCHED_CRON;
+            strncpy(job.cron, cron, sizeof(job.cron) - 1);
+        } else if (at != NULL || cJSON_IsNumber(in_obj)) {
+            job.kind = SCHED_ONCE;
+            if (!scheduler_time_synced()) {
+                error = "Clock is not synced yet (SNTP)";
+            } else if (at != NULL) {
+                if (scheduler_parse_at(at, &job.at) != ESP_OK) {
+                    error = "Invalid 'at' (use 'YYYY-MM-DD HH:MM' or 'HH:MM' in the future)";
+                }
+            } else if (in_obj->valueint <= 0) {
+                error = "'in_s' must be positive";
+            } else {
+                job.at = (int64_t)time(NULL) + in_obj->valueint;
+            }
+        } else {
+            error = "Specify one of 'cron', 'at' or 'in_s'";
+        }
+
+        if (error == NULL) {
+            strcpy(job.tool, tool);
+            if (label != NULL) {
+                strncpy(job.label, label, sizeof(job.label) - 1);
+            }
+            if (cJSON_IsNumber(dur_obj) && dur_obj->valueint > 0) {
+                job.duration_s = (uint32_t)dur_obj->valueint;
+                if (end_tool != NULL && cJSON_IsObject(end_input)) {
+                    if (strlen(end_tool) >= sizeof(job.end_tool) ||
+                        !print_json_to(end_input, job.end_input, sizeof(job.end_input))) {
+                        error = "End action is too long";
+                    } else {
+                        strcpy(job.end_tool, end_tool);
+                    }
+                } else if (!derive_end_action(tool, tool_input, &job)) {
+                    error = "Cannot infer the end action; give 'end_tool' and 'end_input'";
+                }
+            }
+        }
+
+        int id = 0;
+        esp_err_t err = error == NULL ? scheduler_add(&job, &id) : ESP_FAIL;
+        if (error != NULL) {
+            cJSON_AddStringToObject(result, "error", error);
+        } else if (err == ESP_ERR_NO_MEM) {
+            cJSON_AddStringToObject(result, "error", "All schedule slots are in use");
+        } else if (err != ESP_OK) {
+            cJSON_AddStringToObject(result, "error", "Invalid schedule (check cron expression, duration and tool inputs)");
+        } else {
+            cJSON_AddNumberToObject(result, "id", id);
+            if (job.kind == SCHED_ONCE) {
+                char when[24];
+                format_local_time(job.at, when, sizeof(when));
+                cJSON_AddStringToObject(result, "at", when);
+            } else {
+                cJSON_AddStringToObject(result, "cron", job.cron);
+            }
+            if (job.duration_s > 0) {
+                cJSON_AddNumberToObject(result, "duration_s", job.duration_s);
+                cJSON_AddStringToObject(result, "end_tool", job.end_tool);
+            }
+            cJSON_AddBoolToObject(result, "clock_synced", scheduler_time_synced());
+            cJSON_AddBoolToObject(result, "ok", true);
+        }
+    } else if (strcmp(name, "schedule_list") == 0) {
+        sched_info_t *jobs = malloc(sizeof(sched_info_t) * SEEDCLAW_SCHED_MAX_JOBS);
+        if (jobs == NULL) {
+            cJSON_AddStringToObject(result, "error", "Out of memory");
+        } else {
+            int n = scheduler_list(jobs, SEEDCLAW_SCHED_MAX_JOBS);
+            cJSON *arr = cJSON_CreateArray();
+            for (int i = 0; i < n; i++) {
+                const sched_info_t *j = &jobs[i];
+                char when[24];
+                cJSON *o = cJSON_CreateObject();
+                cJSON_AddNumberToObject(o, "id", j->id);
+                if (j->job.label[0] != '\0') {
+                    cJSON_AddStringToObject(o, "label", j->job.label);
+                }
+                if (j->job.kind == SCHED_CRON) {
+                    cJSON_AddStringToObject(o, "cron", j->job.cron);
+                }
+                cJSON_AddStringToObject(o, "tool", j->job.tool);
+                cJSON_AddItemToObject(o, "input", cJSON_Parse(j->job.input));
+                if (j->job.duration_s > 0) {
+                    cJSON_AddNumberToObject(o, "duration_s", j->job.duration_s);
+                }
+                if (j->next_run > 0) {
+                    format_local_time(j->next_run, when, sizeof(when));
+                    cJSON_AddStringToObject(o, "next_run", when);
+                }
+                if (j->end_due > 0) {
+                    format_local_time(j->end_due, when, sizeof(when));
+                    cJSON_AddStringToObject(o, "running_until", when);
+                }
+                cJSON_AddNumberToObject(o, "runs", j->runs);
+                if (!j->last_ok) {
+                    cJSON_AddBoolToObject(o, "last_failed", true);
+                }
+                cJSON_AddItemToArray(arr, o);
+            }
+            free(jobs);
+            cJSON_AddItemToObject(result, "jobs", arr);
+            if (scheduler_time_synced()) {
+                char now_str[24];
+                format_local_time((int64_t)time(NULL), now_str, sizeof(now_str));
+                cJSON_AddStringToObject(result, "now", now_str);
+            } else {
+                cJSON_AddBoolToObject(result, "clock_synced", false);
+            }
+        }
+    } else if (strcmp(name, "schedule_remove") == 0) {
+        cJSON *id_obj = cJSON_GetObjectItem(input, "id");
+        if (!cJSON_IsNumber(id_obj)) {
+            cJSON_AddStringToObject(result, "error", "Missing 'id' parameter");
+        } else if (scheduler_remove(id_obj->valueint) == ESP_OK) {
+            cJSON_AddBoolToObject(result, "ok", true);
+        } else {
+            cJSON_AddStringToObject(result, "error", "No such job");
+        }
     } else {
         char error_msg[100];
         snprintf(error_msg, sizeof(error_msg), "Unknown tool: %s", name);
@@ -637,9 +1357,125 @@ static char *execute_tool(const char *name, const char *input_json)
     return result_str;
 }
 
-char *react_loop(const char *user_message)
+char *tools_execute(const char *name, const char *input_json)
+{
+    return execute_tool(name, input_json);
+}
+
+// ストリーミング中に受け取ったtool_use（content_block_stopごとに即実行）
+typedef struct {
+    int count;
+    char *ids[SEEDCLAW_MAX_TOOL_CALLS];
+    char *names[SEEDCLAW_MAX_TOOL_CALLS];
+    char *inputs[SEEDCLAW_MAX_TOOL_CALLS];
+    char *results[SEEDCLAW_MAX_TOOL_CALLS];
+} tool_batch_t;
+
+static void on_tool_use(const char *tool_use_id, const char *name,
+                        const char *input_json, void *user_ctx)
+{
+    tool_batch_t *batch = (tool_batch_t *)user_ctx;
+    if (batch->count >= SEEDCLAW_MAX_TOOL_CALLS) {
+        ESP_LOGW(TAG, "Too many tool calls, ignoring %s", name);
+        return;
+    }
+
+    int i = batch->count++;
+    batch->ids[i] = strdup(tool_use_id);
+    batch->names[i] = strdup(name);
+    if (input_json == NULL) {
+        // 受信バッファに収まらなかった入力は実行せずにエラーを返す
+        ESP_LOGW(TAG, "Tool %s input too large, not executed", name);
+        batch->inputs[i] = strdup("{}");
+        batch->results[i] = strdup("{\"error\":\"input too large\"}");
+        return;
+    }
+    ESP_LOGI(TAG, "Dispatching tool: %s", name);
+    batch->inputs[i] = strdup(input_json);
+    batch->results[i] = execute_tool(name, input_json);
+}
+
+static void tool_batch_free(tool_batch_t *batch)
+{
+    for (int i = 0; i < batch->count; i++) {
+        free(batch->ids[i]);
+        free(batch->names[i]);
+        free(batch->inputs[i]);
+        free(batch->results[i]);
+    }
+    batch->count = 0;
+}
+
+// 高速パスのツール結果を返信文にする
+static char *format_fastpath_reply(const char *tool, const char *result_json)
+{
+    cJSON *result = cJSON_Parse(result_json);
+    if (result == NULL) {
+        return NULL;
+    }
+
+    char reply[160];
+    const char *error = cJSON_GetStringValue(cJSON_GetObjectItem(result, "error"));
+    // 結果に state が無くても落ちないよう既定値を使う
+    const char *state = cJSON_GetStringValue(cJSON_GetObjectItem(result, "state"));
+    if (state == NULL) {
+        state = "?";
+    }
+    int pin = (int)cJSON_GetNumberValue(cJSON_GetObjectItem(result, "pin"));
+    if (error != NULL) {
+        snprintf(reply, sizeof(reply), "エラー: %s", error);
+    } else if (strcmp(tool, "gpio_write") == 0) {
+        snprintf(reply, sizeof(reply), "GPIO%d を %s にしました", pin, state);
+    } else if (strcmp(tool, "gpio_read") == 0) {
+        snprintf(reply, sizeof(reply), "GPIO%d: %s", pin, state);
+    } else if (strcmp(tool, "adc_read") == 0) {
+        snprintf(reply, sizeof(reply), "GPIO%d: %d mV (%d%%)", pin,
+                 (int)cJSON_GetNumberValue(cJSON_GetObjectItem(result, "voltage_mv")),
+                 (int)cJSON_GetNumberValue(cJSON_GetObjectItem(result, "percentage")));
+    } else if (strcmp(tool, "pwm_set") == 0) {
+        snprintf(reply, sizeof(reply), "GPIO%d のPWMを duty %d%% / %d Hz にしました", pin,
+                 (int)cJSON_GetNumberValue(cJSON_GetObjectItem(result, "duty")),
+                 (int)cJSON_GetNumberValue(cJSON_GetObjectItem(result, "freq")));
+    } else {
+        cJSON_Delete(result);
+        // gpio_status などは結果JSONをそのまま見せる
+        char *text = malloc(strlen(result_json) + 16);
+        if (text != NULL) {
+            sprintf(text, "```json\n%s\n```", result_json);
+        }
+        return text;
+    }
+    cJSON_Delete(result);
+    return strdup(reply);
+}
+
+char *tools_fastpath(const char *user_message)
 {
-    add_user_message(user_message);
+    fastpath_cmd_t cmd;
+    if (!fastpath_parse(user_message, &cmd)) {
+        return NULL;
+    }
+
+    ESP_LOGI(TAG, "Fast path: %s %s", cmd.tool, cmd.input);
+    char *result = execute_tool(cmd.tool, cmd.input);
+    if (result == NULL) {
+        return NULL;
+    }
+    char *reply = format_fastpath_reply(cmd.tool, result);
+    free(result);
+    if (reply == NULL) {
+        return NULL;
+    }
+
+    // LLMが後の会話で文脈を追えるよう、やり取りは履歴に残す
+    add_user_message(&s_chat_history, user_message);
+    history_append(&s_chat_history, HISTORY_ASSISTANT_TEXT, NULL, NULL, reply);
+    return reply;
+}
+
+static char *react_run(history_t *h, const char *user_message)
+{
+    add_user_message(h, user_message);
 
     char *llm_out_buf = malloc(SEEDCLAW_LLM_RESP_BUF_SIZE);
     if (llm_out_buf == NULL) {
@@ -648,25 +1484,31 @@ char *react_loop(const char *user_message)
     }
 
     for (int i = 0; i < SEEDCLAW_MAX_TOOL_CALLS; i++) {
+        // 予算に収まる末尾の往復だけを送る（ヒープが逼迫していれば予算を絞る）
+        size_t budget = SEEDCLAW_HISTORY_TOKEN_BUDGET;
         size_t free_heap = esp_get_free_heap_size();
-        if (free_heap < 40000) {
-            ESP_LOGW(TAG, "Low heap: %u bytes, clearing history", (unsigned)free_heap);
-            s_history_count = 0;
-            add_user_message(user_message);
+        if (free_heap < SEEDCLAW_LOW_HEAP_THRESHOLD) {
+            ESP_LOGW(TAG, "Low heap: %u bytes, halving history budget", (unsigned)free_heap);
+            budget /= 2;
         }
-
-        char *messages_json = build_messages_json();
-        if (messages_json == NULL) {
-            free(llm_out_buf);
-            return strdup("エラー: メッセージJSON作成失敗");
+        size_t est_tokens;
+        messages_ctx_t mctx = { .h = h, .start = history_suffix_start(h, budget, &est_tokens) };
+        if (mctx.start > 0) {
+            ESP_LOGI(TAG, "History budget: sending %d of %d records (~%u tokens)",
+                     history_count(h) - mctx.start, history_count(h), (unsigned)est_tokens);
+        }
+        if (h == &s_chat_history) {
+            s_last_sent_records = history_count(h) - mctx.start;
+            s_last_sent_tokens = est_tokens;
         }
-        sanitize_utf8(messages_json);
 
         llm_response_type_t resp_type;
-        esp_err_t err = llm_chat(messages_json, TOOLS_JSON, llm_out_buf, SEEDCLAW_LLM_RESP_BUF_SIZE, &resp_type);
-        free(messages_json);
+        tool_batch_t batch = { 0 };
+        esp_err_t err = llm_chat_stream(write_messages, &mctx, on_tool_use, &batch,
+                                        llm_out_buf, SEEDCLAW_LLM_RESP_BUF_SIZE, &resp_type);
 
         if (err != ESP_OK || resp_type == LLM_RESP_ERROR) {
+            tool_batch_free(&batch);
             // llm_out_bufにエラー詳細が入っている可能性がある
             char *error_reply;
             if (strlen(llm_out_buf) > 0) {
@@ -680,79 +1522,46 @@ char *react_loop(const char *user_message)
 
         if (resp_type == LLM_RESP_TEXT) {
             // 最終応答
-            add_assistant_text(llm_out_buf);
+            tool_batch_free(&batch);
+            history_append(h, HISTORY_ASSISTANT_TEXT, NULL, NULL, llm_out_buf);
             char *reply = strdup(llm_out_buf);
             free(llm_out_buf);
             return reply;
         } else if (resp_type == LLM_RESP_TOOL_USE) {
-            // ツール呼び出し（JSON配列で複数tool_useに対応）
-            cJSON *tool_calls = cJSON_Parse(llm_out_buf);
-            if (tool_calls == NULL) {
+            // ツールはストリーム受信中に実行済み。結果を履歴に記録する
+            if (batch.count == 0) {
                 free(llm_out_buf);
-                return strdup("エラー: ツール呼び出しJSON解析失敗");
+                return strdup("エラー: ツール呼び出し情報不足");
+            }
+
+            // assistant tool_useエントリ（入り切らなければ入力を省く）
+            bool full = false;
+            for (int tc = 0; tc < batch.count; tc++) {
+                const char *in = is_json_object(batch.inputs[tc])
+                                     ? batch.inputs[tc] : "{}";
+                if (history_append(h, HISTORY_TOOL_USE, batch.ids[tc], batch.names[tc], in) != ESP_OK &&
+                    history_append(h, HISTORY_TOOL_USE, batch.ids[tc], batch.names[tc], "{}") != ESP_OK) {
+                    full = true;
+                }
+            }
+
+            // user tool_resultエントリ（入り切らなければエラーに差し替える）
+            for (int tc = 0; tc < batch.count; tc++) {
+                if (history_append(h, HISTORY_TOOL_RESULT, batch.ids[tc], NULL,
+                                   batch.results[tc] ? batch.results[tc] : "{\"error\":\"no result\"}") != ESP_OK &&
+                    history_append(h, HISTORY_TOOL_RESULT, batch.ids[tc], NULL,
+                                   "{\"error\":\"result dropped: history full\"}") != ESP_OK) {
+                    full = true;
+                }
             }
+            tool_batch_free(&batch);
 
-            int num_calls = cJSON_IsArray(tool_calls) ? cJSON_GetArraySize(tool_calls) : 0;
-            if (num_calls == 0) {
-                cJSON_Delete(tool_calls);
+            // 実行済みのツールを二重に実行しないよう、やり直さずに打ち切る
+            if (full) {
+                ESP_LOGW(TAG, "History full within one exchange, stopping");
                 free(llm_out_buf);
-                return strdup("エラー: ツール呼び出し情報不足");
+                return strdup("エラー: 1回のやり取りで履歴がいっぱいになったため中断しました（実行済みの操作はそのままです）");
             }
-            if (num_calls > SEEDCLAW_MAX_TOOL_CALLS) num_calls = SEEDCLAW_MAX_TOOL_CALLS;
-
-            // 履歴スペース確保
-            trim_history_safe(num_calls * 2);
-
-            // Phase 1: 全ツール実行 + assistant tool_useエントリ追加
-            char *results[SEEDCLAW_MAX_TOOL_CALLS];
-            char *ids[SEEDCLAW_MAX_TOOL_CALLS];
-            int valid_count = 0;
-            memset(results, 0, sizeof(results));
-            memset(ids, 0, sizeof(ids));
-
-            for (int tc = 0; tc < num_calls; tc++) {
-                cJSON *call = cJSON_GetArrayItem(tool_calls, tc);
-                cJSON *id_j = cJSON_GetObjectItem(call, "tool_use_id");
-                cJSON *name_j = cJSON_GetObjectItem(call, "name");
-                cJSON *input_j = cJSON_GetObjectItem(call, "input");
-                if (!id_j || !name_j || !input_j) continue;
-
-                char *input_str = cJSON_PrintUnformatted(input_j);
-                results[valid_count] = execute_tool(name_j->valuestring, input_str);
-                ids[valid_count] = strdup(id_j->valuestring);
-
-                // assistant tool_useエントリ
-                memset(&s_history[s_history_count], 0, sizeof(history_entry_t));
-                strcpy(s_history[s_history_count].role, "assistant");
-                safe_strncpy(s_history[s_history_count].tool_use_id, id_j->valuestring,
-                             sizeof(s_history[0].tool_use_id));
-                safe_strncpy(s_history[s_history_count].tool_name, name_j->valuestring,
-                             sizeof(s_history[0].tool_name));
-                safe_strncpy(s_history[s_history_count].content, input_str,
-                             sizeof(s_history[0].content));
-                s_history[s_history_count].is_tool_use = true;
-                s_history_count++;
-
-                free(input_str);
-                valid_count++;
-            }
-
-            // Phase 2: user tool_resultエントリ追加
-            for (int tc = 0; tc < valid_count; tc++) {
-                memset(&s_history[s_history_count], 0, sizeof(history_entry_t));
-                strcpy(s_history[s_history_count].role, "user");
-                safe_strncpy(s_history[s_history_count].tool_use_id, ids[tc],
-                             sizeof(s_history[0].tool_use_id));
-                safe_strncpy(s_history[s_history_count].content, results[tc],
-                             sizeof(s_history[0].content));
-                s_history[s_history_count].is_tool_result = true;
-                s_history_count++;
-
-                free(ids[tc]);
-                free(results[tc]);
-            }
-
-            cJSON_Delete(tool_calls);
         }
     }
 
@@ -760,36 +1569,55 @@ char *react_loop(const char *user_message)
     return strdup("操作が複雑すぎます。もう少し簡単にお願いします。");
 }
 
+char *react_loop(const char *user_message)
+{
+    return react_run(&s_chat_history, user_message);
+}
+
+void tools_get_history_usage(tools_history_usage_t *out)
+{
+    out->records = history_count(&s_chat_history);
+    out->bytes_used = history_bytes_used(&s_chat_history);
+    out->arena_size = s_chat_history.arena_size;
+    out->last_sent_records = s_last_sent_records;
+    out->last_sent_tokens = s_last_sent_tokens;
+}
+
 char *autonomous_check(void)
 {
-    if (s_rules_count == 0) {
+    // 端末上で評価できるルールは rules_tick() が受け持つ
+    int llm_rules = rules_llm_count();
+    if (llm_rules == 0) {
         return NULL;
     }
 
-    ESP_LOGI(TAG, "Running autonomous check (%d rules)", s_rules_count);
+    ESP_LOGI(TAG, "Running autonomous check (%d rules via LLM)", llm_rules);
 
-    // ルールからプロンプトを構築
-    char prompt[1536];
+    // ルールからプロンプトを構築（ツール一覧の分大きいのでスタックに置かない。呼ぶのはワーカーのみ）
+    static char prompt[2048];
     int offset = snprintf(prompt, sizeof(prompt),
         "【自律監視の実行】今すぐ以下のルールに従い行動せよ。\n"
-        "使用可能: gpio_read, gpio_write, adc_read, pwm_set, gpio_status, web_fetch\n"
+        "使用可能: %s\n"
         "禁止: rule_add, rule_remove, rule_clear, set_auto_interval, get_rules（設定済み。再設定不要）\n"
         "実行結果を1行で報告。変化なければ「変化なし」。\n\n"
-        "ルール:\n");
-
-    for (int i = 0; i < s_rules_count && offset < (int)sizeof(prompt) - 260; i++) {
+        "ルール:\n", s_auto_tools);
+
+    char rule_text[SEEDCLAW_MAX_RULE_LEN];
+    rule_state_t state;
+    for (int i = 0, n = 0;
+         (state = rules_get(i, rule_text, sizeof(rule_text))) != RULE_NONE &&
+         offset < (int)sizeof(prompt) - 260;
+         i++) {
+        if (state == RULE_COMPILED) {
+            continue;
+        }
         offset += snprintf(prompt + offset, sizeof(prompt) - offset,
-                           "%d. %s\n", i + 1, s_rules[i]);
+                           "%d. %s\n", ++n, rule_text);
     }
 
-    // 会話履歴を一時退避
-    int saved_history_count = s_history_count;
-    s_history_count = 0;
-
-    char *result = react_loop(prompt);
-
-    // 会話履歴を復元
-    s_history_count = saved_history_count;
+    // 自律監視は毎回まっさらな専用履歴で実行（ユーザー会話の履歴には触れない）
+    history_clear(&s_auto_history);
+    char *result = react_run(&s_auto_history, prompt);
 
     if (result == NULL) {
         return NULL;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "esp_err.h"
+#include <stddef.h>
 
 /**
  * @brief ツールモジュールを初期化
@@ -14,19 +15,33 @@ void tools_init(void);
  */
 char *react_loop(const char *user_message);
 
+/**
+ * @brief 定型コマンドならLLMを介さずに実行して返信文を返す
+ * @return 返信テキスト（呼び出し元が free()）。定型コマンドでなければ NULL（react_loop() に回す）
+ */
+char *tools_fastpath(const char *user_message);
+
+/**
+ * @brief ツールを1つ実行（スケジューラなど LLM を介さない呼び出し用）
+ * @return 結果JSON（呼び出し元が free()）
+ */
+char *tools_execute(const char *name, const char *input_json);
+
 /**
  * @brief 自律チェックを実行
  * @return Discord に報告するテキスト（NULL なら報告不要）
  */
 char *autonomous_check(void);
 
-/* ── 監視ルール管理 ── */
-
-int rules_count(void);
-esp_err_t rules_add(const char *rule_text);
-esp_err_t rules_remove(int index);
-void rules_list(void);
-void rules_clear(void);
+typedef struct {
+    int records;             // 墓標を含むレコード数
+    size_t bytes_used;       // アリーナ使用量
+    size_t arena_size;
+    int last_sent_records;   // 直近のリクエストで送ったレコード数
+    size_t last_sent_tokens; // その見積もりトークン数
+} tools_history_usage_t;
 
-int auto_interval_get(void);
-void auto_interval_set(int interval);
+/**
+ * @brief ユーザー会話履歴の使用状況を取得
+ */
+void tools_get_history_usage(tools_history_usage_t *out);
@@ -0,0 +1,232 @@
+/*
+ * discord_json.c と cJSON のホスト上ベンチマーク
+ *
+ * payloads/ の応答（埋め込みの大きいものを含む）を、
+ *   discord_json  HTTPクライアントと同じ 512 バイトずつ流し込む
+ *   cJSON         応答全体をバッファしてから cJSON_Parse() し、同じ項目を取り出す
+ * の2通りで処理し、解析時間と作業メモリを比べる。cJSON のヒープは
+ * cJSON_InitHooks() で数えたピークに、応答全体を溜めるバッファを足したもの。
+ * discord_json はヒープを使わないので、パーサ構造体と出力配列の大きさを示す。
+ * 取り出した id / content / author は両者で一致することを確かめる。
+ *
+ * cJSON は ESP-IDF 同梱のものを使う。見つからないときは discord_json だけ測る。
+ */
+#include "discord_json.h"
+#include "seedclaw_config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifndef BENCH_NO_CJSON
+#include "cJSON.h"
+#endif
+
+#define CHUNK_SIZE      512            // esp_http_client の既定の受信バッファ
+#define REPEAT_MIN_NS   200000000LL    // 1方式あたり最低この時間だけ繰り返す
+
+static const char *const PAYLOADS[] = { "plain.json", "unicode.json", "embeds.json" };
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static char *load(const char *name, size_t *out_len)
+{
+    char path[256];
+    snprintf(path, sizeof(path), "payloads/%s", name);
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *buf = malloc((size_t)len + 1);
+    if (buf != NULL && fread(buf, 1, (size_t)len, f) != (size_t)len) {
+        free(buf);
+        buf = NULL;
+    }
+    fclose(f);
+    if (buf != NULL) {
+        buf[len] = '\0';
+        *out_len = (size_t)len;
+    }
+    return buf;
+}
+
+static int parse_streaming(const char *body, size_t len, discord_message_t *out, int max_msgs)
+{
+    discord_json_parser_t p;
+    discord_json_init(&p, out, max_msgs);
+    for (size_t off = 0; off < len; off += CHUNK_SIZE) {
+        discord_json_feed(&p, body + off, len - off < CHUNK_SIZE ? len - off : CHUNK_SIZE);
+    }
+    return discord_json_finish(&p);
+}
+
+#ifndef BENCH_NO_CJSON
+
+static size_t s_heap_now = 0;
+static size_t s_heap_peak = 0;
+
+// 確保サイズを前置きして解放時に差し引く
+static void *count_malloc(size_t n)
+{
+    size_t *p = malloc(n + sizeof(size_t));
+    if (p == NULL) {
+        return NULL;
+    }
+    *p = n;
+    s_heap_now += n;
+    if (s_heap_now > s_heap_peak) {
+        s_heap_peak = s_heap_now;
+    }
+    return p + 1;
+}
+
+static void count_free(void *ptr)
+{
+    if (ptr != NULL) {
+        size_t *p = (size_t *)ptr - 1;
+        s_heap_now -= *p;
+        free(p);
+    }
+}
+
+static void copy_string(char *dst, size_t size, const cJSON *item)
+{
+    const char *s = cJSON_GetStringValue(item);
+    snprintf(dst, size, "%s", s != NULL ? s : "");
+}
+
+// discord_poll() が以前やっていたのと同じく、全体を木にしてから必要な項目を拾う
+static int parse_cjson(const char *body, discord_message_t *out, int max_msgs)
+{
+    cJSON *root = cJSON_Parse(body);
+    if (!cJSON_IsArray(root)) {
+        cJSON_Delete(root);
+        return -1;
+    }
+    int n = 0;
+    const cJSON *m;
+    cJSON_ArrayForEach(m, root) {
+        if (n >= max_msgs) {
+            break;
+        }
+        discord_message_t *msg = &out[n++];
+        const cJSON *author = cJSON_GetObjectItem(m, "author");
+        copy_string(msg->id, sizeof(msg->id), cJSON_GetObjectItem(m, "id"));
+        copy_string(msg->content, sizeof(msg->content), cJSON_GetObjectItem(m, "content"));
+        copy_string(msg->author_id, sizeof(msg->author_id), cJSON_GetObjectItem(author, "id"));
+        msg->author_is_bot = cJSON_IsTrue(cJSON_GetObjectItem(author, "bot"));
+    }
+    cJSON_Delete(root);
+    return n;
+}
+
+// content は discord_json が UTF-8 の境界で切り詰めるので、収まらない本文は前方一致で比べる
+static bool same_content(const char *streamed, const char *full, size_t size)
+{
+    size_t n = strlen(streamed);
+    if (strlen(full) < size - 1) {
+        return strcmp(streamed, full) == 0;
+    }
+    return strncmp(streamed, full, n) == 0 && n + 4 >= size - 1;
+}
+
+static bool same_messages(const discord_message_t *a, const discord_message_t *b, int n)
+{
+    for (int i = 0; i < n; i++) {
+        if (strcmp(a[i].id, b[i].id) != 0 || strcmp(a[i].author_id, b[i].author_id) != 0 ||
+            a[i].author_is_bot != b[i].author_is_bot ||
+            !same_content(a[i].content, b[i].content, sizeof(a[i].content))) {
+            printf("  message %d differs (id %s / %s)\n", i, a[i].id, b[i].id);
+            return false;
+        }
+    }
+    return true;
+}
+
+#endif
+
+int main(void)
+{
+    static discord_message_t out[SEEDCLAW_MAX_POLL_MSGS];
+    int failed = 0;
+
+    printf("discord_json vs cJSON (%d messages max, %d-byte chunks)\n",
+           SEEDCLAW_MAX_POLL_MSGS, CHUNK_SIZE);
+    printf("fixed working set of discord_json: parser %zu + output %zu bytes, no heap\n",
+           sizeof(discord_json_parser_t), sizeof(out));
+#ifdef BENCH_NO_CJSON
+    printf("cJSON not found (set IDF_PATH or CJSON_DIR), measuring discord_json only\n");
+    printf("%-13s %7s %5s %18s\n", "payload", "bytes", "msgs", "discord_json us");
+#else
+    printf("%-13s %7s %5s %18s %10s %16s %9s\n", "payload", "bytes", "msgs",
+           "discord_json us", "cJSON us", "cJSON peak heap", "(tree)");
+#endif
+
+    for (size_t k = 0; k < sizeof(PAYLOADS) / sizeof(PAYLOADS[0]); k++) {
+        size_t len = 0;
+        char *body = load(PAYLOADS[k], &len);
+        if (body == NULL) {
+            printf("FAIL cannot read payloads/%s (run from test/)\n", PAYLOADS[k]);
+            failed++;
+            continue;
+        }
+
+        int msgs = parse_streaming(body, len, out, SEEDCLAW_MAX_POLL_MSGS);
+        if (msgs < 0) {
+            printf("FAIL %s: discord_json rejected the payload\n", PAYLOADS[k]);
+            failed++;
+            free(body);
+            continue;
+        }
+
+        int64_t stream_ns = 0;
+        long stream_rounds = 0;
+        while (stream_ns < REPEAT_MIN_NS) {
+            int64_t t0 = now_ns();
+            parse_streaming(body, len, out, SEEDCLAW_MAX_POLL_MSGS);
+            stream_ns += now_ns() - t0;
+            stream_rounds++;
+        }
+
+#ifdef BENCH_NO_CJSON
+        printf("%-13s %7zu %5d %18.1f\n", PAYLOADS[k], len, msgs,
+               (double)stream_ns / stream_rounds / 1000.0);
+#else
+        static discord_message_t ref[SEEDCLAW_MAX_POLL_MSGS];
+        cJSON_Hooks hooks = { .malloc_fn = count_malloc, .free_fn = count_free };
+        cJSON_InitHooks(&hooks);
+        s_heap_now = 0;
+        s_heap_peak = 0;
+        int ref_msgs = parse_cjson(body, ref, SEEDCLAW_MAX_POLL_MSGS);
+        size_t tree_peak = s_heap_peak;
+        if (ref_msgs != msgs || !same_messages(out, ref, msgs)) {
+            printf("FAIL %s: discord_json and cJSON extracted different messages\n", PAYLOADS[k]);
+            failed++;
+        }
+
+        int64_t cjson_ns = 0;
+        long cjson_rounds = 0;
+        while (cjson_ns < REPEAT_MIN_NS) {
+            int64_t t0 = now_ns();
+            parse_cjson(body, ref, SEEDCLAW_MAX_POLL_MSGS);
+            cjson_ns += now_ns() - t0;
+            cjson_rounds++;
+        }
+
+        // 端末では応答全体を溜めるバッファ (len + 1) も同時に要る
+        printf("%-13s %7zu %5d %18.1f %10.1f %16zu %9zu\n", PAYLOADS[k], len, msgs,
+               (double)stream_ns / stream_rounds / 1000.0,
+               (double)cjson_ns / cjson_rounds / 1000.0,
+               len + 1 + tree_peak, tree_peak);
+#endif
+        free(body);
+    }
+    return failed == 0 ? 0 : 1;
+}
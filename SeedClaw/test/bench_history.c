@@ -0,0 +1,151 @@
+/*
+ * history.c の tool_use / tool_result 対応付けのホスト上ベンチマーク
+ *
+ * 1往復に N 組のツール呼び出しを並べ、追加（対応付け込み）と history_sanitize() の
+ * 1レコードあたりの時間を並べ方ごとに測る。結果の対応付けは毎回検証する。
+ *
+ *   sequential  use1 res1 use2 res2 ...         直前の tool_use がすぐ見つかる
+ *   parallel    use1..useN res1..resN           res1 は並び全体を遡る（最悪）
+ *   reversed    use1..useN resN..res1
+ *   orphan      use1..useN 未知IDの res × N      見つからず並び全体を走査する
+ *
+ * 探索は「直近の tool_use / tool_result の並び」だけを遡るので、1回の追加は並びの
+ * 長さ（≦ SEEDCLAW_HISTORY_MAX_RECORDS）に比例し、sanitize は記録数に比例する。
+ */
+#include "history.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define REPEAT_MIN_NS   200000000LL   // 1パターンあたり最低この時間だけ繰り返す
+
+typedef enum {
+    PATTERN_SEQUENTIAL,
+    PATTERN_PARALLEL,
+    PATTERN_REVERSED,
+    PATTERN_ORPHAN,
+} pattern_t;
+
+static const char *const PATTERN_NAMES[] = { "sequential", "parallel", "reversed", "orphan" };
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void make_id(char *buf, size_t size, int i, bool unknown)
+{
+    snprintf(buf, size, "toolu_%s%02d_0123456789abcdef", unknown ? "x" : "", i);
+}
+
+// 1往復を積む。追加したレコード数を返す
+static int build_exchange(history_t *h, pattern_t pattern, int pairs)
+{
+    static const char *input = "{\"pin\":5,\"value\":1}";
+    static const char *result = "{\"pin\":5,\"state\":\"HIGH\",\"ok\":true}";
+    char id[48];
+    int n = 0;
+
+    history_append(h, HISTORY_USER_TEXT, NULL, NULL, "GPIO5 と GPIO6 を順に ON にして");
+    n++;
+    for (int i = 0; i < pairs; i++) {
+        make_id(id, sizeof(id), i, false);
+        history_append(h, HISTORY_TOOL_USE, id, "gpio_write", input);
+        n++;
+        if (pattern == PATTERN_SEQUENTIAL) {
+            history_append(h, HISTORY_TOOL_RESULT, id, NULL, result);
+            n++;
+        }
+    }
+    if (pattern != PATTERN_SEQUENTIAL) {
+        for (int i = 0; i < pairs; i++) {
+            int k = (pattern == PATTERN_REVERSED) ? pairs - 1 - i : i;
+            make_id(id, sizeof(id), k, pattern == PATTERN_ORPHAN);
+            history_append(h, HISTORY_TOOL_RESULT, id, NULL, result);
+            n++;
+        }
+    }
+    history_append(h, HISTORY_ASSISTANT_TEXT, NULL, NULL, "ON にしました");
+    return n + 1;
+}
+
+// 対応付けが ID どおりか確かめる
+static bool verify(const history_t *h, pattern_t pattern)
+{
+    for (int i = 0; i < h->rec_count; i++) {
+        const history_rec_t *r = &h->recs[(h->rec_head + i) % SEEDCLAW_HISTORY_MAX_RECORDS];
+        if (r->kind != HISTORY_TOOL_USE && r->kind != HISTORY_TOOL_RESULT) {
+            continue;
+        }
+        if (pattern == PATTERN_ORPHAN) {
+            if (r->partner != HISTORY_NO_PARTNER) {
+                return false;
+            }
+            continue;
+        }
+        if (r->partner == HISTORY_NO_PARTNER) {
+            return false;
+        }
+        const history_rec_t *p = &h->recs[r->partner];
+        if (p->partner != (r - h->recs) ||
+            strcmp(h->arena + r->off, h->arena + p->off) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(void)
+{
+    static const int PAIRS[] = { 1, 4, 8, 16, 23 };
+    history_t h;
+    if (history_init(&h, SEEDCLAW_HISTORY_ARENA_SIZE) != ESP_OK) {
+        return 1;
+    }
+
+    printf("history pairing benchmark (records <= %d, arena %d bytes)\n",
+           SEEDCLAW_HISTORY_MAX_RECORDS, SEEDCLAW_HISTORY_ARENA_SIZE);
+    printf("%-11s %5s %8s %14s %16s\n", "pattern", "pairs", "records", "append ns/rec", "sanitize ns/rec");
+
+    int failed = 0;
+    for (int p = PATTERN_SEQUENTIAL; p <= PATTERN_ORPHAN; p++) {
+        for (size_t k = 0; k < sizeof(PAIRS) / sizeof(PAIRS[0]); k++) {
+            int pairs = PAIRS[k];
+            if (2 + 2 * pairs > SEEDCLAW_HISTORY_MAX_RECORDS) {
+                continue;
+            }
+
+            history_clear(&h);
+            int records = build_exchange(&h, (pattern_t)p, pairs);
+            if (!verify(&h, (pattern_t)p)) {
+                printf("FAIL %s x%d: tool_use / tool_result paired incorrectly\n",
+                       PATTERN_NAMES[p], pairs);
+                failed++;
+                continue;
+            }
+
+            int64_t append_ns = 0;
+            int64_t sanitize_ns = 0;
+            long rounds = 0;
+            while (append_ns + sanitize_ns < REPEAT_MIN_NS) {
+                history_clear(&h);
+                int64_t t0 = now_ns();
+                build_exchange(&h, (pattern_t)p, pairs);
+                int64_t t1 = now_ns();
+                history_sanitize(&h);
+                int64_t t2 = now_ns();
+                append_ns += t1 - t0;
+                sanitize_ns += t2 - t1;
+                rounds++;
+            }
+            printf("%-11s %5d %8d %14.1f %16.1f\n", PATTERN_NAMES[p], pairs, records,
+                   (double)append_ns / rounds / records, (double)sanitize_ns / rounds / records);
+        }
+    }
+
+    free(h.arena);
+    return failed == 0 ? 0 : 1;
+}
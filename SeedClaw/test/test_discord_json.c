@@ -0,0 +1,137 @@
+/*
+ * discord_json.c のホストテスト
+ *
+ * Gatewayの MESSAGE_CREATE フレームを再組み立てバッファ (SEEDCLAW_GATEWAY_FRAME_BUF)
+ * より大きくして小分けに流し込み、op / s / t / channel_id / メッセージが取り出せること、
+ * 長い本文が UTF-8 の文字境界で切り詰められることを確かめる。REST のメッセージ配列の
+ * 抽出が変わっていないことも確かめる。
+ */
+#include "discord_json.h"
+#include "seedclaw_config.h"
+#include <stdio.h>
+#include <string.h>
+
+static int s_failed = 0;
+
+#define CHECK(cond, ...) do {                   \
+        if (!(cond)) {                          \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__);                \
+            printf("\n");                       \
+            s_failed++;                         \
+        }                                       \
+    } while (0)
+
+static void feed_chunked(discord_json_parser_t *p, const char *data, size_t len, size_t chunk)
+{
+    for (size_t off = 0; off < len; off += chunk) {
+        discord_json_feed(p, data + off, len - off < chunk ? len - off : chunk);
+    }
+}
+
+// 末尾で途切れた UTF-8 列が無いか
+static bool utf8_complete(const char *s)
+{
+    size_t i = 0;
+    size_t len = strlen(s);
+    while (i < len) {
+        unsigned char c = (unsigned char)s[i];
+        size_t need = (c < 0x80) ? 1 : ((c & 0xE0) == 0xC0) ? 2 : ((c & 0xF0) == 0xE0) ? 3 : 4;
+        if (i + need > len) {
+            return false;
+        }
+        i += need;
+    }
+    return true;
+}
+
+static void test_large_message_create(void)
+{
+    static char content[8192];
+    static char frame[12288];
+    size_t len = 0;
+
+    // 2000文字の日本語（約6KB）
+    for (int i = 0; i < 2000; i++) {
+        memcpy(content + len, (i % 2) ? "語" : "日", 3);
+        len += 3;
+    }
+    content[len] = '\0';
+
+    int n = snprintf(frame, sizeof(frame),
+                     "{\"t\":\"MESSAGE_CREATE\",\"s\":42,\"op\":0,\"d\":{"
+                     "\"type\":0,\"tts\":false,\"mentions\":[{\"id\":\"1\",\"bot\":true}],"
+                     "\"member\":{\"roles\":[\"5\",\"6\"],\"nick\":null},"
+                     "\"id\":\"1234567890123456789\",\"content\":\"%s\","
+                     "\"channel_id\":\"111222333444555666\","
+                     "\"author\":{\"username\":\"user\",\"id\":\"999888777\",\"bot\":false},"
+                     "\"embeds\":[]}}",
+                     content);
+    CHECK(n > SEEDCLAW_GATEWAY_FRAME_BUF, "frame is only %d bytes", n);
+
+    discord_message_t msg;
+    discord_json_parser_t p;
+    discord_json_init_event(&p, &msg);
+    feed_chunked(&p, frame, (size_t)n, 1024);
+    int count = discord_json_finish(&p);
+
+    CHECK(count == 1, "count %d", count);
+    CHECK(p.op == 0, "op %d", p.op);
+    CHECK(p.seq == 42, "seq %ld", (long)p.seq);
+    CHECK(strcmp(p.type, "MESSAGE_CREATE") == 0, "type %s", p.type);
+    CHECK(strcmp(p.channel_id, "111222333444555666") == 0, "channel_id %s", p.channel_id);
+    CHECK(strcmp(msg.id, "1234567890123456789") == 0, "id %s", msg.id);
+    CHECK(strcmp(msg.author_id, "999888777") == 0, "author_id %s", msg.author_id);
+    CHECK(!msg.author_is_bot, "author_is_bot");
+    size_t got = strlen(msg.content);
+    CHECK(got > 0 && got < sizeof(msg.content) && got % 3 == 0, "content %zu bytes", got);
+    CHECK(strncmp(msg.content, content, got) == 0, "content is not a prefix");
+    CHECK(utf8_complete(msg.content), "content ends mid-character");
+}
+
+// d がメッセージでないディスパッチや s が null のフレーム
+static void test_other_frames(void)
+{
+    static const char *ack = "{\"t\":null,\"s\":null,\"op\":11,\"d\":null}";
+    static const char *typing =
+        "{\"t\":\"TYPING_START\",\"s\":7,\"op\":0,\"d\":{\"channel_id\":\"1\",\"user_id\":\"2\"}}";
+    discord_message_t msg;
+    discord_json_parser_t p;
+
+    discord_json_init_event(&p, &msg);
+    feed_chunked(&p, ack, strlen(ack), 5);
+    CHECK(discord_json_finish(&p) == 0, "ack count");
+    CHECK(p.op == 11 && p.seq == -1 && p.type[0] == '\0', "ack op %d seq %ld", p.op, (long)p.seq);
+
+    discord_json_init_event(&p, &msg);
+    feed_chunked(&p, typing, strlen(typing), 7);
+    CHECK(discord_json_finish(&p) == 1, "typing count");
+    CHECK(p.seq == 7 && strcmp(p.type, "TYPING_START") == 0, "typing seq %ld", (long)p.seq);
+    CHECK(msg.id[0] == '\0', "typing has no message id");
+}
+
+// REST のメッセージ配列（従来どおり）
+static void test_message_array(void)
+{
+    static const char *body =
+        "[{\"id\":\"2\",\"channel_id\":\"9\",\"content\":\"b\",\"author\":{\"id\":\"5\",\"bot\":true}},"
+        "{\"id\":\"1\",\"content\":\"a\\u3042\",\"author\":{\"id\":\"4\"}}]";
+    discord_message_t out[SEEDCLAW_MAX_POLL_MSGS];
+    discord_json_parser_t p;
+    discord_json_init(&p, out, SEEDCLAW_MAX_POLL_MSGS);
+    feed_chunked(&p, body, strlen(body), 3);
+
+    CHECK(discord_json_finish(&p) == 2, "array count");
+    CHECK(strcmp(out[0].id, "2") == 0 && out[0].author_is_bot, "message 0");
+    CHECK(strcmp(out[1].content, "a\xe3\x81\x82") == 0 && !out[1].author_is_bot, "message 1");
+    CHECK(p.channel_id[0] == '\0', "channel_id is only read from gateway frames");
+}
+
+int main(void)
+{
+    test_large_message_create();
+    test_other_frames();
+    test_message_array();
+    printf("discord_json: %s\n", s_failed == 0 ? "passed" : "FAILED");
+    return s_failed == 0 ? 0 : 1;
+}
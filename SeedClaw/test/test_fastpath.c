@@ -0,0 +1,102 @@
+/*
+ * fastpath.c のホストテスト
+ *
+ * 定型コマンドの文法・別名・ピン表記・全角の正規化と、
+ * 文法から外れた文を LLM に回す（false を返す）ことを確かめる。
+ */
+#include "fastpath.h"
+#include <stdio.h>
+#include <string.h>
+
+static int s_failed = 0;
+static int s_total = 0;
+
+// text が tool / input に解釈されること
+static void expect(const char *text, const char *tool, const char *input)
+{
+    fastpath_cmd_t cmd;
+    memset(&cmd, 0, sizeof(cmd));
+    s_total++;
+    if (!fastpath_parse(text, &cmd)) {
+        printf("FAIL \"%s\": not parsed (want %s %s)\n", text, tool, input);
+        s_failed++;
+    } else if (strcmp(cmd.tool, tool) != 0 || strcmp(cmd.input, input) != 0) {
+        printf("FAIL \"%s\": got %s %s (want %s %s)\n", text, cmd.tool, cmd.input, tool, input);
+        s_failed++;
+    }
+}
+
+// text が LLM に回されること
+static void reject(const char *text)
+{
+    fastpath_cmd_t cmd;
+    s_total++;
+    if (fastpath_parse(text, &cmd)) {
+        printf("FAIL \"%s\": parsed as %s %s (want LLM)\n", text, cmd.tool, cmd.input);
+        s_failed++;
+    }
+}
+
+int main(void)
+{
+    // gpio_write: ピン表記と状態の別名
+    expect("GPIO5をON", "gpio_write", "{\"pin\":5,\"value\":1}");
+    expect("gpio5 off", "gpio_write", "{\"pin\":5,\"value\":0}");
+    expect("gpio 5 high", "gpio_write", "{\"pin\":5,\"value\":1}");
+    expect("5 low", "gpio_write", "{\"pin\":5,\"value\":0}");
+    expect("gpio5 1", "gpio_write", "{\"pin\":5,\"value\":1}");
+    expect("D3 0", "gpio_write", "{\"pin\":5,\"value\":0}");
+    expect("D3 off", "gpio_write", "{\"pin\":5,\"value\":0}");
+    expect("d6 on!", "gpio_write", "{\"pin\":21,\"value\":1}");
+    expect("D10 on", "gpio_write", "{\"pin\":10,\"value\":1}");
+    expect("D3をオンにして", "gpio_write", "{\"pin\":5,\"value\":1}");
+    expect("GPIO5はオフ。", "gpio_write", "{\"pin\":5,\"value\":0}");
+
+    // 全角英数字・全角スペース
+    expect("ＧＰＩＯ５　ＯＮ", "gpio_write", "{\"pin\":5,\"value\":1}");
+    expect("Ｄ３をオフ", "gpio_write", "{\"pin\":5,\"value\":0}");
+
+    // read / adc と別名
+    expect("read 5", "gpio_read", "{\"pin\":5}");
+    expect("gpio_read D3", "gpio_read", "{\"pin\":5}");
+    expect("adc 3", "adc_read", "{\"pin\":3}");
+    expect("adc_read A2", "adc_read", "{\"pin\":4}");
+    expect("ADC a0", "adc_read", "{\"pin\":2}");
+
+    // pwm と別名（周波数は省略時 1000Hz）
+    expect("pwm 5 50", "pwm_set", "{\"pin\":5,\"duty\":50,\"freq\":1000}");
+    expect("pwm_set D3 100 20000", "pwm_set", "{\"pin\":5,\"duty\":100,\"freq\":20000}");
+    expect("PWM gpio 5 0", "pwm_set", "{\"pin\":5,\"duty\":0,\"freq\":1000}");
+
+    // status
+    expect("status", "gpio_status", "{}");
+    expect("gpio_status?", "gpio_status", "{}");
+
+    // 文法外は LLM へ
+    reject("");
+    reject("   ");
+    reject("GPIO5をONにして、3秒後にOFF");
+    reject("LEDをつけて");
+    reject("5 toggle");
+    reject("5 1");                   // 番号と数字だけでは曖昧
+    reject("3 0");
+    reject("D9 on");                 // BOOTピン
+    reject("D11 on");
+    reject("A3");
+    reject("adc A3");
+    reject("pwm 5 101");
+    reject("pwm 5 50 0");
+    reject("pwm 5 50 40001");
+    reject("pwm 5");
+    reject("read");
+    reject("read 5 6");
+    reject("status now");
+    reject("gpio on");
+    reject("gpio123456 on");
+    reject("1 2 3 4 5 6");
+    reject("温度は？");
+    reject("ＧＰＩＯ５をつけて");
+
+    printf("fastpath: %d/%d passed\n", s_total - s_failed, s_total);
+    return s_failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,189 @@
+/*
+ * history.c のホストテスト
+ *
+ * 典型的な往復（ユーザー発言 → tool_use/tool_result → 最終応答）を積み、
+ * 1往復ごとのアリーナ使用量とレコード数を表にして出す。あわせて
+ *   - 使用量がアリーナを超えない
+ *   - 押し出されるのは古い往復だけで、進行中の往復は残る
+ *   - 進行中の往復だけで埋まったら ESP_ERR_NO_MEM を返す
+ *   - 押し出しフックが捨てた往復のレコードを受け取る
+ *   - 長いツール結果を切り詰めずに残し、アリーナより大きい結果は何も捨てずに断る
+ * を確かめる。
+ */
+#include "history.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int s_failed = 0;
+
+#define CHECK(cond, ...) do {                   \
+        if (!(cond)) {                          \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__);                \
+            printf("\n");                       \
+            s_failed++;                         \
+        }                                       \
+    } while (0)
+
+static int s_evicted = 0;
+
+static void count_evict(const history_entry_t *e, void *ctx)
+{
+    (void)e;
+    (void)ctx;
+    s_evicted++;
+}
+
+// i 番目の往復（ツール呼び出しは 0〜2 回）を積み、積んだ本文の合計バイト数を返す
+static size_t add_turn(history_t *h, int turn)
+{
+    char user[96];
+    char id[40];
+    char result[160];
+    size_t payload = 0;
+
+    snprintf(user, sizeof(user), "ターン%d: GPIO5 の状態と A0 の電圧を教えて", turn);
+    CHECK(history_append(h, HISTORY_USER_TEXT, NULL, NULL, user) == ESP_OK, "user text %d", turn);
+    payload += strlen(user);
+
+    for (int k = 0; k < turn % 3; k++) {
+        snprintf(id, sizeof(id), "toolu_%04d_%d_0123456789abcdef", turn, k);
+        CHECK(history_append(h, HISTORY_TOOL_USE, id, "adc_read", "{\"pin\":2}") == ESP_OK,
+              "tool_use %d/%d", turn, k);
+        snprintf(result, sizeof(result),
+                 "{\"pin\":2,\"raw\":%d,\"voltage_mv\":%d,\"percentage\":%d}",
+                 1000 + turn, 800 + turn, 25);
+        CHECK(history_append(h, HISTORY_TOOL_RESULT, id, NULL, result) == ESP_OK,
+              "tool_result %d/%d", turn, k);
+        payload += strlen(id) * 2 + strlen("adc_read") + strlen("{\"pin\":2}") + strlen(result);
+    }
+
+    CHECK(history_append(h, HISTORY_ASSISTANT_TEXT, NULL, NULL,
+                         "GPIO5 は HIGH、A0 は 0.8V 前後です。") == ESP_OK, "assistant %d", turn);
+    payload += strlen("GPIO5 は HIGH、A0 は 0.8V 前後です。");
+    return payload;
+}
+
+static void test_bytes_per_turn(void)
+{
+    history_t h;
+    CHECK(history_init(&h, SEEDCLAW_HISTORY_ARENA_SIZE) == ESP_OK, "init");
+    history_set_evict_hook(&h, count_evict, NULL);
+
+    printf("history bytes per turn (arena %d bytes, %d records)\n",
+           SEEDCLAW_HISTORY_ARENA_SIZE, SEEDCLAW_HISTORY_MAX_RECORDS);
+    printf("%4s %6s %9s %10s %8s %9s %8s\n",
+           "turn", "tools", "payload", "bytes_used", "records", "exchanges", "evicted");
+
+    for (int turn = 1; turn <= 40; turn++) {
+        size_t before = history_bytes_used(&h);
+        int evicted_before = s_evicted;
+        size_t payload = add_turn(&h, turn);
+        size_t used = history_bytes_used(&h);
+
+        printf("%4d %6d %9zu %10zu %8d %9d %8d\n", turn, turn % 3, payload, used,
+               history_count(&h), history_exchanges(&h), s_evicted - evicted_before);
+
+        CHECK(used <= SEEDCLAW_HISTORY_ARENA_SIZE, "turn %d: %zu bytes used", turn, used);
+        CHECK(history_count(&h) <= SEEDCLAW_HISTORY_MAX_RECORDS, "turn %d: too many records", turn);
+        if (s_evicted == evicted_before) {
+            // 押し出しが無ければ増えた分は本文と区切りのNULだけ
+            CHECK(used - before >= payload, "turn %d: grew %zu < payload %zu",
+                  turn, used - before, payload);
+        }
+
+        // 最新の往復は丸ごと残っている
+        history_entry_t e;
+        int last_user = -1;
+        for (int i = 0; i < history_count(&h); i++) {
+            if (history_get(&h, i, &e) && e.kind == HISTORY_USER_TEXT) {
+                last_user = i;
+            }
+        }
+        CHECK(last_user >= 0 && history_count(&h) - last_user == 2 + 2 * (turn % 3),
+              "turn %d: latest exchange incomplete", turn);
+    }
+    CHECK(s_evicted > 0, "40 turns never evicted anything");
+    free(h.arena);
+}
+
+// 進行中の往復だけでアリーナが埋まったら押し出さずに NO_MEM を返す
+static void test_current_exchange_kept(void)
+{
+    history_t h;
+    CHECK(history_init(&h, 2048) == ESP_OK, "init");
+    add_turn(&h, 1);
+    add_turn(&h, 2);
+
+    char big[1000];
+    memset(big, 'x', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+
+    CHECK(history_append(&h, HISTORY_USER_TEXT, NULL, NULL, "大きな結果を返すツールを呼ぶ") == ESP_OK,
+          "user text");
+    esp_err_t err = ESP_OK;
+    int appended = 0;
+    char id[32];
+    for (int k = 0; k < 8 && err == ESP_OK; k++) {
+        snprintf(id, sizeof(id), "toolu_big_%d", k);
+        err = history_append(&h, HISTORY_TOOL_USE, id, "web_fetch", "{}");
+        if (err == ESP_OK) {
+            err = history_append(&h, HISTORY_TOOL_RESULT, id, NULL, big);
+        }
+        if (err == ESP_OK) {
+            appended++;
+        }
+    }
+    CHECK(err == ESP_ERR_NO_MEM, "expected ESP_ERR_NO_MEM, got %d", err);
+    CHECK(appended >= 1, "no tool result fit");
+
+    history_entry_t e;
+    CHECK(history_get(&h, 0, &e) && e.kind == HISTORY_USER_TEXT &&
+          strcmp(e.content, "大きな結果を返すツールを呼ぶ") == 0,
+          "in-progress exchange was evicted");
+    CHECK(history_exchanges(&h) == 1, "older exchanges should have been evicted");
+    free(h.arena);
+}
+
+// 1KB を超えるツール結果もJSONのまま残る。アリーナより大きければ NO_MEM で、既存の往復は残る
+static void test_large_result_intact(void)
+{
+    history_t h;
+    CHECK(history_init(&h, SEEDCLAW_HISTORY_ARENA_SIZE) == ESP_OK, "init");
+    add_turn(&h, 1);
+
+    static char result[3200];
+    size_t len = (size_t)snprintf(result, sizeof(result), "{\"samples\":[");
+    for (int i = 0; len < sizeof(result) - 32; i++) {
+        len += (size_t)snprintf(result + len, sizeof(result) - len, "%s%d", i ? "," : "", 1000 + i);
+    }
+    len += (size_t)snprintf(result + len, sizeof(result) - len, "]}");
+
+    CHECK(history_append(&h, HISTORY_USER_TEXT, NULL, NULL, "A0 を連続で読んで") == ESP_OK, "user text");
+    CHECK(history_append(&h, HISTORY_TOOL_USE, "toolu_big", "sensor_history", "{\"pin\":2}") == ESP_OK,
+          "tool_use");
+    CHECK(history_append(&h, HISTORY_TOOL_RESULT, "toolu_big", NULL, result) == ESP_OK, "tool_result");
+
+    history_entry_t e;
+    CHECK(history_get(&h, history_count(&h) - 1, &e) && strcmp(e.content, result) == 0,
+          "%zu-byte result was not stored intact", len);
+
+    static char huge[SEEDCLAW_HISTORY_ARENA_SIZE + 16];
+    memset(huge, 'x', sizeof(huge) - 1);
+    huge[sizeof(huge) - 1] = '\0';
+    int exchanges = history_exchanges(&h);
+    CHECK(history_append(&h, HISTORY_TOOL_RESULT, "toolu_huge", NULL, huge) == ESP_ERR_NO_MEM,
+          "result larger than the arena should be refused");
+    CHECK(history_exchanges(&h) == exchanges, "refusing an oversized record evicted exchanges");
+    free(h.arena);
+}
+
+int main(void)
+{
+    test_bytes_per_turn();
+    test_current_exchange_kept();
+    test_large_result_intact();
+    printf("history: %s\n", s_failed == 0 ? "passed" : "FAILED");
+    return s_failed == 0 ? 0 : 1;
+}